@@ -75,6 +75,9 @@ mpirun -np 2 -x OMP_NUM_THREADS=${OMP_NUM} ${EXE_DIR}/gtest_force_improper
 
 mpirun -np 2 -x OMP_NUM_THREADS=${OMP_NUM} ${EXE_DIR}/gtest_force_mask
 
+#--- single process PM test
+mpirun -np 1 -x OMP_NUM_THREADS=${OMP_NUM} ${EXE_DIR}/gtest_pm_local
+
 #--- file I/O test
 mpirun -np ${MPI_NUM} -x OMP_NUM_THREADS=${OMP_NUM} ${EXE_DIR}/gtest_fileIO
 
@@ -5,10 +5,14 @@
 //***************************************************************************************
 #pragma once
 
+#include <cstdlib>
+#include <cstdint>
 #include <sstream>
 #include <tuple>
-#include <unordered_map>
+#include <vector>
+#include <algorithm>
 #include <stdexcept>
+#include <unordered_map>
 
 #include <particle_simulator.hpp>
 #include <molecular_dynamics_ext.hpp>
@@ -23,22 +27,281 @@
 #include "md_coef_table.hpp"
 
 
+//------ intramolecular pair lists of local particles
+/*
+*  @brief packed (CSR format) lists of mask, angle, dihedral and improper indexed by local particle index.
+*  @details the table is updated after PS::ParticleSystem::exchangeParticle(). the buffers are reused.
+*           each thread makes the lists of a continuous index range into its own buffer,
+*           then the buffers are packed in the order of thread ID.
+*/
+class IntraListTable {
+  private:
+    struct ThreadBuff {
+        //--- lists for one particle (cleared by IntraPair::*Maker)
+        MD_DEFS::MaskList    mask_tmp;
+        MD_DEFS::AngleList   angle_tmp;
+        MD_DEFS::TorsionList dihedral_tmp;
+        MD_DEFS::TorsionList improper_tmp;
+
+        //--- lists for index range [i_begin, i_end)
+        PS::S32              i_begin = 0;
+        MD_DEFS::MaskList    mask;
+        MD_DEFS::AngleList   angle;
+        MD_DEFS::TorsionList dihedral;
+        MD_DEFS::TorsionList improper;
+    };
+    std::vector<ThreadBuff> thread_buff;
+
+    struct Table {
+        //--- offset[i] ~ offset[i+1] is the list of local particle i.
+        std::vector<PS::S64> mask_offset;
+        std::vector<PS::S64> angle_offset;
+        std::vector<PS::S64> dihedral_offset;
+        std::vector<PS::S64> improper_offset;
+
+        MD_DEFS::MaskList    mask;
+        MD_DEFS::AngleList   angle;
+        MD_DEFS::TorsionList dihedral;
+        MD_DEFS::TorsionList improper;
+
+        //--- AtomID of local particle i. -1: unknown (the list is not reused in update()).
+        std::vector<MD_DEFS::ID_type> atom_id;
+    };
+    Table table;
+    Table table_prev;
+
+    //--- local-ID map: AtomID -> local particle index.
+    std::unordered_map<MD_DEFS::ID_type, PS::S32> local_index;
+
+    //--- local index of the particle in table_prev. -1: the list is made by maker in update().
+    std::vector<PS::S32> prev_index;
+    std::vector<PS::S32> made_index;
+
+    template <class T>
+    static MD_DEFS::ListView<T> _get_view(const std::vector<PS::S64> &offset,
+                                          const std::vector<T>       &data,
+                                          const PS::S32               index){
+        if(index < 0 || static_cast<size_t>(index) + 1 >= offset.size()) return MD_DEFS::ListView<T>{};
+        return MD_DEFS::ListView<T>{ data.data() + offset[index],
+                                     data.data() + offset[index + 1] };
+    }
+
+    template <class T>
+    static void _append(std::vector<T> &buff, const std::vector<T> &list){
+        buff.insert(buff.end(), list.begin(), list.end());
+    }
+
+    template <class T>
+    static void _copy(std::vector<T> &list, const std::vector<PS::S64> &offset, const std::vector<T> &data, const PS::S32 index){
+        list.assign(data.begin() + offset[index], data.begin() + offset[index + 1]);
+    }
+
+    template <class T>
+    static void _prefix_sum(std::vector<PS::S64> &offset, std::vector<T> &data){
+        for(size_t i=1; i<offset.size(); ++i){
+            offset[i] += offset[i-1];
+        }
+        data.resize(offset.back());
+    }
+
+    template <class T>
+    static void _pack(const std::vector<T>       &buff,
+                      const std::vector<PS::S64> &offset,
+                      const PS::S32               i_begin,
+                            std::vector<T>       &data){
+        std::copy(buff.begin(), buff.end(), data.begin() + offset[i_begin]);
+    }
+
+    template <class Tpsys>
+    void _set_local_index(Tpsys &psys){
+        const PS::S32 n_local = psys.getNumberOfParticleLocal();
+        this->table.atom_id.resize(n_local);
+        this->local_index.clear();
+        this->local_index.reserve(n_local);
+        for(PS::S32 i=0; i<n_local; ++i){
+            psys[i].setIntraIndex(i);
+            this->table.atom_id[i] = psys[i].getAtomID();
+            this->local_index[psys[i].getAtomID()] = i;
+        }
+    }
+
+    //--- fill_list: void (const PS::S32 i, ThreadBuff&). it makes the lists of local particle i into ThreadBuff::*_tmp.
+    template <class Tfill>
+    void _build(const PS::S32 n_local, Tfill &fill_list){
+        this->table.mask_offset.assign(    n_local + 1, 0);
+        this->table.angle_offset.assign(   n_local + 1, 0);
+        this->table.dihedral_offset.assign(n_local + 1, 0);
+        this->table.improper_offset.assign(n_local + 1, 0);
+
+        #ifdef PARTICLE_SIMULATOR_THREAD_PARALLEL
+            #pragma omp parallel
+        #endif
+        {
+            PS::S32 n_thread = 1;
+            PS::S32 i_thread = 0;
+            #ifdef PARTICLE_SIMULATOR_THREAD_PARALLEL
+                n_thread = omp_get_num_threads();
+                i_thread = omp_get_thread_num();
+                #pragma omp single
+            #endif
+            {
+                if(this->thread_buff.size() < static_cast<size_t>(n_thread)) this->thread_buff.resize(n_thread);
+            }
+
+            auto& buff = this->thread_buff[i_thread];
+            const PS::S32 i_begin = static_cast<PS::S32>( (PS::S64(n_local)*i_thread    )/n_thread );
+            const PS::S32 i_end   = static_cast<PS::S32>( (PS::S64(n_local)*(i_thread+1))/n_thread );
+            buff.i_begin = i_begin;
+            buff.mask.clear();
+            buff.angle.clear();
+            buff.dihedral.clear();
+            buff.improper.clear();
+
+            for(PS::S32 i=i_begin; i<i_end; ++i){
+                fill_list(i, buff);
+
+                this->table.mask_offset[i+1]     = buff.mask_tmp.size();
+                this->table.angle_offset[i+1]    = buff.angle_tmp.size();
+                this->table.dihedral_offset[i+1] = buff.dihedral_tmp.size();
+                this->table.improper_offset[i+1] = buff.improper_tmp.size();
+
+                _append(buff.mask,     buff.mask_tmp);
+                _append(buff.angle,    buff.angle_tmp);
+                _append(buff.dihedral, buff.dihedral_tmp);
+                _append(buff.improper, buff.improper_tmp);
+            }
+
+            #ifdef PARTICLE_SIMULATOR_THREAD_PARALLEL
+                #pragma omp barrier
+                #pragma omp single
+            #endif
+            {
+                _prefix_sum(this->table.mask_offset,     this->table.mask);
+                _prefix_sum(this->table.angle_offset,    this->table.angle);
+                _prefix_sum(this->table.dihedral_offset, this->table.dihedral);
+                _prefix_sum(this->table.improper_offset, this->table.improper);
+            }
+
+            _pack(buff.mask,     this->table.mask_offset,     i_begin, this->table.mask);
+            _pack(buff.angle,    this->table.angle_offset,    i_begin, this->table.angle);
+            _pack(buff.dihedral, this->table.dihedral_offset, i_begin, this->table.dihedral);
+            _pack(buff.improper, this->table.improper_offset, i_begin, this->table.improper);
+        }
+    }
+
+    template <class Tmaker>
+    struct MakerFill {
+        Tmaker &maker;
+        void operator () (const PS::S32 i, ThreadBuff &buff) const {
+            maker(i, buff.mask_tmp, buff.angle_tmp, buff.dihedral_tmp, buff.improper_tmp);
+        }
+    };
+
+    template <class Tmaker>
+    struct UpdateFill {
+        const Table                &prev;
+        const std::vector<PS::S32> &prev_index;
+        Tmaker                     &maker;
+        void operator () (const PS::S32 i, ThreadBuff &buff) const {
+            const PS::S32 k = prev_index[i];
+            if(k < 0){
+                maker(i, buff.mask_tmp, buff.angle_tmp, buff.dihedral_tmp, buff.improper_tmp);
+            } else {
+                _copy(buff.mask_tmp,     prev.mask_offset,     prev.mask,     k);
+                _copy(buff.angle_tmp,    prev.angle_offset,    prev.angle,    k);
+                _copy(buff.dihedral_tmp, prev.dihedral_offset, prev.dihedral, k);
+                _copy(buff.improper_tmp, prev.improper_offset, prev.improper, k);
+            }
+        }
+    };
+
+  public:
+    MD_DEFS::MaskView    mask_list(    const PS::S32 index) const { return _get_view(this->table.mask_offset,     this->table.mask,     index); }
+    MD_DEFS::AngleView   angle_list(   const PS::S32 index) const { return _get_view(this->table.angle_offset,    this->table.angle,    index); }
+    MD_DEFS::TorsionView dihedral_list(const PS::S32 index) const { return _get_view(this->table.dihedral_offset, this->table.dihedral, index); }
+    MD_DEFS::TorsionView improper_list(const PS::S32 index) const { return _get_view(this->table.improper_offset, this->table.improper, index); }
+
+    //--- local indices of the particles whose lists are made by maker in the last update().
+    const std::vector<PS::S32>& made_list() const { return this->made_index; }
+
+    //--- local index of the particle. -1: the particle is not in this process.
+    PS::S32 find_local_index(const MD_DEFS::ID_type id) const {
+        const auto itr = this->local_index.find(id);
+        if(itr == this->local_index.end()) return -1;
+        return itr->second;
+    }
+
+    /*
+    *  @brief rebuild the table for local particles.
+    *  @param[in] maker  functor: void (const PS::S32 i, MaskList&, AngleList&, TorsionList& dihedral, TorsionList& improper).
+    *                    it makes the lists of local particle i into the given (cleared) containers.
+    */
+    template <class Tpsys, class Tmaker>
+    void rebuild(Tpsys &psys, Tmaker &maker){
+        const PS::S32 n_local = psys.getNumberOfParticleLocal();
+        this->_set_local_index(psys);
+
+        MakerFill<Tmaker> fill{maker};
+        this->_build(n_local, fill);
+    }
+
+    /*
+    *  @brief update the table after PS::ParticleSystem::exchangeParticle().
+    *  @details the particle staying in the process is found by its intra_index (the index in previous table)
+    *           pointing the entry with the same AtomID. its lists are copied from the previous table.
+    *           the maker is called only for the other (arrived) particles. see made_list().
+    *           the intra_index of local particles and the local-ID map are updated to the local index.
+    *  @param[in] maker  same as rebuild().
+    */
+    template <class Tpsys, class Tmaker>
+    void update(Tpsys &psys, Tmaker &maker){
+        const PS::S32 n_local = psys.getNumberOfParticleLocal();
+
+        std::swap(this->table, this->table_prev);
+        const PS::S32 n_prev = this->table_prev.atom_id.size();
+
+        this->prev_index.resize(n_local);
+        #ifdef PARTICLE_SIMULATOR_THREAD_PARALLEL
+            #pragma omp parallel for
+        #endif
+        for(PS::S32 i=0; i<n_local; ++i){
+            const PS::S32          k  = psys[i].getIntraIndex();
+            const MD_DEFS::ID_type id = psys[i].getAtomID();
+            this->prev_index[i] = (0 <= k && k < n_prev && this->table_prev.atom_id[k] == id) ? k : -1;
+        }
+
+        this->_set_local_index(psys);
+
+        this->made_index.clear();
+        for(PS::S32 i=0; i<n_local; ++i){
+            if(this->prev_index[i] < 0) this->made_index.push_back(i);
+        }
+
+        UpdateFill<Tmaker> fill{this->table_prev, this->prev_index, maker};
+        this->_build(n_local, fill);
+    }
+};
+
 //------ connection
 class AtomIntraMask :
   public AtomID {
-  private:
-    //--- static data for intra mask
-    static std::unordered_map< MD_DEFS::ID_type,
-                               MD_DEFS::MaskList > intra_mask_table;
+  protected:
+    PS::S32 intra_index = -1;   // local particle index in intra_list_table. -1: the list is not made.
+
+    //--- static data for intra pair lists
+    static IntraListTable intra_list_table;
 
   public:
     template <class Tptcl>
     void copyAtomIntraMask(const Tptcl &fp){
         this->copyAtomID(fp);
+        this->intra_index = fp.getIntraIndex();
     }
 
-    MD_DEFS::MaskList&       mask_list()       { return this->intra_mask_table[this->getId()]; }
-    const MD_DEFS::MaskList& mask_list() const { return this->intra_mask_table[this->getId()]; }
+    inline PS::S32 getIntraIndex() const { return this->intra_index; }
+    inline void    setIntraIndex(const PS::S32 index){ this->intra_index = index; }
+
+    MD_DEFS::MaskView mask_list() const { return this->intra_list_table.mask_list(this->intra_index); }
 
     inline MD_DEFS::IntraMask find_mask(const MD_DEFS::ID_type id_j) const {
         return MD_DEFS::find_mask(this->mask_list(), id_j);
@@ -47,16 +310,112 @@ class AtomIntraMask :
         return MD_DEFS::isFind_mask(this->mask_list(), id_j);
     }
 
-    static void clear_mask_table(){
-        intra_mask_table.clear();
+    //--- local index of the atom by the local-ID map. -1: the atom is not in this process.
+    static PS::S32 findLocalIndex(const MD_DEFS::ID_type id){
+        return intra_list_table.find_local_index(id);
     }
-    static void reserve_mask_table(const PS::S64 n, const PS::F32 factor = 0.7){
-        intra_mask_table.max_load_factor(factor);
-        intra_mask_table.reserve(n);
+    //--- mask list of the local atom. empty for the atom in other process.
+    static MD_DEFS::MaskView findMaskList(const MD_DEFS::ID_type id){
+        return intra_list_table.mask_list( intra_list_table.find_local_index(id) );
+    }
+
+    //--- rebuild the intra pair lists for local particles. see IntraListTable::rebuild().
+    template <class Tpsys, class Tmaker>
+    static void rebuild_intra_list_table(Tpsys &psys, Tmaker &maker){
+        intra_list_table.rebuild(psys, maker);
+    }
+
+    //--- update the intra pair lists after exchange of particles. see IntraListTable::update().
+    template <class Tpsys, class Tmaker>
+    static void update_intra_list_table(Tpsys &psys, Tmaker &maker){
+        intra_list_table.update(psys, maker);
+    }
+    static const std::vector<PS::S32>& made_intra_list(){
+        return intra_list_table.made_list();
+    }
+};
+IntraListTable AtomIntraMask::intra_list_table;
+
+//------ intramolecular mask encoded into bits (for inline evaluation in PP kernel)
+class AtomMaskBits {
+  protected:
+    PS::U64      mask_bits =  0;   // 2 bits mask level for each relative atom ID. see MD_DEFS::mask_bits_range.
+    std::int16_t mask_type = -1;   // index of MODEL::coef_table.mask_scale. -1: the mask is not encoded.
+
+  public:
+    inline PS::U64 getMaskBits()  const { return this->mask_bits; }
+    inline PS::S32 getMaskType()  const { return this->mask_type; }
+    inline bool    isMaskInline() const { return (this->mask_type >= 0); }
+
+    template <class Tptcl>
+    void copyAtomMaskBits(const Tptcl &fp){
+        this->mask_bits = fp.getMaskBits();
+        this->mask_type = static_cast<std::int16_t>(fp.getMaskType());
+    }
+
+    /*
+    *  @brief  encode the mask list into bits.
+    *  @return "false" means the mask list cannot be encoded (relative atom ID or mask level is out of range).
+    */
+    bool setMaskBits(const MolName           &mol_type,
+                     const MD_DEFS::ID_type   id_i,
+                     const MD_DEFS::MaskView &mask_list){
+        this->mask_bits = 0;
+        this->mask_type = -1;
+
+        PS::U64 bits = 0;
+        for(const auto& mask : mask_list){
+            const PS::S64 d_id  = mask.getId() - id_i;
+            const PS::S32 level = MODEL::coef_table.getMaskLevel(mol_type, mask);
+            if(d_id == 0 || std::abs(d_id) > MD_DEFS::mask_bits_range || level <= 0) return false;
+
+            bits |= static_cast<PS::U64>(level) << (2*MD_DEFS::mask_bits_slot(d_id));
+        }
+
+        this->mask_bits = bits;
+        this->mask_type = static_cast<std::int16_t>(mol_type);
+        return true;
+    }
+};
+
+//------ site index for 3-site water kernel (molecule-pair interaction in PP kernel)
+class AtomWaterSite {
+  protected:
+    std::int8_t water_site = -1;   // local ID in the water molecule. -1: the atom is not treated by the water kernel.
+
+  public:
+    inline PS::S32 getWaterSite() const { return this->water_site; }
+    inline bool    isWaterSite()  const { return (this->water_site >= 0); }
+
+    template <class Tptcl>
+    void copyAtomWaterSite(const Tptcl &fp){
+        this->water_site = static_cast<std::int8_t>(fp.getWaterSite());
+    }
+
+    /*
+    *  @brief  set the site index from the mask list.
+    *  @return "false" means the atom is not treated by the water kernel.
+    *  @details all other atoms in the molecule must be found in mask list with the scaling factor 0.0.
+    *           the atom ID in molecule is consecutive, then the 1st site has the minimum ID.
+    */
+    bool setWaterSite(const MolName           &mol_type,
+                      const MD_DEFS::ID_type   id_i,
+                      const MD_DEFS::MaskView &mask_list){
+        this->water_site = -1;
+        if( !MODEL::coef_table.isWaterKernel(mol_type) ) return false;
+        if( mask_list.size() != 2 ) return false;
+
+        MD_DEFS::ID_type id_first = id_i;
+        for(const auto& mask : mask_list){
+            if( mask.scale_LJ != 0.0 || mask.scale_coulomb != 0.0 ) return false;
+            if( std::abs(mask.getId() - id_i) > 2 ) return false;
+            id_first = std::min(id_first, mask.getId());
+        }
+
+        this->water_site = static_cast<std::int8_t>(id_i - id_first);
+        return true;
     }
 };
-std::unordered_map< MD_DEFS::ID_type,
-                    MD_DEFS::MaskList > AtomIntraMask::intra_mask_table;
 
 class AtomConnect :
   public AtomIntraMask {
@@ -78,43 +437,11 @@ class AtomConnect :
         }
     }
 
-  private:
-    //--- static data for intra pair table
-    static std::unordered_map< MD_DEFS::ID_type,
-                               std::tuple<MD_DEFS::AngleList,
-                                          MD_DEFS::TorsionList,
-                                          MD_DEFS::TorsionList> > intra_pair_table;
-
   public:
-    MD_DEFS::AngleList&   angle_list()   { return std::get<0>(this->intra_pair_table[this->getId()]); }
-    MD_DEFS::TorsionList& dihedral_list(){ return std::get<1>(this->intra_pair_table[this->getId()]); }
-    MD_DEFS::TorsionList& improper_list(){ return std::get<2>(this->intra_pair_table[this->getId()]); }
-
-    const MD_DEFS::AngleList&   angle_list()    const { return std::get<0>(this->intra_pair_table[this->getId()]); }
-    const MD_DEFS::TorsionList& dihedral_list() const { return std::get<1>(this->intra_pair_table[this->getId()]); }
-    const MD_DEFS::TorsionList& improper_list() const { return std::get<2>(this->intra_pair_table[this->getId()]); }
-
-    void clear_intra_list(){
-        this->mask_list().clear();
-        this->angle_list().clear();
-        this->dihedral_list().clear();
-        this->improper_list().clear();
-    }
-
-    static void clear_intra_pair_table(){
-        intra_pair_table.clear();
-        AtomIntraMask::clear_mask_table();
-    }
-    static void reserve_intra_pair_table(const PS::S64 n, const PS::F32 factor = 0.7){
-        intra_pair_table.max_load_factor(factor);
-        intra_pair_table.reserve(n);
-        AtomIntraMask::reserve_mask_table(n, factor);
-    }
+    MD_DEFS::AngleView   angle_list()    const { return this->intra_list_table.angle_list(   this->intra_index); }
+    MD_DEFS::TorsionView dihedral_list() const { return this->intra_list_table.dihedral_list(this->intra_index); }
+    MD_DEFS::TorsionView improper_list() const { return this->intra_list_table.improper_list(this->intra_index); }
 };
-std::unordered_map< MD_DEFS::ID_type,
-                    std::tuple<MD_DEFS::AngleList,
-                               MD_DEFS::TorsionList,
-                               MD_DEFS::TorsionList> > AtomConnect::intra_pair_table;
 
 
 //--- derived force class
@@ -144,7 +471,9 @@ class ForceInter :
 template <class Tf>
 class Force_FP :
   public ForceInter<Tf>,
-  public ForceIntra<Tf> {
+  public ForceIntra<Tf>,
+  public ForceLongRange<Tf>,
+  public ForceConstraint<Tf> {
   public:
 
     //--- copy results of calculated force
@@ -166,6 +495,7 @@ class Force_FP :
     void clear() {
         this->clearForceInter();
         this->clearForceIntra();
+        this->clearForceLongRange();
     }
 };
 
@@ -175,28 +505,46 @@ class Force_FP :
 //------ This class is based on base classes.
 class Atom_FP :
   public AtomType,
+  public AtomTemplateIndex,
   public AtomConnect,
+  public AtomMaskBits,
+  public AtomWaterSite,
   public AtomPos   <PS::F32>,
+  public AtomPosBuff<PS::F32>,
   public AtomVel   <PS::F32>,
   public AtomCharge<PS::F32>,
   public AtomVDW   <PS::F32>,
+  public AtomVDWType,
   public Force_FP  <PS::F32> {
   public:
 
     //--- output interaction result
+    //------ the long-range part of coulomb is not included in getForce() (kicked separately, see ATOM_MOVE::kick()).
     inline PS::F32vec getForceInter() const {
         return    this->getForceLJ()
                 + this->getFieldCoulomb()*this->getCharge();
     }
+    inline PS::F32vec getForceLongRange() const {
+        return this->getFieldLongRange()*this->getCharge();
+    }
     inline PS::F32vec getForce() const {
         return   this->getForceIntra()
                + this->getForceInter();
     }
     inline PS::F32vec getVirial() const {
-        const PS::F32 virial_coulomb = 1.0/3.0*this->getPotCoulomb()*this->getCharge();
+        PS::F32vec virial_coulomb;
+        if( this->isVirialPairwise() ){
+            virial_coulomb = ( this->getVirialCoulomb()
+                             + this->getVirialLongRange() )*this->getCharge();
+        } else {
+            const PS::F32 v = 1.0/3.0*( this->getPotCoulomb()
+                                      + this->getPotLongRange() )*this->getCharge();
+            virial_coulomb = PS::F32vec{v, v, v};
+        }
         return   this->getVirialIntra()
+               + this->getVirialConstraint()
                + this->getVirialLJ()
-               + PS::F32vec{virial_coulomb, virial_coulomb, virial_coulomb};
+               + virial_coulomb;
     }
 
     //--- copy model property from molecular model template (using FP class)
@@ -212,19 +560,36 @@ class Atom_FP :
         }
         *this = tmp;
 
-        //--- id
+        //--- id (AtomID in template is the index in template)
         this->setAtomID(atom_id_shift + tmp.getAtomID());
         this->setMolID(mol_id);
+        this->setTemplateIndex(tmp.getAtomID());
 
         //--- connection pair
         this->shift_pair_ID(atom_id_shift);
     }
 
+    //--- encode intramolecular mask list into bits (for inline evaluation in PP kernel)
+    bool makeMaskBits(){
+        return this->setMaskBits(this->getMolType(), this->getAtomID(), this->mask_list());
+    }
+
+    //--- set site index for the water kernel (must be called after mask list is made)
+    //------ the own molecule is excluded without the mask in the water kernel, then the mask must be encoded in bits.
+    bool makeWaterSite(){
+        if( !this->isMaskInline() ){
+            this->water_site = -1;
+            return false;
+        }
+        return this->setWaterSite(this->getMolType(), this->getAtomID(), this->mask_list());
+    }
+
     std::string str() const {
         std::ostringstream oss;
 
         oss << "    AtomID   : " << this->getAtomID()   << "\n";
         oss << "    MolID    : " << this->getMolID()    << "\n";
+        oss << "    TmpIndex : " << this->getTemplateIndex() << "\n";
         oss << "    AtomType : " << this->getAtomType() << "\n";
         oss << "    MolType  : " << this->getMolType()  << "\n";
         oss << "    Pos      : ("  << this->getPos().x
@@ -238,6 +603,7 @@ class Atom_FP :
             << "  | real value: " << std::setw(12) << this->getVDW_D()*this->getVDW_D()    << " [kcal/mol]" << "\n";
         oss << "    VDW_R    : "  << std::setw(12) << this->getVDW_R()
             << "  | real value: " << std::setw(12) << this->getVDW_R()*2.0                 << " [angstrom]" << "\n";
+        oss << "    VDWType  : " << this->getVDWType() << "\n";
 
         oss << "    bond: n=" << this->bond.size() << "\n";
         oss << "       id= ";
@@ -282,12 +648,15 @@ std::ostream& operator << (std::ostream &s, const Atom_FP &atom){
 //------ They are the subset of Full Particle class.
 //------ They are based on base classes.
 
+//------ mask_type, water_site and vdw_type are packed into the tail of mask_bits.
+//------ the intra pair lists are found by the local-ID map (EP_inter is used for local atoms as EPI).
 class EP_inter :
-  public AtomIntraMask,
-  public AtomType,
+  public AtomID,
+  public AtomMaskBits,
+  public AtomWaterSite,
+  public AtomVDWType,
   public AtomPos   <PS::F32>,
-  public AtomCharge<PS::F32>,
-  public AtomVDW   <PS::F32> {
+  public AtomCharge<PS::F32> {
   private:
     static PS::F32 r_cut_LJ;
     static PS::F32 r_cut_coulomb;
@@ -318,13 +687,18 @@ class EP_inter :
     static PS::F32 getRcut_LJ()      { return EP_inter::r_cut_LJ; }
     static PS::F32 getRcut_coulomb() { return EP_inter::r_cut_coulomb; }
 
+    inline MD_DEFS::IntraMask find_mask(const MD_DEFS::ID_type id_j) const {
+        return MD_DEFS::find_mask(AtomIntraMask::findMaskList(this->getAtomID()), id_j);
+    }
+
     template <class T>
     void copyFromFP(const T &fp){
-        this->copyAtomIntraMask(fp);
-        this->copyAtomType(fp);
+        this->copyAtomID(fp);
+        this->copyAtomMaskBits(fp);
+        this->copyAtomWaterSite(fp);
+        this->copyAtomVDWType(fp);
         this->copyAtomPos(fp);
         this->copyAtomCharge(fp);
-        this->copyAtomVDW(fp);
     }
 };
 PS::F32 EP_inter::r_cut_LJ      = 0.0;
@@ -39,6 +39,16 @@ public:
     }
 };
 
+//------ atom index in molecular model template (FP only). the ID shift of molecule is AtomID - template index.
+class AtomTemplateIndex{
+protected:
+    PS::S32 template_index = -1;
+
+public:
+    void setTemplateIndex(const PS::S32 index){ this->template_index = index; }
+    inline PS::S32 getTemplateIndex() const { return this->template_index; }
+};
+
 //------ sub identifier
 class AtomType{
 protected:
@@ -85,6 +95,17 @@ public:
     }
 };
 
+//------ original position while the position is replaced by the center of molecule in particle exchange
+template <class Tf>
+class AtomPosBuff{
+protected:
+    PS::Vector3<Tf> pos_buff = 0.0;
+
+public:
+    void setPosBuff(const PS::Vector3<Tf> &pos){ this->pos_buff = pos; }
+    inline PS::Vector3<Tf> getPosBuff() const { return this->pos_buff; }
+};
+
 //------ mass & velocity
 template <class Tf>
 class AtomVel{
@@ -149,6 +170,22 @@ public:
     }
 };
 
+//------ LJ type index (index of MODEL::coef_table.vdw_matrix)
+class AtomVDWType{
+protected:
+    PS::S32 vdw_type = -1;  // illigal value
+
+public:
+
+    void setVDWType(const PS::S32 &type){ this->vdw_type = type; }
+    inline PS::S32 getVDWType() const { return this->vdw_type; }
+
+    template<class Tptcl>
+    void copyAtomVDWType(const Tptcl &fp){
+        this->vdw_type = fp.getVDWType();
+    }
+};
+
 
 //--- Force class -----------------------------------------------------------------------
 //------ This class has the result of force. (used as temporary data)
@@ -190,31 +227,40 @@ public:
 };
 
 //------ coulomb interaction
+//------    virial_coulomb is the pairwise virial of the field (multiply the charge of atom i).
+//------    it is used instead of pot/3 when the coulomb potential is not homogeneous (DSF or SF_TREE mode).
 template <class Tf>
 class ForceCoulomb {
 protected:
-    PS::Vector3<Tf> field_coulomb = 0.0;
-    Tf              pot_coulomb   = 0.0;
+    PS::Vector3<Tf> field_coulomb  = 0.0;
+    PS::Vector3<Tf> virial_coulomb = 0.0;
+    Tf              pot_coulomb    = 0.0;
+
+    static bool virial_pairwise;
 
 public:
     void clearForceCoulomb(){
-        field_coulomb = 0.0;
-          pot_coulomb = 0.0;
+        field_coulomb  = 0.0;
+        virial_coulomb = 0.0;
+          pot_coulomb  = 0.0;
     }
     void clear(){ this->clearForceCoulomb(); }
 
-    inline PS::Vector3<Tf> getFieldCoulomb() const { return this->field_coulomb; }
-    inline Tf              getPotCoulomb()   const { return this->pot_coulomb;   }
-    inline void addFieldCoulomb(const PS::Vector3<Tf> &f){ this->field_coulomb += f; }
-    inline void addPotCoulomb(  const Tf              &p){ this->pot_coulomb   += p; }
+    inline PS::Vector3<Tf> getFieldCoulomb()  const { return this->field_coulomb;  }
+    inline PS::Vector3<Tf> getVirialCoulomb() const { return this->virial_coulomb; }
+    inline Tf              getPotCoulomb()    const { return this->pot_coulomb;    }
+    inline void addFieldCoulomb( const PS::Vector3<Tf> &f){ this->field_coulomb  += f; }
+    inline void addVirialCoulomb(const PS::Vector3<Tf> &v){ this->virial_coulomb += v; }
+    inline void addPotCoulomb(   const Tf              &p){ this->pot_coulomb    += p; }
 
-    //--- interface for ParticleMesh wrapper
-    inline void addFieldParticleMesh(const PS::Vector3<Tf> &f){ this->field_coulomb += f; }
-    inline void addPotParticleMesh(  const Tf              &p){ this->pot_coulomb   += p; }
+    //--- false: virial = pot/3 (PM mode), true: the pairwise virial is used.
+    static void setVirialPairwise(const bool flag){ virial_pairwise = flag; }
+    static bool isVirialPairwise(){ return virial_pairwise; }
 
     template <class T>
     void copyForceCoulomb(const T &f){
         this->field_coulomb  = f.getFieldCoulomb();
+        this->virial_coulomb = f.getVirialCoulomb();
         this->pot_coulomb    = f.getPotCoulomb();
     }
     template <class Tf_rhs>
@@ -223,6 +269,36 @@ public:
     }
 };
 
+template <class Tf>
+bool ForceCoulomb<Tf>::virial_pairwise = false;
+
+//------ long-range part of coulomb interaction (PM or long-range tree).
+//------    evaluated in the separated stage, it may be kept for several steps (see CalcForce::update_long_range()).
+template <class Tf>
+class ForceLongRange {
+protected:
+    PS::Vector3<Tf> field_LR  = 0.0;
+    PS::Vector3<Tf> virial_LR = 0.0;
+    Tf              pot_LR    = 0.0;
+
+public:
+    void clearForceLongRange(){
+        this->field_LR  = 0.0;
+        this->virial_LR = 0.0;
+        this->pot_LR    = 0.0;
+    }
+    void clear(){ this->clearForceLongRange(); }
+
+    inline PS::Vector3<Tf> getFieldLongRange()  const { return this->field_LR;  }
+    inline PS::Vector3<Tf> getVirialLongRange() const { return this->virial_LR; }
+    inline Tf              getPotLongRange()    const { return this->pot_LR;    }
+    inline void addVirialLongRange(const PS::Vector3<Tf> &v){ this->virial_LR += v; }
+
+    //--- interface for ParticleMesh wrapper
+    inline void addFieldParticleMesh(const PS::Vector3<Tf> &f){ this->field_LR += f; }
+    inline void addPotParticleMesh(  const Tf              &p){ this->pot_LR   += p; }
+};
+
 //--- Intramoleecular interaction
 template <class Tf>
 class ForceIntra {
@@ -254,6 +330,14 @@ public:
     inline void addPotAngle(   const Tf &p){ this->pot_angle   += p; }
     inline void addPotTorsion( const Tf &p){ this->pot_torsion += p; }
 
+    template <class T>
+    void accumForceIntra(const T &f){
+        this->force_intra  += f.getForceIntra();
+        this->virial_intra += f.getVirialIntra();
+        this->pot_bond     += f.getPotBond();
+        this->pot_angle    += f.getPotAngle();
+        this->pot_torsion  += f.getPotTorsion();
+    }
     template <class T>
     void copyForceIntra(const T &f){
         this->force_intra  = f.getForceIntra();
@@ -267,3 +351,16 @@ public:
         this->copyForceIntra(f);
     }
 };
+
+//--- constraint force (see CONSTRAINT::Solver). not cleared with the force, it is managed by the solver.
+template <class Tf>
+class ForceConstraint {
+protected:
+    PS::Vector3<Tf> virial_constraint = 0.0;
+
+public:
+    void clearVirialConstraint(){ this->virial_constraint = 0.0; }
+
+    inline PS::Vector3<Tf> getVirialConstraint() const { return this->virial_constraint; }
+    inline void addVirialConstraint(const PS::Vector3<Tf> &v){ this->virial_constraint += v; }
+};
@@ -0,0 +1,1214 @@
+//***************************************************************************************
+//  This is constraint solver for rigid bonds.
+//    SETTLE for 3-site rigid water, SHAKE/RATTLE or LINCS for general bonds,
+//    and rigid body integrator for the whole molecule.
+//***************************************************************************************
+#pragma once
+
+#include <cmath>
+#include <map>
+#include <tuple>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <algorithm>
+#include <stdexcept>
+
+#include <particle_simulator.hpp>
+#include <molecular_dynamics_ext.hpp>
+
+#include "md_enum.hpp"
+#include "md_coef_table.hpp"
+#include "ff_inter_force_func.hpp"
+
+
+namespace CONSTRAINT {
+
+    /**
+    * @brief distance constraint between atom i and j (index in the model template).
+    */
+    struct Pair {
+        PS::S32 i, j;
+        PS::F64 d2;     // squared length [angstrom^2]
+    };
+
+    /**
+    * @brief parameter of analytic SETTLE for 3-site rigid water (O, H, H).
+    * @details ref: S. Miyamoto and P. A. Kollman, J. Comput. Chem., 13, 952 (1992).
+    *          ra, rb, rc are the canonical position of O and H measured from the center of mass.
+    */
+    struct SettleParam {
+        PS::S32 i_O  = -1;
+        PS::S32 i_H1 = -1;
+        PS::S32 i_H2 = -1;
+        PS::F64 wh   = 0.0;    // m_H/(m_O + 2*m_H)
+        PS::F64 ra   = 0.0;
+        PS::F64 rb   = 0.0;
+        PS::F64 rc   = 0.0;
+    };
+
+    /**
+    * @brief coupling of constraint c and d sharing the atom (for LINCS).
+    * @details sign = (+1 or -1 of the atom in c)*(+1 or -1 of the atom in d). +1: Pair::i, -1: Pair::j.
+    */
+    struct LincsCouple {
+        PS::S32 d;
+        PS::S32 atom;
+        PS::F64 sign;
+    };
+
+    /**
+    * @brief rigid body parameter of a model template.
+    * @details body[i] is the atom position in principal axes frame around the center of mass.
+    */
+    struct RigidParam {
+        std::vector<PS::F64vec> body;
+        PS::F64                 inertia[3] = {0.0, 0.0, 0.0};    // principal moments
+        PS::F64                 moment2[3] = {0.0, 0.0, 0.0};    // sum of m*body^2 for each axis
+        PS::F64                 mass       = 0.0;
+    };
+
+    /**
+    * @brief constraints of a model template.
+    */
+    struct ModelConstraint {
+        PS::S32              n_atom = 0;
+        std::vector<PS::F64> mass;     // mass in the model template (after HMR)
+        std::vector<Pair>    pair;
+        bool              settle = false;
+        SettleParam       settle_param;
+
+        //--- LINCS setting. couple[couple_offset[c]] ~ couple[couple_offset[c+1]] are coupled with constraint c.
+        MODEL::CoefConstraint    coef;
+        std::vector<PS::S32>     couple_offset;
+        std::vector<LincsCouple> couple;
+
+        //--- rigid body setting (ConstraintSolver::RIGID)
+        bool       rigid = false;
+        RigidParam rigid_param;
+
+        //--- number of removed degree of freedom
+        PS::S64 n_dof_removed() const {
+            if(this->rigid) return 3*this->n_atom - 6;
+            return this->pair.size();
+        }
+        bool isActive() const { return this->rigid || this->pair.size() > 0; }
+    };
+
+    namespace _Impl {
+
+        //--- work space of LINCS for one molecule
+        struct LincsBuff {
+            std::vector<PS::F64vec> dir;     // direction of constraint
+            std::vector<PS::F64>    s;       // 1/sqrt(1/m_i + 1/m_j)
+            std::vector<PS::F64>    coef;    // coupling matrix A (sparse, same layout of ModelConstraint::couple)
+            std::vector<PS::F64>    rhs, sol, tmp;
+
+            void resize(const size_t n_pair, const size_t n_couple){
+                this->dir.resize(n_pair);
+                this->s.resize(n_pair);
+                this->rhs.resize(n_pair);
+                this->sol.resize(n_pair);
+                this->tmp.resize(n_pair);
+                this->coef.resize(n_couple);
+            }
+        };
+
+        /**
+        * @brief make the direction and the coupling matrix A = I - S*B*M^-1*B^T*S from the structure x.
+        */
+        inline void lincsSetMatrix(const ModelConstraint &mc,
+                                   const PS::F64         *m_inv,
+                                   const PS::F64vec      *x,
+                                         LincsBuff       &buff){
+            const PS::S32 n_pair = mc.pair.size();
+            buff.resize(n_pair, mc.couple.size());
+            for(PS::S32 c=0; c<n_pair; ++c){
+                const auto&      p = mc.pair[c];
+                const PS::F64vec r = x[p.i] - x[p.j];
+                buff.dir[c] = r*(1.0/std::sqrt(r*r));
+                buff.s[c]   = 1.0/std::sqrt(m_inv[p.i] + m_inv[p.j]);
+            }
+            for(PS::S32 c=0; c<n_pair; ++c){
+                for(PS::S32 k=mc.couple_offset[c]; k<mc.couple_offset[c+1]; ++k){
+                    const auto& cp = mc.couple[k];
+                    buff.coef[k] = -cp.sign*m_inv[cp.atom]*buff.s[c]*buff.s[cp.d]*(buff.dir[c]*buff.dir[cp.d]);
+                }
+            }
+        }
+
+        /**
+        * @brief solve (I - A)*sol = rhs by the expansion I + A + A^2 + ..., then x -= M^-1*B^T*S*sol.
+        */
+        inline void lincsSolve(const ModelConstraint &mc,
+                               const PS::F64         *m_inv,
+                                     LincsBuff       &buff,
+                                     PS::F64vec      *x   ){
+            const PS::S32 n_pair = mc.pair.size();
+            buff.sol = buff.rhs;
+            for(PS::S32 order=0; order<mc.coef.lincs_order; ++order){
+                for(PS::S32 c=0; c<n_pair; ++c){
+                    PS::F64 sum = 0.0;
+                    for(PS::S32 k=mc.couple_offset[c]; k<mc.couple_offset[c+1]; ++k){
+                        sum += buff.coef[k]*buff.rhs[ mc.couple[k].d ];
+                    }
+                    buff.tmp[c] = sum;
+                }
+                std::swap(buff.rhs, buff.tmp);
+                for(PS::S32 c=0; c<n_pair; ++c){
+                    buff.sol[c] += buff.rhs[c];
+                }
+            }
+            for(PS::S32 c=0; c<n_pair; ++c){
+                const auto&      p = mc.pair[c];
+                const PS::F64vec f = (buff.s[c]*buff.sol[c])*buff.dir[c];
+                x[p.i] -= m_inv[p.i]*f;
+                x[p.j] += m_inv[p.j]*f;
+            }
+        }
+
+        /**
+        * @brief LINCS for position.
+        * @details ref: B. Hess, et al., J. Comput. Chem., 18, 1463 (1997).
+        *          the projection is done along the reference structure x_ref,
+        *          then "lincs_iter" times of correction for rotational lengthening.
+        * @return "false" means the result is not finite.
+        */
+        inline bool lincsPosition(const ModelConstraint &mc,
+                                  const PS::F64         *m_inv,
+                                  const PS::F64vec      *x_ref,
+                                        PS::F64vec      *x,
+                                        LincsBuff       &buff ){
+            const PS::S32 n_pair = mc.pair.size();
+            lincsSetMatrix(mc, m_inv, x_ref, buff);
+
+            for(PS::S32 c=0; c<n_pair; ++c){
+                const auto& p = mc.pair[c];
+                buff.rhs[c] = buff.s[c]*(buff.dir[c]*(x[p.i] - x[p.j]) - std::sqrt(p.d2));
+            }
+            lincsSolve(mc, m_inv, buff, x);
+
+            for(PS::S32 iter=0; iter<mc.coef.lincs_iter; ++iter){
+                for(PS::S32 c=0; c<n_pair; ++c){
+                    //--- keep the perpendicular part, the projection is corrected to satisfy the length.
+                    const auto&      p    = mc.pair[c];
+                    const PS::F64vec r    = x[p.i] - x[p.j];
+                    const PS::F64    proj = buff.dir[c]*r;
+                    const PS::F64    p2   = std::max(p.d2 - (r*r - proj*proj), 0.0);
+                    buff.rhs[c] = buff.s[c]*(proj - std::sqrt(p2));
+                }
+                lincsSolve(mc, m_inv, buff, x);
+            }
+
+            for(PS::S32 c=0; c<n_pair; ++c){
+                const PS::F64vec r = x[mc.pair[c].i] - x[mc.pair[c].j];
+                if( !std::isfinite(r*r) ) return false;
+            }
+            return true;
+        }
+
+        /**
+        * @brief LINCS for velocity. the relative velocity along the constraint is removed.
+        * @details the projection is repeated "lincs_iter" times with the updated residual.
+        */
+        inline bool lincsVelocity(const ModelConstraint &mc,
+                                  const PS::F64         *m_inv,
+                                  const PS::F64vec      *x,
+                                        PS::F64vec      *v,
+                                        LincsBuff       &buff ){
+            const PS::S32 n_pair = mc.pair.size();
+            lincsSetMatrix(mc, m_inv, x, buff);
+
+            for(PS::S32 iter=0; iter<=mc.coef.lincs_iter; ++iter){
+                for(PS::S32 c=0; c<n_pair; ++c){
+                    const auto& p = mc.pair[c];
+                    buff.rhs[c] = buff.s[c]*(buff.dir[c]*(v[p.i] - v[p.j]));
+                }
+                lincsSolve(mc, m_inv, buff, v);
+            }
+
+            for(PS::S32 c=0; c<n_pair; ++c){
+                const PS::F64vec dv = v[mc.pair[c].i] - v[mc.pair[c].j];
+                if( !std::isfinite(dv*dv) ) return false;
+            }
+            return true;
+        }
+
+        /**
+        * @brief SHAKE. the position x is corrected along the reference vector x_ref.
+        * @return number of iteration. -1: not converged.
+        */
+        inline PS::S32 shakePosition(const std::vector<Pair>    &pair,
+                                     const PS::F64              *m_inv,
+                                     const PS::F64vec           *x_ref,
+                                           PS::F64vec           *x,
+                                     const PS::F64               tolerance,
+                                     const PS::S32               max_iteration){
+            for(PS::S32 iter=0; iter<max_iteration; ++iter){
+                bool done = true;
+                for(const auto& c : pair){
+                    const PS::F64vec r    = x[c.i] - x[c.j];
+                    const PS::F64    diff = c.d2 - r*r;
+                    if(std::abs(diff) <= 2.0*tolerance*c.d2) continue;
+                    done = false;
+
+                    const PS::F64vec s  = x_ref[c.i] - x_ref[c.j];
+                    const PS::F64    rs = r*s;
+                    if(rs < tolerance*c.d2) return -1;
+
+                    const PS::F64 g = diff/(2.0*rs*(m_inv[c.i] + m_inv[c.j]));
+                    x[c.i] += (g*m_inv[c.i])*s;
+                    x[c.j] -= (g*m_inv[c.j])*s;
+                }
+                if(done) return iter;
+            }
+            return -1;
+        }
+
+        /**
+        * @brief RATTLE velocity part. the relative velocity along the constraint is removed.
+        * @param[in] v_tolerance  tolerance of relative velocity along the constraint, [angstrom/time].
+        * @return number of iteration. -1: not converged.
+        */
+        inline PS::S32 rattleVelocity(const std::vector<Pair>    &pair,
+                                      const PS::F64              *m_inv,
+                                      const PS::F64vec           *x,
+                                            PS::F64vec           *v,
+                                      const PS::F64               v_tolerance,
+                                      const PS::S32               max_iteration){
+            for(PS::S32 iter=0; iter<max_iteration; ++iter){
+                bool done = true;
+                for(const auto& c : pair){
+                    const PS::F64vec r  = x[c.i] - x[c.j];
+                    const PS::F64    rv = r*(v[c.i] - v[c.j]);
+                    if(std::abs(rv) <= v_tolerance*std::sqrt(c.d2)) continue;
+                    done = false;
+
+                    const PS::F64 k = -rv/((r*r)*(m_inv[c.i] + m_inv[c.j]));
+                    v[c.i] += (k*m_inv[c.i])*r;
+                    v[c.j] -= (k*m_inv[c.j])*r;
+                }
+                if(done) return iter;
+            }
+            return -1;
+        }
+
+        /**
+        * @brief analytic SETTLE for position.
+        * @details the implementation follows the canonical frame of Miyamoto & Kollman.
+        *          the center of mass is made from the O-H vectors to avoid the loss of precision.
+        * @return "false" means the deformation is too large to solve.
+        */
+        inline bool settlePosition(const SettleParam &p,
+                                   const PS::F64vec  *x_ref,
+                                         PS::F64vec  *x     ){
+
+            const PS::F64vec dist21 = x_ref[p.i_H1] - x_ref[p.i_O];
+            const PS::F64vec dist31 = x_ref[p.i_H2] - x_ref[p.i_O];
+            const PS::F64vec doh2   = x[p.i_H1] - x[p.i_O];
+            const PS::F64vec doh3   = x[p.i_H2] - x[p.i_O];
+
+            const PS::F64vec a1  = -(doh2 + doh3)*p.wh;
+            const PS::F64vec com = x[p.i_O] - a1;
+            const PS::F64vec b1  = x[p.i_H1] - com;
+            const PS::F64vec c1  = x[p.i_H2] - com;
+
+            //--- canonical frame: z is normal to the reference plane
+                  PS::F64vec ez = dist21 ^ dist31;
+                  PS::F64vec ex = a1 ^ ez;
+                  PS::F64vec ey = ez ^ ex;
+            ex = ex*(1.0/std::sqrt(ex*ex));
+            ey = ey*(1.0/std::sqrt(ey*ey));
+            ez = ez*(1.0/std::sqrt(ez*ez));
+
+            const PS::F64 xb0 = ex*dist21,  yb0 = ey*dist21;
+            const PS::F64 xc0 = ex*dist31,  yc0 = ey*dist31;
+            const PS::F64 za1 = ez*a1;
+            const PS::F64 xb1 = ex*b1,  yb1 = ey*b1,  zb1 = ez*b1;
+            const PS::F64 xc1 = ex*c1,  yc1 = ey*c1,  zc1 = ez*c1;
+
+            const PS::F64 sinphi   = za1/p.ra;
+            const PS::F64 cosphi_2 = 1.0 - sinphi*sinphi;
+            if(cosphi_2 <= 0.0) return false;
+            const PS::F64 cosphi   = std::sqrt(cosphi_2);
+
+            const PS::F64 sinpsi   = (zb1 - zc1)/(2.0*p.rc*cosphi);
+            const PS::F64 cospsi_2 = 1.0 - sinpsi*sinpsi;
+            if(cospsi_2 <= 0.0) return false;
+            const PS::F64 cospsi   = std::sqrt(cospsi_2);
+
+            const PS::F64 ya2 =  p.ra*cosphi;
+            const PS::F64 xb2 = -p.rc*cospsi;
+            const PS::F64 t1  = -p.rb*cosphi;
+            const PS::F64 t2  =  p.rc*sinpsi*sinphi;
+            const PS::F64 yb2 = t1 - t2;
+            const PS::F64 yc2 = t1 + t2;
+
+            const PS::F64 alpha  = xb2*(xb0 - xc0) + yb0*yb2 + yc0*yc2;
+            const PS::F64 beta   = xb2*(yc0 - yb0) + xb0*yb2 + xc0*yc2;
+            const PS::F64 gamma  = xb0*yb1 - xb1*yb0 + xc0*yc1 - xc1*yc0;
+            const PS::F64 al2be2 = alpha*alpha + beta*beta;
+            const PS::F64 det    = al2be2 - gamma*gamma;
+            if(det < 0.0) return false;
+
+            const PS::F64 sintheta   = (alpha*gamma - beta*std::sqrt(det))/al2be2;
+            const PS::F64 costheta_2 = 1.0 - sintheta*sintheta;
+            if(costheta_2 < 0.0) return false;
+            const PS::F64 costheta   = std::sqrt(costheta_2);
+
+            const PS::F64vec a3 =   ex*(-ya2*sintheta)
+                                  + ey*( ya2*costheta)
+                                  + ez*za1;
+            const PS::F64vec b3 =   ex*( xb2*costheta - yb2*sintheta)
+                                  + ey*( xb2*sintheta + yb2*costheta)
+                                  + ez*zb1;
+            const PS::F64vec c3 =   ex*(-xb2*costheta - yc2*sintheta)
+                                  + ey*(-xb2*sintheta + yc2*costheta)
+                                  + ez*zc1;
+
+            x[p.i_O]  = com + a3;
+            x[p.i_H1] = com + b3;
+            x[p.i_H2] = com + c3;
+            return true;
+        }
+
+        /**
+        * @brief analytic velocity constraint for 3 constraints (SETTLE velocity part).
+        * @details the 3x3 linear equation of the constraint impulses is solved by Cramer's rule.
+        * @return "false" means the equation is singular.
+        */
+        inline bool settleVelocity(const std::vector<Pair> &pair,
+                                   const PS::F64           *m_inv,
+                                   const PS::F64vec        *x,
+                                         PS::F64vec        *v     ){
+            PS::F64vec e[3];
+            PS::F64    a[3][3];
+            PS::F64    b[3];
+            for(PS::S32 c=0; c<3; ++c){
+                e[c] = x[pair[c].i] - x[pair[c].j];
+                b[c] = -e[c]*(v[pair[c].i] - v[pair[c].j]);
+            }
+            //--- relative velocity of constraint c by the unit impulse of constraint d
+            for(PS::S32 c=0; c<3; ++c){
+                for(PS::S32 d=0; d<3; ++d){
+                    PS::F64 w = 0.0;
+                    if(pair[d].i == pair[c].i) w += m_inv[pair[c].i];
+                    if(pair[d].j == pair[c].i) w -= m_inv[pair[c].i];
+                    if(pair[d].i == pair[c].j) w -= m_inv[pair[c].j];
+                    if(pair[d].j == pair[c].j) w += m_inv[pair[c].j];
+                    a[c][d] = w*(e[c]*e[d]);
+                }
+            }
+
+            const PS::F64 det = a[0][0]*(a[1][1]*a[2][2] - a[1][2]*a[2][1])
+                              - a[0][1]*(a[1][0]*a[2][2] - a[1][2]*a[2][0])
+                              + a[0][2]*(a[1][0]*a[2][1] - a[1][1]*a[2][0]);
+            if(std::abs(det) <= 0.0) return false;
+            const PS::F64 det_inv = 1.0/det;
+
+            PS::F64 tau[3];
+            tau[0] = ( b[0]   *(a[1][1]*a[2][2] - a[1][2]*a[2][1])
+                     - a[0][1]*(b[1]   *a[2][2] - a[1][2]*b[2]   )
+                     + a[0][2]*(b[1]   *a[2][1] - a[1][1]*b[2]   ) )*det_inv;
+            tau[1] = ( a[0][0]*(b[1]   *a[2][2] - a[1][2]*b[2]   )
+                     - b[0]   *(a[1][0]*a[2][2] - a[1][2]*a[2][0])
+                     + a[0][2]*(a[1][0]*b[2]    - b[1]   *a[2][0]) )*det_inv;
+            tau[2] = ( a[0][0]*(a[1][1]*b[2]    - b[1]   *a[2][1])
+                     - a[0][1]*(a[1][0]*b[2]    - b[1]   *a[2][0])
+                     + b[0]   *(a[1][0]*a[2][1] - a[1][1]*a[2][0]) )*det_inv;
+
+            for(PS::S32 c=0; c<3; ++c){
+                v[pair[c].i] += (tau[c]*m_inv[pair[c].i])*e[c];
+                v[pair[c].j] -= (tau[c]*m_inv[pair[c].j])*e[c];
+            }
+            return true;
+        }
+
+
+        /**
+        * @brief eigen value and vector of symmetric 3x3 matrix by Jacobi method.
+        * @details evec[k] is the eigen vector of eval[k]. the vectors make the right-handed system.
+        */
+        inline void jacobiEigen(PS::F64 a[3][3], PS::F64 eval[3], PS::F64vec evec[3]){
+            PS::F64 v[3][3] = { {1.0, 0.0, 0.0},
+                                {0.0, 1.0, 0.0},
+                                {0.0, 0.0, 1.0} };
+            for(PS::S32 sweep=0; sweep<50; ++sweep){
+                const PS::F64 off = a[0][1]*a[0][1] + a[0][2]*a[0][2] + a[1][2]*a[1][2];
+                const PS::F64 dia = a[0][0]*a[0][0] + a[1][1]*a[1][1] + a[2][2]*a[2][2];
+                if(off <= 1.e-30*dia) break;
+                for(PS::S32 p=0; p<2; ++p){
+                    for(PS::S32 q=p+1; q<3; ++q){
+                        if(a[p][q] == 0.0) continue;
+                        const PS::F64 theta = 0.5*(a[q][q] - a[p][p])/a[p][q];
+                        const PS::F64 t     = (theta >= 0.0 ? 1.0 : -1.0)/(std::abs(theta) + std::sqrt(theta*theta + 1.0));
+                        const PS::F64 c     = 1.0/std::sqrt(t*t + 1.0);
+                        const PS::F64 sn    = t*c;
+                        for(PS::S32 k=0; k<3; ++k){
+                            const PS::F64 akp = a[k][p], akq = a[k][q];
+                            a[k][p] = c*akp - sn*akq;
+                            a[k][q] = sn*akp + c*akq;
+                        }
+                        for(PS::S32 k=0; k<3; ++k){
+                            const PS::F64 apk = a[p][k], aqk = a[q][k];
+                            a[p][k] = c*apk - sn*aqk;
+                            a[q][k] = sn*apk + c*aqk;
+                        }
+                        for(PS::S32 k=0; k<3; ++k){
+                            const PS::F64 vkp = v[k][p], vkq = v[k][q];
+                            v[k][p] = c*vkp - sn*vkq;
+                            v[k][q] = sn*vkp + c*vkq;
+                        }
+                    }
+                }
+            }
+            for(PS::S32 k=0; k<3; ++k){
+                eval[k] = a[k][k];
+                evec[k] = PS::F64vec{v[0][k], v[1][k], v[2][k]};
+            }
+            evec[2] = evec[0] ^ evec[1];
+        }
+
+        /**
+        * @brief make the rigid body parameter from the template structure.
+        * @return "false" means the molecule is linear (not supported).
+        */
+        inline bool rigidMakeParam(const std::vector<PS::F64vec> &x,
+                                   const std::vector<PS::F64>    &mass,
+                                         RigidParam              &rp   ){
+            const size_t n = x.size();
+            rp.mass = 0.0;
+            PS::F64vec com = 0.0;
+            for(size_t i=0; i<n; ++i){
+                rp.mass += mass[i];
+                com     += mass[i]*x[i];
+            }
+            com = com*(1.0/rp.mass);
+
+            PS::F64 tensor[3][3] = { {0.0, 0.0, 0.0},
+                                     {0.0, 0.0, 0.0},
+                                     {0.0, 0.0, 0.0} };
+            for(size_t i=0; i<n; ++i){
+                const PS::F64vec r  = x[i] - com;
+                const PS::F64    r2 = r*r;
+                const PS::F64    rv[3] = {r.x, r.y, r.z};
+                for(PS::S32 p=0; p<3; ++p){
+                    for(PS::S32 q=0; q<3; ++q){
+                        tensor[p][q] += mass[i]*( (p == q ? r2 : 0.0) - rv[p]*rv[q] );
+                    }
+                }
+            }
+
+            PS::F64vec axis[3];
+            jacobiEigen(tensor, rp.inertia, axis);
+            const PS::F64 I_max = std::max(rp.inertia[0], std::max(rp.inertia[1], rp.inertia[2]));
+            for(PS::S32 k=0; k<3; ++k){
+                if(rp.inertia[k] <= 1.e-6*I_max) return false;
+            }
+
+            rp.body.resize(n);
+            for(PS::S32 k=0; k<3; ++k) rp.moment2[k] = 0.0;
+            for(size_t i=0; i<n; ++i){
+                const PS::F64vec r = x[i] - com;
+                rp.body[i] = PS::F64vec{axis[0]*r, axis[1]*r, axis[2]*r};
+                rp.moment2[0] += mass[i]*rp.body[i].x*rp.body[i].x;
+                rp.moment2[1] += mass[i]*rp.body[i].y*rp.body[i].y;
+                rp.moment2[2] += mass[i]*rp.body[i].z*rp.body[i].z;
+            }
+            return true;
+        }
+
+        /**
+        * @brief rigid body state from atom position and velocity.
+        * @details axis[k] is the principal axis k in space frame (fitted to the template, orthonormalized).
+        *          L_body is the angular momentum in the principal axes frame.
+        */
+        inline void rigidGetState(const RigidParam &rp,
+                                  const PS::F64    *m_inv,
+                                  const PS::F64vec *x,
+                                  const PS::F64vec *v,
+                                        PS::F64vec &com,
+                                        PS::F64vec &v_com,
+                                        PS::F64vec  axis[3],
+                                        PS::F64     L_body[3]){
+            const size_t n = rp.body.size();
+            com   = 0.0;
+            v_com = 0.0;
+            for(size_t i=0; i<n; ++i){
+                const PS::F64 m = 1.0/m_inv[i];
+                com   += m*x[i];
+                v_com += m*v[i];
+            }
+            com   = com*(1.0/rp.mass);
+            v_com = v_com*(1.0/rp.mass);
+
+            //--- fit the principal axes: axis[k] = sum(m*r*body_k)/sum(m*body_k^2)
+            PS::F64vec fit[3] = {0.0, 0.0, 0.0};
+            PS::F64vec L      = 0.0;
+            for(size_t i=0; i<n; ++i){
+                const PS::F64    m = 1.0/m_inv[i];
+                const PS::F64vec r = x[i] - com;
+                fit[0] += (m*rp.body[i].x)*r;
+                fit[1] += (m*rp.body[i].y)*r;
+                fit[2] += (m*rp.body[i].z)*r;
+                L      += m*(r ^ (v[i] - v_com));
+            }
+            const PS::F64 m2_max = std::max(rp.moment2[0], std::max(rp.moment2[1], rp.moment2[2]));
+            PS::S32 i_plane = -1;    // the normal axis of planar molecule
+            for(PS::S32 k=0; k<3; ++k){
+                if(rp.moment2[k] <= 1.e-12*m2_max){
+                    i_plane = k;
+                } else {
+                    fit[k] = fit[k]*(1.0/rp.moment2[k]);
+                }
+            }
+            if(i_plane >= 0){
+                fit[i_plane] = fit[(i_plane + 1)%3] ^ fit[(i_plane + 2)%3];
+            }
+
+            //--- orthonormalize
+            axis[0] = fit[0]*(1.0/std::sqrt(fit[0]*fit[0]));
+            axis[1] = fit[1] - (axis[0]*fit[1])*axis[0];
+            axis[1] = axis[1]*(1.0/std::sqrt(axis[1]*axis[1]));
+            axis[2] = axis[0] ^ axis[1];
+
+            L_body[0] = axis[0]*L;
+            L_body[1] = axis[1]*L;
+            L_body[2] = axis[2]*L;
+        }
+
+        /**
+        * @brief free rotation for time dt.
+        * @details symmetric splitting of rotations around principal axes: x(dt/2), y(dt/2), z(dt), y(dt/2), x(dt/2).
+        *          ref: A. Dullweber, B. Leimkuhler, and R. McLachlan, J. Chem. Phys., 107, 5840 (1997).
+        */
+        inline void rigidRotate(const RigidParam &rp,
+                                const PS::F64     dt,
+                                      PS::F64vec  axis[3],
+                                      PS::F64     L_body[3]){
+            auto rotate = [&](const PS::S32 k, const PS::F64 h){
+                const PS::S32 p     = (k + 1)%3;
+                const PS::S32 q     = (k + 2)%3;
+                const PS::F64 theta = h*L_body[k]/rp.inertia[k];
+                const PS::F64 c     = std::cos(theta);
+                const PS::F64 sn    = std::sin(theta);
+
+                const PS::F64vec axis_p = axis[p];
+                const PS::F64vec axis_q = axis[q];
+                axis[p] =  c*axis_p + sn*axis_q;
+                axis[q] = -sn*axis_p + c*axis_q;
+
+                const PS::F64 L_p = L_body[p];
+                const PS::F64 L_q = L_body[q];
+                L_body[p] =  c*L_p + sn*L_q;
+                L_body[q] = -sn*L_p + c*L_q;
+            };
+            rotate(0, 0.5*dt);
+            rotate(1, 0.5*dt);
+            rotate(2,     dt);
+            rotate(1, 0.5*dt);
+            rotate(0, 0.5*dt);
+        }
+
+        /**
+        * @brief atom position and velocity from the rigid body state. x = nullptr: position is not written.
+        */
+        inline void rigidSetAtom(const RigidParam &rp,
+                                 const PS::F64vec &com,
+                                 const PS::F64vec &v_com,
+                                 const PS::F64vec  axis[3],
+                                 const PS::F64     L_body[3],
+                                       PS::F64vec *x,
+                                       PS::F64vec *v        ){
+            const PS::F64vec omega =   axis[0]*(L_body[0]/rp.inertia[0])
+                                     + axis[1]*(L_body[1]/rp.inertia[1])
+                                     + axis[2]*(L_body[2]/rp.inertia[2]);
+            for(size_t i=0; i<rp.body.size(); ++i){
+                const PS::F64vec r =   axis[0]*rp.body[i].x
+                                     + axis[1]*rp.body[i].y
+                                     + axis[2]*rp.body[i].z;
+                if(x != nullptr) x[i] = com + r;
+                v[i] = v_com + (omega ^ r);
+            }
+        }
+
+        /**
+        * @brief rigid body drift. the state is made from the reference position and the velocity.
+        */
+        inline void rigidPosition(const RigidParam &rp,
+                                  const PS::F64    *m_inv,
+                                  const PS::F64vec *x_ref,
+                                  const PS::F64     dt,
+                                        PS::F64vec *x,
+                                        PS::F64vec *v     ){
+            PS::F64vec com, v_com, axis[3];
+            PS::F64    L_body[3];
+            rigidGetState(rp, m_inv, x_ref, v, com, v_com, axis, L_body);
+            com += v_com*dt;
+            rigidRotate(rp, dt, axis, L_body);
+            rigidSetAtom(rp, com, v_com, axis, L_body, x, v);
+        }
+
+        /**
+        * @brief rigid body kick. the momentum and the angular momentum are made from the kicked atom velocity.
+        * @details the result is same to the kick by total force and torque of the molecule.
+        */
+        inline void rigidVelocity(const RigidParam &rp,
+                                  const PS::F64    *m_inv,
+                                  const PS::F64vec *x,
+                                        PS::F64vec *v     ){
+            PS::F64vec com, v_com, axis[3];
+            PS::F64    L_body[3];
+            rigidGetState(rp, m_inv, x, v, com, v_com, axis, L_body);
+            rigidSetAtom(rp, com, v_com, axis, L_body, nullptr, v);
+        }
+    }
+
+    /**
+    * @brief constraint solver for velocity Verlet integration.
+    * @details usage in each step:
+    *            clearVirial() -> kick(dt/2) -> setReference() -> drift(dt) -> applyPosition()
+    *            -> exchange -> update() -> force -> kick(dt/2) -> applyVelocity().
+    *          all atoms of a constrained molecule must be in the same process (mol_exchange = 1).
+    *          the molecule with ConstraintSolver::RIGID is moved as a rigid body in applyPosition(),
+    *          and the kicked atom velocity is projected to the rigid body motion in applyVelocity().
+    *          the virial of constraint force is the average of position and velocity parts,
+    *          it is stored in FP (ForceConstraint).
+    *          with r-RESPA, call clearVirial() once at the beginning of step and give each correction
+    *          the weight dt_c/dt (dt_c: interval of the correction, dt: outer time step).
+    */
+    class Solver {
+    private:
+        std::vector<ModelConstraint>  model;
+        std::map<MolName, PS::S32>    model_index;
+        bool                          enable = false;
+
+        //--- local molecules with constraint. atoms are in the order of the model template.
+        std::vector<PS::S32> mol_model;
+        std::vector<PS::S64> mol_offset;
+        std::vector<PS::S64> atom_index;
+        std::vector<PS::F64vec> pos_ref;    // normalized position at setReference()
+        PS::S64                 n_rigid_local = 0;
+
+        PS::F64 tolerance     = 1.e-6;     // relative to the constraint length
+        PS::S32 max_iteration = 1000;
+
+        //--- buffer for one molecule
+        struct MolBuff {
+            std::vector<PS::F64vec> x_ref, x, v;
+            std::vector<PS::F64>    m_inv;
+            _Impl::LincsBuff        lincs;
+
+            void resize(const size_t n){
+                this->x_ref.resize(n);
+                this->x.resize(n);
+                this->v.resize(n);
+                this->m_inv.resize(n);
+            }
+        };
+
+        void _throw_failure(const PS::S64 i_mol, const std::string &stage) const {
+            if(i_mol < 0) return;
+            std::string model_name = "";
+            for(const auto& p : this->model_index){
+                if(p.second == this->mol_model[i_mol]) model_name = ENUM::what(p.first);
+            }
+            std::ostringstream oss;
+            oss << "the constraint is not solved in " << stage << "." << "\n"
+                << "   model = " << model_name << "\n"
+                << "   the deformation of molecule is too large. check the time step or the initial structure." << "\n";
+            throw std::logic_error(oss.str());
+        }
+
+        //--- load the molecule into real space frame around atom 0 (min image).
+        template <class Tpsys>
+        void _load(const PS::S64  i_mol,
+                   const Tpsys   &psys,
+                   const bool     use_ref,
+                         MolBuff &buff) const {
+            const PS::S64    offset = this->mol_offset[i_mol];
+            const PS::S32    n_atom = this->mol_offset[i_mol+1] - offset;
+            const PS::F64vec pos_0  = psys[ this->atom_index[offset] ].getPos();
+            buff.resize(n_atom);
+            for(PS::S32 k=0; k<n_atom; ++k){
+                const auto& atom = psys[ this->atom_index[offset + k] ];
+                buff.x[k]     = Normalize::realPos( Normalize::relativePosAdjustNorm( PS::F64vec(atom.getPos()) - pos_0 ) );
+                buff.v[k]     = atom.getVel();
+                buff.m_inv[k] = 1.0/atom.getMass();
+                if(use_ref){
+                    buff.x_ref[k] = Normalize::realPos( Normalize::relativePosAdjustNorm( this->pos_ref[offset + k] - pos_0 ) );
+                }
+            }
+        }
+
+    public:
+        bool    isEnable()               const { return this->enable;        }
+        PS::S64 getNumberOfRigidLocal()  const { return this->n_rigid_local; }
+
+        /**
+        * @brief make constraint list from model template.
+        * @details the bond with "constraint" form is a distance constraint.
+        *          the angle with "constraint" form is a distance constraint between both ends,
+        *          both bonds of the angle must be "constraint" form.
+        */
+        template <class Tptcl>
+        void init(const std::vector<std::pair<MolName, PS::S64>> &model_list,
+                  const std::vector<std::vector<Tptcl>>          &model_template,
+                  const bool                                      mol_exchange  ){
+
+            this->model.clear();
+            this->model_index.clear();
+            this->enable = false;
+
+            for(size_t m=0; m<model_list.size(); ++m){
+                const MolName mol = model_list[m].first;
+                if(this->model_index.count(mol) > 0) continue;
+                this->model_index[mol] = this->model.size();
+
+                ModelConstraint mc;
+                if(MODEL::coef_table.constraint.count(mol) > 0){
+                    mc.coef = MODEL::coef_table.constraint.at(mol);
+                }
+                if(m < model_template.size()){
+                    const auto& tmp = model_template[m];
+                    mc.n_atom = tmp.size();
+                    for(const auto& atom : tmp){
+                        mc.mass.push_back(atom.getMass());
+                    }
+
+                    for(PS::S32 i=0; i<mc.n_atom; ++i){
+                        if(tmp[i].getAtomID() != i){
+                            std::ostringstream oss;
+                            oss << "AtomID in model template must be same to the index." << "\n"
+                                << "   model = " << ENUM::what(mol) << ", index = " << i << ", AtomID = " << tmp[i].getAtomID() << "\n";
+                            throw std::invalid_argument(oss.str());
+                        }
+                    }
+
+                    auto bond_r0 = [&](const PS::S32 i, const PS::S32 j, PS::F64 &r0) -> bool {
+                        const MODEL::KeyBond key = std::make_tuple(mol, tmp[i].getAtomType(), tmp[j].getAtomType());
+                        if(MODEL::coef_table.bond.count(key) == 0) return false;
+                        const auto& coef = MODEL::coef_table.bond.at(key);
+                        r0 = coef.r0;
+                        return (coef.form == IntraFuncForm::constraint);
+                    };
+
+                    for(PS::S32 i=0; i<mc.n_atom; ++i){
+                        //--- bond
+                        for(const auto j : tmp[i].bond){
+                            PS::F64 r0 = 0.0;
+                            if(j <= i || !bond_r0(i, j, r0)) continue;
+                            mc.pair.push_back( Pair{i, static_cast<PS::S32>(j), r0*r0} );
+                        }
+
+                        //--- angle j-i-k
+                        for(const auto j : tmp[i].bond){
+                            for(const auto k : tmp[i].bond){
+                                if(k <= j) continue;
+                                const MODEL::KeyAngle key = std::make_tuple(mol, tmp[j].getAtomType(),
+                                                                                 tmp[i].getAtomType(),
+                                                                                 tmp[k].getAtomType() );
+                                if(MODEL::coef_table.angle.count(key) == 0) continue;
+                                const auto& coef = MODEL::coef_table.angle.at(key);
+                                if(coef.form != IntraFuncForm::constraint) continue;
+
+                                PS::F64 r_ij = 0.0, r_ik = 0.0;
+                                if( !bond_r0(i, j, r_ij) || !bond_r0(i, k, r_ik) ){
+                                    std::ostringstream oss;
+                                    oss << "the angle constraint requires the constraint bonds." << "\n"
+                                        << "   key_angle = " << ENUM::what(key) << "\n";
+                                    throw std::invalid_argument(oss.str());
+                                }
+                                if(mc.coef.solver == ConstraintSolver::LINCS){
+                                    std::ostringstream oss;
+                                    oss << "the angle constraint is not supported by LINCS. use SHAKE." << "\n"
+                                        << "   key_angle = " << ENUM::what(key) << "\n";
+                                    throw std::invalid_argument(oss.str());
+                                }
+                                const PS::F64 d2 = r_ij*r_ij + r_ik*r_ik - 2.0*r_ij*r_ik*std::cos(coef.theta0);
+                                mc.pair.push_back( Pair{ static_cast<PS::S32>(j), static_cast<PS::S32>(k), d2 } );
+                            }
+                        }
+                    }
+
+                    //--- rigid body: the bond/angle constraints are included in the body.
+                    if(mc.coef.solver == ConstraintSolver::RIGID && mc.n_atom > 1){
+                        std::vector<PS::F64vec> x_tmp;
+                        std::vector<PS::F64>    m_tmp;
+                        for(const auto& atom : tmp){
+                            x_tmp.push_back(atom.getPos());
+                            m_tmp.push_back(atom.getMass());
+                        }
+                        if( !_Impl::rigidMakeParam(x_tmp, m_tmp, mc.rigid_param) ){
+                            throw std::invalid_argument("the linear molecule is not supported by RIGID solver. model = " + ENUM::what(mol));
+                        }
+                        mc.rigid = true;
+                        mc.pair.clear();
+                    }
+
+                    //--- coupling list for LINCS
+                    const PS::S32 n_pair = mc.pair.size();
+                    mc.couple_offset.assign(1, 0);
+                    for(PS::S32 c=0; c<n_pair; ++c){
+                        const auto& pc = mc.pair[c];
+                        for(PS::S32 d=0; d<n_pair; ++d){
+                            if(d == c) continue;
+                            const auto& pd = mc.pair[d];
+                            if(pc.i == pd.i) mc.couple.push_back( LincsCouple{d, pc.i,  1.0} );
+                            if(pc.i == pd.j) mc.couple.push_back( LincsCouple{d, pc.i, -1.0} );
+                            if(pc.j == pd.i) mc.couple.push_back( LincsCouple{d, pc.j, -1.0} );
+                            if(pc.j == pd.j) mc.couple.push_back( LincsCouple{d, pc.j,  1.0} );
+                        }
+                        mc.couple_offset.push_back(mc.couple.size());
+                    }
+
+                    //--- SETTLE for rigid 3-site model with symmetric H
+                    if(mc.coef.solver == ConstraintSolver::SHAKE &&
+                       mc.n_atom == 3 && mc.pair.size() == 3){
+                        for(PS::S32 o=0; o<3; ++o){
+                            const PS::S32 h1 = (o + 1)%3;
+                            const PS::S32 h2 = (o + 2)%3;
+                            PS::F64 d2_oh1 = -1.0, d2_oh2 = -1.0, d2_hh = -1.0;
+                            for(const auto& c : mc.pair){
+                                const PS::S32 a = std::min(c.i, c.j);
+                                const PS::S32 b = std::max(c.i, c.j);
+                                if(a == std::min(o, h1) && b == std::max(o, h1)) d2_oh1 = c.d2;
+                                if(a == std::min(o, h2) && b == std::max(o, h2)) d2_oh2 = c.d2;
+                                if(a == std::min(h1,h2) && b == std::max(h1,h2)) d2_hh  = c.d2;
+                            }
+                            const PS::F64 m_O = tmp[o].getMass();
+                            const PS::F64 m_H = tmp[h1].getMass();
+                            if( d2_oh1 <= 0.0 || d2_hh <= 0.0 ||
+                                std::abs(d2_oh1 - d2_oh2) > this->tolerance*d2_oh1 ||
+                                std::abs(m_H - tmp[h2].getMass()) > this->tolerance*m_H ) continue;
+
+                            const PS::F64 d_OH = std::sqrt(d2_oh1);
+                            const PS::F64 d_HH = std::sqrt(d2_hh);
+                            const PS::F64 h    = std::sqrt(d_OH*d_OH - 0.25*d_HH*d_HH);
+                            mc.settle          = true;
+                            mc.settle_param.i_O  = o;
+                            mc.settle_param.i_H1 = h1;
+                            mc.settle_param.i_H2 = h2;
+                            mc.settle_param.wh   = m_H/(m_O + 2.0*m_H);
+                            mc.settle_param.rc   = 0.5*d_HH;
+                            mc.settle_param.ra   = 2.0*m_H*h/(m_O + 2.0*m_H);
+                            mc.settle_param.rb   = h - mc.settle_param.ra;
+                            break;
+                        }
+                    }
+                }
+
+                if(mc.isActive() && model_list[m].second > 0) this->enable = true;
+                this->model.push_back(mc);
+            }
+
+            if(this->enable && !mol_exchange){
+                throw std::logic_error("the constraint solver (SETTLE, SHAKE/RATTLE, LINCS, or RIGID) requires the exchange of whole molecule."
+                                       " set 'mol_exchange 1' in the TREE setting.");
+            }
+        }
+
+        std::string str() const {
+            std::ostringstream oss;
+            oss << "constraint:" << "\n";
+            if( !this->enable ){
+                oss << "    no constraints." << "\n";
+            }
+            for(const auto& p : this->model_index){
+                const auto& mc = this->model[p.second];
+                if( !mc.isActive() ) continue;
+                oss << "  " << ENUM::what(p.first) << ": ";
+                if(mc.rigid){
+                    oss << "RIGID body" << "\n";
+                    continue;
+                }
+                oss << mc.pair.size() << " constraints, ";
+                if(mc.settle){
+                    oss << "SETTLE" << "\n";
+                } else if(mc.coef.solver == ConstraintSolver::LINCS){
+                    oss << "LINCS (order = " << mc.coef.lincs_order << ", iter = " << mc.coef.lincs_iter << ")" << "\n";
+                } else {
+                    oss << "SHAKE/RATTLE" << "\n";
+                }
+            }
+            oss << "\n";
+            return oss.str();
+        }
+
+        /**
+        * @brief make the list of local molecules with constraint. call after the exchange of particles.
+        */
+        template <class Tpsys>
+        void update(const Tpsys &psys){
+            this->mol_model.clear();
+            this->mol_offset.clear();
+            this->atom_index.clear();
+            this->mol_offset.push_back(0);
+            this->n_rigid_local = 0;
+            if( !this->enable ) return;
+
+            const PS::S64 n_local = psys.getNumberOfParticleLocal();
+            std::vector<std::tuple<MD_DEFS::ID_type, MD_DEFS::ID_type, PS::S64>> mol_atom;
+            mol_atom.reserve(n_local);
+            for(PS::S64 i=0; i<n_local; ++i){
+                const auto itr = this->model_index.find(psys[i].getMolType());
+                if(itr == this->model_index.end() || !this->model[itr->second].isActive()) continue;
+                mol_atom.push_back( std::make_tuple(psys[i].getMolID(), psys[i].getAtomID(), i) );
+            }
+            std::sort(mol_atom.begin(), mol_atom.end());
+
+            const PS::S64 n_atom = mol_atom.size();
+            PS::S64 i_begin = 0;
+            while(i_begin < n_atom){
+                const PS::S64 i_0    = std::get<2>(mol_atom[i_begin]);
+                const PS::S32 m      = this->model_index.at(psys[i_0].getMolType());
+                const PS::S32 n_tmp  = this->model[m].n_atom;
+                const auto    id_0   = std::get<1>(mol_atom[i_begin]);
+
+                PS::S64 i_end = i_begin;
+                while(i_end < n_atom && std::get<0>(mol_atom[i_end]) == std::get<0>(mol_atom[i_begin])){
+                    if(std::get<1>(mol_atom[i_end]) != id_0 + (i_end - i_begin)) break;
+                    ++i_end;
+                }
+                if(i_end - i_begin != n_tmp){
+                    std::ostringstream oss;
+                    oss << "the molecule with constraint is not whole in the process." << "\n"
+                        << "   MolID = " << std::get<0>(mol_atom[i_begin])
+                        << ", n_atom = " << (i_end - i_begin) << " / " << n_tmp << "\n"
+                        << "   use ATOM_MOVE::exchangeMolecule() ('mol_exchange 1')." << "\n";
+                    throw std::logic_error(oss.str());
+                }
+
+                //--- the mass is loaded from the resume file. it must be same to the template (see HMR_mass).
+                for(PS::S64 k=i_begin; k<i_end; ++k){
+                    const PS::F64 m_atom = psys[ std::get<2>(mol_atom[k]) ].getMass();
+                    const PS::F64 m_tmp  = this->model[m].mass[k - i_begin];
+                    if( std::abs(m_atom - m_tmp) > this->tolerance*m_tmp ){
+                        std::ostringstream oss;
+                        oss << "the mass of atom is different from the model template." << "\n"
+                            << "   AtomID = " << std::get<1>(mol_atom[k])
+                            << ", mass = " << m_atom << ", template = " << m_tmp << " (normalized)" << "\n"
+                            << "   check HMR_mass is same to the run that wrote the resume file." << "\n";
+                        throw std::invalid_argument(oss.str());
+                    }
+                    this->atom_index.push_back( std::get<2>(mol_atom[k]) );
+                }
+                this->mol_model.push_back(m);
+                this->mol_offset.push_back(this->atom_index.size());
+                this->n_rigid_local += this->model[m].n_dof_removed();
+
+                i_begin = i_end;
+            }
+        }
+
+        //--- clear the virial of constraint force. call once at the beginning of step.
+        template <class Tpsys>
+        void clearVirial(Tpsys &psys) const {
+            const PS::S64 n = this->atom_index.size();
+            for(PS::S64 k=0; k<n; ++k){
+                psys[ this->atom_index[k] ].clearVirialConstraint();
+            }
+        }
+
+        //--- record the position before drift.
+        template <class Tpsys>
+        void setReference(const Tpsys &psys){
+            const PS::S64 n = this->atom_index.size();
+            this->pos_ref.resize(n);
+            for(PS::S64 k=0; k<n; ++k){
+                this->pos_ref[k] = psys[ this->atom_index[k] ].getPos();
+            }
+        }
+
+        /**
+        * @brief constraint for position after drift (SETTLE, SHAKE or LINCS along the reference position, or rigid body drift).
+        * @details the velocity is corrected by the displacement.
+        *          must call psys.adjustPositionIntoRootDomain(dinfo) after.
+        *          the virial is added with virial_weight (0 for no update, see clearVirial()).
+        */
+        template <class Tpsys>
+        void applyPosition(const PS::F64 &dt,
+                                 Tpsys   &psys,
+                           const PS::F64  virial_weight = 1.0){
+            const PS::S64 n_mol    = this->mol_model.size();
+                  PS::S64 fail_mol = -1;
+
+            #ifdef PARTICLE_SIMULATOR_THREAD_PARALLEL
+                #pragma omp parallel
+            #endif
+            {
+                MolBuff buff;
+                std::vector<PS::F64vec> x_0;
+
+                #ifdef PARTICLE_SIMULATOR_THREAD_PARALLEL
+                    #pragma omp for
+                #endif
+                for(PS::S64 i_mol=0; i_mol<n_mol; ++i_mol){
+                    const auto& mc = this->model[ this->mol_model[i_mol] ];
+                    this->_load(i_mol, psys, true, buff);
+                    x_0 = buff.x;
+
+                    bool success = true;
+                    if(mc.rigid){
+                        _Impl::rigidPosition(mc.rigid_param, buff.m_inv.data(), buff.x_ref.data(), dt, buff.x.data(), buff.v.data());
+                    } else if(mc.settle){
+                        success = _Impl::settlePosition(mc.settle_param, buff.x_ref.data(), buff.x.data());
+                    } else if(mc.coef.solver == ConstraintSolver::LINCS){
+                        success = _Impl::lincsPosition(mc, buff.m_inv.data(), buff.x_ref.data(), buff.x.data(), buff.lincs);
+                    } else {
+                        success = (_Impl::shakePosition(mc.pair, buff.m_inv.data(), buff.x_ref.data(), buff.x.data(),
+                                                        this->tolerance, this->max_iteration) >= 0);
+                    }
+                    if( !success ){
+                        #ifdef PARTICLE_SIMULATOR_THREAD_PARALLEL
+                            #pragma omp critical
+                        #endif
+                        {
+                            fail_mol = i_mol;
+                        }
+                        continue;
+                    }
+
+                    //--- write back. constraint force: G = 2*m*dx/dt^2 acts at the reference position.
+                    const PS::S64    offset = this->mol_offset[i_mol];
+                    const PS::F64vec pos_0  = psys[ this->atom_index[offset] ].getPos();
+                    for(size_t k=0; k<buff.x.size(); ++k){
+                        auto& atom = psys[ this->atom_index[offset + k] ];
+                        const PS::F64vec dx = buff.x[k] - x_0[k];
+                        const PS::F64vec G  = dx*(2.0*virial_weight/(buff.m_inv[k]*dt*dt));
+
+                        atom.setPos( pos_0 + Normalize::normPos(buff.x[k]) );
+                        atom.setVel( mc.rigid ? buff.v[k] : buff.v[k] + dx*(1.0/dt) );
+                        atom.addTrj( dx );
+                        atom.addVirialConstraint( FORCE::calcVirialEPI(buff.x_ref[k], G) );
+                    }
+                }
+            }
+            this->_throw_failure(fail_mol, "position part");
+        }
+
+        /**
+        * @brief constraint for velocity after the 2nd kick (SETTLE, RATTLE, LINCS, or rigid body kick).
+        * @details the virial is added with virial_weight (0 for no update, see clearVirial()).
+        */
+        template <class Tpsys>
+        void applyVelocity(const PS::F64 &dt,
+                                 Tpsys   &psys,
+                           const PS::F64  virial_weight = 1.0){
+            const PS::S64 n_mol    = this->mol_model.size();
+                  PS::S64 fail_mol = -1;
+
+            #ifdef PARTICLE_SIMULATOR_THREAD_PARALLEL
+                #pragma omp parallel
+            #endif
+            {
+                MolBuff buff;
+                std::vector<PS::F64vec> v_0;
+
+                #ifdef PARTICLE_SIMULATOR_THREAD_PARALLEL
+                    #pragma omp for
+                #endif
+                for(PS::S64 i_mol=0; i_mol<n_mol; ++i_mol){
+                    const auto& mc = this->model[ this->mol_model[i_mol] ];
+                    this->_load(i_mol, psys, false, buff);
+                    v_0 = buff.v;
+
+                    bool success = true;
+                    if(mc.rigid){
+                        _Impl::rigidVelocity(mc.rigid_param, buff.m_inv.data(), buff.x.data(), buff.v.data());
+                    } else if(mc.settle){
+                        success = _Impl::settleVelocity(mc.pair, buff.m_inv.data(), buff.x.data(), buff.v.data());
+                    } else if(mc.coef.solver == ConstraintSolver::LINCS){
+                        success = _Impl::lincsVelocity(mc, buff.m_inv.data(), buff.x.data(), buff.v.data(), buff.lincs);
+                    } else {
+                        const PS::F64 v_tolerance = this->tolerance/dt;
+                        success = (_Impl::rattleVelocity(mc.pair, buff.m_inv.data(), buff.x.data(), buff.v.data(),
+                                                         v_tolerance, this->max_iteration) >= 0);
+                    }
+                    if( !success ){
+                        #ifdef PARTICLE_SIMULATOR_THREAD_PARALLEL
+                            #pragma omp critical
+                        #endif
+                        {
+                            fail_mol = i_mol;
+                        }
+                        continue;
+                    }
+
+                    //--- write back. constraint force: G = 2*m*dv/dt.
+                    const PS::S64 offset = this->mol_offset[i_mol];
+                    for(size_t k=0; k<buff.v.size(); ++k){
+                        auto& atom = psys[ this->atom_index[offset + k] ];
+                        const PS::F64vec G = (buff.v[k] - v_0[k])*(2.0*virial_weight/(buff.m_inv[k]*dt));
+
+                        atom.setVel( buff.v[k] );
+                        atom.addVirialConstraint( FORCE::calcVirialEPI(buff.x[k], G) );
+                    }
+                }
+            }
+            this->_throw_failure(fail_mol, "velocity part");
+        }
+
+        /**
+        * @brief project position and velocity onto the constraint (for initial structure).
+        * @details SHAKE along the current structure, then RATTLE. the rigid body is fitted to the template.
+        *          the virial is cleared.
+        */
+        template <class Tpsys>
+        void project(Tpsys &psys){
+            const PS::S64 n_mol    = this->mol_model.size();
+                  PS::S64 fail_mol = -1;
+
+            #ifdef PARTICLE_SIMULATOR_THREAD_PARALLEL
+                #pragma omp parallel
+            #endif
+            {
+                MolBuff buff;
+
+                #ifdef PARTICLE_SIMULATOR_THREAD_PARALLEL
+                    #pragma omp for
+                #endif
+                for(PS::S64 i_mol=0; i_mol<n_mol; ++i_mol){
+                    const auto& mc = this->model[ this->mol_model[i_mol] ];
+                    this->_load(i_mol, psys, false, buff);
+                    buff.x_ref = buff.x;
+
+                    //--- velocity tolerance: relative to the max speed in molecule
+                    PS::F64 v2_max = 0.0;
+                    for(const auto& v : buff.v) v2_max = std::max(v2_max, v*v);
+                    const PS::F64 v_tolerance = this->tolerance*std::max(std::sqrt(v2_max), 1.e-12);
+
+                    bool success = true;
+                    if(mc.rigid){
+                        _Impl::rigidPosition(mc.rigid_param, buff.m_inv.data(), buff.x_ref.data(), 0.0, buff.x.data(), buff.v.data());
+                    } else {
+                        success = (_Impl::shakePosition( mc.pair, buff.m_inv.data(), buff.x_ref.data(), buff.x.data(),
+                                                         this->tolerance, this->max_iteration) >= 0) &&
+                                  (_Impl::rattleVelocity(mc.pair, buff.m_inv.data(), buff.x.data(), buff.v.data(),
+                                                         v_tolerance, this->max_iteration) >= 0);
+                    }
+                    if( !success ){
+                        #ifdef PARTICLE_SIMULATOR_THREAD_PARALLEL
+                            #pragma omp critical
+                        #endif
+                        {
+                            fail_mol = i_mol;
+                        }
+                        continue;
+                    }
+
+                    const PS::S64    offset = this->mol_offset[i_mol];
+                    const PS::F64vec pos_0  = psys[ this->atom_index[offset] ].getPos();
+                    for(size_t k=0; k<buff.x.size(); ++k){
+                        auto& atom = psys[ this->atom_index[offset + k] ];
+                        atom.setPos( pos_0 + Normalize::normPos(buff.x[k]) );
+                        atom.setVel( buff.v[k] );
+                        atom.clearVirialConstraint();
+                    }
+                }
+            }
+            this->_throw_failure(fail_mol, "projection of initial structure");
+        }
+    };
+
+}
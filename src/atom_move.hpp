@@ -3,29 +3,39 @@
 //***************************************************************************************
 #pragma once
 
+#include <cmath>
 #include <sstream>
 #include <vector>
+#include <utility>
+#include <algorithm>
 
 #include <particle_simulator.hpp>
 #include <molecular_dynamics_ext.hpp>
 
+#include "md_defs.hpp"
 
+
+//--- force part for ATOM_MOVE::kick().
+//------ "all" is intra + inter (PP part). the long-range part of coulomb is kicked separately by "long_range".
 enum class RESPA_MODE {
     all,
     intra,
     inter,
+    long_range,
 };
 
 namespace ENUM {
     static const std::map<std::string, RESPA_MODE> table_str_RESPA_MODE{
-        {"all"  , RESPA_MODE::all  },
-        {"intra", RESPA_MODE::intra},
-        {"inter", RESPA_MODE::inter},
+        {"all"       , RESPA_MODE::all       },
+        {"intra"     , RESPA_MODE::intra     },
+        {"inter"     , RESPA_MODE::inter     },
+        {"long_range", RESPA_MODE::long_range},
     };
     static const std::map<RESPA_MODE, std::string> table_RESPA_MODE_str{
-        {RESPA_MODE::all  , "all"  },
-        {RESPA_MODE::intra, "intra"},
-        {RESPA_MODE::inter, "inter"},
+        {RESPA_MODE::all       , "all"       },
+        {RESPA_MODE::intra     , "intra"     },
+        {RESPA_MODE::inter     , "inter"     },
+        {RESPA_MODE::long_range, "long_range"},
     };
 
     RESPA_MODE which_RESPA_MODE(const std::string &str){
@@ -102,6 +112,13 @@ namespace ATOM_MOVE {
         }
     };
 
+    struct GetForceLongRange {
+        template <class Tptcl>
+        decltype(declval<Tptcl>().getForceLongRange()) operator () (const Tptcl &ptcl) const {
+            return ptcl.getForceLongRange();
+        }
+    };
+
     struct GetForceTotal {
         template <class Tptcl>
         decltype(declval<Tptcl>().getForce()) operator () (const Tptcl &ptcl) const {
@@ -132,6 +149,10 @@ namespace ATOM_MOVE {
                 _Impl::kick_atom<GetForceInter>(dt, psys, v_barycentric);
             break;
 
+            case RESPA_MODE::long_range:
+                _Impl::kick_atom<GetForceLongRange>(dt, psys, v_barycentric);
+            break;
+
             default:
                 throw std::invalid_argument("undefined RESPA_MODE: " + ENUM::what(respa_mode));
         }
@@ -226,4 +247,74 @@ namespace ATOM_MOVE {
         return max_move;
     }
 
+    /**
+    * @brief exchange particles with keeping all atoms of a molecule in the same process.
+    * @details every atom is sent to the domain including the center of mass of its molecule.
+    *          the molecules must be whole in each process before calling
+    *          (e.g. all atoms are loaded in one process, then this function is used for all exchange).
+    *          must call psys.adjustPositionIntoRootDomain(dinfo) before.
+    */
+    template <class Tptcl, class Tdinfo>
+    void exchangeMolecule(PS::ParticleSystem<Tptcl> &psys,
+                          Tdinfo                    &dinfo){
+
+        PS::S64 n_local = psys.getNumberOfParticleLocal();
+
+        //--- group local atoms by molecule
+        std::vector<std::pair<MD_DEFS::ID_type, PS::S64>> mol_index;
+        mol_index.reserve(n_local);
+        for(PS::S64 i=0; i<n_local; ++i){
+            mol_index.push_back( std::make_pair(psys[i].getMolID(), i) );
+        }
+        std::sort(mol_index.begin(), mol_index.end());
+
+        //--- replace the position by the center of mass in [0.0, 1.0)
+        PS::S64 i_begin = 0;
+        while(i_begin < n_local){
+            PS::S64 i_end = i_begin + 1;
+            while(i_end < n_local && mol_index[i_end].first == mol_index[i_begin].first) ++i_end;
+
+            const PS::F64vec pos_0  = psys[mol_index[i_begin].second].getPos();
+                  PS::F64vec d_pos  = 0.0;
+                  PS::F64    m_sum  = 0.0;
+            for(PS::S64 k=i_begin; k<i_end; ++k){
+                const auto& atom = psys[mol_index[k].second];
+                d_pos += atom.getMass()*Normalize::relativePosAdjustNorm( PS::F64vec(atom.getPos()) - pos_0 );
+                m_sum += atom.getMass();
+            }
+            PS::F64vec pos_c = pos_0;
+            if(m_sum > 0.0) pos_c += d_pos*(1.0/m_sum);
+            pos_c.x -= std::floor(pos_c.x);
+            pos_c.y -= std::floor(pos_c.y);
+            pos_c.z -= std::floor(pos_c.z);
+
+            for(PS::S64 k=i_begin; k<i_end; ++k){
+                auto& atom = psys[mol_index[k].second];
+                atom.setPosBuff(atom.getPos());
+                atom.setPos(pos_c);
+            }
+            i_begin = i_end;
+        }
+
+        psys.exchangeParticle(dinfo);
+
+        //--- restore the position
+        n_local = psys.getNumberOfParticleLocal();
+        for(PS::S64 i=0; i<n_local; ++i){
+            psys[i].setPos( psys[i].getPosBuff() );
+        }
+    }
+
+    //--- exchange particle by each atom or by whole molecule (see exchangeMolecule())
+    template <class Tptcl, class Tdinfo>
+    void exchangeParticle(      PS::ParticleSystem<Tptcl> &psys,
+                                Tdinfo                    &dinfo,
+                          const bool                       whole_molecule){
+        if(whole_molecule){
+            exchangeMolecule(psys, dinfo);
+        } else {
+            psys.exchangeParticle(dinfo);
+        }
+    }
+
 }
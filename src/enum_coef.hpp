@@ -16,6 +16,8 @@ enum class IntraFuncForm : int {
 
     cos,
     OPLS_3,
+
+    constraint,
 };
 
 enum class TorsionShape : int {
@@ -23,6 +25,13 @@ enum class TorsionShape : int {
     improper,
 };
 
+//--- solver for "constraint" form (selected for each model)
+enum class ConstraintSolver : int {
+    SHAKE,
+    LINCS,
+    RIGID,    // whole molecule is integrated as a rigid body
+};
+
 namespace ENUM {
 
     //====================================
@@ -34,6 +43,7 @@ namespace ENUM {
         {"anharmonic"   , IntraFuncForm::anharmonic  },
         {"cos"          , IntraFuncForm::cos         },
         {"OPLS_3"       , IntraFuncForm::OPLS_3      },
+        {"constraint"   , IntraFuncForm::constraint  },
     };
 
     static const std::map<IntraFuncForm, std::string> table_IntraFuncForm_str{
@@ -42,6 +52,7 @@ namespace ENUM {
         {IntraFuncForm::anharmonic  , "anharmonic"   },
         {IntraFuncForm::cos         , "cos"          },
         {IntraFuncForm::OPLS_3      , "OPLS_3"       },
+        {IntraFuncForm::constraint  , "constraint"   },
     };
 
     IntraFuncForm which_IntraFuncForm(const std::string &str){
@@ -95,12 +106,47 @@ namespace ENUM {
         }
     }
 
+    //====================================
+    //  enum interface for ConstraintSolver
+    //====================================
+    static const std::map<std::string, ConstraintSolver> table_str_ConstraintSolver{
+        {"SHAKE", ConstraintSolver::SHAKE},
+        {"LINCS", ConstraintSolver::LINCS},
+        {"RIGID", ConstraintSolver::RIGID},
+    };
+
+    static const std::map<ConstraintSolver, std::string> table_ConstraintSolver_str{
+        {ConstraintSolver::SHAKE, "SHAKE"},
+        {ConstraintSolver::LINCS, "LINCS"},
+        {ConstraintSolver::RIGID, "RIGID"},
+    };
+
+    ConstraintSolver which_ConstraintSolver(const std::string &str){
+        if(table_str_ConstraintSolver.find(str) != table_str_ConstraintSolver.end()){
+            return table_str_ConstraintSolver.at(str);
+        } else {
+            std::cerr << "  ConstraintSolver: input = " << str << std::endl;
+            throw std::out_of_range("undefined enum value in ConstraintSolver.");
+        }
+    }
+
+    std::string what(const ConstraintSolver &e){
+        if(table_ConstraintSolver_str.find(e) != table_ConstraintSolver_str.end()){
+            return table_ConstraintSolver_str.at(e);
+        } else {
+            using type_base = typename std::underlying_type<ConstraintSolver>::type;
+            std::cerr << "  ConstraintSolver: input = " << static_cast<type_base>(e) << std::endl;
+            throw std::out_of_range("undefined enum value in ConstraintSolver.");
+        }
+    }
+
 }
 
 //--- specialize for std::to_string()
 namespace std {
-    inline string to_string(const IntraFuncForm &e){ return ENUM::what(e); }
-    inline string to_string(const TorsionShape  &e){ return ENUM::what(e); }
+    inline string to_string(const IntraFuncForm    &e){ return ENUM::what(e); }
+    inline string to_string(const TorsionShape     &e){ return ENUM::what(e); }
+    inline string to_string(const ConstraintSolver &e){ return ENUM::what(e); }
 }
 
 //--- output function as "std::cout << (enum class::value)"
@@ -114,6 +160,11 @@ inline std::ostream& operator << (std::ostream& s, const TorsionShape &e){
     return s;
 }
 
+inline std::ostream& operator << (std::ostream& s, const ConstraintSolver &e){
+    s << ENUM::what(e);
+    return s;
+}
+
 //--- specialized hash function
 //        (support for gcc 4.x ~ 5.x. naturally supported by gcc 6.0 or later.)
 //         ref: http://qiita.com/taskie/items/479d649ea1b20bacbe03
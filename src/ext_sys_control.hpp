@@ -237,8 +237,9 @@ namespace EXT_SYS {
                          Teng    &eng     );
 
         template <class Tpsys>
-        void kick(const PS::F64 &dt,
-                        Tpsys   &psys);
+        void kick(const PS::F64    &dt,
+                        Tpsys      &psys,
+                  const RESPA_MODE  respa_mode = RESPA_MODE::all);
         template <class Tpsys>
         PS::F64 drift(const PS::F64 &dt,
                             Tpsys   &psys);
@@ -377,9 +378,10 @@ namespace EXT_SYS {
     }
 
     template <class Tpsys>
-    void Controller::kick(const PS::F64 &dt,
-                                Tpsys   &psys){
-        ATOM_MOVE::kick(dt, psys);
+    void Controller::kick(const PS::F64    &dt,
+                                Tpsys      &psys,
+                          const RESPA_MODE  respa_mode){
+        ATOM_MOVE::kick(dt, psys, respa_mode);
     }
 
     //--- after calling drift(), must call psys.adjustPositionIntoRootDomain(dinfo);
@@ -545,7 +547,7 @@ namespace EXT_SYS {
 
         PS::F64 v_mass         = PS::F64(n_deg_free + 3)*norm_tgt_temp/std::pow(this->state.NPT_freq, 2);
         PS::F64 n_deg_free_inv = 1.0 + 3.0/PS::F64(n_deg_free);
-        PS::F64 press_internal = (eng.virial.x + eng.virial.y + eng.virial.z);
+        PS::F64 press_internal = eng.virial_trace();   // with LJ tail correction
         PS::F64 g_n1kt         = PS::F64(n_deg_free + 1)*norm_tgt_temp;
 
         PS::F64 scale   = 1.0;
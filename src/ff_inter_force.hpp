@@ -5,12 +5,17 @@
 //***************************************************************************************
 #pragma once
 
+#include <cmath>
 #include <algorithm>
+#include <vector>
 
 #include <particle_simulator.hpp>
 #include <particle_mesh.hpp>
 
+#include "md_defs.hpp"
+#include "md_coef_table.hpp"
 #include "ff_inter_force_func.hpp"
+#include "ff_inter_force_table.hpp"
 
 
 namespace FORCE {
@@ -54,20 +59,795 @@ namespace FORCE {
                     force_IA.addPotLJ(       force_ij.getPotLJ()       );
                     force_IA.addForceLJ(     force_ij.getForceLJ()     );
                     force_IA.addVirialLJ(    force_ij.getVirialLJ()    );
-                    force_IA.addPotCoulomb(  force_ij.getPotCoulomb()  );
-                    force_IA.addFieldCoulomb(force_ij.getFieldCoulomb());
+                    force_IA.addPotCoulomb(   force_ij.getPotCoulomb()   );
+                    force_IA.addFieldCoulomb( force_ij.getFieldCoulomb() );
+                    force_IA.addVirialCoulomb(force_ij.getVirialCoulomb());
                 }
                 force[i].copyFromForce(force_IA);
 
-                //--- self consistant term for PM
-                force[i].addPotCoulomb( -ep_i[i].getCharge()*(208.0/70.0)*r_cut_coulomb_inv );
+                //--- self consistant term for PM or DSF
+                if( coulomb_DSF.isEnable() ){
+                    force[i].addPotCoulomb( -ep_i[i].getCharge()*coulomb_DSF.getSelfCoef() );
+                } else {
+                    force[i].addPotCoulomb( -ep_i[i].getCharge()*(208.0/70.0)*r_cut_coulomb_inv );
+                }
             }
         }
     };
 
+    namespace _Impl {
+
+        /*
+        *  @brief structure-of-arrays buffer of EPJ for the vectorized PP kernel.
+        *         one buffer is kept for each thread and reused for all interaction groups.
+        */
+        struct EpjSoA {
+            std::vector<PS::F64>          pos_x;
+            std::vector<PS::F64>          pos_y;
+            std::vector<PS::F64>          pos_z;
+            std::vector<PS::F64>          charge;
+            std::vector<PS::S32>          vdw_type;
+            std::vector<MD_DEFS::ID_type> id;
+            std::vector<MD_DEFS::ID_type> mol_id;
+
+            template <class Tepj>
+            void load(const Tepj *ep_j, const PS::S32 n_ep_j){
+                this->pos_x.resize(n_ep_j);
+                this->pos_y.resize(n_ep_j);
+                this->pos_z.resize(n_ep_j);
+                this->charge.resize(n_ep_j);
+                this->vdw_type.resize(n_ep_j);
+                this->id.resize(n_ep_j);
+                this->mol_id.resize(n_ep_j);
+
+                for(PS::S32 j=0; j<n_ep_j; ++j){
+                    const auto pos_j = ep_j[j].getPos();
+                    this->pos_x[j]    = pos_j.x;
+                    this->pos_y[j]    = pos_j.y;
+                    this->pos_z[j]    = pos_j.z;
+                    this->charge[j]   = ep_j[j].getCharge();
+                    this->vdw_type[j] = ep_j[j].getVDWType();
+                    this->id[j]       = ep_j[j].getAtomID();
+                    this->mol_id[j]   = ep_j[j].getMolID();
+                }
+            }
+        };
+
+        /*
+        *  @brief index list of EPJ for particle i.
+        *         inner: r <= min(r_cut_LJ, r_cut_coulomb) or masked pair. LJ and coulomb are evaluated.
+        *         outer: min(r_cut_LJ, r_cut_coulomb) < r <= max(r_cut_LJ, r_cut_coulomb).
+        *                only the interaction with the longer cut off is evaluated.
+        *         level: mask level of each inner entry (evaluated once in the split).
+        */
+        struct ShellList {
+            std::vector<PS::S32> inner;
+            std::vector<PS::S32> outer;
+            std::vector<PS::S32> level;
+
+            void resize(const PS::S32 n){
+                this->inner.resize(n);
+                this->outer.resize(n);
+                this->level.resize(n);
+            }
+        };
+
+        template <class Tepi>
+        inline void load_mask_scale(const Tepi &ep_i, PS::F64 *mask_LJ, PS::F64 *mask_cl){
+            for(PS::S32 k=0; k<=MD_DEFS::mask_bits_max_level; ++k){
+                mask_LJ[k] = 0.0;
+                mask_cl[k] = 0.0;
+            }
+            if( !ep_i.isMaskInline() ) return;
+
+            const auto& coef = MODEL::coef_table.mask_scale[ep_i.getMaskType()];
+            for(PS::S32 k=1; k<=MD_DEFS::mask_bits_max_level; ++k){
+                mask_LJ[k] = coef.scale_LJ[k]      - 1.0;
+                mask_cl[k] = coef.scale_coulomb[k] - 1.0;
+            }
+        }
+
+        //--- mask level of j for particle i. 0: no mask.
+        inline PS::S32 mask_level(const PS::U64          bits_i,
+                                  const MD_DEFS::ID_type id_i,
+                                  const MD_DEFS::ID_type mol_i,
+                                  const MD_DEFS::ID_type id_j,
+                                  const MD_DEFS::ID_type mol_j){
+            const PS::S64 d_id   = id_j - id_i;
+            const bool    in_bit = (mol_i == mol_j) && (d_id != 0) &&
+                                   (d_id >= -MD_DEFS::mask_bits_range) && (d_id <= MD_DEFS::mask_bits_range);
+            const PS::S64 slot   = in_bit ? MD_DEFS::mask_bits_slot(d_id) : 0;
+            return in_bit ? static_cast<PS::S32>( (bits_i >> (2*slot)) & 0x3 ) : 0;
+        }
+
+        //--- the bare coulomb term with the shift of tree part (zero in PM mode). f[0]: pot, f[1]: force.
+        inline void mask_coulomb_PM(const CoulombTreeShift &shift,
+                                    const PS::F64           r2,
+                                    const PS::F64           r2_inv,
+                                    const PS::F64           r_inv,
+                                          PS::F64          *f     ){
+            shift.eval(r2, r_inv, f);
+            f[0] += r_inv;
+            f[1] += r2_inv;
+        }
+
+        /*
+        *  @brief radial functions: r^-12, r^-6, coulomb (pot), coulomb (force).
+        *  @details "with_PM = true" : coulomb is PM-split. the mask is applied to the bare coulomb term
+        *                              (and the shift of tree part in SF_TREE mode).
+        *           "with_PM = false": coulomb is DSF. the mask is applied to the DSF term itself.
+        *           "self_coef" is the coefficient of self term: pot_i += -q_i*self_coef.
+        *           "mask()" gives the coulomb term to be scaled by the intramolecular mask. f_mask[0]: pot, f_mask[1]: force.
+        */
+        struct RadialFuncAnalytic {
+            static constexpr bool with_PM = true;
+            PS::F64 self_coef;
+            PS::F64 r_cut_coulomb_inv;
+            const CoulombTreeShift *shift;
+
+            inline void operator () (const PS::F64  r2,
+                                     const PS::F64  r2_inv,
+                                     const PS::F64  r_inv,
+                                           PS::F64 *f     ) const {
+                const PS::F64 r6_inv  = r2_inv*r2_inv*r2_inv;
+                const PS::F64 r_scale = 2.0*(r2*r_inv)*this->r_cut_coulomb_inv;
+                f[0] = r6_inv*r6_inv;
+                f[1] = r6_inv;
+                f[2] = S2_pcut_bf(r_scale)*r_inv;
+                f[3] = S2_fcut_bf(r_scale)*r2_inv;
+            }
+            inline void mask(const PS::F64  r2,
+                             const PS::F64  r2_inv,
+                             const PS::F64  r_inv,
+                             const PS::F64 *,
+                                   PS::F64 *f_mask) const {
+                mask_coulomb_PM(*(this->shift), r2, r2_inv, r_inv, f_mask);
+            }
+        };
+        struct RadialFuncDSF {
+            static constexpr bool with_PM = false;
+            PS::F64 self_coef;
+            const CoulombDSF *dsf;
+
+            inline void operator () (const PS::F64  r2,
+                                     const PS::F64  r2_inv,
+                                     const PS::F64  r_inv,
+                                           PS::F64 *f     ) const {
+                const PS::F64 r6_inv = r2_inv*r2_inv*r2_inv;
+                f[0] = r6_inv*r6_inv;
+                f[1] = r6_inv;
+                this->dsf->eval(r2, r_inv, f + 2);
+            }
+            inline void mask(const PS::F64  ,
+                             const PS::F64  ,
+                             const PS::F64  ,
+                             const PS::F64 *f,
+                                   PS::F64 *f_mask) const {
+                f_mask[0] = f[2];
+                f_mask[1] = f[3];
+            }
+        };
+        template <bool PM>
+        struct RadialFuncTable {
+            static constexpr bool with_PM = PM;
+            PS::F64 self_coef;
+            const ForceTable       *table;
+            const CoulombTreeShift *shift;
+
+            inline void operator () (const PS::F64  r2,
+                                     const PS::F64  ,
+                                     const PS::F64  ,
+                                           PS::F64 *f ) const {
+                this->table->eval(r2, f);
+            }
+            inline void mask(const PS::F64  r2,
+                             const PS::F64  r2_inv,
+                             const PS::F64  r_inv,
+                             const PS::F64 *f,
+                                   PS::F64 *f_mask) const {
+                if(PM){
+                    mask_coulomb_PM(*(this->shift), r2, r2_inv, r_inv, f_mask);
+                } else {
+                    f_mask[0] = f[2];
+                    f_mask[1] = f[3];
+                }
+            }
+        };
+
+        //--- accumulator of PP interaction for particle i
+        struct ForceAccum {
+            PS::F64 pot_LJ  = 0.0;
+            PS::F64 f_LJ_x  = 0.0, f_LJ_y  = 0.0, f_LJ_z  = 0.0;
+            PS::F64 vir_x   = 0.0, vir_y   = 0.0, vir_z   = 0.0;
+            PS::F64 pot_cl  = 0.0;
+            PS::F64 field_x = 0.0, field_y = 0.0, field_z = 0.0;
+            PS::F64 vcl_x   = 0.0, vcl_y   = 0.0, vcl_z   = 0.0;
+
+            void clear(){ *this = ForceAccum{}; }
+
+            template <class Tforce>
+            void writeBack(Tforce &force) const {
+                Tforce force_IA;
+                force_IA.clear();
+                force_IA.addPotLJ(        this->pot_LJ );
+                force_IA.addForceLJ(      PS::F64vec{this->f_LJ_x,  this->f_LJ_y,  this->f_LJ_z } );
+                force_IA.addVirialLJ(     PS::F64vec{this->vir_x,   this->vir_y,   this->vir_z  } );
+                force_IA.addPotCoulomb(   this->pot_cl );
+                force_IA.addFieldCoulomb( PS::F64vec{this->field_x, this->field_y, this->field_z} );
+                force_IA.addVirialCoulomb(PS::F64vec{this->vcl_x,   this->vcl_y,   this->vcl_z  } );
+                force.copyFromForce(force_IA);
+            }
+        };
+
+        /*
+        *  @brief SoA buffer of 3-site water molecule (see MODEL::CoefTable::make_water_kernel_flag()).
+        *         [s][m]: site s of molecule m.
+        */
+        struct WaterSoA {
+            std::vector<PS::F64>          pos_x[3];
+            std::vector<PS::F64>          pos_y[3];
+            std::vector<PS::F64>          pos_z[3];
+            std::vector<PS::F64>          charge[3];
+            std::vector<PS::S32>          index[3];   // index in EPI or EPJ array
+            std::vector<PS::S32>          vdw_type;   // LJ type of the 1st site
+            std::vector<MD_DEFS::ID_type> mol_id;
+            PS::S32                       n_mol = 0;
+
+            void clear(){
+                for(PS::S32 s=0; s<3; ++s){
+                    this->pos_x[s].clear();
+                    this->pos_y[s].clear();
+                    this->pos_z[s].clear();
+                    this->charge[s].clear();
+                    this->index[s].clear();
+                }
+                this->vdw_type.clear();
+                this->mol_id.clear();
+                this->n_mol = 0;
+            }
+
+            /*
+            *  @brief collect the water molecules whose all sites are found once in ep.
+            *  @param[out] in_water flag for each particle in ep. "1": the particle is collected.
+            *  @details the molecule which has duplicated image or wide site distance is not collected
+            *           (it is evaluated in the generic kernel).
+            */
+            template <class Tep>
+            void load(const Tep              *ep,
+                      const PS::S32           n_ep,
+                      const PS::F64vec       &box,
+                            std::vector<PS::S32> &order,
+                            std::vector<char>    &in_water){
+                this->clear();
+                in_water.assign(n_ep, 0);
+
+                order.clear();
+                for(PS::S32 j=0; j<n_ep; ++j){
+                    if( ep[j].isWaterSite() ) order.push_back(j);
+                }
+                if(order.size() < 3) return;
+
+                std::sort(order.begin(), order.end(),
+                          [&ep](const PS::S32 a, const PS::S32 b){
+                              return (ep[a].getAtomID() <  ep[b].getAtomID()) ||
+                                     (ep[a].getAtomID() == ep[b].getAtomID() && a < b);
+                          });
+
+                const PS::S32 n_site   = order.size();
+                const PS::F64 r2_site  = MD_DEFS::water_site_r_max*MD_DEFS::water_site_r_max;
+                for(PS::S32 k=0; k+2<n_site; ++k){
+                    const auto& ep_0 = ep[order[k]];
+                    if(ep_0.getWaterSite() != 0) continue;
+
+                    const MD_DEFS::ID_type id_0 = ep_0.getAtomID();
+                    if( k > 0          && ep[order[k-1]].getAtomID() == id_0     ) continue;  // duplicated image
+                    if( ep[order[k+1]].getAtomID() != id_0 + 1 ||
+                        ep[order[k+2]].getAtomID() != id_0 + 2                   ) continue;
+                    if( k+3 < n_site   && ep[order[k+3]].getAtomID() == id_0 + 2 ) continue;  // duplicated image
+
+                    bool flag = true;
+                    for(PS::S32 s=1; s<3; ++s){
+                        const PS::F64vec r_vec = ep[order[k+s]].getPos() - ep_0.getPos();
+                        const PS::F64vec r_real{r_vec.x*box.x, r_vec.y*box.y, r_vec.z*box.z};
+                        flag = flag && (ep[order[k+s]].getMolID()     == ep_0.getMolID()) &&
+                                       (ep[order[k+s]].getWaterSite() == s              ) &&
+                                       (r_real*r_real <= r2_site                          );
+                    }
+                    if( !flag ) continue;
+
+                    for(PS::S32 s=0; s<3; ++s){
+                        const PS::S32 j     = order[k+s];
+                        const auto    pos_j = ep[j].getPos();
+                        this->pos_x[s].push_back(pos_j.x);
+                        this->pos_y[s].push_back(pos_j.y);
+                        this->pos_z[s].push_back(pos_j.z);
+                        this->charge[s].push_back(ep[j].getCharge());
+                        this->index[s].push_back(j);
+                        in_water[j] = 1;
+                    }
+                    this->vdw_type.push_back(ep_0.getVDWType());
+                    this->mol_id.push_back(ep_0.getMolID());
+                    ++(this->n_mol);
+                }
+            }
+        };
+
+        struct WaterBuff {
+            WaterSoA             epi;
+            WaterSoA             epj;
+            std::vector<PS::S32> order;
+            std::vector<char>    in_water_i;
+            std::vector<char>    in_water_j;
+            std::vector<PS::S32> pair_list;
+        };
+        inline WaterBuff& getWaterBuff(){
+            static thread_local WaterBuff buff;
+            return buff;
+        }
+
+        /*
+        *  @brief 1x3 block of site "s_i" in water molecule "m_i" and the water molecules in pair_list.
+        *         the LJ is evaluated between the 1st sites only (compile time flag "with_LJ").
+        *  @details the own molecule is not included in pair_list, then no mask is applied.
+        */
+        template <bool with_LJ, class Tfunc>
+        void calcForceWater_site(const WaterSoA      &water_i,
+                                 const PS::S32        m_i,
+                                 const PS::S32        s_i,
+                                 const WaterSoA      &water_j,
+                                 const PS::S32       *pair_list,
+                                 const PS::S32        n_pair,
+                                 const MODEL::CoefLJ *coef_i,
+                                 const PS::F64vec    &box,
+                                 const PS::F64        r2_cut_LJ,
+                                 const PS::F64        r2_cut_coulomb,
+                                 const Tfunc         &func,
+                                       ForceAccum    &acc    ){
+
+            const PS::F64 x_i = water_i.pos_x[s_i][m_i];
+            const PS::F64 y_i = water_i.pos_y[s_i][m_i];
+            const PS::F64 z_i = water_i.pos_z[s_i][m_i];
+
+            const PS::F64 *x_j[3] = { water_j.pos_x[0].data(),  water_j.pos_x[1].data(),  water_j.pos_x[2].data()  };
+            const PS::F64 *y_j[3] = { water_j.pos_y[0].data(),  water_j.pos_y[1].data(),  water_j.pos_y[2].data()  };
+            const PS::F64 *z_j[3] = { water_j.pos_z[0].data(),  water_j.pos_z[1].data(),  water_j.pos_z[2].data()  };
+            const PS::F64 *q_j[3] = { water_j.charge[0].data(), water_j.charge[1].data(), water_j.charge[2].data() };
+            const PS::S32 *type_j = water_j.vdw_type.data();
+
+            PS::F64 pot_LJ  = 0.0;
+            PS::F64 f_LJ_x  = 0.0, f_LJ_y  = 0.0, f_LJ_z  = 0.0;
+            PS::F64 vir_x   = 0.0, vir_y   = 0.0, vir_z   = 0.0;
+            PS::F64 pot_cl  = 0.0;
+            PS::F64 field_x = 0.0, field_y = 0.0, field_z = 0.0;
+            PS::F64 vcl_x   = 0.0, vcl_y   = 0.0, vcl_z   = 0.0;
+
+            #ifdef PARTICLE_SIMULATOR_THREAD_PARALLEL
+                #pragma omp simd reduction(+:pot_LJ, f_LJ_x, f_LJ_y, f_LJ_z, vir_x, vir_y, vir_z, pot_cl, field_x, field_y, field_z, vcl_x, vcl_y, vcl_z)
+            #endif
+            for(PS::S32 k=0; k<n_pair; ++k){
+                const PS::S32 m_j = pair_list[k];
+
+                for(PS::S32 s_j=0; s_j<3; ++s_j){
+                    const PS::F64 rx = (x_i - x_j[s_j][m_j])*box.x;
+                    const PS::F64 ry = (y_i - y_j[s_j][m_j])*box.y;
+                    const PS::F64 rz = (z_i - z_j[s_j][m_j])*box.z;
+                    const PS::F64 r2 = rx*rx + ry*ry + rz*rz;
+
+                    const PS::F64 r2_inv = 1.0/r2;
+                    const PS::F64 r_inv  = std::sqrt(r2_inv);
+
+                    PS::F64 f[4];
+                    func(r2, r2_inv, r_inv, f);
+
+                    //--- VDW part (1st site - 1st site only)
+                    if(with_LJ && s_j == 0){
+                        const PS::F64 factor_LJ = (r2 <= r2_cut_LJ) ? 1.0 : 0.0;
+                        const PS::F64 sb6  = factor_LJ*coef_i[type_j[m_j]].c6*f[1];
+                        const PS::F64 sb12 = factor_LJ*coef_i[type_j[m_j]].c12*f[0];
+                        const PS::F64 f_LJ = 12.0*(sb12 - sb6)*r2_inv;
+
+                        pot_LJ += 0.5*(sb12 - 2.0*sb6);
+                        f_LJ_x += f_LJ*rx;
+                        f_LJ_y += f_LJ*ry;
+                        f_LJ_z += f_LJ*rz;
+                        vir_x  += 0.5*rx*(f_LJ*rx);
+                        vir_y  += 0.5*ry*(f_LJ*ry);
+                        vir_z  += 0.5*rz*(f_LJ*rz);
+                    }
+
+                    //--- coulomb PP part
+                    const PS::F64 factor_PM = (r2 <= r2_cut_coulomb) ? 1.0 : 0.0;
+                    const PS::F64 f_cl      = factor_PM*f[3]*q_j[s_j][m_j];
+
+                    pot_cl  += factor_PM*f[2]*q_j[s_j][m_j];
+                    field_x += f_cl*rx;
+                    field_y += f_cl*ry;
+                    field_z += f_cl*rz;
+                    vcl_x   += 0.5*rx*(f_cl*rx);
+                    vcl_y   += 0.5*ry*(f_cl*ry);
+                    vcl_z   += 0.5*rz*(f_cl*rz);
+                }
+            }
+
+            acc.pot_LJ  += pot_LJ;
+            acc.f_LJ_x  += f_LJ_x;
+            acc.f_LJ_y  += f_LJ_y;
+            acc.f_LJ_z  += f_LJ_z;
+            acc.vir_x   += vir_x;
+            acc.vir_y   += vir_y;
+            acc.vir_z   += vir_z;
+            acc.pot_cl  += pot_cl;
+            acc.field_x += field_x;
+            acc.field_y += field_y;
+            acc.field_z += field_z;
+            acc.vcl_x   += vcl_x;
+            acc.vcl_y   += vcl_y;
+            acc.vcl_z   += vcl_z;
+        }
+
+        /*
+        *  @brief intramolecular part for site "s_i" in water molecule "m_j" (the own molecule found in EPJ).
+        *  @details all intramolecular pairs are excluded (scaling factor 0.0),
+        *           then only the cancelation of the bare coulomb term included in PM part remains
+        *           (with the shift of tree part in SF_TREE mode, zero in DSF).
+        */
+        template <class Tfunc>
+        void calcForceWater_intra(const WaterSoA   &water_i,
+                                  const PS::S32     m_i,
+                                  const PS::S32     s_i,
+                                  const WaterSoA   &water_j,
+                                  const PS::S32     m_j,
+                                  const PS::F64vec &box,
+                                  const PS::F64     r2_cut_coulomb,
+                                  const Tfunc      &func,
+                                        ForceAccum &acc    ){
+
+            for(PS::S32 s_j=0; s_j<3; ++s_j){
+                if(s_j == s_i) continue;
+
+                const PS::F64 rx = (water_i.pos_x[s_i][m_i] - water_j.pos_x[s_j][m_j])*box.x;
+                const PS::F64 ry = (water_i.pos_y[s_i][m_i] - water_j.pos_y[s_j][m_j])*box.y;
+                const PS::F64 rz = (water_i.pos_z[s_i][m_i] - water_j.pos_z[s_j][m_j])*box.z;
+                const PS::F64 r2 = rx*rx + ry*ry + rz*rz;
+
+                const PS::F64 r2_inv = 1.0/r2;
+                const PS::F64 r_inv  = std::sqrt(r2_inv);
+
+                PS::F64 f[4];
+                func(r2, r2_inv, r_inv, f);
+
+                const PS::F64 factor_PM = (r2 <= r2_cut_coulomb) ? 1.0 : 0.0;
+                const PS::F64 q_j       = water_j.charge[s_j][m_j];
+                PS::F64 f_mask[2];
+                func.mask(r2, r2_inv, r_inv, f, f_mask);
+                const PS::F64 f_cl      = (factor_PM*f[3] - f_mask[1])*q_j;
+
+                acc.pot_cl  += (factor_PM*f[2] - f_mask[0])*q_j;
+                acc.field_x += f_cl*rx;
+                acc.field_y += f_cl*ry;
+                acc.field_z += f_cl*rz;
+                acc.vcl_x   += 0.5*rx*(f_cl*rx);
+                acc.vcl_y   += 0.5*ry*(f_cl*ry);
+                acc.vcl_z   += 0.5*rz*(f_cl*rz);
+            }
+        }
+
+        inline EpjSoA& getEpjSoA_buff(){
+            static thread_local EpjSoA buff;
+            return buff;
+        }
+        inline ShellList& getShellList_buff(){
+            static thread_local ShellList buff;
+            return buff;
+        }
+        inline std::vector<ForceAccum>& getForceAccum_buff(){
+            static thread_local std::vector<ForceAccum> buff;
+            return buff;
+        }
+
+        /*
+        *  @brief PP kernel body with dual-radius shells. the radial functions are given by Tfunc.
+        *  @details the same atom is excluded from both shells.
+        *           the intramolecular mask encoded in EPI (AtomMaskBits) is applied inline in the inner shell.
+        *           the pair of 3-site water molecules found in both of EPI and EPJ is evaluated
+        *           by the molecule-pair kernel "calcForceWater_site()" instead of the shells.
+        */
+        template <class Tepi, class Tepj, class Tforce, class Tfunc>
+        void calcForceShort_shell(const Tepi    *ep_i,
+                                  const PS::S32  n_ep_i,
+                                  const Tepj    *ep_j,
+                                  const PS::S32  n_ep_j,
+                                        Tforce  *force,
+                                  const Tfunc   &func  ){
+
+            const PS::F64 r_cut_LJ          = Normalize::realCutOff( Tepi::getRcut_LJ() );
+            const PS::F64 r2_cut_LJ         = r_cut_LJ*r_cut_LJ;
+            const PS::F64 r_cut_coulomb     = Normalize::realCutOff( Tepi::getRcut_coulomb() );
+            const PS::F64 r2_cut_coulomb    = r_cut_coulomb*r_cut_coulomb;
+
+            const PS::F64 r2_inner = std::min(r2_cut_LJ, r2_cut_coulomb);
+            const PS::F64 r2_outer = std::max(r2_cut_LJ, r2_cut_coulomb);
+            const bool    outer_LJ = (r2_cut_LJ > r2_cut_coulomb);
+
+            const PS::F64vec box = Normalize::getBoxSize();
+
+            //--- transpose EPJ into SoA
+            auto& epj_buff = getEpjSoA_buff();
+            epj_buff.load(ep_j, n_ep_j);
+
+            const PS::F64          *x_j    = epj_buff.pos_x.data();
+            const PS::F64          *y_j    = epj_buff.pos_y.data();
+            const PS::F64          *z_j    = epj_buff.pos_z.data();
+            const PS::F64          *q_j    = epj_buff.charge.data();
+            const PS::S32          *type_j = epj_buff.vdw_type.data();
+            const MD_DEFS::ID_type *id_j   = epj_buff.id.data();
+            const MD_DEFS::ID_type *mol_j  = epj_buff.mol_id.data();
+
+            auto& shell = getShellList_buff();
+            shell.resize(n_ep_j);
+            PS::S32 *idx_inner = shell.inner.data();
+            PS::S32 *idx_outer = shell.outer.data();
+            PS::S32 *lv_inner  = shell.level.data();
+
+            auto& acc = getForceAccum_buff();
+            acc.resize(n_ep_i);
+
+            //--- 3-site water molecules found in EPI and EPJ
+            auto& water = getWaterBuff();
+            water.epi.load(ep_i, n_ep_i, box, water.order, water.in_water_i);
+            if(water.epi.n_mol > 0){
+                water.epj.load(ep_j, n_ep_j, box, water.order, water.in_water_j);
+            } else {
+                water.epj.clear();
+                water.in_water_j.assign(n_ep_j, 0);
+            }
+            const char *in_water_j = water.in_water_j.data();
+
+            //--- LJ coefficient matrix
+            const MODEL::CoefLJ *coef_LJ    = MODEL::coef_table.vdw_matrix.data();
+            const PS::S32        n_vdw_type = MODEL::coef_table.n_vdw_type;
+
+            for(PS::S32 i=0; i<n_ep_i; ++i){
+                const PS::F64vec       pos_i  = ep_i[i].getPos();
+                const MD_DEFS::ID_type id_i   = ep_i[i].getAtomID();
+                const MD_DEFS::ID_type mol_i  = ep_i[i].getMolID();
+                const PS::U64          bits_i = ep_i[i].getMaskBits();
+                const MODEL::CoefLJ   *coef_i = coef_LJ + ep_i[i].getVDWType()*n_vdw_type;
+
+                //--- scaling factor for each mask level ("-1.0" is cancelation for the non-masked term)
+                PS::F64 mask_LJ_i[MD_DEFS::mask_bits_max_level + 1];
+                PS::F64 mask_cl_i[MD_DEFS::mask_bits_max_level + 1];
+                load_mask_scale(ep_i[i], mask_LJ_i, mask_cl_i);
+
+                //--- the pair between water molecules is evaluated in the water kernel
+                const bool water_i = (water.in_water_i[i] != 0);
+
+                //--- split EPJ into inner and outer shell (branch-free compaction)
+                PS::S32 n_inner = 0;
+                PS::S32 n_outer = 0;
+                for(PS::S32 j=0; j<n_ep_j; ++j){
+                    const PS::F64 rx = (pos_i.x - x_j[j])*box.x;
+                    const PS::F64 ry = (pos_i.y - y_j[j])*box.y;
+                    const PS::F64 rz = (pos_i.z - z_j[j])*box.z;
+                    const PS::F64 r2 = (id_i == id_j[j]) ? 1.0e20 : rx*rx + ry*ry + rz*rz;
+
+                    const bool skip     = water_i && (in_water_j[j] != 0);
+                    const PS::S32 level    = mask_level(bits_i, id_i, mol_i, id_j[j], mol_j[j]);
+                    const bool    in_inner = ((r2 <= r2_inner) || (level > 0)) && !skip;
+                    const bool    in_outer = (r2 <= r2_outer) && !in_inner && !skip;
+
+                    idx_inner[n_inner] = j;
+                    lv_inner[n_inner]  = level;
+                    idx_outer[n_outer] = j;
+                    n_inner += in_inner ? 1 : 0;
+                    n_outer += in_outer ? 1 : 0;
+                }
+
+                PS::F64 pot_LJ  = 0.0;
+                PS::F64 f_LJ_x  = 0.0, f_LJ_y  = 0.0, f_LJ_z  = 0.0;
+                PS::F64 vir_x   = 0.0, vir_y   = 0.0, vir_z   = 0.0;
+                PS::F64 pot_cl  = 0.0;
+                PS::F64 field_x = 0.0, field_y = 0.0, field_z = 0.0;
+                PS::F64 vcl_x   = 0.0, vcl_y   = 0.0, vcl_z   = 0.0;
+
+                //--- inner shell: LJ + coulomb
+                #ifdef PARTICLE_SIMULATOR_THREAD_PARALLEL
+                    #pragma omp simd reduction(+:pot_LJ, f_LJ_x, f_LJ_y, f_LJ_z, vir_x, vir_y, vir_z, pot_cl, field_x, field_y, field_z, vcl_x, vcl_y, vcl_z)
+                #endif
+                for(PS::S32 k=0; k<n_inner; ++k){
+                    const PS::S32 j = idx_inner[k];
+
+                    const PS::F64 rx = (pos_i.x - x_j[j])*box.x;
+                    const PS::F64 ry = (pos_i.y - y_j[j])*box.y;
+                    const PS::F64 rz = (pos_i.z - z_j[j])*box.z;
+                    const PS::F64 r2 = rx*rx + ry*ry + rz*rz;
+
+                    const PS::F64 r2_inv = 1.0/r2;
+                    const PS::F64 r_inv  = std::sqrt(r2_inv);
+
+                    PS::F64 f[4];
+                    func(r2, r2_inv, r_inv, f);
+
+                    //--- intramolecular mask (the masked pair is not cut off)
+                    const PS::F64 mask_LJ = mask_LJ_i[lv_inner[k]];
+                    const PS::F64 mask_cl = mask_cl_i[lv_inner[k]];
+
+                    //--- cut off radius
+                    const PS::F64 factor_LJ = ((r2 <= r2_cut_LJ     ) ? 1.0 : 0.0) + mask_LJ;
+                    const PS::F64 factor_PM =  (r2 <= r2_cut_coulomb) ? 1.0 : 0.0;
+
+                    //--- VDW part
+                    const PS::F64 sb6  = factor_LJ*coef_i[type_j[j]].c6*f[1];
+                    const PS::F64 sb12 = factor_LJ*coef_i[type_j[j]].c12*f[0];
+                    const PS::F64 f_LJ = 12.0*(sb12 - sb6)*r2_inv;
+
+                    pot_LJ += 0.5*(sb12 - 2.0*sb6);                    // 0.5* for double count
+                    f_LJ_x += f_LJ*rx;
+                    f_LJ_y += f_LJ*ry;
+                    f_LJ_z += f_LJ*rz;
+                    vir_x  += 0.5*rx*(f_LJ*rx);
+                    vir_y  += 0.5*ry*(f_LJ*ry);
+                    vir_z  += 0.5*rz*(f_LJ*rz);
+
+                    //--- coulomb PP part (mask is applied to the bare coulomb term with tree shift, or DSF term itself)
+                    PS::F64 f_mask[2];
+                    func.mask(r2, r2_inv, r_inv, f, f_mask);
+                    const PS::F64 f_cl     = (factor_PM*f[3] + mask_cl*f_mask[1])*q_j[j];
+
+                    pot_cl  += (factor_PM*f[2] + mask_cl*f_mask[0])*q_j[j];
+                    field_x += f_cl*rx;
+                    field_y += f_cl*ry;
+                    field_z += f_cl*rz;
+                    vcl_x   += 0.5*rx*(f_cl*rx);
+                    vcl_y   += 0.5*ry*(f_cl*ry);
+                    vcl_z   += 0.5*rz*(f_cl*rz);
+                }
+
+                //--- outer shell: the interaction with the longer cut off only
+                if(outer_LJ){
+                    #ifdef PARTICLE_SIMULATOR_THREAD_PARALLEL
+                        #pragma omp simd reduction(+:pot_LJ, f_LJ_x, f_LJ_y, f_LJ_z, vir_x, vir_y, vir_z)
+                    #endif
+                    for(PS::S32 k=0; k<n_outer; ++k){
+                        const PS::S32 j = idx_outer[k];
+
+                        const PS::F64 rx = (pos_i.x - x_j[j])*box.x;
+                        const PS::F64 ry = (pos_i.y - y_j[j])*box.y;
+                        const PS::F64 rz = (pos_i.z - z_j[j])*box.z;
+                        const PS::F64 r2 = rx*rx + ry*ry + rz*rz;
+
+                        const PS::F64 r2_inv = 1.0/r2;
+                        const PS::F64 r6_inv = r2_inv*r2_inv*r2_inv;
+
+                        const PS::F64 sb6  = coef_i[type_j[j]].c6*r6_inv;
+                        const PS::F64 sb12 = coef_i[type_j[j]].c12*r6_inv*r6_inv;
+                        const PS::F64 f_LJ = 12.0*(sb12 - sb6)*r2_inv;
+
+                        pot_LJ += 0.5*(sb12 - 2.0*sb6);
+                        f_LJ_x += f_LJ*rx;
+                        f_LJ_y += f_LJ*ry;
+                        f_LJ_z += f_LJ*rz;
+                        vir_x  += 0.5*rx*(f_LJ*rx);
+                        vir_y  += 0.5*ry*(f_LJ*ry);
+                        vir_z  += 0.5*rz*(f_LJ*rz);
+                    }
+                } else {
+                    #ifdef PARTICLE_SIMULATOR_THREAD_PARALLEL
+                        #pragma omp simd reduction(+:pot_cl, field_x, field_y, field_z, vcl_x, vcl_y, vcl_z)
+                    #endif
+                    for(PS::S32 k=0; k<n_outer; ++k){
+                        const PS::S32 j = idx_outer[k];
+
+                        const PS::F64 rx = (pos_i.x - x_j[j])*box.x;
+                        const PS::F64 ry = (pos_i.y - y_j[j])*box.y;
+                        const PS::F64 rz = (pos_i.z - z_j[j])*box.z;
+                        const PS::F64 r2 = rx*rx + ry*ry + rz*rz;
+
+                        const PS::F64 r2_inv = 1.0/r2;
+                        const PS::F64 r_inv  = std::sqrt(r2_inv);
+
+                        PS::F64 f[4];
+                        func(r2, r2_inv, r_inv, f);
+
+                        const PS::F64 f_cl = f[3]*q_j[j];
+
+                        pot_cl  += f[2]*q_j[j];
+                        field_x += f_cl*rx;
+                        field_y += f_cl*ry;
+                        field_z += f_cl*rz;
+                        vcl_x   += 0.5*rx*(f_cl*rx);
+                        vcl_y   += 0.5*ry*(f_cl*ry);
+                        vcl_z   += 0.5*rz*(f_cl*rz);
+                    }
+                }
+
+                auto& acc_i = acc[i];
+                acc_i.pot_LJ  = pot_LJ;
+                acc_i.f_LJ_x  = f_LJ_x;
+                acc_i.f_LJ_y  = f_LJ_y;
+                acc_i.f_LJ_z  = f_LJ_z;
+                acc_i.vir_x   = vir_x;
+                acc_i.vir_y   = vir_y;
+                acc_i.vir_z   = vir_z;
+                acc_i.pot_cl  = pot_cl;
+                acc_i.field_x = field_x;
+                acc_i.field_y = field_y;
+                acc_i.field_z = field_z;
+                acc_i.vcl_x   = vcl_x;
+                acc_i.vcl_y   = vcl_y;
+                acc_i.vcl_z   = vcl_z;
+            }
+
+            //--- water - water molecule pair
+            if(water.epj.n_mol > 0){
+                const PS::F64 r_mol  = std::sqrt(r2_outer) + 2.0*MD_DEFS::water_site_r_max;
+                const PS::F64 r2_mol = r_mol*r_mol;
+
+                const PS::F64          *x_O_j   = water.epj.pos_x[0].data();
+                const PS::F64          *y_O_j   = water.epj.pos_y[0].data();
+                const PS::F64          *z_O_j   = water.epj.pos_z[0].data();
+                const MD_DEFS::ID_type *mol_w_j = water.epj.mol_id.data();
+
+                water.pair_list.resize(water.epj.n_mol);
+                PS::S32 *pair_list = water.pair_list.data();
+
+                for(PS::S32 m_i=0; m_i<water.epi.n_mol; ++m_i){
+                    const PS::F64          x_O_i  = water.epi.pos_x[0][m_i];
+                    const PS::F64          y_O_i  = water.epi.pos_y[0][m_i];
+                    const PS::F64          z_O_i  = water.epi.pos_z[0][m_i];
+                    const MD_DEFS::ID_type mol_i  = water.epi.mol_id[m_i];
+                    const MODEL::CoefLJ   *coef_i = coef_LJ + water.epi.vdw_type[m_i]*n_vdw_type;
+
+                    //--- cut off test at the 1st site (branch-free compaction), the own molecule is separated.
+                    PS::S32 n_pair = 0;
+                    PS::S32 m_own  = -1;
+                    for(PS::S32 m_j=0; m_j<water.epj.n_mol; ++m_j){
+                        const PS::F64 rx = (x_O_i - x_O_j[m_j])*box.x;
+                        const PS::F64 ry = (y_O_i - y_O_j[m_j])*box.y;
+                        const PS::F64 rz = (z_O_i - z_O_j[m_j])*box.z;
+                        const PS::F64 r2 = rx*rx + ry*ry + rz*rz;
+
+                        const bool own = (mol_i == mol_w_j[m_j]);
+                        pair_list[n_pair] = m_j;
+                        n_pair += ( (r2 <= r2_mol) && !own ) ? 1 : 0;
+                        m_own   = own ? m_j : m_own;
+                    }
+
+                    calcForceWater_site<true >(water.epi, m_i, 0, water.epj, pair_list, n_pair, coef_i, box,
+                                               r2_cut_LJ, r2_cut_coulomb, func, acc[water.epi.index[0][m_i]]);
+                    calcForceWater_site<false>(water.epi, m_i, 1, water.epj, pair_list, n_pair, coef_i, box,
+                                               r2_cut_LJ, r2_cut_coulomb, func, acc[water.epi.index[1][m_i]]);
+                    calcForceWater_site<false>(water.epi, m_i, 2, water.epj, pair_list, n_pair, coef_i, box,
+                                               r2_cut_LJ, r2_cut_coulomb, func, acc[water.epi.index[2][m_i]]);
+
+                    //--- own molecule (when it is not found as complete water in EPJ, it is evaluated in the shells)
+                    if(m_own >= 0){
+                        for(PS::S32 s_i=0; s_i<3; ++s_i){
+                            calcForceWater_intra(water.epi, m_i, s_i, water.epj, m_own, box,
+                                                 r2_cut_coulomb, func, acc[water.epi.index[s_i][m_i]]);
+                        }
+                    }
+                }
+            }
+
+            for(PS::S32 i=0; i<n_ep_i; ++i){
+                acc[i].writeBack(force[i]);
+
+                //--- self consistant term for PM or DSF
+                force[i].addPotCoulomb( -ep_i[i].getCharge()*func.self_coef );
+            }
+        }
+
+    }
+
     /*
-    *  @breif optimized implementation: intramolecular mask is ignored in this function.
-    *         when use this function, must consider mask by the function of "calcForceIntraMask()" in below.
+    *  @breif optimized implementation: intramolecular mask encoded in EPI (AtomMaskBits) is applied inline.
+    *         when use this function, must consider the mask not encoded in bits by the function of "calcForceIntraMask()" in below.
+    *  @details EPJ is transposed into SoA buffer and split into the inner shell (LJ + coulomb) and
+    *           the outer shell (the interaction with the longer cut off only) for each EPI.
+    *           the loop on each shell is written without branch for auto-vectorization
+    *           (AVX2, AVX-512 by "-march=native", "#pragma omp simd" in OpenMP mode).
+    *           The result is same to "calcForceShort_IJ_coulombSP_LJ12_6()" + "calcForceMask_IJ_coulombSP_LJ12_6()".
     */
     struct calcForceShort{
         template <class Tepi, class Tepj, class Tforce>
@@ -77,35 +857,58 @@ namespace FORCE {
                           const PS::S32  n_ep_j,
                                 Tforce  *force){
 
-            const PS::F64 r_cut_LJ          = Normalize::realCutOff( Tepi::getRcut_LJ() );
-            const PS::F64 r2_cut_LJ         = r_cut_LJ*r_cut_LJ;
-            const PS::F64 r_cut_coulomb     = Normalize::realCutOff( Tepi::getRcut_coulomb() );
-            const PS::F64 r_cut_coulomb_inv = 1.0/r_cut_coulomb;
-            const PS::F64 r2_cut_coulomb    = r_cut_coulomb*r_cut_coulomb;
+            if( coulomb_DSF.isEnable() ){
+                _Impl::RadialFuncDSF func;
+                func.self_coef = coulomb_DSF.getSelfCoef();
+                func.dsf       = &coulomb_DSF;
 
-            for(PS::S32 i=0; i<n_ep_i; ++i){
-                Tforce force_IA;
-                force_IA.clear();
-                for(PS::S32 j=0; j<n_ep_j; ++j){
-                    calcForceShort_IJ_coulombSP_LJ12_6(ep_i[i],
-                                                       ep_j[j],
-                                                       r2_cut_LJ,
-                                                       r2_cut_coulomb,
-                                                       r_cut_coulomb_inv,
-                                                       force_IA);
-                }
-                force[i].copyFromForce(force_IA);
+                _Impl::calcForceShort_shell(ep_i, n_ep_i, ep_j, n_ep_j, force, func);
+            } else {
+                _Impl::RadialFuncAnalytic func;
+                func.r_cut_coulomb_inv = 1.0/Normalize::realCutOff( Tepi::getRcut_coulomb() );
+                func.self_coef         = (208.0/70.0)*func.r_cut_coulomb_inv;
+                func.shift             = &coulomb_tree_shift;
 
-                //--- self consistant term for PM
-                force[i].addPotCoulomb( -ep_i[i].getCharge()*(208.0/70.0)*r_cut_coulomb_inv );
+                _Impl::calcForceShort_shell(ep_i, n_ep_i, ep_j, n_ep_j, force, func);
             }
         }
     };
 
 
+    /*
+    *  @breif tabulated implementation: intramolecular mask and shells are treated as same as "calcForceShort".
+    *         LJ terms (inner shell) and PM cut off functions (or DSF coulomb) are evaluated by "FORCE::force_table".
+    */
+    struct calcForceShort_table{
+        template <class Tepi, class Tepj, class Tforce>
+        void operator () (const Tepi    *ep_i,
+                          const PS::S32  n_ep_i,
+                          const Tepj    *ep_j,
+                          const PS::S32  n_ep_j,
+                                Tforce  *force){
+
+            if( coulomb_DSF.isEnable() ){
+                _Impl::RadialFuncTable<false> func;
+                func.self_coef = coulomb_DSF.getSelfCoef();
+                func.table     = &force_table;
+                func.shift     = &coulomb_tree_shift;
+
+                _Impl::calcForceShort_shell(ep_i, n_ep_i, ep_j, n_ep_j, force, func);
+            } else {
+                _Impl::RadialFuncTable<true> func;
+                func.self_coef = (208.0/70.0)/Normalize::realCutOff( Tepi::getRcut_coulomb() );
+                func.table     = &force_table;
+                func.shift     = &coulomb_tree_shift;
+
+                _Impl::calcForceShort_shell(ep_i, n_ep_i, ep_j, n_ep_j, force, func);
+            }
+        }
+    };
+
     /*
     *  @breif fuction for intramolecular mask evaluation.
     *         use with the 'calcForceShort()' functor.
+    *         the atom with mask encoded in bits (AtomMaskBits::isMaskInline()) is skipped.
     */
     template <class TSM, class Tforce, class Tepi, class Tepj, class Tmomloc, class Tmomglb, class Tspj,
               class Tpsys>
@@ -129,6 +932,7 @@ namespace FORCE {
         #endif
         for(PS::S64 i=0; i<n_local; ++i){
             const auto& fp_i = atom[i];
+            if( fp_i.isMaskInline() ) continue;
 
             Tforce force_IA;
             force_IA.clear();
@@ -149,6 +953,7 @@ namespace FORCE {
             pp_force_buff[i].addVirialLJ(     force_IA.getVirialLJ()     );
             pp_force_buff[i].addPotCoulomb(   force_IA.getPotCoulomb()   );
             pp_force_buff[i].addFieldCoulomb( force_IA.getFieldCoulomb() );
+            pp_force_buff[i].addVirialCoulomb(force_IA.getVirialCoulomb());
         }
     }
 
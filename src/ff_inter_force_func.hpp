@@ -5,6 +5,15 @@
 //***************************************************************************************
 #pragma once
 
+#include <cmath>
+#include <sstream>
+#include <stdexcept>
+
+#include <particle_simulator.hpp>
+#include <molecular_dynamics_ext.hpp>
+
+#include "md_coef_table.hpp"
+
 namespace FORCE {
 
     //--- Cutoff functions  (copy from FDPS-master/sample/c++/p3m/main.cpp)
@@ -59,6 +68,149 @@ namespace FORCE {
        }
     }
 
+    //--- branch-free form of cutoff functions (for vectorized kernel)
+    //------ both polynomial branches are evaluated and selected, the result is same to S2_pcut() or S2_fcut().
+    inline PS::F64 S2_pcut_bf(const PS::F64 xi){
+        const PS::F64 xi2   = xi*xi;
+        const PS::F64 p_in  = 1.0 - xi*(208.0
+                                       +xi2*(-112.0
+                                            +xi2*(56.0
+                                                 +xi*(-14.0
+                                                     +xi*(-8.0
+                                                         +3.0*xi)))))/140.0;
+        const PS::F64 p_out = 1.0 - (12.0
+                                    +xi*(128.0
+                                        +xi*(224.0
+                                            +xi*(-448.0
+                                                +xi*(280.0
+                                                    +xi*(-56.0
+                                                        +xi*(-14.0
+                                                            +xi*(8.0
+                                                                -xi))))))))/140.0;
+        const PS::F64 p = (xi <= 1.0) ? p_in : p_out;
+        return (xi < 2.0) ? p : 0.0;
+    }
+
+    inline PS::F64 S2_fcut_bf(const PS::F64 xi){
+        const PS::F64 xi2   = xi*xi;
+        const PS::F64 f_in  = 1.0 - (xi2*xi)*(224.0
+                                             +xi2*(-224.0
+                                                  +xi*(70.0
+                                                      +xi*(48.0-21.0*xi))))/140.0;
+        const PS::F64 f_out = 1.0 - (12.0
+                                    +xi2*(-224.0
+                                         +xi*(896.0
+                                             +xi*(-840.0
+                                                 +xi*(224.0
+                                                     +xi*(70.0
+                                                         +xi*(-48.0+7.0*xi)))))))/140.0;
+        const PS::F64 f = (xi <= 1.0) ? f_in : f_out;
+        return (xi < 2.0) ? f : 0.0;
+    }
+
+    /*
+    *  @brief damped shifted force (DSF) coulomb. used instead of PM-split coulomb when enabled.
+    *  @details Fennell & Gezelter, J. Chem. Phys. 124, 234104 (2006).
+    *           V(r) = erfc(a*r)/r - erfc(a*R)/R + F_c*(r - R),  F_c = erfc(a*R)/R^2 + (2a/sqrt(pi))*exp(-a^2*R^2)/R
+    *           both of potential and force are continuous to zero at the cut off radius R.
+    *           self term: pot_i += -q_i*( erfc(a*R)/R + 2a/sqrt(pi) ) (same convention to PM self term).
+    */
+    class CoulombDSF {
+    private:
+        bool    enable      = false;
+        PS::F64 alpha       = 0.0;
+        PS::F64 r_cut       = 0.0;
+        PS::F64 r2_cut      = 0.0;
+        PS::F64 pot_shift   = 0.0;
+        PS::F64 force_shift = 0.0;
+        PS::F64 coef_exp    = 0.0;
+
+    public:
+        bool    isEnable()    const { return this->enable; }
+        PS::F64 getAlpha()    const { return this->alpha;  }
+        PS::F64 getRcut()     const { return this->r_cut;  }
+        PS::F64 getSelfCoef() const { return this->pot_shift + this->coef_exp; }
+
+        void init(const bool    enable,
+                  const PS::F64 alpha,
+                  const PS::F64 r_cut ){
+
+            this->enable = enable;
+            if( !enable ) return;
+
+            if(alpha < 0.0 || r_cut <= 0.0){
+                std::ostringstream oss;
+                oss << "invalid parameter for DSF coulomb." << "\n"
+                    << "    alpha = " << alpha << ", r_cut = " << r_cut << "\n";
+                throw std::invalid_argument(oss.str());
+            }
+
+            this->alpha       = alpha;
+            this->r_cut       = r_cut;
+            this->r2_cut      = r_cut*r_cut;
+            this->coef_exp    = 2.0*alpha/std::sqrt(Unit::pi);
+            this->pot_shift   = std::erfc(alpha*r_cut)/r_cut;
+            this->force_shift = this->pot_shift/r_cut
+                              + this->coef_exp*std::exp(-alpha*alpha*r_cut*r_cut)/r_cut;
+        }
+
+        //--- f[0]: V(r), f[1]: F(r)/r (multiplied by r_ij vector). zero at r >= R.
+        inline void eval(const PS::F64  r2,
+                         const PS::F64  r_inv,
+                               PS::F64 *f    ) const {
+            const PS::F64 r       = r2*r_inv;
+            const PS::F64 erfc_ar = std::erfc(this->alpha*r);
+            const PS::F64 exp_ar  = std::exp(-this->alpha*this->alpha*r2);
+            const PS::F64 factor  = (r2 < this->r2_cut) ? 1.0 : 0.0;
+
+            f[0] = factor*( erfc_ar*r_inv - this->pot_shift + this->force_shift*(r - this->r_cut) );
+            f[1] = factor*( erfc_ar*r_inv*r_inv + this->coef_exp*exp_ar*r_inv - this->force_shift )*r_inv;
+        }
+    };
+
+    //--- global DSF coulomb object (initialized in CalcForce::setRcut())
+    static CoulombDSF coulomb_DSF;
+
+    /*
+    *  @brief shift of the long-range tree in SF_TREE mode: -1/R + (r - R)/R^2 at the tree cut off R.
+    *  @details the sum of PP part and tree part is the shifted-force coulomb: 1/r - 1/R + (r - R)/R^2.
+    *           the intramolecular mask must scale this whole term, so the shift is masked with the bare coulomb term.
+    *           all values are zero when disabled (PM and DSF mode).
+    */
+    class CoulombTreeShift {
+    private:
+        PS::F64 r_cut  = 0.0;
+        PS::F64 R_inv  = 0.0;
+        PS::F64 R2_inv = 0.0;
+
+    public:
+        PS::F64 getRcut()    const { return this->r_cut;  }
+        PS::F64 getR_inv()   const { return this->R_inv;  }
+        PS::F64 getR2_inv()  const { return this->R2_inv; }
+
+        void init(const bool    enable,
+                  const PS::F64 r_cut ){
+            if( !enable ){
+                *this = CoulombTreeShift{};
+                return;
+            }
+            this->r_cut  = r_cut;
+            this->R_inv  = 1.0/r_cut;
+            this->R2_inv = this->R_inv*this->R_inv;
+        }
+
+        //--- f[0]: shift of potential, f[1]: shift of field / r (multiplied by r_ij vector).
+        inline void eval(const PS::F64  r2,
+                         const PS::F64  r_inv,
+                               PS::F64 *f    ) const {
+            f[0] = r2*r_inv*this->R2_inv - 2.0*this->R_inv;
+            f[1] = -this->R2_inv*r_inv;
+        }
+    };
+
+    //--- global tree shift object (initialized in CalcForce::setRcut())
+    static CoulombTreeShift coulomb_tree_shift;
+
     //--- simple functions
     //------ culculate virial value of particle i
     inline PS::F64vec calcVirialEPI(const PS::F64vec &pos, const PS::F64vec &force){
@@ -110,24 +262,30 @@ namespace FORCE {
         };
 
         //--- VDW part
-        PS::F64 vddm = ep_i.getVDW_D()*ep_j.getVDW_D();      // VDW_D values are pre-affected "sqrt"
-        PS::F64 vdrm = ep_i.getVDW_R() + ep_j.getVDW_R();    // VDW_R values are pre-affected "0.5*"
-        PS::F64 sbr6 = vdrm*vdrm*r2_inv;
-                sbr6 = sbr6*sbr6*sbr6;                       // (r0/r)^6
+        const auto&   coef_LJ = MODEL::coef_table.getCoefLJ(ep_i.getVDWType(), ep_j.getVDWType());
+        const PS::F64 r6_inv  = r2_inv*r2_inv*r2_inv;
+        const PS::F64 sb6     = factor_LJ*coef_LJ.c6*r6_inv;            // affect scaling mask
+        const PS::F64 sb12    = factor_LJ*coef_LJ.c12*r6_inv*r6_inv;
 
-                vddm = factor_LJ*vddm;                       // affect scaling mask
-
-        PS::F64    pot_ij =   0.5*vddm*sbr6*(sbr6-2.0);      // 0.5* for double count
-        PS::F64vec f_ij   = (12.0*vddm*sbr6*(sbr6-1.0)*r2_inv)*r_ij;
+        PS::F64    pot_ij =   0.5*(sb12 - 2.0*sb6);                     // 0.5* for double count
+        PS::F64vec f_ij   = (12.0*(sb12 - sb6)*r2_inv)*r_ij;
         force_IJ.addPotLJ(    pot_ij );
         force_IJ.addForceLJ(  f_ij   );
         force_IJ.addVirialLJ( calcVirialEPI(r_ij, f_ij) );
 
         //--- coulomb part
-        pot_ij =   factor_PM_pot  *ep_j.getCharge()*r_inv;
-        f_ij   = ( factor_PM_force*ep_j.getCharge()*r2_inv )*r_ij;
-        force_IJ.addPotCoulomb(   pot_ij );
-        force_IJ.addFieldCoulomb( f_ij   );
+        if( coulomb_DSF.isEnable() ){
+            PS::F64 f_DSF[2];
+            coulomb_DSF.eval(r2, r_inv, f_DSF);
+            pot_ij =   f_DSF[0]*ep_j.getCharge();
+            f_ij   = ( f_DSF[1]*ep_j.getCharge() )*r_ij;
+        } else {
+            pot_ij =   factor_PM_pot  *ep_j.getCharge()*r_inv;
+            f_ij   = ( factor_PM_force*ep_j.getCharge()*r2_inv )*r_ij;
+        }
+        force_IJ.addPotCoulomb(    pot_ij );
+        force_IJ.addFieldCoulomb(  f_ij   );
+        force_IJ.addVirialCoulomb( calcVirialEPI(r_ij, f_ij) );
     }
 
     //--- basic Particle-Particle mask function
@@ -154,24 +312,33 @@ namespace FORCE {
         PS::F64 factor_PM_force = mask_ij.scale_coulomb - 1.0;
 
         //--- VDW part
-        PS::F64 vddm = ep_i.getVDW_D()*ep_j.getVDW_D();      // VDW_D values are pre-affected "sqrt"
-        PS::F64 vdrm = ep_i.getVDW_R() + ep_j.getVDW_R();    // VDW_R values are pre-affected "0.5*"
-        PS::F64 sbr6 = vdrm*vdrm*r2_inv;
-                sbr6 = sbr6*sbr6*sbr6;                       // (r0/r)^6
+        const auto&   coef_LJ = MODEL::coef_table.getCoefLJ(ep_i.getVDWType(), ep_j.getVDWType());
+        const PS::F64 r6_inv  = r2_inv*r2_inv*r2_inv;
+        const PS::F64 sb6     = factor_LJ*coef_LJ.c6*r6_inv;            // affect scaling mask
+        const PS::F64 sb12    = factor_LJ*coef_LJ.c12*r6_inv*r6_inv;
 
-                vddm = factor_LJ*vddm;                       // affect scaling mask
-
-        PS::F64    pot_ij =   0.5*vddm*sbr6*(sbr6-2.0);      // 0.5* for double count
-        PS::F64vec f_ij   = (12.0*vddm*sbr6*(sbr6-1.0)*r2_inv)*r_ij;
+        PS::F64    pot_ij =   0.5*(sb12 - 2.0*sb6);                     // 0.5* for double count
+        PS::F64vec f_ij   = (12.0*(sb12 - sb6)*r2_inv)*r_ij;
         force_IJ.addPotLJ(    pot_ij );
         force_IJ.addForceLJ(  f_ij   );
         force_IJ.addVirialLJ( calcVirialEPI(r_ij, f_ij) );
 
-        //--- coulomb part
-        pot_ij =   factor_PM_pot  *ep_j.getCharge()*r_inv;
-        f_ij   = ( factor_PM_force*ep_j.getCharge()*r2_inv )*r_ij;
-        force_IJ.addPotCoulomb(   pot_ij );
-        force_IJ.addFieldCoulomb( f_ij   );
+        //--- coulomb part (DSF: mask is applied to the DSF term itself, no PM part to cancel)
+        //                  (SF_TREE: the shift of tree part is masked with the bare coulomb term)
+        if( coulomb_DSF.isEnable() ){
+            PS::F64 f_DSF[2];
+            coulomb_DSF.eval(r2, r_inv, f_DSF);
+            pot_ij =   factor_PM_pot*f_DSF[0]*ep_j.getCharge();
+            f_ij   = ( factor_PM_force*f_DSF[1]*ep_j.getCharge() )*r_ij;
+        } else {
+            PS::F64 f_shift[2];
+            coulomb_tree_shift.eval(r2, r_inv, f_shift);
+            pot_ij =   factor_PM_pot  *ep_j.getCharge()*(r_inv  + f_shift[0]);
+            f_ij   = ( factor_PM_force*ep_j.getCharge()*(r2_inv + f_shift[1]) )*r_ij;
+        }
+        force_IJ.addPotCoulomb(    pot_ij );
+        force_IJ.addFieldCoulomb(  f_ij   );
+        force_IJ.addVirialCoulomb( calcVirialEPI(r_ij, f_ij) );
     }
 
 }
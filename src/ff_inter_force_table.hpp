@@ -0,0 +1,366 @@
+//***************************************************************************************
+//  This is the tabulated function engine for intermolecular interaction.
+//    LJ terms are evaluated by piecewise polynomial in r^2 space,
+//    S2_pcut(), S2_fcut() (or DSF coulomb) in reduced xi^2 = (2r/rc)^2 space (independent of box size).
+//***************************************************************************************
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <array>
+#include <string>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <stdexcept>
+
+#include <particle_simulator.hpp>
+
+#include "ff_inter_force_func.hpp"
+
+
+namespace FORCE {
+
+    /*
+    *  @brief piecewise polynomial table on segments uniform in each octave of x: [2^e, 2^(e+1)) is split into n_div segments.
+    *  @details the segment index and the local coordinate t in [0, 1) are taken from the exponent and mantissa bits of x
+    *           (no log, no division). each segment is interpolated at the Chebyshev-Lobatto points of order N_order-1.
+    *           both ends of segment are included, so the table is continuous at segment boundaries.
+    *           the domain is [2^e_min, 2^e_max]. x >= 2^e_max gives the value at 2^e_max.
+    *           x < 2^e_min must not be evaluated.
+    */
+    template <size_t N_col, size_t N_order>
+    class PolyTable_log2 {
+    private:
+        PS::S32  n_div      = 0;
+        PS::S32  e_min      = 0;
+        PS::S32  e_max      = 0;
+        PS::S32  n_shift    = 0;
+        uint64_t seg_offset = 0;
+        uint64_t t_mask     = 0;
+        PS::F64  t_scale    = 0.0;
+        PS::F64  x_max      = 0.0;
+
+        //--- coefficients: [segment][column][order]. the last segment is the constant value at x_max.
+        std::vector<std::array<std::array<PS::F64, N_order>, N_col>> coef;
+
+        static uint64_t _bits(const PS::F64 x){
+            uint64_t b;
+            std::memcpy(&b, &x, sizeof(b));
+            return b;
+        }
+
+    public:
+        PS::S32 getNumDivision() const { return this->n_div; }
+        PS::S32 getNumSegment()  const { return std::max(static_cast<PS::S32>(this->coef.size()) - 1, 0); }
+        PS::S32 getEmin()        const { return this->e_min; }
+        PS::S32 getEmax()        const { return this->e_max; }
+        PS::F64 getXmin()        const { return std::ldexp(1.0, this->e_min); }
+        PS::F64 getXmax()        const { return this->x_max; }
+        size_t  getMemorySize()  const { return this->coef.size()*sizeof(this->coef[0]); }
+
+        //--- x of the local coordinate t in segment i.
+        PS::F64 getX(const PS::S32 i, const PS::F64 t) const {
+            const PS::F64 x_oct = std::ldexp(1.0, this->e_min + i/this->n_div);
+            return x_oct*(1.0 + (PS::F64(i%this->n_div) + t)/PS::F64(this->n_div));
+        }
+
+        template <class Tfunc>
+        void init(const PS::S32  n_div,
+                  const PS::S32  e_min,
+                  const PS::S32  e_max,
+                        Tfunc   &func  ){
+
+            if(n_div <= 0 || n_div > 1024 || (n_div & (n_div - 1)) != 0 || e_min >= e_max){
+                std::ostringstream oss;
+                oss << "invalid table range." << "\n"
+                    << "    n_div = " << n_div << " (must be power of 2, <= 1024)"
+                    << ", x = [2^" << e_min << ", 2^" << e_max << "]" << "\n";
+                throw std::invalid_argument(oss.str());
+            }
+
+            PS::S32 m = 0;
+            while((1 << m) < n_div) ++m;
+
+            this->n_div      = n_div;
+            this->e_min      = e_min;
+            this->e_max      = e_max;
+            this->n_shift    = 52 - m;
+            this->seg_offset = _bits(std::ldexp(1.0, e_min)) >> this->n_shift;
+            this->t_mask     = (uint64_t(1) << this->n_shift) - 1;
+            this->t_scale    = std::ldexp(1.0, -this->n_shift);
+            this->x_max      = std::ldexp(1.0, e_max);
+
+            const PS::S32 n_seg = n_div*(e_max - e_min);
+            this->coef.resize(n_seg + 1);
+
+            //--- Chebyshev-Lobatto points in [0, 1]
+            std::array<PS::F64, N_order> t_node;
+            for(size_t k=0; k<N_order; ++k){
+                t_node[k] = 0.5*(1.0 - std::cos(Unit::pi*PS::F64(k)/PS::F64(N_order - 1)));
+            }
+
+            std::array<std::array<PS::F64, N_col>, N_order> f;
+            for(PS::S32 i=0; i<n_seg; ++i){
+                for(size_t k=0; k<N_order; ++k){
+                    func(this->getX(i, t_node[k]), f[k]);
+                }
+                for(size_t c=0; c<N_col; ++c){
+                    //--- Newton divided difference -> power series of t
+                    std::array<PS::F64, N_order> a;
+                    for(size_t k=0; k<N_order; ++k) a[k] = f[k][c];
+                    for(size_t j=1; j<N_order; ++j){
+                        for(size_t k=N_order-1; k>=j; --k){
+                            a[k] = (a[k] - a[k-1])/(t_node[k] - t_node[k-j]);
+                        }
+                    }
+                    std::array<PS::F64, N_order> p;
+                    p.fill(0.0);
+                    p[0] = a[N_order-1];
+                    for(size_t k=N_order-1; k>0; --k){
+                        //--- p = p*(t - t_node[k-1]) + a[k-1]
+                        for(size_t j=N_order-1; j>0; --j){
+                            p[j] = p[j-1] - t_node[k-1]*p[j];
+                        }
+                        p[0] = a[k-1] - t_node[k-1]*p[0];
+                    }
+                    this->coef[i][c] = p;
+                }
+            }
+
+            func(this->x_max, f[0]);
+            for(size_t c=0; c<N_col; ++c){
+                this->coef[n_seg][c].fill(0.0);
+                this->coef[n_seg][c][0] = f[0][c];
+            }
+        }
+
+        //--- branch-free lookup. x is clamped to x_max.
+        inline void eval(const PS::F64 x, PS::F64 *result) const {
+            const uint64_t b   = _bits( std::min(x, this->x_max) );
+            const uint64_t seg = (b >> this->n_shift) - this->seg_offset;
+            const PS::F64  t   = PS::F64(b & this->t_mask)*this->t_scale;
+            const auto&    c   = this->coef[seg];
+            for(size_t i=0; i<N_col; ++i){
+                PS::F64 v = c[i][N_order-1];
+                for(size_t k=N_order-1; k>0; --k){
+                    v = c[i][k-1] + t*v;
+                }
+                result[i] = v;
+            }
+        }
+    };
+
+
+    /*
+    *  @brief tabulated engine for the short-range kernel.
+    *  @details columns: r^-12, r^-6 (LJ), S2_pcut(2r/rc)/r, S2_fcut(2r/rc)/r^2 (PM-split coulomb).
+    *           the coulomb columns are V(r), F(r)/r of "CoulombDSF" in DSF mode.
+    *           LJ is tabulated in x = r^2, coulomb in x = xi^2 = (2r/rc)^2 and scaled by 2/rc and (2/rc)^2.
+    *           the PM table is independent of rc, so it is not remaked when the box size is changed (NPT).
+    *           r < r_min is evaluated by the analytic functions.
+    *           "n_div = 0" means the table is not used (analytic kernel).
+    */
+    class ForceTable {
+    private:
+        static constexpr size_t n_col   = 2;
+        static constexpr size_t n_order = 8;
+
+        PolyTable_log2<n_col, n_order> table_LJ;
+        PolyTable_log2<n_col, n_order> table_coulomb;
+
+        PS::F64    r_min         = 0.0;
+        PS::F64    x_min         = 0.0;    // r^2 of the lower limit
+        PS::F64    r_cut_LJ      = 0.0;
+        PS::F64    r_cut_coulomb = 0.0;
+        PS::F64    xi2_scale     = 0.0;    // (2/rc)^2
+        PS::F64    pot_scale     = 0.0;    // 2/rc
+        CoulombDSF dsf;
+
+        std::array<PS::F64, 2*n_col> max_err{};
+
+        //--- r^-12, r^-6 in x = r^2
+        struct FuncLJ {
+            void operator () (const PS::F64 r2, std::array<PS::F64, n_col> &f) const {
+                const PS::F64 r2_inv = 1.0/r2;
+                const PS::F64 r6_inv = r2_inv*r2_inv*r2_inv;
+                f[0] = r6_inv*r6_inv;
+                f[1] = r6_inv;
+            }
+        };
+
+        //--- coulomb in x = xi^2. the value is scaled by (rc/2) and (rc/2)^2.
+        struct FuncCoulomb {
+            PS::F64           r_half;    // rc/2 for DSF
+            const CoulombDSF *dsf;
+            void operator () (const PS::F64 xi2, std::array<PS::F64, n_col> &f) const {
+                const PS::F64 xi = std::sqrt(xi2);
+                if(this->dsf != nullptr){
+                    const PS::F64 r = xi*this->r_half;
+                    PS::F64 f_dsf[2];
+                    this->dsf->eval(r*r, 1.0/r, f_dsf);
+                    f[0] = f_dsf[0]*this->r_half;
+                    f[1] = f_dsf[1]*this->r_half*this->r_half;
+                } else {
+                    f[0] = S2_pcut(xi)/xi;
+                    f[1] = S2_fcut(xi)/xi2;
+                }
+            }
+        };
+
+        inline void eval_analytic(const PS::F64 r2, PS::F64 *result) const {
+            const PS::F64 r2_inv = 1.0/r2;
+            const PS::F64 r_inv  = std::sqrt(r2_inv);
+            const PS::F64 r6_inv = r2_inv*r2_inv*r2_inv;
+            result[0] = r6_inv*r6_inv;
+            result[1] = r6_inv;
+            if(this->dsf.isEnable()){
+                this->dsf.eval(r2, r_inv, result + 2);
+            } else {
+                const PS::F64 xi = 2.0*(r2*r_inv)/this->r_cut_coulomb;
+                result[2] = S2_pcut(xi)*r_inv;
+                result[3] = S2_fcut(xi)*r2_inv;
+            }
+        }
+
+        template <class Ttable, class Tfunc>
+        void check_error(const Ttable &table,
+                         const Tfunc  &func,
+                         const bool    coulomb,
+                               PS::F64 *err   ){
+
+            //--- LJ: relative error, coulomb: error relative to the bare coulomb term (1/xi, 1/xi^2).
+            std::array<PS::F64, n_col> f_ref, f_tbl, f_scale;
+            for(PS::S32 i=0; i<table.getNumSegment(); ++i){
+                for(const PS::F64 t : {0.1, 0.3, 0.5, 0.7, 0.9}){
+                    const PS::F64 x = table.getX(i, t);
+                    if(coulomb && x >= 4.0) continue;   // coulomb part is zero outside of cut off.
+                    func(x, f_ref);
+                    table.eval(x, f_tbl.data());
+
+                    if(coulomb){
+                        f_scale[0] = 1.0/std::sqrt(x);
+                        f_scale[1] = 1.0/x;
+                    } else {
+                        f_scale = f_ref;
+                    }
+                    for(size_t c=0; c<n_col; ++c){
+                        err[c] = std::max(err[c], std::abs(f_tbl[c] - f_ref[c])/f_scale[c]);
+                    }
+                }
+            }
+        }
+
+        static PS::S32 floor_log2(const PS::F64 x){ return static_cast<PS::S32>(std::floor(std::log2(x))); }
+        static PS::S32 ceil_log2( const PS::F64 x){ return static_cast<PS::S32>(std::ceil( std::log2(x))); }
+
+    public:
+        bool    isEnable()      const { return (this->table_LJ.getNumSegment() > 0); }
+        size_t  getMemorySize() const { return this->table_LJ.getMemorySize() + this->table_coulomb.getMemorySize(); }
+        PS::F64 getRmin()       const { return this->r_min; }
+
+        /*
+        *  @brief set the cut off length and make the table. the table is remaked only when it does not cover the range.
+        *  @param[in] n_div number of segments in each octave of r^2 (power of 2).
+        *  @details the coulomb columns are made from "dsf" when it is enabled (PM-split coulomb in default).
+        *           in PM mode, the table is remaked only when rc is increased over the lower limit of xi^2 table.
+        *  @return "true" means the table was remaked.
+        */
+        bool update(const PS::S32     n_div,
+                    const PS::F64     r_min,
+                    const PS::F64     r_cut_LJ,
+                    const PS::F64     r_cut_coulomb,
+                    const CoulombDSF &dsf = CoulombDSF{} ){
+
+            if(n_div <= 0) return false;
+            if(r_min <= 0.0 || r_min >= r_cut_LJ || r_min >= r_cut_coulomb){
+                std::ostringstream oss;
+                oss << "invalid table range." << "\n"
+                    << "    r_min = " << r_min << ", r_cut_LJ = " << r_cut_LJ << ", r_cut_coulomb = " << r_cut_coulomb << "\n";
+                throw std::invalid_argument(oss.str());
+            }
+
+            const PS::F64 rc = dsf.isEnable() ? dsf.getRcut() : r_cut_coulomb;
+            this->r_cut_coulomb = rc;
+            this->pot_scale     = 2.0/rc;
+            this->xi2_scale     = this->pot_scale*this->pot_scale;
+
+            const PS::S32 e_min_LJ = floor_log2(r_min*r_min);
+            const PS::S32 e_max_LJ = std::max(ceil_log2(r_cut_LJ*r_cut_LJ), e_min_LJ + 1);
+            const PS::F64 xi2_min  = std::ldexp(1.0, e_min_LJ)*this->xi2_scale;
+
+            const bool remake_LJ = ( n_div    != this->table_LJ.getNumDivision() ||
+                                     e_min_LJ != this->table_LJ.getEmin()        ||
+                                     e_max_LJ != this->table_LJ.getEmax()          );
+            const bool remake_cl = ( n_div            != this->table_coulomb.getNumDivision() ||
+                                     xi2_min          <  this->table_coulomb.getXmin()        ||
+                                     dsf.isEnable()   != this->dsf.isEnable()                 ||
+                                     dsf.getAlpha()   != this->dsf.getAlpha()                 ||
+                                     dsf.getRcut()    != this->dsf.getRcut()                    );
+
+            this->r_min    = r_min;
+            this->x_min    = std::ldexp(1.0, e_min_LJ);
+            this->r_cut_LJ = r_cut_LJ;
+            this->dsf      = dsf;
+
+            if( !remake_LJ && !remake_cl ) return false;
+
+            this->max_err.fill(0.0);
+            if(remake_LJ){
+                FuncLJ func;
+                this->table_LJ.init(n_div, e_min_LJ, e_max_LJ, func);
+            }
+            if(remake_cl){
+                FuncCoulomb func;
+                func.r_half = 0.5*rc;
+                func.dsf    = dsf.isEnable() ? &this->dsf : nullptr;
+                //--- 1 octave margin: rc can be increased by sqrt(2) at least (NPT) without remaking.
+                this->table_coulomb.init(n_div, floor_log2(xi2_min) - 1, 2, func);
+            }
+
+            FuncLJ      func_LJ;
+            FuncCoulomb func_cl;
+            func_cl.r_half = 0.5*rc;
+            func_cl.dsf    = dsf.isEnable() ? &this->dsf : nullptr;
+            this->check_error(this->table_LJ,      func_LJ, false, &this->max_err[0]);
+            this->check_error(this->table_coulomb, func_cl, true,  &this->max_err[n_col]);
+
+            return true;
+        }
+
+        //--- result: r^-12, r^-6, coulomb (pot), coulomb (force).
+        inline void eval(const PS::F64 r2, PS::F64 *result) const {
+            if(r2 < this->x_min){
+                this->eval_analytic(r2, result);
+                return;
+            }
+            this->table_LJ.eval(r2, result);
+            this->table_coulomb.eval(r2*this->xi2_scale, result + 2);
+            result[2] *= this->pot_scale;
+            result[3] *= this->xi2_scale;
+        }
+
+        std::string str_error() const {
+            std::ostringstream oss;
+            oss << "  force table: " << this->table_LJ.getNumDivision() << " segments/octave, order = " << n_order - 1
+                << ", coulomb = " << (this->dsf.isEnable() ? "DSF" : "PM") << "\n"
+                << "    LJ     : r^2  = [" << this->table_LJ.getXmin()      << ", " << this->table_LJ.getXmax()      << "] [angstrom^2], "
+                << this->table_LJ.getNumSegment()      << " segments" << "\n"
+                << "    coulomb: xi^2 = [" << this->table_coulomb.getXmin() << ", " << this->table_coulomb.getXmax() << "], "
+                << this->table_coulomb.getNumSegment() << " segments" << "\n"
+                << "    size   : " << std::fixed << std::setprecision(1) << PS::F64(this->getMemorySize())/1024.0 << " [KiB]" << "\n";
+            oss << "    max relative error: " << std::scientific << std::setprecision(3) << "\n"
+                << "      LJ r^-12       : " << this->max_err[0] << "\n"
+                << "      LJ r^-6        : " << this->max_err[1] << "\n"
+                << "      coulomb (pot)  : " << this->max_err[2] << "\n"
+                << "      coulomb (force): " << this->max_err[3] << "\n";
+            return oss.str();
+        }
+    };
+
+    //--- global table object
+    static ForceTable force_table;
+
+}
@@ -0,0 +1,107 @@
+//***************************************************************************************
+//  This is the long-range correction for LJ interaction with cut off.
+//    the density beyond the cut off radius is assumed to be uniform (isotropic correction).
+//***************************************************************************************
+#pragma once
+
+#include <cmath>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <iomanip>
+
+#include <particle_simulator.hpp>
+#include <molecular_dynamics_ext.hpp>
+
+#include "unit.hpp"
+#include "md_coef_table.hpp"
+
+
+namespace FORCE {
+
+    /*
+    *  @brief tail correction of energy and virial for LJ 12-6 potential: V(r) = c12/r^12 - 2*c6/r^6.
+    *  @details E_tail = (2*pi/V) * sum_ij N_i*N_j*[   c12/(9*rc^9) - 2*c6/(3*rc^3) ]
+    *           W_tail = (2*pi/V) * sum_ij N_i*N_j*[ 4*c12/(3*rc^9) - 4*c6/rc^3     ]   (W = sum r*f, P_tail = W_tail/3V)
+    *           N_i is the number of atoms of LJ type i in the whole system.
+    */
+    class LJTailCorrection {
+    private:
+        bool    enable   = false;
+        PS::F64 r_cut_LJ = 0.0;
+
+        //--- E_tail*V and W_tail*V
+        PS::F64 coef_eng = 0.0;
+        PS::F64 coef_vir = 0.0;
+
+        std::vector<PS::S64> n_type;
+
+    public:
+        bool isEnable() const { return this->enable; }
+
+        /*
+        *  @brief update the number of atoms for each LJ type.
+        *  @details must be called after the LJ type index is set into atoms (see MODEL::CoefTable::setVDWType()).
+        *           the populations are conserved in the simulation, call once at initialize.
+        */
+        template <class Tpsys>
+        void update(const Tpsys   &psys,
+                    const PS::F64  r_cut_LJ,
+                    const bool     enable   ){
+
+            this->enable   = enable;
+            this->r_cut_LJ = r_cut_LJ;
+            this->coef_eng = 0.0;
+            this->coef_vir = 0.0;
+            if( !enable ) return;
+
+            const PS::S32 n_vdw_type = MODEL::coef_table.n_vdw_type;
+            this->n_type.assign(n_vdw_type, 0);
+
+            const PS::S64 n_local = psys.getNumberOfParticleLocal();
+            for(PS::S64 i=0; i<n_local; ++i){
+                ++( this->n_type.at( psys[i].getVDWType() ) );
+            }
+            for(auto& n : this->n_type){
+                n = PS::Comm::getSum(n);
+            }
+
+            const PS::F64 rc3_inv = 1.0/(r_cut_LJ*r_cut_LJ*r_cut_LJ);
+            const PS::F64 rc9_inv = rc3_inv*rc3_inv*rc3_inv;
+
+            PS::F64 sum_eng = 0.0;
+            PS::F64 sum_vir = 0.0;
+            for(PS::S32 i=0; i<n_vdw_type; ++i){
+                for(PS::S32 j=0; j<n_vdw_type; ++j){
+                    const auto&   coef  = MODEL::coef_table.getCoefLJ(i, j);
+                    const PS::F64 n_ij  = PS::F64(this->n_type[i])*PS::F64(this->n_type[j]);
+                    sum_eng += n_ij*(      coef.c12*rc9_inv/9.0 - 2.0*coef.c6*rc3_inv/3.0 );
+                    sum_vir += n_ij*( 4.0*coef.c12*rc9_inv/3.0 - 4.0*coef.c6*rc3_inv     );
+                }
+            }
+            this->coef_eng = 2.0*Unit::pi*sum_eng;
+            this->coef_vir = 2.0*Unit::pi*sum_vir;
+        }
+
+        //--- values at current volume. 0.0 when the correction is disabled.
+        PS::F64 getEnergy() const { return this->coef_eng*Normalize::getVolInv(); }
+        PS::F64 getVirial() const { return this->coef_vir*Normalize::getVolInv(); }
+
+        std::string str() const {
+            std::ostringstream oss;
+            oss << "  LJ tail correction: ";
+            if( !this->enable ){
+                oss << "disabled.\n";
+                return oss.str();
+            }
+            oss << "r_cut_LJ = " << this->r_cut_LJ << " [angstrom]\n"
+                << "    E_tail = " << std::scientific << std::setprecision(6) << this->getEnergy()
+                << ", W_tail = "   << this->getVirial() << " (at current volume)\n";
+            return oss.str();
+        }
+    };
+
+    //--- global correction object
+    static LJTailCorrection lj_tail;
+
+}
@@ -4,125 +4,228 @@
 #pragma once
 
 #include <tuple>
+#include <array>
+#include <vector>
+#include <string>
+#include <unordered_map>
 
 #include <particle_simulator.hpp>
 #include <molecular_dynamics_ext.hpp>
 
 #include "md_coef_table.hpp"
 #include "ff_intra_force_func.hpp"
+#include "ff_intra_topology.hpp"
 
 
 namespace FORCE {
 
-    template<class Tepi, class Ttree,
-             class Tforce>
-    void calcForceBond_IA(const Tepi   &ep_i,
-                                Ttree  &tree,
-                                Tforce &force_IA){
-
-        //--- bond potential
-        for(const auto& id_j : ep_i.bond){
-            const auto* ptr_j = tree.getEpjFromId(id_j);
-            IntraPair::check_nullptr_ptcl(ptr_j, ep_i.getAtomID(), id_j);
+    /**
+    * @brief real position and local index of the neighbor slots of local atoms (see IntraTopology::AtomTerm).
+    * @details resolved once for each tree construction. one PS::TreeForForce::getEpjFromId() for each slot,
+    *          then the bonded force loop gathers the position by slot index.
+    *          the local index is found by the local-ID map of the intra pair lists (see IntraListTable),
+    *          it is -1 for the slot of the atom in other process.
+    */
+    class IntraSlotTable {
+    private:
+        std::vector<PS::S64>                           offset;
+        std::vector<PS::F64vec>                        pos;
+        std::vector<PS::S32>                           local;
+        std::vector<const IntraTopology::AtomTerm*>    term;
+        std::vector<MD_DEFS::ID_type>                  shift;
+
+    public:
+        inline const IntraTopology::AtomTerm& getTerm( const PS::S64 i) const { return *(this->term[i]); }
+        inline       MD_DEFS::ID_type         getShift(const PS::S64 i) const { return this->shift[i];   }
+        inline const PS::F64vec*              getPos(  const PS::S64 i) const { return this->pos.data()   + this->offset[i]; }
+        inline const PS::S32*                 getLocal(const PS::S64 i) const { return this->local.data() + this->offset[i]; }
+
+        template <class Ttree, class Tpsys>
+        void resolve(const IntraTopology &topology,
+                           Ttree         &tree,
+                           Tpsys         &atom    ){
+
+            const PS::S64 n_local = atom.getNumberOfParticleLocal();
+            this->offset.resize(n_local + 1);
+            this->term.resize(n_local);
+            this->shift.resize(n_local);
+
+            this->offset[0] = 0;
+            for(PS::S64 i=0; i<n_local; ++i){
+                if(atom[i].getIntraIndex() != i){
+                    std::ostringstream oss;
+                    oss << "the intra index of local atom is not updated." << "\n"
+                        << "   i = " << i << ", intra_index = " << atom[i].getIntraIndex() << "\n"
+                        << "   call update_intra_pair_list() after PS::ParticleSystem::exchangeParticle()." << "\n";
+                    throw std::logic_error(oss.str());
+                }
+                this->term[i]      = &( topology.getTerm(atom[i], this->shift[i]) );
+                this->offset[i+1]  = this->offset[i] + this->term[i]->slot.size();
+            }
+            this->pos.resize(  this->offset[n_local]);
+            this->local.resize(this->offset[n_local]);
+
+            #ifdef PARTICLE_SIMULATOR_THREAD_PARALLEL
+                #pragma omp parallel for
+            #endif
+            for(PS::S64 i=0; i<n_local; ++i){
+                const auto&      slot     = this->term[i]->slot;
+                      PS::F64vec *pos_i   = this->pos.data()   + this->offset[i];
+                      PS::S32    *local_i = this->local.data() + this->offset[i];
+
+                pos_i[0]   = Normalize::realPos( atom[i].getPos() );
+                local_i[0] = static_cast<PS::S32>(i);
+                for(size_t s=1; s<slot.size(); ++s){
+                    const MD_DEFS::ID_type id_s  = this->shift[i] + slot[s];
+                    const auto*            ptr_s = tree.getEpjFromId(id_s);
+                    IntraPair::check_nullptr_ptcl(ptr_s, atom[i].getAtomID(), id_s);
+
+                    pos_i[s]   = Normalize::realPos( (*ptr_s).getPos() );
+                    local_i[s] = atom[i].findLocalIndex(id_s);
+                }
+            }
+        }
+    };
+
+    /**
+    * @brief EPJ table of local atoms. alternative of the tree for IntraSlotTable::resolve().
+    * @details available when all atoms of each molecule are in the same process (see ATOM_MOVE::exchangeMolecule()).
+    *          the bonded force is evaluated without ghost atoms.
+    */
+    template <class Tepj>
+    class IntraLocalEpj {
+    private:
+        std::vector<Tepj>                              epj;
+        std::unordered_map<MD_DEFS::ID_type, PS::S64>  id_index;
+
+    public:
+        template <class Tpsys>
+        void update(const Tpsys &atom){
+            const PS::S64 n_local = atom.getNumberOfParticleLocal();
+            this->epj.resize(n_local);
+            this->id_index.clear();
+            for(PS::S64 i=0; i<n_local; ++i){
+                this->epj[i].copyFromFP(atom[i]);
+                this->id_index[atom[i].getAtomID()] = i;
+            }
+        }
 
-            MODEL::KeyBond  key_bond = std::make_tuple(ep_i.getMolType(),
-                                                       ep_i.getAtomType(),
-                                                       (*ptr_j).getAtomType());
+        //--- same interface with PS::TreeForForce::getEpjFromId(). returns nullptr for atom in other process.
+        const Tepj* getEpjFromId(const MD_DEFS::ID_type id) const {
+            const auto itr = this->id_index.find(id);
+            if(itr == this->id_index.end()) return nullptr;
+            return &(this->epj[itr->second]);
+        }
+    };
+
+    namespace _Impl {
+
+        /**
+        * @brief the term is evaluated by the local participant with the smallest ID.
+        * @details every participant has the same term in its own list.
+        *          the participants in other process are skipped (they evaluate the term on their side).
+        */
+        template <size_t N>
+        inline bool isOwner_term(const IntraTopology::AtomTerm &term,
+                                 const PS::S32                 *local,
+                                 const std::array<PS::S32, N>  &index){
+            for(const auto s : index){
+                if(local[s] >= 0 && term.slot[s] < term.slot[0]) return false;
+            }
+            return true;
+        }
 
-            if(MODEL::coef_table.bond.count(key_bond) != 1){
-                std::ostringstream oss;
-                oss << "key_bond = " << ENUM::what(key_bond) << " is not defined in MODEL::coef_table.bond." << "\n";
-                throw std::invalid_argument(oss.str());
+        //--- bonded terms gathered for each function form
+        struct IntraBatchSet {
+            BondBatch    bond_harmonic;
+            BondBatch    bond_anharmonic;
+            AngleBatch   angle_harmonic;
+            TorsionBatch dihedral_harmonic;
+            TorsionBatch dihedral_OPLS_3rd;
+            TorsionBatch improper_harmonic;
+            TorsionBatch improper_OPLS_3rd;
+
+            void clear(){
+                this->bond_harmonic.clear();
+                this->bond_anharmonic.clear();
+                this->angle_harmonic.clear();
+                this->dihedral_harmonic.clear();
+                this->dihedral_OPLS_3rd.clear();
+                this->improper_harmonic.clear();
+                this->improper_OPLS_3rd.clear();
             }
+        };
+
+        //--- buffer for each thread
+        template <class Tforce>
+        struct IntraThreadBuff {
+            std::vector<Tforce> force;    // result of local atoms
+            IntraBatchSet       batch;
+        };
+    }
 
-            const auto bond_prm = MODEL::coef_table.bond.at(key_bond);
+    //--- gather the bonded terms owned by the atom into batch.
+    //    the slot index is used as ID. the target atom is slot 0. the local index of participant is the scatter target.
+    inline void gatherBond_IA(const IntraTopology           &topology,
+                              const IntraTopology::AtomTerm &term,
+                              const PS::F64vec              *pos,
+                              const PS::S32                 *local,
+                              const MD_DEFS::ID_type         shift,
+                                    _Impl::IntraBatchSet    &batch){
 
+        //--- bond potential
+        for(const auto& bond : term.bond){
+            if( !_Impl::isOwner_term(term, local, std::array<PS::S32, 1>{bond.j}) ) continue;
+
+            const auto&      bond_prm = topology.getBondParam(bond.coef);
+            const PS::F64vec R_ij     = Normalize::relativePosAdjustReal(pos[0] - pos[bond.j]);
+
+            #ifndef NDEBUG
             try{
-                switch (bond_prm.form) {
-                    case IntraFuncForm::none:
-                        //--- free potential
-                        continue;
-                    break;
-
-                    case IntraFuncForm::anharmonic:
-                        calcBondForce_anharmonic_IJ(Normalize::realPos(ep_i.getPos()),
-                                                    Normalize::realPos((*ptr_j).getPos()),
-                                                    bond_prm,
-                                                    force_IA);
-                    break;
-
-                    case IntraFuncForm::harmonic:
-                        calcBondForce_harmonic_IJ(Normalize::realPos(ep_i.getPos()),
-                                                  Normalize::realPos((*ptr_j).getPos()),
-                                                  bond_prm,
-                                                  force_IA);
-                    break;
-
-                    default:
-                        throw std::invalid_argument("undefined function form: " + ENUM::what(bond_prm.form) + " at bond force.");
-                }
+                _Impl::check_max_bond_length( VEC_EXT::norm(R_ij) );
             } catch(...) {
                 std::ostringstream oss;
-                oss << "  atom_i: id = " << ep_i.getId()
-                    << ", pos = "        << ep_i.getPos()
-                    << ", MolType = "    << ep_i.getMolType()
-                    << ", AtomType = "   << ep_i.getAtomType() << "\n"
-                    << "  atom_j: id = " << (*ptr_j).getId()
-                    << ", pos = "        << (*ptr_j).getPos()
-                    << ", MolType = "    << (*ptr_j).getMolType()
-                    << ", AtomType = "   << (*ptr_j).getAtomType() << "\n";
+                oss << "  atom_i: id = " << shift + term.slot[0]
+                    << ", pos = "        << pos[0]      << "\n"
+                    << "  atom_j: id = " << shift + term.slot[bond.j]
+                    << ", pos = "        << pos[bond.j] << "\n";
                 std::cerr << oss.str() << std::flush;
                 throw;
             }
+            #endif
+
+            switch (bond_prm.form) {
+                case IntraFuncForm::anharmonic:
+                    batch.bond_anharmonic.push(R_ij, bond_prm, local[0], local[bond.j]);
+                break;
+
+                case IntraFuncForm::harmonic:
+                    batch.bond_harmonic.push(R_ij, bond_prm, local[0], local[bond.j]);
+                break;
+
+                default:
+                    throw std::invalid_argument("undefined function form: " + ENUM::what(bond_prm.form) + " at bond force.");
+            }
         }
     }
 
-    template<class Tepi, class Ttree,
-             class Tforce>
-    void calcForceAngle_IA(const Tepi   &ep_i,
-                                 Ttree  &tree,
-                                 Tforce &force_IA){
+    inline void gatherAngle_IA(const IntraTopology           &topology,
+                               const IntraTopology::AtomTerm &term,
+                               const PS::F64vec              *pos,
+                               const PS::S32                 *local,
+                                     _Impl::IntraBatchSet    &batch){
 
         //--- angle potential
-        for(const auto& angle_set : ep_i.angle_list()){
-            const auto id_i   = std::get<0>(angle_set);
-            const auto id_j   = std::get<1>(angle_set);
-            const auto id_k   = std::get<2>(angle_set);
-            const auto id_tgt = ep_i.getAtomID();
-
-            const auto* ptr_i = tree.getEpjFromId(id_i);
-            const auto* ptr_j = tree.getEpjFromId(id_j);
-            const auto* ptr_k = tree.getEpjFromId(id_k);
-
-            IntraPair::check_nullptr_ptcl(ptr_i, ep_i.getAtomID(), id_i);
-            IntraPair::check_nullptr_ptcl(ptr_j, ep_i.getAtomID(), id_j);
-            IntraPair::check_nullptr_ptcl(ptr_k, ep_i.getAtomID(), id_k);
-
-            MODEL::KeyAngle  key_angle = std::make_tuple(ep_i.getMolType(),
-                                                         (*ptr_i).getAtomType(),
-                                                         (*ptr_j).getAtomType(),
-                                                         (*ptr_k).getAtomType() );
-
-            if(MODEL::coef_table.angle.count(key_angle) != 1){
-                std::ostringstream oss;
-                oss << "key_angle = " << ENUM::what(key_angle) << " is not defined in MODEL::coef_table.angle." << "\n";
-                throw std::invalid_argument(oss.str());
-            }
+        for(const auto& angle : term.angle){
+            if( !_Impl::isOwner_term(term, local, std::array<PS::S32, 3>{angle.i, angle.j, angle.k}) ) continue;
 
-            const auto angle_prm = MODEL::coef_table.angle.at(key_angle);
+            const auto& angle_prm = topology.getAngleParam(angle.coef);
             switch (angle_prm.form){
-                case IntraFuncForm::none:
-                    //--- free potential
-                    continue;
-                break;
-
                 case IntraFuncForm::harmonic:
-                    calcAngleForce_harmonic_IJK(Normalize::realPos( (*ptr_i).getPos() ),
-                                                Normalize::realPos( (*ptr_j).getPos() ),
-                                                Normalize::realPos( (*ptr_k).getPos() ),
-                                                id_i, id_j, id_k,
-                                                id_tgt, angle_prm,
-                                                force_IA);
+                    batch.angle_harmonic.push(Normalize::relativePosAdjustReal(pos[angle.i] - pos[angle.j]),
+                                              Normalize::relativePosAdjustReal(pos[angle.k] - pos[angle.j]),
+                                              angle_prm,
+                                              local[angle.i], local[angle.j], local[angle.k]                );
                 break;
 
                 default:
@@ -131,131 +234,63 @@ namespace FORCE {
         }
     }
 
-    template<class Tepi, class Ttree,
-             class Tforce>
-    void calcForceTorsion_IA(const Tepi   &ep_i,
-                                   Ttree  &tree,
-                                   Tforce &force_IA){
+    inline void gatherDihedral_IA(const IntraTopology           &topology,
+                                  const IntraTopology::AtomTerm &term,
+                                  const PS::F64vec              *pos,
+                                  const PS::S32                 *local,
+                                        _Impl::IntraBatchSet    &batch){
 
         //--- dihedral torsion potential
-        for(const auto& dihedral_set : ep_i.dihedral_list()){
-            const auto id_i   = std::get<0>(dihedral_set);
-            const auto id_j   = std::get<1>(dihedral_set);
-            const auto id_k   = std::get<2>(dihedral_set);
-            const auto id_l   = std::get<3>(dihedral_set);
-            const auto id_tgt = ep_i.getAtomID();
-
-            const auto* ptr_i = tree.getEpjFromId(id_i);
-            const auto* ptr_j = tree.getEpjFromId(id_j);
-            const auto* ptr_k = tree.getEpjFromId(id_k);
-            const auto* ptr_l = tree.getEpjFromId(id_l);
-
-            IntraPair::check_nullptr_ptcl(ptr_i, ep_i.getAtomID(), id_i);
-            IntraPair::check_nullptr_ptcl(ptr_j, ep_i.getAtomID(), id_j);
-            IntraPair::check_nullptr_ptcl(ptr_k, ep_i.getAtomID(), id_k);
-            IntraPair::check_nullptr_ptcl(ptr_l, ep_i.getAtomID(), id_l);
-
-            MODEL::KeyTorsion  key_torsion = std::make_tuple(ep_i.getMolType(),
-                                                             TorsionShape::dihedral,
-                                                             (*ptr_i).getAtomType(),
-                                                             (*ptr_j).getAtomType(),
-                                                             (*ptr_k).getAtomType(),
-                                                             (*ptr_l).getAtomType() );
-
-            if(MODEL::coef_table.torsion.count(key_torsion) != 1){
-                std::ostringstream oss;
-                oss << "key_torsion = " << ENUM::what(key_torsion) << " is not defined in MODEL::coef_table.torsion." << "\n";
-                throw std::invalid_argument(oss.str());
-            }
-
-            const auto torsion_prm = MODEL::coef_table.torsion.at(key_torsion);
+        for(const auto& torsion : term.dihedral){
+            if( !_Impl::isOwner_term(term, local,
+                                     std::array<PS::S32, 4>{torsion.i, torsion.j, torsion.k, torsion.l}) ) continue;
+
+            const auto&      torsion_prm = topology.getTorsionParam(torsion.coef);
+            const PS::F64vec R_ij        = Normalize::relativePosAdjustReal(pos[torsion.i] - pos[torsion.j]);
+            const PS::F64vec R_kj        = Normalize::relativePosAdjustReal(pos[torsion.k] - pos[torsion.j]);
+            const PS::F64vec R_kl        = Normalize::relativePosAdjustReal(pos[torsion.k] - pos[torsion.l]);
             switch (torsion_prm.form){
-                case IntraFuncForm::none:
-                    //--- free potential
-                    continue;
-                break;
-
                 case IntraFuncForm::cos:
-                    calcTorsionForce_harmonic_IJKL(Normalize::realPos( (*ptr_i).getPos() ),
-                                                   Normalize::realPos( (*ptr_j).getPos() ),
-                                                   Normalize::realPos( (*ptr_k).getPos() ),
-                                                   Normalize::realPos( (*ptr_l).getPos() ),
-                                                   id_i, id_j, id_k, id_l,
-                                                   id_tgt, torsion_prm,
-                                                   force_IA);
+                    batch.dihedral_harmonic.push(R_ij, R_kj, R_kl, torsion_prm,
+                                                 local[torsion.i], local[torsion.j], local[torsion.k], local[torsion.l]);
                 break;
 
                 case IntraFuncForm::OPLS_3:
-                    calcTorsionForce_OPLS_3rd_IJKL(Normalize::realPos( (*ptr_i).getPos() ),
-                                                   Normalize::realPos( (*ptr_j).getPos() ),
-                                                   Normalize::realPos( (*ptr_k).getPos() ),
-                                                   Normalize::realPos( (*ptr_l).getPos() ),
-                                                   id_i, id_j, id_k, id_l,
-                                                   id_tgt, torsion_prm,
-                                                   force_IA);
+                    batch.dihedral_OPLS_3rd.push(R_ij, R_kj, R_kl, torsion_prm,
+                                                 local[torsion.i], local[torsion.j], local[torsion.k], local[torsion.l]);
                 break;
 
                 default:
                     throw std::invalid_argument("undefined potential type: " + ENUM::what(torsion_prm.form) + "at dihedral torsion force");
             }
         }
+    }
 
-        //--- improper torsion potential
-        for(const auto& improper_set : ep_i.improper_list()){
-            const auto id_i   = std::get<0>(improper_set);
-            const auto id_j   = std::get<1>(improper_set);
-            const auto id_k   = std::get<2>(improper_set);
-            const auto id_l   = std::get<3>(improper_set);
-            const auto id_tgt = ep_i.getAtomID();
-
-            const auto* ptr_i = tree.getEpjFromId(id_i);
-            const auto* ptr_j = tree.getEpjFromId(id_j);
-            const auto* ptr_k = tree.getEpjFromId(id_k);
-            const auto* ptr_l = tree.getEpjFromId(id_l);
-
-            IntraPair::check_nullptr_ptcl(ptr_i, ep_i.getAtomID(), id_i);
-            IntraPair::check_nullptr_ptcl(ptr_j, ep_i.getAtomID(), id_j);
-            IntraPair::check_nullptr_ptcl(ptr_k, ep_i.getAtomID(), id_k);
-            IntraPair::check_nullptr_ptcl(ptr_l, ep_i.getAtomID(), id_l);
-
-            MODEL::KeyTorsion  key_torsion = std::make_tuple(ep_i.getMolType(),
-                                                             TorsionShape::improper,
-                                                             (*ptr_i).getAtomType(),
-                                                             (*ptr_j).getAtomType(),
-                                                             (*ptr_k).getAtomType(),
-                                                             (*ptr_l).getAtomType() );
-
-            if(MODEL::coef_table.torsion.count(key_torsion) != 1){
-                std::ostringstream oss;
-                oss << "key_torsion = " << ENUM::what(key_torsion) << " is not defined in MODEL::coef_table.torsion." << "\n";
-                throw std::invalid_argument(oss.str());
-            }
+    //--- the improper tuple is common between the participants (the tuple of the center atom, see IntraTopology).
+    inline void gatherImproper_IA(const IntraTopology           &topology,
+                                  const IntraTopology::AtomTerm &term,
+                                  const PS::F64vec              *pos,
+                                  const PS::S32                 *local,
+                                        _Impl::IntraBatchSet    &batch){
 
-            const auto torsion_prm = MODEL::coef_table.torsion.at(key_torsion);
+        //--- improper torsion potential
+        for(const auto& torsion : term.improper){
+            if( !_Impl::isOwner_term(term, local,
+                                     std::array<PS::S32, 4>{torsion.i, torsion.j, torsion.k, torsion.l}) ) continue;
+
+            const auto&      torsion_prm = topology.getTorsionParam(torsion.coef);
+            const PS::F64vec R_ij        = Normalize::relativePosAdjustReal(pos[torsion.i] - pos[torsion.j]);
+            const PS::F64vec R_kj        = Normalize::relativePosAdjustReal(pos[torsion.k] - pos[torsion.j]);
+            const PS::F64vec R_kl        = Normalize::relativePosAdjustReal(pos[torsion.k] - pos[torsion.l]);
             switch (torsion_prm.form){
-                case IntraFuncForm::none:
-                    //--- free potential
-                    continue;
-                break;
-
                 case IntraFuncForm::cos:
-                    calcTorsionForce_harmonic_IJKL(Normalize::realPos( (*ptr_i).getPos() ),
-                                                   Normalize::realPos( (*ptr_j).getPos() ),
-                                                   Normalize::realPos( (*ptr_k).getPos() ),
-                                                   Normalize::realPos( (*ptr_l).getPos() ),
-                                                   id_i, id_j, id_k, id_l,
-                                                   id_tgt, torsion_prm,
-                                                   force_IA);
+                    batch.improper_harmonic.push(R_ij, R_kj, R_kl, torsion_prm,
+                                                 local[torsion.i], local[torsion.j], local[torsion.k], local[torsion.l]);
                 break;
 
                 case IntraFuncForm::OPLS_3:
-                    calcTorsionForce_OPLS_3rd_IJKL(Normalize::realPos( (*ptr_i).getPos() ),
-                                                   Normalize::realPos( (*ptr_j).getPos() ),
-                                                   Normalize::realPos( (*ptr_k).getPos() ),
-                                                   Normalize::realPos( (*ptr_l).getPos() ),
-                                                   id_i, id_j, id_k, id_l,
-                                                   id_tgt, torsion_prm,
-                                                   force_IA);
+                    batch.improper_OPLS_3rd.push(R_ij, R_kj, R_kl, torsion_prm,
+                                                 local[torsion.i], local[torsion.j], local[torsion.k], local[torsion.l]);
                 break;
 
                 default:
@@ -264,35 +299,104 @@ namespace FORCE {
         }
     }
 
+    //--- evaluate the gathered terms for each function form, then add the result into force buffer.
+    template <class Tforce>
+    void calcForceBatch(_Impl::IntraBatchSet &batch,
+                        std::vector<Tforce>  &force_buff){
+
+        calcBondBatch_harmonic(batch.bond_harmonic);
+        scatterBatch(batch.bond_harmonic, force_buff, &Tforce::addPotBond);
+
+        calcBondBatch_anharmonic(batch.bond_anharmonic);
+        scatterBatch(batch.bond_anharmonic, force_buff, &Tforce::addPotBond);
 
-    //--- template function for FDPS interface
-    template <class TSM, class Tforce, class Tepi, class Tepj, class Tmomloc, class Tmomglb, class Tspj,
-              class Tpsys>
-    void calcForceIntra(PS::TreeForForce<TSM,
-                                         Tforce,
-                                         Tepi,
-                                         Tepj,
-                                         Tmomloc,
-                                         Tmomglb,
-                                         Tspj    > &tree,
-                        Tpsys                      &atom ){
+        calcAngleBatch_harmonic(batch.angle_harmonic);
+        scatterBatch(batch.angle_harmonic, force_buff, &Tforce::addPotAngle);
+
+        calcTorsionBatch_harmonic(batch.dihedral_harmonic);
+        scatterBatch(batch.dihedral_harmonic, force_buff, &Tforce::addPotTorsion);
+
+        calcTorsionBatch_OPLS_3rd(batch.dihedral_OPLS_3rd);
+        scatterBatch(batch.dihedral_OPLS_3rd, force_buff, &Tforce::addPotTorsion);
+
+        calcTorsionBatch_harmonic(batch.improper_harmonic);
+        scatterBatch(batch.improper_harmonic, force_buff, &Tforce::addPotTorsion);
+
+        calcTorsionBatch_OPLS_3rd(batch.improper_OPLS_3rd);
+        scatterBatch(batch.improper_OPLS_3rd, force_buff, &Tforce::addPotTorsion);
+    }
+
+
+    /**
+    * @brief template function for FDPS interface
+    * @details the tree is used only for neighbor search by getEpjFromId().
+    *          PS::TreeForForce is available if its EPJ has position, owner rank and intra index,
+    *          and its search radius covers EP_intra::getRSearch(). IntraLocalEpj is also available.
+    */
+    template <class Ttree, class Tpsys>
+    void calcForceIntra(const IntraTopology  &topology,
+                              IntraSlotTable &slot_table,
+                              Ttree          &tree,
+                              Tpsys          &atom ){
+
+        using Tforce = ForceIntra<PS::F64>;
 
         const PS::S64 n_local = atom.getNumberOfParticleLocal();
 
-        Tforce force_IA;
+        //--- resolve neighbor slots in the tree
+        slot_table.resolve(topology, tree, atom);
+
+        //--- thread local buffer for gathered terms and scattered result
+        static std::vector<_Impl::IntraThreadBuff<Tforce>> thread_buff;
 
         //--- calculate intramolecular force
         #ifdef PARTICLE_SIMULATOR_THREAD_PARALLEL
-            #pragma omp parallel for private(force_IA)
+            #pragma omp parallel
         #endif
-        for(PS::S64 i=0; i<n_local; ++i){
-            force_IA.clear();
-
-            calcForceBond_IA(   atom[i], tree, force_IA);
-            calcForceAngle_IA(  atom[i], tree, force_IA);
-            calcForceTorsion_IA(atom[i], tree, force_IA);
+        {
+            PS::S32 n_thread = 1;
+            PS::S32 i_thread = 0;
+            #ifdef PARTICLE_SIMULATOR_THREAD_PARALLEL
+                n_thread = omp_get_num_threads();
+                i_thread = omp_get_thread_num();
+                #pragma omp single
+            #endif
+            {
+                if(thread_buff.size() < static_cast<size_t>(n_thread)) thread_buff.resize(n_thread);
+            }
 
-            atom[i].copyForceIntra(force_IA);
+            auto& buff = thread_buff[i_thread];
+            buff.force.resize(n_local);
+            for(auto& f : buff.force) f.clear();
+            buff.batch.clear();
+
+            #ifdef PARTICLE_SIMULATOR_THREAD_PARALLEL
+                #pragma omp for nowait
+            #endif
+            for(PS::S64 i=0; i<n_local; ++i){
+                const auto&       term  = slot_table.getTerm(i);
+                const PS::F64vec *pos   = slot_table.getPos(i);
+                const PS::S32    *local = slot_table.getLocal(i);
+
+                gatherBond_IA(    topology, term, pos, local, slot_table.getShift(i), buff.batch);
+                gatherAngle_IA(   topology, term, pos, local,                         buff.batch);
+                gatherDihedral_IA(topology, term, pos, local,                         buff.batch);
+                gatherImproper_IA(topology, term, pos, local,                         buff.batch);
+            }
+            calcForceBatch(buff.batch, buff.force);
+
+            //--- reduce thread buffers
+            #ifdef PARTICLE_SIMULATOR_THREAD_PARALLEL
+                #pragma omp barrier
+                #pragma omp for
+            #endif
+            for(PS::S64 i=0; i<n_local; ++i){
+                Tforce force_IA = thread_buff[0].force[i];
+                for(PS::S32 t=1; t<n_thread; ++t){
+                    force_IA.accumForceIntra(thread_buff[t].force[i]);
+                }
+                atom[i].copyForceIntra(force_IA);
+            }
         }
     }
 
@@ -4,7 +4,9 @@
 #pragma once
 
 #include <cmath>
+#include <vector>
 #include <cassert>
+#include <algorithm>
 #include <stdexcept>
 
 #include <particle_simulator.hpp>
@@ -29,11 +31,13 @@ namespace FORCE {
     }
 
     //------ harmonic bond potential
+    //  the result is added to the non-null force_i and force_j (each atom has the half of potential).
     template <class Tcoef, class Tforce>
     void calcBondForce_harmonic_IJ(const PS::F64vec &pos_i,
                                    const PS::F64vec &pos_j,
                                    const Tcoef      &coef,
-                                         Tforce     &force_i){
+                                         Tforce     *force_i,
+                                         Tforce     *force_j){
 
         PS::F64vec R_ij = Normalize::relativePosAdjustReal(pos_i - pos_j);
         PS::F64    r2   = R_ij*R_ij;
@@ -46,22 +50,41 @@ namespace FORCE {
 
         //--- potential
         PS::F64 r_diff = r - coef.r0;
-        force_i.addPotBond( 0.5*0.5*coef.k*r_diff*r_diff );
+        PS::F64 pot    = 0.5*0.5*coef.k*r_diff*r_diff;
 
         //--- force
         PS::F64vec F_ij = ( -coef.k*r_diff/r )*R_ij;
-        force_i.addForceIntra( F_ij );
 
         //--- virial
-        force_i.addVirialIntra( calcVirialEPI(F_ij, R_ij) );
+        PS::F64vec virial = calcVirialEPI(F_ij, R_ij);
+
+        if(force_i != nullptr){
+            force_i->addPotBond(pot);
+            force_i->addForceIntra( F_ij );
+            force_i->addVirialIntra(virial);
+        }
+        if(force_j != nullptr){
+            force_j->addPotBond(pot);
+            force_j->addForceIntra(-F_ij );
+            force_j->addVirialIntra(virial);
+        }
+    }
+    template <class Tcoef, class Tforce>
+    void calcBondForce_harmonic_IJ(const PS::F64vec &pos_i,
+                                   const PS::F64vec &pos_j,
+                                   const Tcoef      &coef,
+                                         Tforce     &force_i){
+        calcBondForce_harmonic_IJ(pos_i, pos_j, coef, &force_i, static_cast<Tforce*>(nullptr));
     }
 
     //------ anharmonic bond potential
+    //  the result is added to the non-null force_i and force_j (each atom has the half of potential).
     template <class Tcoef, class Tforce>
     void calcBondForce_anharmonic_IJ(const PS::F64vec  &pos_i,
                                      const PS::F64vec  &pos_j,
                                      const Tcoef       &coef,
-                                           Tforce      &force_i){
+                                           Tforce      *force_i,
+                                           Tforce      *force_j){
 
         PS::F64vec R_ij = Normalize::relativePosAdjustReal(pos_i - pos_j);
         PS::F64    r2   = R_ij*R_ij;
@@ -76,28 +99,45 @@ namespace FORCE {
         constexpr PS::F64 factor = 7.0/12.0;
         PS::F64 ar  = coef.a*(r - coef.r0);
         PS::F64 ar2 = ar*ar;
-        force_i.addPotBond(    0.5*coef.k*(  1.0 - ar + factor*ar2)*ar2 );
+        PS::F64 pot = 0.5*coef.k*(  1.0 - ar + factor*ar2)*ar2;
 
         //--- force
         PS::F64    ebp   = -coef.a*coef.k*( (2.0 - 3.0*ar) + 4.0*factor*ar2 )*ar/r;
         PS::F64vec F_ij = ebp*R_ij;
-        force_i.addForceIntra( F_ij );
 
         //--- virial
-        force_i.addVirialIntra( calcVirialEPI(F_ij, R_ij) );
+        PS::F64vec virial = calcVirialEPI(F_ij, R_ij);
+
+        if(force_i != nullptr){
+            force_i->addPotBond(pot);
+            force_i->addForceIntra( F_ij );
+            force_i->addVirialIntra(virial);
+        }
+        if(force_j != nullptr){
+            force_j->addPotBond(pot);
+            force_j->addForceIntra(-F_ij );
+            force_j->addVirialIntra(virial);
+        }
+    }
+    template <class Tcoef, class Tforce>
+    void calcBondForce_anharmonic_IJ(const PS::F64vec  &pos_i,
+                                     const PS::F64vec  &pos_j,
+                                     const Tcoef       &coef,
+                                           Tforce      &force_i){
+        calcBondForce_anharmonic_IJ(pos_i, pos_j, coef, &force_i, static_cast<Tforce*>(nullptr));
     }
 
     //------ harminic angle potential  (i-j-k form: "j" must be center)
-    template <class Tid, class Tcoef, class Tforce>
+    //  the result is added to the non-null force_i, force_j and force_k (each atom has 1/3 of potential).
+    //  "coef.cos_theta0" must be cos(coef.theta0) (see IntraTopology::AngleParam).
+    template <class Tcoef, class Tforce>
     void calcAngleForce_harmonic_IJK(const PS::F64vec &pos_i,
                                      const PS::F64vec &pos_j,
                                      const PS::F64vec &pos_k,
-                                     const Tid        &id_i,
-                                     const Tid        &id_j,
-                                     const Tid        &id_k,
-                                     const Tid        &id_tgt,
                                      const Tcoef      &coef,
-                                           Tforce     &force_tgt){
+                                           Tforce     *force_i,
+                                           Tforce     *force_j,
+                                           Tforce     *force_k){
 
         PS::F64vec R_ij = Normalize::relativePosAdjustReal(pos_i - pos_j);
         PS::F64vec R_kj = Normalize::relativePosAdjustReal(pos_k - pos_j);
@@ -108,10 +148,10 @@ namespace FORCE {
         PS::F64 in_prod  = R_ij*R_kj;
         PS::F64 r_ab_inv = 1.0/(r_a*r_b);
         PS::F64 cos_tmp  = in_prod*r_ab_inv;
-        PS::F64 diff     = cos_tmp - std::cos(coef.theta0);
+        PS::F64 diff     = cos_tmp - coef.cos_theta0;
 
         //--- potential
-        force_tgt.addPotAngle( (1.0/3.0)*0.5*coef.k*diff*diff );
+        PS::F64 pot = (1.0/3.0)*0.5*coef.k*diff*diff;
 
         //--- force
         PS::F64 acoef     = -coef.k*diff;
@@ -120,18 +160,37 @@ namespace FORCE {
         PS::F64vec F_ij = (acoef*r_ab2_inv)*( (r_b*r_b*cos_tmp)*R_ij - (r_a*r_b)*R_kj );
         PS::F64vec F_kj = (acoef*r_ab2_inv)*( (r_a*r_a*cos_tmp)*R_kj - (r_a*r_b)*R_ij );
 
+        //--- output
+        if(force_i != nullptr){
+            force_i->addPotAngle(pot);
+            force_i->addForceIntra(-F_ij);
+            force_i->addVirialIntra( -calcVirialEPI(F_ij, R_ij) );
+        }
+        if(force_j != nullptr){
+            force_j->addPotAngle(pot);
+            force_j->addForceIntra(F_ij + F_kj);
+            force_j->addVirialIntra(  calcVirialEPI(F_ij, R_ij)
+                                    + calcVirialEPI(F_kj, R_kj) );
+        }
+        if(force_k != nullptr){
+            force_k->addPotAngle(pot);
+            force_k->addForceIntra(-F_kj);
+            force_k->addVirialIntra( -calcVirialEPI(F_kj, R_kj) );
+        }
+    }
+    template <class Tid, class Tcoef, class Tforce>
+    void calcAngleForce_harmonic_IJK(const PS::F64vec &pos_i,
+                                     const PS::F64vec &pos_j,
+                                     const PS::F64vec &pos_k,
+                                     const Tid        &id_i,
+                                     const Tid        &id_j,
+                                     const Tid        &id_k,
+                                     const Tid        &id_tgt,
+                                     const Tcoef      &coef,
+                                           Tforce     &force_tgt){
+
         //--- select output
-        if(       id_tgt == id_i){
-            force_tgt.addForceIntra(-F_ij);
-            force_tgt.addVirialIntra( -calcVirialEPI(F_ij, R_ij) );
-        } else if(id_tgt == id_j) {
-            force_tgt.addForceIntra(F_ij + F_kj);
-            force_tgt.addVirialIntra(  calcVirialEPI(F_ij, R_ij)
-                                     + calcVirialEPI(F_kj, R_kj) );
-        } else if(id_tgt == id_k) {
-            force_tgt.addForceIntra(-F_kj);
-            force_tgt.addVirialIntra( -calcVirialEPI(F_kj, R_kj) );
-        } else {
+        if(id_tgt != id_i && id_tgt != id_j && id_tgt != id_k){
             std::ostringstream oss;
             oss << "id_tgt is not match to id_i, id_j, or id_k in angle pair." << "\n"
                 << "   id_tgt = " << id_tgt << "\n"
@@ -140,6 +199,10 @@ namespace FORCE {
                 <<       "  k = " << id_k << "\n";
             throw std::invalid_argument(oss.str());
         }
+        calcAngleForce_harmonic_IJK(pos_i, pos_j, pos_k, coef,
+                                    (id_tgt == id_i) ? &force_tgt : nullptr,
+                                    (id_tgt == id_j) ? &force_tgt : nullptr,
+                                    (id_tgt == id_k) ? &force_tgt : nullptr );
     }
 
     //------ support functions for torsion force
@@ -260,40 +323,14 @@ namespace FORCE {
         return result;
     }
 
-    //------ harminic torsion potential  (i-jk-l form)
-    //  shape:      i
-    //              |
-    //              j---k     ---- axis ----
-    //              |   |
-    //   (improper) l   l (dihedral)
-    template <class Tid, class Tcoef, class Tforce>
-    void calcTorsionForce_harmonic_IJKL(const PS::F64vec &pos_i,
-                                        const PS::F64vec &pos_j,
-                                        const PS::F64vec &pos_k,
-                                        const PS::F64vec &pos_l,
-                                        const Tid        &id_i,
-                                        const Tid        &id_j,
-                                        const Tid        &id_k,
-                                        const Tid        &id_l,
-                                        const Tid        &id_tgt,
-                                        const Tcoef      &coef,
-                                              Tforce     &force_tgt){
-
-        if( std::abs(coef.theta0)            <= 1.e-5 ||
-            std::abs(coef.theta0 - Unit::pi) <= 1.e-5 ){
-            //--- pass checking
-        } else {
-            throw std::invalid_argument("theta0 = " + std::to_string(coef.theta0)
-                                        + ", must be 0.0 or pi (0.0 or 180.0 in degree).");
-        }
-
-        auto local_vec = calcTorsionForce_LocalVec(pos_i, pos_j, pos_k, pos_l);
-        auto Force_tmp = calcTorsionForce_intensity(local_vec,
-                                                    coef.k,
-                                                    coef.theta0,
-                                                    coef.n_min  );
-
-        force_tgt.addPotTorsion(Force_tmp.eng);
+    //------ scatter the torsion force into the non-null force_i, force_j, force_k and force_l
+    template <typename Tlocal_vec, class Tforce>
+    inline void scatterTorsionForce(const Tlocal_vec            &local_vec,
+                                    const TorsionForceIntensity &Force_tmp,
+                                          Tforce                *force_i,
+                                          Tforce                *force_j,
+                                          Tforce                *force_k,
+                                          Tforce                *force_l){
 
         PS::F64vec F_a = (  local_vec.R_b*local_vec.r_b_inv
                           - local_vec.R_a*local_vec.r_a_inv*local_vec.cos_p)*local_vec.r_a_inv;
@@ -301,25 +338,41 @@ namespace FORCE {
                           - local_vec.R_b*local_vec.r_b_inv*local_vec.cos_p)*local_vec.r_b_inv;
 
         PS::F64vec F_tmp;
-        if(       id_tgt == id_i){
+        if(force_i != nullptr){
             F_tmp = Force_tmp.f*VEC_EXT::cross(F_a, local_vec.R_kj);
-            force_tgt.addForceIntra(F_tmp);
-            force_tgt.addVirialIntra( 2.0*calcVirialEPI(F_tmp, local_vec.R_ij) );
-        } else if(id_tgt == id_j){
+            force_i->addPotTorsion(Force_tmp.eng);
+            force_i->addForceIntra(F_tmp);
+            force_i->addVirialIntra( 2.0*calcVirialEPI(F_tmp, local_vec.R_ij) );
+        }
+        if(force_j != nullptr){
             F_tmp = Force_tmp.f*(  VEC_EXT::cross( F_a, local_vec.R_ik)
                                  + VEC_EXT::cross(-F_b, local_vec.R_kl) );
-            force_tgt.addForceIntra(F_tmp);
+            force_j->addPotTorsion(Force_tmp.eng);
+            force_j->addForceIntra(F_tmp);
             //--- virial = 0.
-        } else if(id_tgt == id_k){
+        }
+        if(force_k != nullptr){
             F_tmp = Force_tmp.f*(  VEC_EXT::cross(-F_a, local_vec.R_ij)
                                  + VEC_EXT::cross( F_b, local_vec.R_jl) );
-            force_tgt.addForceIntra(F_tmp);
-            force_tgt.addVirialIntra( 2.0*calcVirialEPI(F_tmp, local_vec.R_kj) );
-        } else if(id_tgt == id_l){
+            force_k->addPotTorsion(Force_tmp.eng);
+            force_k->addForceIntra(F_tmp);
+            force_k->addVirialIntra( 2.0*calcVirialEPI(F_tmp, local_vec.R_kj) );
+        }
+        if(force_l != nullptr){
             F_tmp = Force_tmp.f*VEC_EXT::cross(F_b, local_vec.R_kj);
-            force_tgt.addForceIntra(F_tmp);
-            force_tgt.addVirialIntra( 2.0*calcVirialEPI(F_tmp, -local_vec.R_jl) );
-        } else {
+            force_l->addPotTorsion(Force_tmp.eng);
+            force_l->addForceIntra(F_tmp);
+            force_l->addVirialIntra( 2.0*calcVirialEPI(F_tmp, -local_vec.R_jl) );
+        }
+    }
+
+    template <class Tid>
+    void check_torsion_tgt(const Tid &id_i,
+                           const Tid &id_j,
+                           const Tid &id_k,
+                           const Tid &id_l,
+                           const Tid &id_tgt){
+        if(id_tgt != id_i && id_tgt != id_j && id_tgt != id_k && id_tgt != id_l){
             std::ostringstream oss;
             oss << "id_tgt is not match to id_i, id_j, id_k, or id_l in torsion pair." << "\n"
                 << "   id_tgt = " << id_tgt << "\n"
@@ -331,15 +384,35 @@ namespace FORCE {
         }
     }
 
-
-    //------ OPLS_AA 3rd order torsion potential  (i-jk-l form)
+    //------ harminic torsion potential  (i-jk-l form)
     //  shape:      i
     //              |
     //              j---k     ---- axis ----
     //              |   |
     //   (improper) l   l (dihedral)
+    //  the result is added to the non-null force_i ~ force_l (each atom has 1/4 of potential).
+    //  "coef.theta0" must be 0.0 or pi (checked in IntraTopology::init()).
+    template <class Tcoef, class Tforce>
+    void calcTorsionForce_harmonic_IJKL(const PS::F64vec &pos_i,
+                                        const PS::F64vec &pos_j,
+                                        const PS::F64vec &pos_k,
+                                        const PS::F64vec &pos_l,
+                                        const Tcoef      &coef,
+                                              Tforce     *force_i,
+                                              Tforce     *force_j,
+                                              Tforce     *force_k,
+                                              Tforce     *force_l){
+
+        auto local_vec = calcTorsionForce_LocalVec(pos_i, pos_j, pos_k, pos_l);
+        auto Force_tmp = calcTorsionForce_intensity(local_vec,
+                                                    coef.k,
+                                                    coef.theta0,
+                                                    coef.n_min  );
+
+        scatterTorsionForce(local_vec, Force_tmp, force_i, force_j, force_k, force_l);
+    }
     template <class Tid, class Tcoef, class Tforce>
-    void calcTorsionForce_OPLS_3rd_IJKL(const PS::F64vec &pos_i,
+    void calcTorsionForce_harmonic_IJKL(const PS::F64vec &pos_i,
                                         const PS::F64vec &pos_j,
                                         const PS::F64vec &pos_k,
                                         const PS::F64vec &pos_l,
@@ -351,6 +424,33 @@ namespace FORCE {
                                         const Tcoef      &coef,
                                               Tforce     &force_tgt){
 
+        check_torsion_tgt(id_i, id_j, id_k, id_l, id_tgt);
+        calcTorsionForce_harmonic_IJKL(pos_i, pos_j, pos_k, pos_l, coef,
+                                       (id_tgt == id_i) ? &force_tgt : nullptr,
+                                       (id_tgt == id_j) ? &force_tgt : nullptr,
+                                       (id_tgt == id_k) ? &force_tgt : nullptr,
+                                       (id_tgt == id_l) ? &force_tgt : nullptr );
+    }
+
+
+    //------ OPLS_AA 3rd order torsion potential  (i-jk-l form)
+    //  shape:      i
+    //              |
+    //              j---k     ---- axis ----
+    //              |   |
+    //   (improper) l   l (dihedral)
+    //  the result is added to the non-null force_i ~ force_l (each atom has 1/4 of potential).
+    template <class Tcoef, class Tforce>
+    void calcTorsionForce_OPLS_3rd_IJKL(const PS::F64vec &pos_i,
+                                        const PS::F64vec &pos_j,
+                                        const PS::F64vec &pos_k,
+                                        const PS::F64vec &pos_l,
+                                        const Tcoef      &coef,
+                                              Tforce     *force_i,
+                                              Tforce     *force_j,
+                                              Tforce     *force_k,
+                                              Tforce     *force_l){
+
         auto local_vec = calcTorsionForce_LocalVec(pos_i, pos_j, pos_k, pos_l);
 
         auto Force_tmp  = calcTorsionForce_intensity(local_vec,
@@ -360,41 +460,524 @@ namespace FORCE {
              Force_tmp += calcTorsionForce_intensity(local_vec,
                                                      coef.k3, Unit::pi, 3);
 
-        force_tgt.addPotTorsion(Force_tmp.eng);
+        scatterTorsionForce(local_vec, Force_tmp, force_i, force_j, force_k, force_l);
+    }
+    template <class Tid, class Tcoef, class Tforce>
+    void calcTorsionForce_OPLS_3rd_IJKL(const PS::F64vec &pos_i,
+                                        const PS::F64vec &pos_j,
+                                        const PS::F64vec &pos_k,
+                                        const PS::F64vec &pos_l,
+                                        const Tid        &id_i,
+                                        const Tid        &id_j,
+                                        const Tid        &id_k,
+                                        const Tid        &id_l,
+                                        const Tid        &id_tgt,
+                                        const Tcoef      &coef,
+                                              Tforce     &force_tgt){
 
-        PS::F64vec F_a = (  local_vec.R_b*local_vec.r_b_inv
-                          - local_vec.R_a*local_vec.r_a_inv*local_vec.cos_p)*local_vec.r_a_inv;
-        PS::F64vec F_b = (  local_vec.R_a*local_vec.r_a_inv
-                          - local_vec.R_b*local_vec.r_b_inv*local_vec.cos_p)*local_vec.r_b_inv;
+        check_torsion_tgt(id_i, id_j, id_k, id_l, id_tgt);
+        calcTorsionForce_OPLS_3rd_IJKL(pos_i, pos_j, pos_k, pos_l, coef,
+                                       (id_tgt == id_i) ? &force_tgt : nullptr,
+                                       (id_tgt == id_j) ? &force_tgt : nullptr,
+                                       (id_tgt == id_k) ? &force_tgt : nullptr,
+                                       (id_tgt == id_l) ? &force_tgt : nullptr );
+    }
 
-        PS::F64vec F_tmp;
-        if(       id_tgt == id_i){
-            F_tmp = Force_tmp.f*VEC_EXT::cross(F_a, local_vec.R_kj);
-            force_tgt.addForceIntra(F_tmp);
-            force_tgt.addVirialIntra( 2.0*calcVirialEPI(F_tmp, local_vec.R_ij) );
-        } else if(id_tgt == id_j){
-            F_tmp = Force_tmp.f*(  VEC_EXT::cross( F_a, local_vec.R_ik)
-                                 + VEC_EXT::cross(-F_b, local_vec.R_kl) );
-            force_tgt.addForceIntra(F_tmp);
-            //--- virial = 0.
-        } else if(id_tgt == id_k){
-            F_tmp = Force_tmp.f*(  VEC_EXT::cross(-F_a, local_vec.R_ij)
-                                 + VEC_EXT::cross( F_b, local_vec.R_jl) );
-            force_tgt.addForceIntra(F_tmp);
-            force_tgt.addVirialIntra( 2.0*calcVirialEPI(F_tmp, local_vec.R_kj) );
-        } else if(id_tgt == id_l){
-            F_tmp = Force_tmp.f*VEC_EXT::cross(F_b, local_vec.R_kj);
-            force_tgt.addForceIntra(F_tmp);
-            force_tgt.addVirialIntra( 2.0*calcVirialEPI(F_tmp, -local_vec.R_jl) );
-        } else {
-            std::ostringstream oss;
-            oss << "id_tgt is not match to id_i, id_j, id_k, or id_l in torsion pair." << "\n"
-                << "   id_tgt = " << id_tgt << "\n"
-                << "        i = " << id_i
-                <<       ", j = " << id_j
-                <<       ", k = " << id_k
-                <<       ", l = " << id_l << "\n";
-            throw std::invalid_argument(oss.str());
+
+    //------ batch kernels of bonded terms
+    //  the terms of the same function form are gathered into structure-of-arrays and evaluated in a loop
+    //  without branch for auto-vectorization ("#pragma omp simd" in OpenMP mode).
+    //  the input is the relative vectors of the participants, the output is the force and virial on each participant.
+    //  the output is added into atoms by "scatterBatch()" with the index of participants (-1: skipped).
+    template <PS::S32 N_vec, PS::S32 N_atom>
+    struct IntraBatchBase {
+        std::vector<PS::F64> r_x[N_vec], r_y[N_vec], r_z[N_vec];
+        std::vector<PS::S32> tgt[N_atom];
+
+        std::vector<PS::F64> f_x[N_atom], f_y[N_atom], f_z[N_atom];
+        std::vector<PS::F64> v_x[N_atom], v_y[N_atom], v_z[N_atom];
+        std::vector<PS::F64> pot;    // potential share of each participant
+
+        inline PS::S64 size() const { return static_cast<PS::S64>(this->tgt[0].size()); }
+
+        void clear(){
+            for(PS::S32 v=0; v<N_vec; ++v){
+                this->r_x[v].clear();
+                this->r_y[v].clear();
+                this->r_z[v].clear();
+            }
+            for(PS::S32 a=0; a<N_atom; ++a){
+                this->tgt[a].clear();
+            }
+        }
+
+        //--- used in push() of derived class
+        inline void push_vec(const PS::S32 v, const PS::F64vec &r){
+            this->r_x[v].push_back(r.x);
+            this->r_y[v].push_back(r.y);
+            this->r_z[v].push_back(r.z);
+        }
+        inline void push_tgt(const PS::S32 a, const PS::S32 index){
+            this->tgt[a].push_back(index);
+        }
+
+        //--- used in kernel
+        struct OutputPtr {
+            PS::F64 *f_x[N_atom], *f_y[N_atom], *f_z[N_atom];
+            PS::F64 *v_x[N_atom], *v_y[N_atom], *v_z[N_atom];
+            PS::F64 *pot;
+        };
+        OutputPtr resize_output(){
+            const PS::S64 n = this->size();
+            OutputPtr out;
+            for(PS::S32 a=0; a<N_atom; ++a){
+                this->f_x[a].resize(n);
+                this->f_y[a].resize(n);
+                this->f_z[a].resize(n);
+                this->v_x[a].resize(n);
+                this->v_y[a].resize(n);
+                this->v_z[a].resize(n);
+                out.f_x[a] = this->f_x[a].data();
+                out.f_y[a] = this->f_y[a].data();
+                out.f_z[a] = this->f_z[a].data();
+                out.v_x[a] = this->v_x[a].data();
+                out.v_y[a] = this->v_y[a].data();
+                out.v_z[a] = this->v_z[a].data();
+            }
+            this->pot.resize(n);
+            out.pot = this->pot.data();
+            return out;
+        }
+    };
+
+    //--- R_ij = pos_i - pos_j
+    struct BondBatch : public IntraBatchBase<1, 2> {
+        std::vector<PS::F64> k, r0, a;
+
+        void clear(){
+            IntraBatchBase<1, 2>::clear();
+            this->k.clear();
+            this->r0.clear();
+            this->a.clear();
+        }
+        template <class Tcoef>
+        void push(const PS::F64vec &R_ij,
+                  const Tcoef      &coef,
+                  const PS::S32     tgt_i,
+                  const PS::S32     tgt_j){
+            this->push_vec(0, R_ij);
+            this->push_tgt(0, tgt_i);
+            this->push_tgt(1, tgt_j);
+            this->k.push_back(coef.k);
+            this->r0.push_back(coef.r0);
+            this->a.push_back(coef.a);
+        }
+    };
+
+    //--- R_ij = pos_i - pos_j, R_kj = pos_k - pos_j ("j" must be center)
+    struct AngleBatch : public IntraBatchBase<2, 3> {
+        std::vector<PS::F64> k, cos_theta0;
+
+        void clear(){
+            IntraBatchBase<2, 3>::clear();
+            this->k.clear();
+            this->cos_theta0.clear();
+        }
+        template <class Tcoef>
+        void push(const PS::F64vec &R_ij,
+                  const PS::F64vec &R_kj,
+                  const Tcoef      &coef,
+                  const PS::S32     tgt_i,
+                  const PS::S32     tgt_j,
+                  const PS::S32     tgt_k){
+            this->push_vec(0, R_ij);
+            this->push_vec(1, R_kj);
+            this->push_tgt(0, tgt_i);
+            this->push_tgt(1, tgt_j);
+            this->push_tgt(2, tgt_k);
+            this->k.push_back(coef.k);
+            this->cos_theta0.push_back(coef.cos_theta0);
+        }
+    };
+
+    //--- R_ij = pos_i - pos_j, R_kj = pos_k - pos_j, R_kl = pos_k - pos_l (i-jk-l form)
+    //    used for both dihedral and improper torsion (gathered into separated batches for each shape and form).
+    struct TorsionBatch : public IntraBatchBase<3, 4> {
+        std::vector<PS::F64> k, k2, k3, cos_eq;
+        std::vector<PS::S32> n_min;
+
+        void clear(){
+            IntraBatchBase<3, 4>::clear();
+            this->k.clear();
+            this->k2.clear();
+            this->k3.clear();
+            this->cos_eq.clear();
+            this->n_min.clear();
+        }
+        template <class Tcoef>
+        void push(const PS::F64vec &R_ij,
+                  const PS::F64vec &R_kj,
+                  const PS::F64vec &R_kl,
+                  const Tcoef      &coef,
+                  const PS::S32     tgt_i,
+                  const PS::S32     tgt_j,
+                  const PS::S32     tgt_k,
+                  const PS::S32     tgt_l){
+            this->push_vec(0, R_ij);
+            this->push_vec(1, R_kj);
+            this->push_vec(2, R_kl);
+            this->push_tgt(0, tgt_i);
+            this->push_tgt(1, tgt_j);
+            this->push_tgt(2, tgt_k);
+            this->push_tgt(3, tgt_l);
+            this->k.push_back(coef.k);
+            this->k2.push_back(coef.k2);
+            this->k3.push_back(coef.k3);
+            this->cos_eq.push_back(coef.cos_theta0);
+            this->n_min.push_back(coef.n_min);
+        }
+    };
+
+    //------ bond batch: harmonic  (the bond length is checked in gathering)
+    inline void calcBondBatch_harmonic(BondBatch &batch){
+        const auto out = batch.resize_output();
+
+        const PS::S64  n_term = batch.size();
+        const PS::F64 *rx = batch.r_x[0].data();
+        const PS::F64 *ry = batch.r_y[0].data();
+        const PS::F64 *rz = batch.r_z[0].data();
+        const PS::F64 *k  = batch.k.data();
+        const PS::F64 *r0 = batch.r0.data();
+
+        #ifdef PARTICLE_SIMULATOR_THREAD_PARALLEL
+            #pragma omp simd
+        #endif
+        for(PS::S64 m=0; m<n_term; ++m){
+            const PS::F64 r      = std::sqrt(rx[m]*rx[m] + ry[m]*ry[m] + rz[m]*rz[m]);
+            const PS::F64 r_diff = r - r0[m];
+            const PS::F64 f      = -k[m]*r_diff/r;
+
+            const PS::F64 fx = f*rx[m];
+            const PS::F64 fy = f*ry[m];
+            const PS::F64 fz = f*rz[m];
+            out.f_x[0][m] =  fx;
+            out.f_y[0][m] =  fy;
+            out.f_z[0][m] =  fz;
+            out.f_x[1][m] = -fx;
+            out.f_y[1][m] = -fy;
+            out.f_z[1][m] = -fz;
+
+            out.v_x[0][m] = out.v_x[1][m] = 0.5*rx[m]*fx;
+            out.v_y[0][m] = out.v_y[1][m] = 0.5*ry[m]*fy;
+            out.v_z[0][m] = out.v_z[1][m] = 0.5*rz[m]*fz;
+
+            out.pot[m] = 0.5*0.5*k[m]*r_diff*r_diff;
+        }
+    }
+
+    //------ bond batch: anharmonic
+    inline void calcBondBatch_anharmonic(BondBatch &batch){
+        const auto out = batch.resize_output();
+
+        const PS::S64  n_term = batch.size();
+        const PS::F64 *rx = batch.r_x[0].data();
+        const PS::F64 *ry = batch.r_y[0].data();
+        const PS::F64 *rz = batch.r_z[0].data();
+        const PS::F64 *k  = batch.k.data();
+        const PS::F64 *r0 = batch.r0.data();
+        const PS::F64 *a  = batch.a.data();
+
+        constexpr PS::F64 factor = 7.0/12.0;
+
+        #ifdef PARTICLE_SIMULATOR_THREAD_PARALLEL
+            #pragma omp simd
+        #endif
+        for(PS::S64 m=0; m<n_term; ++m){
+            const PS::F64 r   = std::sqrt(rx[m]*rx[m] + ry[m]*ry[m] + rz[m]*rz[m]);
+            const PS::F64 ar  = a[m]*(r - r0[m]);
+            const PS::F64 ar2 = ar*ar;
+            const PS::F64 f   = -a[m]*k[m]*( (2.0 - 3.0*ar) + 4.0*factor*ar2 )*ar/r;
+
+            const PS::F64 fx = f*rx[m];
+            const PS::F64 fy = f*ry[m];
+            const PS::F64 fz = f*rz[m];
+            out.f_x[0][m] =  fx;
+            out.f_y[0][m] =  fy;
+            out.f_z[0][m] =  fz;
+            out.f_x[1][m] = -fx;
+            out.f_y[1][m] = -fy;
+            out.f_z[1][m] = -fz;
+
+            out.v_x[0][m] = out.v_x[1][m] = 0.5*rx[m]*fx;
+            out.v_y[0][m] = out.v_y[1][m] = 0.5*ry[m]*fy;
+            out.v_z[0][m] = out.v_z[1][m] = 0.5*rz[m]*fz;
+
+            out.pot[m] = 0.5*k[m]*(  1.0 - ar + factor*ar2)*ar2;
+        }
+    }
+
+    //------ angle batch: harmonic
+    inline void calcAngleBatch_harmonic(AngleBatch &batch){
+        const auto out = batch.resize_output();
+
+        const PS::S64  n_term = batch.size();
+        const PS::F64 *ax = batch.r_x[0].data();
+        const PS::F64 *ay = batch.r_y[0].data();
+        const PS::F64 *az = batch.r_z[0].data();
+        const PS::F64 *bx = batch.r_x[1].data();
+        const PS::F64 *by = batch.r_y[1].data();
+        const PS::F64 *bz = batch.r_z[1].data();
+        const PS::F64 *k  = batch.k.data();
+        const PS::F64 *c0 = batch.cos_theta0.data();
+
+        #ifdef PARTICLE_SIMULATOR_THREAD_PARALLEL
+            #pragma omp simd
+        #endif
+        for(PS::S64 m=0; m<n_term; ++m){
+            const PS::F64 r_a      = std::sqrt(ax[m]*ax[m] + ay[m]*ay[m] + az[m]*az[m]);
+            const PS::F64 r_b      = std::sqrt(bx[m]*bx[m] + by[m]*by[m] + bz[m]*bz[m]);
+            const PS::F64 in_prod  = ax[m]*bx[m] + ay[m]*by[m] + az[m]*bz[m];
+            const PS::F64 r_ab_inv = 1.0/(r_a*r_b);
+            const PS::F64 cos_tmp  = in_prod*r_ab_inv;
+            const PS::F64 diff     = cos_tmp - c0[m];
+
+            const PS::F64 coef = -k[m]*diff*r_ab_inv*r_ab_inv;
+            const PS::F64 c_aa = coef*(r_b*r_b*cos_tmp);
+            const PS::F64 c_bb = coef*(r_a*r_a*cos_tmp);
+            const PS::F64 c_ab = coef*(r_a*r_b);
+
+            //--- F_ij: force on i by j, F_kj: force on k by j
+            const PS::F64 fa_x = c_aa*ax[m] - c_ab*bx[m];
+            const PS::F64 fa_y = c_aa*ay[m] - c_ab*by[m];
+            const PS::F64 fa_z = c_aa*az[m] - c_ab*bz[m];
+            const PS::F64 fb_x = c_bb*bx[m] - c_ab*ax[m];
+            const PS::F64 fb_y = c_bb*by[m] - c_ab*ay[m];
+            const PS::F64 fb_z = c_bb*bz[m] - c_ab*az[m];
+
+            const PS::F64 va_x = 0.5*ax[m]*fa_x;
+            const PS::F64 va_y = 0.5*ay[m]*fa_y;
+            const PS::F64 va_z = 0.5*az[m]*fa_z;
+            const PS::F64 vb_x = 0.5*bx[m]*fb_x;
+            const PS::F64 vb_y = 0.5*by[m]*fb_y;
+            const PS::F64 vb_z = 0.5*bz[m]*fb_z;
+
+            out.f_x[0][m] = -fa_x;
+            out.f_y[0][m] = -fa_y;
+            out.f_z[0][m] = -fa_z;
+            out.f_x[1][m] =  fa_x + fb_x;
+            out.f_y[1][m] =  fa_y + fb_y;
+            out.f_z[1][m] =  fa_z + fb_z;
+            out.f_x[2][m] = -fb_x;
+            out.f_y[2][m] = -fb_y;
+            out.f_z[2][m] = -fb_z;
+
+            out.v_x[0][m] = -va_x;
+            out.v_y[0][m] = -va_y;
+            out.v_z[0][m] = -va_z;
+            out.v_x[1][m] =  va_x + vb_x;
+            out.v_y[1][m] =  va_y + vb_y;
+            out.v_z[1][m] =  va_z + vb_z;
+            out.v_x[2][m] = -vb_x;
+            out.v_y[2][m] = -vb_y;
+            out.v_z[2][m] = -vb_z;
+
+            out.pot[m] = (1.0/3.0)*0.5*k[m]*diff*diff;
+        }
+    }
+
+    //------ torsion batch
+    //  the intensity is written as polynomial of cos(phi) (Chebyshev polynomial), then acos() and the branch by n_min are not used.
+    //    cos(n*phi) = T_n(cos(phi)),  sin(n*phi)/sin(phi) = U_(n-1)(cos(phi))
+    //  theta0 must be 0.0 or pi (sin(theta0) = 0).
+    namespace _Impl {
+
+        //--- harmonic (cos) form: k*(1 - cos(n*phi - theta0))
+        struct TorsionIntensity_harmonic {
+            const PS::F64 *k;
+            const PS::F64 *cos_eq;
+            const PS::S32 *n_min;
+            PS::S32        n_max;
+
+            inline void operator () (const PS::S64 m, const PS::F64 c, PS::F64 &eng, PS::F64 &f) const {
+                const PS::S32 n = n_min[m];
+
+                //--- T_n and U_(n-1) by recurrence
+                PS::F64 T_prev = 1.0, T_curr = c;
+                PS::F64 U_prev = 0.0, U_curr = 1.0;
+                PS::F64 T_n    = (n == 0) ? 1.0 : c;
+                PS::F64 U_n1   = (n == 0) ? 0.0 : 1.0;
+                for(PS::S32 p=2; p<=this->n_max; ++p){
+                    const PS::F64 T_next = 2.0*c*T_curr - T_prev;
+                    const PS::F64 U_next = 2.0*c*U_curr - U_prev;
+                    T_prev = T_curr;
+                    T_curr = T_next;
+                    U_prev = U_curr;
+                    U_curr = U_next;
+
+                    T_n  = (p == n) ? T_curr : T_n;
+                    U_n1 = (p == n) ? U_curr : U_n1;
+                }
+
+                eng = (1.0/4.0)*0.5*k[m]*(1.0 - cos_eq[m]*T_n);
+                f   = -0.5*k[m]*PS::F64(n)*cos_eq[m]*U_n1;
+            }
+        };
+
+        //--- OPLS_AA 3rd order form: k (n=1, theta0=pi) + k2 (n=2, theta0=0) + k3 (n=3, theta0=pi)
+        struct TorsionIntensity_OPLS_3rd {
+            const PS::F64 *k;
+            const PS::F64 *k2;
+            const PS::F64 *k3;
+
+            inline void operator () (const PS::S64 m, const PS::F64 c, PS::F64 &eng, PS::F64 &f) const {
+                const PS::F64 c2 = c*c;
+                eng = (1.0/4.0)*0.5*(  k[m] *(1.0 + c)
+                                     + k2[m]*(2.0 - 2.0*c2)
+                                     + k3[m]*(1.0 + (4.0*c2 - 3.0)*c) );
+                f   = 0.5*k[m] - 2.0*k2[m]*c + 1.5*k3[m]*(4.0*c2 - 1.0);
+            }
+        };
+
+        template <class Tintensity>
+        void calcTorsionBatch(TorsionBatch &batch, const Tintensity &intensity){
+            const auto out = batch.resize_output();
+
+            const PS::S64  n_term = batch.size();
+            const PS::F64 *ax = batch.r_x[0].data();    // R_ij
+            const PS::F64 *ay = batch.r_y[0].data();
+            const PS::F64 *az = batch.r_z[0].data();
+            const PS::F64 *bx = batch.r_x[1].data();    // R_kj
+            const PS::F64 *by = batch.r_y[1].data();
+            const PS::F64 *bz = batch.r_z[1].data();
+            const PS::F64 *cx = batch.r_x[2].data();    // R_kl
+            const PS::F64 *cy = batch.r_y[2].data();
+            const PS::F64 *cz = batch.r_z[2].data();
+
+            #ifdef PARTICLE_SIMULATOR_THREAD_PARALLEL
+                #pragma omp simd
+            #endif
+            for(PS::S64 m=0; m<n_term; ++m){
+                //--- R_ik = R_ij - R_kj, R_jl = R_kl - R_kj
+                const PS::F64 ik_x = ax[m] - bx[m], ik_y = ay[m] - by[m], ik_z = az[m] - bz[m];
+                const PS::F64 jl_x = cx[m] - bx[m], jl_y = cy[m] - by[m], jl_z = cz[m] - bz[m];
+
+                //--- R_a = R_ij x R_kj, R_b = R_kj x R_kl
+                const PS::F64 Ra_x = ay[m]*bz[m] - az[m]*by[m];
+                const PS::F64 Ra_y = az[m]*bx[m] - ax[m]*bz[m];
+                const PS::F64 Ra_z = ax[m]*by[m] - ay[m]*bx[m];
+                const PS::F64 Rb_x = by[m]*cz[m] - bz[m]*cy[m];
+                const PS::F64 Rb_y = bz[m]*cx[m] - bx[m]*cz[m];
+                const PS::F64 Rb_z = bx[m]*cy[m] - by[m]*cx[m];
+
+                const PS::F64 r_a_inv = 1.0/std::sqrt(Ra_x*Ra_x + Ra_y*Ra_y + Ra_z*Ra_z);
+                const PS::F64 r_b_inv = 1.0/std::sqrt(Rb_x*Rb_x + Rb_y*Rb_y + Rb_z*Rb_z);
+
+                PS::F64 cos_p = (Ra_x*Rb_x + Ra_y*Rb_y + Ra_z*Rb_z)*(r_a_inv*r_b_inv);
+                cos_p = std::min(cos_p,  1.0);
+                cos_p = std::max(cos_p, -1.0);
+
+                PS::F64 eng, f;
+                intensity(m, cos_p, eng, f);
+
+                //--- F_a, F_b (multiplied by the intensity)
+                const PS::F64 Fa_x = f*(Rb_x*r_b_inv - Ra_x*r_a_inv*cos_p)*r_a_inv;
+                const PS::F64 Fa_y = f*(Rb_y*r_b_inv - Ra_y*r_a_inv*cos_p)*r_a_inv;
+                const PS::F64 Fa_z = f*(Rb_z*r_b_inv - Ra_z*r_a_inv*cos_p)*r_a_inv;
+                const PS::F64 Fb_x = f*(Ra_x*r_a_inv - Rb_x*r_b_inv*cos_p)*r_b_inv;
+                const PS::F64 Fb_y = f*(Ra_y*r_a_inv - Rb_y*r_b_inv*cos_p)*r_b_inv;
+                const PS::F64 Fb_z = f*(Ra_z*r_a_inv - Rb_z*r_b_inv*cos_p)*r_b_inv;
+
+                //--- i: F_a x R_kj
+                const PS::F64 fi_x = Fa_y*bz[m] - Fa_z*by[m];
+                const PS::F64 fi_y = Fa_z*bx[m] - Fa_x*bz[m];
+                const PS::F64 fi_z = Fa_x*by[m] - Fa_y*bx[m];
+
+                //--- j: F_a x R_ik - F_b x R_kl
+                const PS::F64 fj_x = (Fa_y*ik_z - Fa_z*ik_y) - (Fb_y*cz[m] - Fb_z*cy[m]);
+                const PS::F64 fj_y = (Fa_z*ik_x - Fa_x*ik_z) - (Fb_z*cx[m] - Fb_x*cz[m]);
+                const PS::F64 fj_z = (Fa_x*ik_y - Fa_y*ik_x) - (Fb_x*cy[m] - Fb_y*cx[m]);
+
+                //--- k: -F_a x R_ij + F_b x R_jl
+                const PS::F64 fk_x = (Fb_y*jl_z - Fb_z*jl_y) - (Fa_y*az[m] - Fa_z*ay[m]);
+                const PS::F64 fk_y = (Fb_z*jl_x - Fb_x*jl_z) - (Fa_z*ax[m] - Fa_x*az[m]);
+                const PS::F64 fk_z = (Fb_x*jl_y - Fb_y*jl_x) - (Fa_x*ay[m] - Fa_y*ax[m]);
+
+                //--- l: F_b x R_kj
+                const PS::F64 fl_x = Fb_y*bz[m] - Fb_z*by[m];
+                const PS::F64 fl_y = Fb_z*bx[m] - Fb_x*bz[m];
+                const PS::F64 fl_z = Fb_x*by[m] - Fb_y*bx[m];
+
+                out.f_x[0][m] = fi_x;
+                out.f_y[0][m] = fi_y;
+                out.f_z[0][m] = fi_z;
+                out.f_x[1][m] = fj_x;
+                out.f_y[1][m] = fj_y;
+                out.f_z[1][m] = fj_z;
+                out.f_x[2][m] = fk_x;
+                out.f_y[2][m] = fk_y;
+                out.f_z[2][m] = fk_z;
+                out.f_x[3][m] = fl_x;
+                out.f_y[3][m] = fl_y;
+                out.f_z[3][m] = fl_z;
+
+                //--- virial (same to calcTorsionForce_*_IJKL(). j: 0)
+                out.v_x[0][m] =  ax[m]*fi_x;
+                out.v_y[0][m] =  ay[m]*fi_y;
+                out.v_z[0][m] =  az[m]*fi_z;
+                out.v_x[1][m] = 0.0;
+                out.v_y[1][m] = 0.0;
+                out.v_z[1][m] = 0.0;
+                out.v_x[2][m] =  bx[m]*fk_x;
+                out.v_y[2][m] =  by[m]*fk_y;
+                out.v_z[2][m] =  bz[m]*fk_z;
+                out.v_x[3][m] = -jl_x*fl_x;
+                out.v_y[3][m] = -jl_y*fl_y;
+                out.v_z[3][m] = -jl_z*fl_z;
+
+                out.pot[m] = eng;
+            }
+        }
+    }
+
+    inline void calcTorsionBatch_harmonic(TorsionBatch &batch){
+        _Impl::TorsionIntensity_harmonic intensity;
+        intensity.k      = batch.k.data();
+        intensity.cos_eq = batch.cos_eq.data();
+        intensity.n_min  = batch.n_min.data();
+        intensity.n_max  = 0;
+        for(const auto n : batch.n_min){
+            intensity.n_max = std::max(intensity.n_max, n);
+        }
+        _Impl::calcTorsionBatch(batch, intensity);
+    }
+
+    inline void calcTorsionBatch_OPLS_3rd(TorsionBatch &batch){
+        _Impl::TorsionIntensity_OPLS_3rd intensity;
+        intensity.k  = batch.k.data();
+        intensity.k2 = batch.k2.data();
+        intensity.k3 = batch.k3.data();
+        _Impl::calcTorsionBatch(batch, intensity);
+    }
+
+    //------ add the result of batch into the force buffer
+    //  add_pot: member function to add the potential (ex. &Tforce::addPotBond).
+    template <class Tbatch, class Tforce, class Tadd_pot>
+    void scatterBatch(const Tbatch              &batch,
+                            std::vector<Tforce> &force_buff,
+                            Tadd_pot             add_pot   ){
+
+        const PS::S64 n_term = batch.size();
+        const PS::S32 n_atom = sizeof(batch.tgt)/sizeof(batch.tgt[0]);
+        for(PS::S64 m=0; m<n_term; ++m){
+            for(PS::S32 a=0; a<n_atom; ++a){
+                const PS::S32 t = batch.tgt[a][m];
+                if(t < 0) continue;
+
+                auto& force_tgt = force_buff[t];
+                (force_tgt.*add_pot)(batch.pot[m]);
+                force_tgt.addForceIntra(  PS::F64vec{batch.f_x[a][m], batch.f_y[a][m], batch.f_z[a][m]} );
+                force_tgt.addVirialIntra( PS::F64vec{batch.v_x[a][m], batch.v_y[a][m], batch.v_z[a][m]} );
+            }
         }
     }
 
@@ -0,0 +1,450 @@
+/**************************************************************************************************/
+/**
+* @file  ff_intra_topology.hpp
+* @brief intramolecular pair lists derived from the molecular model template.
+*/
+/**************************************************************************************************/
+#pragma once
+
+#include <cmath>
+#include <vector>
+#include <sstream>
+#include <unordered_map>
+#include <algorithm>
+#include <stdexcept>
+
+#include <particle_simulator.hpp>
+#include <molecular_dynamics_ext.hpp>
+
+#include "unit.hpp"
+#include "md_defs.hpp"
+#include "md_coef_table.hpp"
+#include "atom_class.hpp"
+
+
+namespace FORCE {
+
+    /**
+    * @brief mask, angle, dihedral and improper lists made once for each molecular model template.
+    * @details the lists are recorded with the atom ID in template (relative ID from the 1st atom in molecule).
+    *          the list for an atom in system is instantiated by adding the ID shift of the molecule.
+    *          the atom IDs in a molecule must be consecutive. the ID shift is AtomID - template index of the atom
+    *          (given by Atom_FP::copyFromModelTemplate() and kept in resume file), the MolID is not used.
+    *          the bonded terms are also resolved into the neighbor slot index and the index of parameter table.
+    *          the parameter table is a flat copy of the coefficients in MODEL::coef_table with precomputed values.
+    */
+    class IntraTopology {
+    public:
+        //--- parameters of bonded terms
+        using BondParam = MODEL::CoefBond;
+        struct AngleParam : public MODEL::CoefAngle {
+            PS::F64 cos_theta0;
+
+            AngleParam() = default;
+            explicit AngleParam(const MODEL::CoefAngle &coef) : MODEL::CoefAngle(coef) {
+                this->cos_theta0 = std::cos( PS::F64(coef.theta0) );
+            }
+        };
+        struct TorsionParam : public MODEL::CoefTorsion {
+            PS::F64 cos_theta0;
+
+            TorsionParam() = default;
+            explicit TorsionParam(const MODEL::CoefTorsion &coef) : MODEL::CoefTorsion(coef) {
+                this->cos_theta0 = std::cos( PS::F64(coef.theta0) );
+            }
+        };
+
+        //--- bonded terms. i,j,k,l are the slot index in AtomTerm::slot. the term with "IntraFuncForm::none" or "constraint" is removed.
+        //------ "coef" is the index in the parameter table.
+        struct BondTerm {
+            PS::S32 j;
+            PS::S32 coef;
+        };
+        struct AngleTerm {
+            PS::S32 i, j, k;
+            PS::S32 coef;
+        };
+        struct TorsionTerm {
+            PS::S32 i, j, k, l;
+            PS::S32 coef;
+        };
+        struct AtomTerm {
+            std::vector<MD_DEFS::ID_type> slot;    // atom ID in template of the neighbors. slot[0] is the atom itself.
+            std::vector<BondTerm>         bond;
+            std::vector<AngleTerm>        angle;
+            std::vector<TorsionTerm>      dihedral;
+            std::vector<TorsionTerm>      improper;
+        };
+
+    private:
+        struct GetBond {
+            MD_EXT::basic_connect<MD_DEFS::ID_type,
+                                  MD_DEFS::max_bond> operator () (const AtomConnect &atom){
+                return atom.bond;
+            }
+        };
+
+        //--- search interface in model template (instead of PS::TreeForForce::getEpjFromId())
+        template <class Tptcl>
+        struct TemplateTree {
+            const std::vector<Tptcl> &model;
+
+            const Tptcl* getEpjFromId(const MD_DEFS::ID_type id) const {
+                if(id < 0 || id >= static_cast<MD_DEFS::ID_type>(this->model.size())) return nullptr;
+                return &(this->model[id]);
+            }
+        };
+
+        struct AtomList {
+            MD_DEFS::MaskList    mask;
+            MD_DEFS::AngleList   angle;
+            MD_DEFS::TorsionList dihedral;
+            MD_DEFS::TorsionList improper;
+        };
+
+        //--- flat parameter table. the same coefficient in MODEL::coef_table has the same index.
+        template <class Tcoef, class Tparam>
+        struct ParamTable {
+            std::vector<Tparam>                         param;
+            std::unordered_map<const Tcoef*, PS::S32>   index;   // used in init() only
+
+            void clear(){
+                this->param.clear();
+                this->index.clear();
+            }
+            PS::S32 add(const Tcoef &coef){
+                const auto itr = this->index.find(&coef);
+                if(itr != this->index.end()) return itr->second;
+
+                const PS::S32 i_new = static_cast<PS::S32>(this->param.size());
+                this->param.push_back( Tparam(coef) );
+                this->index[&coef] = i_new;
+                return i_new;
+            }
+        };
+
+        //--- lists of each model in "model_list" order. [model index][atom index in template]
+        std::vector<std::vector<AtomList>> model_list_table;
+        std::vector<std::vector<AtomTerm>> model_term_table;
+        std::vector<MolName>               model_name;
+
+        ParamTable<MODEL::CoefBond,    BondParam>    bond_table;
+        ParamTable<MODEL::CoefAngle,   AngleParam>   angle_table;
+        ParamTable<MODEL::CoefTorsion, TorsionParam> torsion_table;
+
+        //--- number of atoms in each model
+        std::vector<MD_DEFS::ID_type> n_atom_mol;
+
+        bool initialized = false;
+
+        static void _shift_id(MD_DEFS::IntraMask &mask, const MD_DEFS::ID_type shift){
+            mask.setId(mask.getId() + shift);
+        }
+        static void _shift_id(MD_DEFS::AngleSet &angle, const MD_DEFS::ID_type shift){
+            std::get<0>(angle) += shift;
+            std::get<1>(angle) += shift;
+            std::get<2>(angle) += shift;
+        }
+        static void _shift_id(MD_DEFS::TorsionSet &torsion, const MD_DEFS::ID_type shift){
+            std::get<0>(torsion) += shift;
+            std::get<1>(torsion) += shift;
+            std::get<2>(torsion) += shift;
+            std::get<3>(torsion) += shift;
+        }
+
+        template <class T>
+        static void _instantiate(const std::vector<T>       &tmp,
+                                 const MD_DEFS::ID_type      shift,
+                                       std::vector<T>       &result){
+            result.assign(tmp.begin(), tmp.end());
+            for(auto& elem : result){
+                _shift_id(elem, shift);
+            }
+        }
+
+        static PS::S32 _slot(AtomTerm &term, const MD_DEFS::ID_type id){
+            const auto itr = std::find(term.slot.begin(), term.slot.end(), id);
+            if(itr != term.slot.end()) return static_cast<PS::S32>( std::distance(term.slot.begin(), itr) );
+            term.slot.push_back(id);
+            return static_cast<PS::S32>(term.slot.size()) - 1;
+        }
+
+        static void _check_form(const IntraFuncForm     form,
+                                const IntraFuncForm    *form_list,
+                                const size_t            n_form,
+                                const std::string      &key_str){
+            if( std::find(form_list, form_list + n_form, form) != form_list + n_form ) return;
+
+            std::ostringstream oss;
+            oss << "undefined function form: " << ENUM::what(form) << " at " << key_str << "\n";
+            throw std::invalid_argument(oss.str());
+        }
+
+        //--- improper tuples listed by the center atom ("j" of i-jk-l form, bonded to i, k and l) which include the atom "index".
+        //    the side atoms list the same torsion planes in another order of atoms,
+        //    then the tuple of the center atom is used as common term between the participants.
+        template <class Tptcl>
+        static void _center_improper(const std::vector<Tptcl>    &model,
+                                     const std::vector<AtomList> &table,
+                                     const MD_DEFS::ID_type       index,
+                                           MD_DEFS::TorsionList  &result){
+            result.clear();
+
+            std::vector<MD_DEFS::ID_type> center_list;
+            center_list.push_back(index);
+            for(const auto id_j : model[index].bond){
+                center_list.push_back(id_j);
+            }
+
+            for(const auto id_c : center_list){
+                const auto& bond_c    = model.at(id_c).bond;
+                const auto  is_bonded = [&bond_c](const MD_DEFS::ID_type id){
+                    return std::find(bond_c.begin(), bond_c.end(), id) != bond_c.end();
+                };
+                for(const auto& torsion : table.at(id_c).improper){
+                    if( std::get<1>(torsion) != id_c         ||
+                       !is_bonded( std::get<0>(torsion) )    ||
+                       !is_bonded( std::get<2>(torsion) )    ||
+                       !is_bonded( std::get<3>(torsion) )      ) continue;
+                    if( std::get<0>(torsion) != index &&
+                        std::get<1>(torsion) != index &&
+                        std::get<2>(torsion) != index &&
+                        std::get<3>(torsion) != index    ) continue;
+                    if( std::find(result.begin(), result.end(), torsion) != result.end() ) continue;
+
+                    result.push_back(torsion);
+                }
+            }
+        }
+
+        template <class Tptcl>
+        void _make_term(const MolName                mol,
+                        const std::vector<Tptcl>    &model,
+                        const size_t                 index,
+                        const AtomList              &list,
+                        const MD_DEFS::TorsionList  &improper_list,
+                              AtomTerm              &term ){
+            term.slot.clear();
+            term.slot.push_back(index);
+
+            for(const auto id_j : model[index].bond){
+                const MODEL::KeyBond key = std::make_tuple(mol,
+                                                           model[index].getAtomType(),
+                                                           model.at(id_j).getAtomType());
+                if(MODEL::coef_table.bond.count(key) != 1){
+                    std::ostringstream oss;
+                    oss << "key_bond = " << ENUM::what(key) << " is not defined in MODEL::coef_table.bond." << "\n";
+                    throw std::invalid_argument(oss.str());
+                }
+                const auto& coef = MODEL::coef_table.bond.at(key);
+                if(coef.form == IntraFuncForm::none ||
+                   coef.form == IntraFuncForm::constraint) continue;   // constraint is solved in CONSTRAINT::Solver
+
+                const IntraFuncForm bond_form[] = { IntraFuncForm::harmonic, IntraFuncForm::anharmonic };
+                _check_form(coef.form, bond_form, 2, "key_bond = " + ENUM::what(key));
+
+                term.bond.push_back( BondTerm{ _slot(term, id_j), this->bond_table.add(coef) } );
+            }
+
+            for(const auto& angle_set : list.angle){
+                const MODEL::KeyAngle key = std::make_tuple(mol,
+                                                            model.at(std::get<0>(angle_set)).getAtomType(),
+                                                            model.at(std::get<1>(angle_set)).getAtomType(),
+                                                            model.at(std::get<2>(angle_set)).getAtomType() );
+                if(MODEL::coef_table.angle.count(key) != 1){
+                    std::ostringstream oss;
+                    oss << "key_angle = " << ENUM::what(key) << " is not defined in MODEL::coef_table.angle." << "\n";
+                    throw std::invalid_argument(oss.str());
+                }
+                const auto& coef = MODEL::coef_table.angle.at(key);
+                if(coef.form == IntraFuncForm::none ||
+                   coef.form == IntraFuncForm::constraint) continue;
+
+                const IntraFuncForm angle_form[] = { IntraFuncForm::harmonic };
+                _check_form(coef.form, angle_form, 1, "key_angle = " + ENUM::what(key));
+
+                term.angle.push_back( AngleTerm{ _slot(term, std::get<0>(angle_set)),
+                                                 _slot(term, std::get<1>(angle_set)),
+                                                 _slot(term, std::get<2>(angle_set)),
+                                                 this->angle_table.add(coef)          } );
+            }
+
+            const TorsionShape shape_list[2] = { TorsionShape::dihedral, TorsionShape::improper };
+            for(const auto shape : shape_list){
+                const auto& torsion_list = (shape == TorsionShape::dihedral) ? list.dihedral : improper_list;
+                      auto& torsion_term = (shape == TorsionShape::dihedral) ? term.dihedral : term.improper;
+                for(const auto& torsion_set : torsion_list){
+                    const MODEL::KeyTorsion key = std::make_tuple(mol,
+                                                                  shape,
+                                                                  model.at(std::get<0>(torsion_set)).getAtomType(),
+                                                                  model.at(std::get<1>(torsion_set)).getAtomType(),
+                                                                  model.at(std::get<2>(torsion_set)).getAtomType(),
+                                                                  model.at(std::get<3>(torsion_set)).getAtomType() );
+                    if(MODEL::coef_table.torsion.count(key) != 1){
+                        std::ostringstream oss;
+                        oss << "key_torsion = " << ENUM::what(key) << " is not defined in MODEL::coef_table.torsion." << "\n";
+                        throw std::invalid_argument(oss.str());
+                    }
+                    const auto& coef = MODEL::coef_table.torsion.at(key);
+                    if(coef.form == IntraFuncForm::none) continue;
+
+                    const IntraFuncForm torsion_form[] = { IntraFuncForm::cos, IntraFuncForm::OPLS_3 };
+                    _check_form(coef.form, torsion_form, 2, "key_torsion = " + ENUM::what(key));
+                    if( coef.form == IntraFuncForm::cos                &&
+                        std::abs(coef.theta0)            >  1.e-5      &&
+                        std::abs(coef.theta0 - Unit::pi) >  1.e-5         ){
+                        std::ostringstream oss;
+                        oss << "key_torsion = " << ENUM::what(key) << "\n"
+                            << "   theta0 = " << coef.theta0 << ", must be 0.0 or pi (0.0 or 180.0 in degree)." << "\n";
+                        throw std::invalid_argument(oss.str());
+                    }
+
+                    torsion_term.push_back( TorsionTerm{ _slot(term, std::get<0>(torsion_set)),
+                                                         _slot(term, std::get<1>(torsion_set)),
+                                                         _slot(term, std::get<2>(torsion_set)),
+                                                         _slot(term, std::get<3>(torsion_set)),
+                                                         this->torsion_table.add(coef)          } );
+                }
+            }
+        }
+
+        //--- model index, atom index in template and ID shift of the atom
+        //------ the template index is given at Atom_FP::copyFromModelTemplate(). the layout of MolID is not assumed.
+        template <class Tptcl>
+        void _locate(const Tptcl            &atom,
+                           PS::S64          &m,
+                           MD_DEFS::ID_type &index,
+                           MD_DEFS::ID_type &shift ) const {
+
+            const auto itr = std::find(this->model_name.begin(),
+                                       this->model_name.end(),
+                                       atom.getMolType()       );
+            m     = std::distance(this->model_name.begin(), itr);
+            index = atom.getTemplateIndex();
+            shift = atom.getAtomID() - index;
+            if(itr   == this->model_name.end() ||
+               index <  0                      ||
+               index >= this->n_atom_mol[m]      ){
+                std::ostringstream oss;
+                oss << "the atom is not found in the model templates." << "\n"
+                    << "   AtomID = " << atom.getAtomID() << ", template index = " << index
+                    << ", MolType = " << ENUM::what(atom.getMolType()) << "\n";
+                throw std::logic_error(oss.str());
+            }
+        }
+
+    public:
+        bool isInitialized() const { return this->initialized; }
+
+        /**
+        * @brief make the lists from molecular model templates.
+        * @param[in] model_list     pair of model name and number of molecules.
+        * @param[in] model_template atom data of molecular model. atom ID must be [0, n_atom_mol).
+        * @param[in] mask_table     mask parameters of each model.
+        */
+        template <class Tptcl, class Tmask>
+        void init(const std::vector<std::pair<MolName, PS::S64>> &model_list,
+                  const std::vector<std::vector<Tptcl>>          &model_template,
+                  const Tmask                                    &mask_table){
+
+            IntraPair::IntraMaskMaker<  MD_DEFS::ID_type, GetBond> intra_mask_maker;
+            IntraPair::AngleListMaker<  MD_DEFS::ID_type, GetBond> angle_list_maker;
+            IntraPair::TorsionListMaker<MD_DEFS::ID_type, GetBond> torsion_list_maker;
+
+            const size_t n_model = model_list.size();
+            this->model_list_table.resize(n_model);
+            this->model_term_table.resize(n_model);
+            this->model_name.resize(n_model);
+            this->n_atom_mol.resize(n_model);
+
+            this->bond_table.clear();
+            this->angle_table.clear();
+            this->torsion_table.clear();
+
+            for(size_t m=0; m<n_model; ++m){
+                const auto& model = model_template.at(m);
+
+                this->model_name[m] = model_list[m].first;
+                this->n_atom_mol[m] = model.size();
+
+                for(size_t i=0; i<model.size(); ++i){
+                    if(model[i].getAtomID() != static_cast<MD_DEFS::ID_type>(i)){
+                        std::ostringstream oss;
+                        oss << "atom ID in model template must be consecutive from 0." << "\n"
+                            << "   model = " << ENUM::what(model_list[m].first)
+                            << ", index = " << i << ", AtomID = " << model[i].getAtomID() << "\n";
+                        throw std::invalid_argument(oss.str());
+                    }
+                }
+
+                //--- search pair in template
+                const TemplateTree<Tptcl> tree{model};
+                auto& table = this->model_list_table[m];
+                table.resize(model.size());
+                for(size_t i=0; i<model.size(); ++i){
+                    intra_mask_maker(  model[i], tree, mask_table.at(model_list[m].first), table[i].mask);
+                    angle_list_maker(  model[i], tree, table[i].angle);
+                    torsion_list_maker(model[i], tree, table[i].dihedral, table[i].improper);
+                }
+
+                //--- resolve bonded terms (the model not in system is skipped)
+                auto& term = this->model_term_table[m];
+                term.clear();
+                term.resize(model.size());
+                if(model_list[m].second <= 0) continue;
+                MD_DEFS::TorsionList improper_list;
+                for(size_t i=0; i<model.size(); ++i){
+                    _center_improper(model, table, i, improper_list);
+                    this->_make_term(model_list[m].first, model, i, table[i], improper_list, term[i]);
+                }
+            }
+
+            //--- the pointers to MODEL::coef_table are not used after init().
+            this->bond_table.index.clear();
+            this->angle_table.index.clear();
+            this->torsion_table.index.clear();
+
+            this->initialized = true;
+        }
+
+        /**
+        * @brief instantiate the lists for the atom from the template.
+        */
+        template <class Tptcl>
+        void makeList(const Tptcl                &atom,
+                            MD_DEFS::MaskList    &mask_list,
+                            MD_DEFS::AngleList   &angle_list,
+                            MD_DEFS::TorsionList &dihedral_list,
+                            MD_DEFS::TorsionList &improper_list) const {
+
+            PS::S64          m;
+            MD_DEFS::ID_type index, shift;
+            this->_locate(atom, m, index, shift);
+
+            const auto& tmp = this->model_list_table[m][index];
+            _instantiate(tmp.mask,     shift, mask_list);
+            _instantiate(tmp.angle,    shift, angle_list);
+            _instantiate(tmp.dihedral, shift, dihedral_list);
+            _instantiate(tmp.improper, shift, improper_list);
+        }
+
+        /**
+        * @brief get the resolved bonded terms of the atom.
+        * @param[out] shift ID shift of the molecule. atom ID of slot s is shift + AtomTerm::slot[s].
+        */
+        template <class Tptcl>
+        const AtomTerm& getTerm(const Tptcl            &atom,
+                                      MD_DEFS::ID_type &shift) const {
+            PS::S64          m;
+            MD_DEFS::ID_type index;
+            this->_locate(atom, m, index, shift);
+            return this->model_term_table[m][index];
+        }
+
+        //--- parameter of bonded term. "i" is BondTerm::coef, AngleTerm::coef, or TorsionTerm::coef.
+        inline const BondParam&    getBondParam(   const PS::S32 i) const { return this->bond_table.param[i];    }
+        inline const AngleParam&   getAngleParam(  const PS::S32 i) const { return this->angle_table.param[i];   }
+        inline const TorsionParam& getTorsionParam(const PS::S32 i) const { return this->torsion_table.param[i]; }
+    };
+
+}
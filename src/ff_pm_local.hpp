@@ -0,0 +1,352 @@
+/**************************************************************************************************/
+/**
+* @file  ff_pm_local.hpp
+* @brief process-local ParticleMesh for single process execution. provide same interface with FORCE::PM wrappers.
+*/
+/**************************************************************************************************/
+#pragma once
+
+#include <cmath>
+#include <vector>
+#include <complex>
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+
+#include <fftw3.h>
+
+#include <particle_simulator.hpp>
+#include <particle_mesh.hpp>
+#include <molecular_dynamics_ext.hpp>
+
+#include "unit.hpp"
+
+
+namespace FORCE {
+    namespace PM {
+
+    /*
+    * @brief P3M solver on the local mesh by FFTW (single precision, same as PS::PM::ParticleMesh).
+    * @details the long-range part of the S2 split used in the PP kernel is evaluated:
+    *              phi_L(k) = 4*pi/k^2 * U(k)^2,   U(k): Fourier transform of S2 shape with diameter rc.
+    *          charge assignment and interpolation: TSC. field: ik differentiation.
+    *          the assignment function is deconvoluted in k space.
+    *          all particles must be in the local process (single process execution).
+    *          the mesh size is "SIZE_OF_MESH" in FDPS, then the cut off length is same to "Normalize::normCutOff_PM()".
+    *          charge assignment and interpolation are threaded by OpenMP.
+    *          the charge assignment is divided by slabs of x planes (each thread writes own slab only),
+    *          then no mesh buffer for each thread is needed.
+    *          for threaded FFT, define "LOCAL_PM_FFTW_THREADS" and link "libfftw3f_omp" (or "libfftw3f_threads").
+    *          memory: 6 real meshes (rho, pot, field x3) and 3 complex meshes (rho_k, work_k, green) in single precision.
+    */
+    class LocalParticleMesh {
+    private:
+        static constexpr PS::S32 n_mesh   = SIZE_OF_MESH;
+        static constexpr PS::S32 n_mesh_k = SIZE_OF_MESH/2 + 1;
+
+        PS::S32 n_thread = 1;
+
+        //--- mesh data
+        PS::F32          *rho       = nullptr;     // charge on mesh (real space), also used as work buffer
+        fftwf_complex    *rho_k     = nullptr;     // charge on mesh (k space)
+        fftwf_complex    *work_k    = nullptr;     // work buffer for c2r transform
+        std::vector<PS::F32> pot_mesh;
+        std::vector<PS::F32> field_mesh[3];
+
+        //--- particle index sorted by the nearest x plane (for slab division of charge assignment)
+        std::vector<PS::S64> plane_begin;
+        std::vector<PS::S64> plane_index;
+        std::vector<PS::S32> plane_of;
+
+        //--- influence function (depend on box size and cut off)
+        std::vector<PS::F32> green;
+        std::vector<PS::F64> window_inv2;     // 1/W(k)^2 of TSC for each wave number (independent of box)
+        PS::F64vec box_green = 0.0;
+        PS::F64    rc_green  = 0.0;
+
+        fftwf_plan plan_r2c;
+        fftwf_plan plan_c2r;
+
+        //--- particle data
+        std::vector<PS::F64vec> pos_buff;
+        std::vector<PS::F64>    charge_buff;
+
+        static PS::S64 mesh_index(const PS::S32 ix, const PS::S32 iy, const PS::S32 iz){
+            return (PS::S64(ix)*n_mesh + iy)*n_mesh + iz;
+        }
+        static PS::S64 mesh_index_k(const PS::S32 ix, const PS::S32 iy, const PS::S32 iz){
+            return (PS::S64(ix)*n_mesh + iy)*n_mesh_k + iz;
+        }
+        static PS::S32 wave_number(const PS::S32 i){
+            return (i < n_mesh/2) ? i : i - n_mesh;
+        }
+
+        //--- TSC weight of nearest grid point "i0" and neighbors (i0-1, i0, i0+1)
+        static void tsc_weight(const PS::F64 x_norm, PS::S32 &i0, PS::F64 *w){
+            const PS::F64 u = x_norm*n_mesh;
+            i0 = static_cast<PS::S32>( std::floor(u + 0.5) );
+            const PS::F64 d = u - PS::F64(i0);
+            w[0] = 0.5*(0.5 - d)*(0.5 - d);
+            w[1] = 0.75 - d*d;
+            w[2] = 0.5*(0.5 + d)*(0.5 + d);
+        }
+        static PS::S32 wrap(const PS::S32 i){
+            return ( (i % n_mesh) + n_mesh ) % n_mesh;
+        }
+
+        //--- Fourier transform of S2 shape (diameter a). Hockney & Eastwood (1987), Eq.(8-22).
+        static PS::F64 S2_shape_k(const PS::F64 k, const PS::F64 a){
+            const PS::F64 x = 0.5*k*a;
+            if(x < 1.e-3) return 1.0 - x*x/15.0;
+            return 12.0/(x*x*x*x)*(2.0 - 2.0*std::cos(x) - x*std::sin(x));
+        }
+        static PS::F64 sinc(const PS::F64 x){
+            return (std::abs(x) < 1.e-8) ? 1.0 : std::sin(x)/x;
+        }
+
+        void update_green(const PS::F64vec &box, const PS::F64 r_cut){
+            if(box.x == this->box_green.x &&
+               box.y == this->box_green.y &&
+               box.z == this->box_green.z &&
+               r_cut == this->rc_green      ) return;
+
+            this->box_green = box;
+            this->rc_green  = r_cut;
+
+            const PS::F64 coef = 4.0*Unit::pi/(box.x*box.y*box.z);
+
+            //--- k^2 for each axis
+            PS::F64 k2_x[n_mesh], k2_y[n_mesh], k2_z[n_mesh_k];
+            for(PS::S32 i=0; i<n_mesh; ++i){
+                const PS::F64 n_k = 2.0*Unit::pi*wave_number(i);
+                k2_x[i] = (n_k/box.x)*(n_k/box.x);
+                k2_y[i] = (n_k/box.y)*(n_k/box.y);
+                if(i < n_mesh_k) k2_z[i] = (n_k/box.z)*(n_k/box.z);
+            }
+            const PS::F64 *w_inv2 = this->window_inv2.data();
+
+            #ifdef PARTICLE_SIMULATOR_THREAD_PARALLEL
+                #pragma omp parallel for
+            #endif
+            for(PS::S32 ix=0; ix<n_mesh; ++ix){
+                for(PS::S32 iy=0; iy<n_mesh; ++iy){
+                    const PS::F64 k2_xy = k2_x[ix] + k2_y[iy];
+                    const PS::F64 w_xy  = coef*w_inv2[ix]*w_inv2[iy];
+                    for(PS::S32 iz=0; iz<n_mesh_k; ++iz){
+                        const PS::F64 k2 = k2_xy + k2_z[iz];
+
+                        PS::F64 g = 0.0;
+                        if(k2 > 0.0){
+                            const PS::F64 u = S2_shape_k(std::sqrt(k2), r_cut);
+                            g = w_xy*w_inv2[iz]*u*u/k2;
+                        }
+                        this->green[mesh_index_k(ix, iy, iz)] = static_cast<PS::F32>(g);
+                    }
+                }
+            }
+        }
+
+    public:
+        LocalParticleMesh(){
+            const PS::S64 n_real = PS::S64(n_mesh)*n_mesh*n_mesh;
+            const PS::S64 n_cplx = PS::S64(n_mesh)*n_mesh*n_mesh_k;
+
+            #ifdef PARTICLE_SIMULATOR_THREAD_PARALLEL
+                this->n_thread = PS::Comm::getNumberOfThread();
+                #ifdef LOCAL_PM_FFTW_THREADS
+                    fftwf_init_threads();
+                    fftwf_plan_with_nthreads(this->n_thread);
+                #endif
+            #endif
+
+            this->rho    = fftwf_alloc_real(n_real);
+            this->rho_k  = fftwf_alloc_complex(n_cplx);
+            this->work_k = fftwf_alloc_complex(n_cplx);
+
+            this->pot_mesh.resize(n_real);
+            for(auto& f : this->field_mesh){ f.resize(n_real); }
+            this->plane_begin.resize(n_mesh + 1);
+            this->green.resize(n_cplx);
+
+            //--- TSC window (sinc^3 in each direction), deconvoluted for assignment and interpolation
+            this->window_inv2.resize(n_mesh);
+            for(PS::S32 i=0; i<n_mesh; ++i){
+                const PS::F64 s = sinc(Unit::pi*wave_number(i)/n_mesh);
+                const PS::F64 w = s*s*s;
+                this->window_inv2[i] = 1.0/(w*w);
+            }
+
+            this->plan_r2c = fftwf_plan_dft_r2c_3d(n_mesh, n_mesh, n_mesh, this->rho,    this->rho_k, FFTW_ESTIMATE);
+            this->plan_c2r = fftwf_plan_dft_c2r_3d(n_mesh, n_mesh, n_mesh, this->work_k, this->rho,   FFTW_ESTIMATE);
+        }
+        LocalParticleMesh(const LocalParticleMesh&) = delete;
+        LocalParticleMesh& operator = (const LocalParticleMesh&) = delete;
+        ~LocalParticleMesh(){
+            fftwf_destroy_plan(this->plan_r2c);
+            fftwf_destroy_plan(this->plan_c2r);
+            fftwf_free(this->rho);
+            fftwf_free(this->rho_k);
+            fftwf_free(this->work_k);
+        }
+
+        /*
+        * @breif dummy function. (for compativility with PS::PM::ParticleMesh)
+        */
+        template <class Tdinfo>
+        void setDomainInfoParticleMesh(Tdinfo &dinfo){ return; }
+
+        template <class Tptcl>
+        void setParticleParticleMesh(PS::ParticleSystem<Tptcl> &psys,
+                                     const bool                 clear_flag = true){
+
+            if(PS::Comm::getNumberOfProc() > 1){
+                throw std::logic_error("FORCE::PM::LocalParticleMesh is for single process execution.");
+            }
+
+            const PS::S64 n_local = psys.getNumberOfParticleLocal();
+            this->pos_buff.resize(n_local);
+            this->charge_buff.resize(n_local);
+            this->plane_of.resize(n_local);
+            this->plane_index.resize(n_local);
+            std::fill(this->plane_begin.begin(), this->plane_begin.end(), 0);
+            for(PS::S64 i=0; i<n_local; ++i){
+                this->pos_buff[i]    = psys[i].getPos();
+                this->charge_buff[i] = psys[i].getChargeParticleMesh();
+
+                const PS::S32 ix = wrap( static_cast<PS::S32>( std::floor(this->pos_buff[i].x*n_mesh + 0.5) ) );
+                this->plane_of[i] = ix;
+                ++this->plane_begin[ix + 1];
+            }
+
+            //--- sort particle index by the nearest x plane (counting sort)
+            for(PS::S32 ix=0; ix<n_mesh; ++ix){
+                this->plane_begin[ix + 1] += this->plane_begin[ix];
+            }
+            {
+                std::vector<PS::S64> cursor(this->plane_begin.begin(), this->plane_begin.end() - 1);
+                for(PS::S64 i=0; i<n_local; ++i){
+                    this->plane_index[ cursor[this->plane_of[i]]++ ] = i;
+                }
+            }
+
+            //--- charge assignment (TSC). each thread writes the slab of x planes [x_begin, x_end) only.
+            #ifdef PARTICLE_SIMULATOR_THREAD_PARALLEL
+                #pragma omp parallel
+            #endif
+            {
+                PS::S32 i_thread = 0;
+                PS::S32 n_team   = 1;
+                #ifdef PARTICLE_SIMULATOR_THREAD_PARALLEL
+                    i_thread = omp_get_thread_num();
+                    n_team   = omp_get_num_threads();
+                #endif
+                const PS::S32 x_begin = PS::S32( (PS::S64(n_mesh)*i_thread      )/n_team );
+                const PS::S32 x_end   = PS::S32( (PS::S64(n_mesh)*(i_thread + 1))/n_team );
+
+                std::fill(this->rho + mesh_index(x_begin, 0, 0),
+                          this->rho + mesh_index(x_end,   0, 0), 0.0f);
+
+                //--- the particles on the planes x_begin-1 to x_end reach the slab
+                const PS::S32 n_scan = (x_end > x_begin) ? std::min(x_end - x_begin + 2, n_mesh) : 0;
+                for(PS::S32 k=0; k<n_scan; ++k){
+                    const PS::S32 plane = wrap(x_begin - 1 + k);
+                    for(PS::S64 n=this->plane_begin[plane]; n<this->plane_begin[plane + 1]; ++n){
+                        const PS::S64 i = this->plane_index[n];
+
+                        PS::S32 ix, iy, iz;
+                        PS::F64 wx[3], wy[3], wz[3];
+                        tsc_weight(this->pos_buff[i].x, ix, wx);
+                        tsc_weight(this->pos_buff[i].y, iy, wy);
+                        tsc_weight(this->pos_buff[i].z, iz, wz);
+                        const PS::F64 q = this->charge_buff[i];
+                        for(PS::S32 a=0; a<3; ++a){
+                            const PS::S32 jx = wrap(ix+a-1);
+                            if(jx < x_begin || jx >= x_end) continue;
+                            for(PS::S32 b=0; b<3; ++b){
+                                for(PS::S32 c=0; c<3; ++c){
+                                    this->rho[ mesh_index(jx, wrap(iy+b-1), wrap(iz+c-1)) ] += q*wx[a]*wy[b]*wz[c];
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+        void calcMeshForceOnly(){
+            const PS::F64vec box   = Normalize::getBoxSize();
+            const PS::F64    r_cut = Normalize::realCutOff( Normalize::normCutOff_PM() );
+            this->update_green(box, r_cut);
+
+            fftwf_execute(this->plan_r2c);
+
+            const PS::S64    n_real = PS::S64(n_mesh)*n_mesh*n_mesh;
+            const PS::F64vec k_unit{ 2.0*Unit::pi/box.x, 2.0*Unit::pi/box.y, 2.0*Unit::pi/box.z };
+
+            //--- potential: phi(k) = G(k)*rho(k),  field: E(k) = -i*k*phi(k)
+            for(PS::S32 d=-1; d<3; ++d){
+                #ifdef PARTICLE_SIMULATOR_THREAD_PARALLEL
+                    #pragma omp parallel for
+                #endif
+                for(PS::S32 ix=0; ix<n_mesh; ++ix){
+                    for(PS::S32 iy=0; iy<n_mesh; ++iy){
+                        for(PS::S32 iz=0; iz<n_mesh_k; ++iz){
+                            const PS::S64 m = mesh_index_k(ix, iy, iz);
+                            const PS::F32 g = this->green[m];
+                            if(d < 0){
+                                this->work_k[m][0] = g*this->rho_k[m][0];
+                                this->work_k[m][1] = g*this->rho_k[m][1];
+                                continue;
+                            }
+                            //--- derivative of Nyquist frequency is set to zero
+                            const PS::S32 i_d = (d == 0) ? ix       : (d == 1) ? iy       : iz;
+                            const PS::F64 k_u = (d == 0) ? k_unit.x : (d == 1) ? k_unit.y : k_unit.z;
+                            const PS::F64 k_d = (2*i_d == n_mesh) ? 0.0 : k_u*wave_number(i_d);
+                            this->work_k[m][0] =  k_d*g*this->rho_k[m][1];
+                            this->work_k[m][1] = -k_d*g*this->rho_k[m][0];
+                        }
+                    }
+                }
+                fftwf_execute_dft_c2r(this->plan_c2r, this->work_k, this->rho);
+
+                auto& target = (d < 0) ? this->pot_mesh : this->field_mesh[d];
+                std::copy(this->rho, this->rho + n_real, target.begin());
+            }
+        }
+
+        template <class Tptcl>
+        void writeBackForce(PS::ParticleSystem<Tptcl> &psys){
+            const PS::S64 n_local = psys.getNumberOfParticleLocal();
+
+            #ifdef PARTICLE_SIMULATOR_THREAD_PARALLEL
+                #pragma omp parallel for
+            #endif
+            for(PS::S64 i=0; i<n_local; ++i){
+                PS::S32 ix, iy, iz;
+                PS::F64 wx[3], wy[3], wz[3];
+                tsc_weight(this->pos_buff[i].x, ix, wx);
+                tsc_weight(this->pos_buff[i].y, iy, wy);
+                tsc_weight(this->pos_buff[i].z, iz, wz);
+
+                PS::F64    pot   = 0.0;
+                PS::F64vec field = 0.0;
+                for(PS::S32 a=0; a<3; ++a){
+                    for(PS::S32 b=0; b<3; ++b){
+                        for(PS::S32 c=0; c<3; ++c){
+                            const PS::S64 m = mesh_index(wrap(ix+a-1), wrap(iy+b-1), wrap(iz+c-1));
+                            const PS::F64 w = wx[a]*wy[b]*wz[c];
+                            pot     += w*this->pot_mesh[m];
+                            field.x += w*this->field_mesh[0][m];
+                            field.y += w*this->field_mesh[1][m];
+                            field.z += w*this->field_mesh[2][m];
+                        }
+                    }
+                }
+                psys[i].addFieldParticleMesh( field );
+                psys[i].addPotParticleMesh(   pot   );
+            }
+        }
+    };
+
+    }
+}
@@ -0,0 +1,579 @@
+/**************************************************************************************************/
+/**
+* @file  ff_tree_wrapper.hpp
+* @brief shifted-force coulomb with large cut off by FDPS long-range tree (smooth part of PM-split kernel).
+*        this is NOT a periodic lattice sum: the periodic images are included only within the cut off.
+*/
+/**************************************************************************************************/
+#pragma once
+
+#include <cmath>
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+
+#include <particle_simulator.hpp>
+#include <molecular_dynamics_ext.hpp>
+
+#include "ff_inter_force_func.hpp"
+
+
+namespace FORCE {
+    namespace TREE {
+
+    /*
+    * @brief temporary data class for CalcForceShiftedForceTree (internal use). used as FP, EPI and EPJ.
+    */
+    class EP_TreeMultipole {
+    private:
+        PS::F64vec pos;
+        PS::F64    charge;
+
+        static PS::F64 r_cut;
+
+    public:
+        inline PS::F64vec getPos()    const { return this->pos;    }
+        inline PS::F64    getCharge() const { return this->charge; }
+
+        inline void setPos(const PS::F64vec &pos_new) { this->pos = pos_new; }
+
+        static void    setRcut(const PS::F64 r) { EP_TreeMultipole::r_cut = r;    }
+        static PS::F64 getRSearch()             { return EP_TreeMultipole::r_cut; }
+
+        template <class Tptcl>
+        void copyFromFP(const Tptcl &ptcl){
+            this->pos    = ptcl.getPos();
+            this->charge = ptcl.getChargeParticleMesh();
+        }
+    };
+    PS::F64 EP_TreeMultipole::r_cut = 0.0;
+
+    /*
+    * @brief temporary data class for CalcForceShiftedForceTree (internal use)
+    */
+    class Result_TreeMultipole {
+    private:
+        PS::F64    pot;
+        PS::F64vec field;
+        PS::F64vec virial;
+
+    public:
+        void clear(){
+            this->pot    = 0.0;
+            this->field  = PS::F64vec{0.0, 0.0, 0.0};
+            this->virial = PS::F64vec{0.0, 0.0, 0.0};
+        }
+
+        inline PS::F64    getPot()    const { return this->pot;    }
+        inline PS::F64vec getField()  const { return this->field;  }
+        inline PS::F64vec getVirial() const { return this->virial; }
+
+        inline void addPot(   const PS::F64     pot)   { this->pot    += pot;    }
+        inline void addField( const PS::F64vec &field) { this->field  += field;  }
+        inline void addVirial(const PS::F64vec &virial){ this->virial += virial; }
+    };
+
+    /*
+    * @brief moment of tree cell: charge, dipole and quadrupole around the geometric center (internal use).
+    * @details the charge-weighted center (PS::MomentMonopoleCutoff) is not defined for neutral cells.
+    *          the expansion around the geometric center is valid for any cell.
+    *          "quad" is the 2nd moment sum( q*d*d ) (not traceless). all values are in normalized space.
+    *          "vertex_in_" is the box of particle positions, used for the extent of cell around the tree cut off.
+    */
+    class MomentMultipoleCutoff {
+    public:
+        PS::S64    n_ptcl;
+        PS::F64    charge;
+        PS::F64vec pos;
+        PS::F64vec dipole;
+        PS::F64mat quad;
+        PS::F64ort vertex_out_;
+        PS::F64ort vertex_in_;
+
+        MomentMultipoleCutoff(){
+            this->init();
+        }
+        MomentMultipoleCutoff(const PS::S64     n,
+                              const PS::F64     q,
+                              const PS::F64vec &p,
+                              const PS::F64vec &d,
+                              const PS::F64mat &m,
+                              const PS::F64vec &e){
+            this->n_ptcl = n;
+            this->charge = q;
+            this->pos    = p;
+            this->dipole = d;
+            this->quad   = m;
+            this->vertex_out_.init();
+            this->vertex_in_.low_  = p - e;
+            this->vertex_in_.high_ = p + e;
+        }
+        void init(){
+            this->n_ptcl = 0;
+            this->charge = 0.0;
+            this->pos    = 0.0;
+            this->dipole = 0.0;
+            this->quad   = 0.0;
+            this->vertex_out_.init();
+            this->vertex_in_.init();
+        }
+
+        PS::F64vec getPos()       const { return this->pos;         }
+        PS::F64    getCharge()    const { return this->charge;      }
+        PS::F64ort getVertexOut() const { return this->vertex_out_; }
+
+        template <class Tepj>
+        void accumulateAtLeaf(const Tepj &epj){
+            this->n_ptcl += 1;
+            this->charge += epj.getCharge();
+            this->pos    += epj.getPos();
+            this->vertex_out_.merge(epj.getPos(), epj.getRSearch());
+            this->vertex_in_.merge(epj.getPos());
+        }
+        void accumulate(const MomentMultipoleCutoff &mom){
+            this->n_ptcl += mom.n_ptcl;
+            this->charge += mom.charge;
+            this->pos    += PS::F64(mom.n_ptcl)*mom.pos;
+            this->vertex_out_.merge(mom.vertex_out_);
+            this->vertex_in_.merge(mom.vertex_in_);
+        }
+        void set(){
+            if(this->n_ptcl > 0) this->pos = this->pos/PS::F64(this->n_ptcl);
+        }
+
+        template <class Tepj>
+        void accumulateAtLeaf2(const Tepj &epj){
+            const PS::F64vec d = epj.getPos() - this->pos;
+            const PS::F64    q = epj.getCharge();
+            this->dipole  += q*d;
+            this->quad.xx += q*d.x*d.x;
+            this->quad.yy += q*d.y*d.y;
+            this->quad.zz += q*d.z*d.z;
+            this->quad.xy += q*d.x*d.y;
+            this->quad.xz += q*d.x*d.z;
+            this->quad.yz += q*d.y*d.z;
+        }
+        void accumulate2(const MomentMultipoleCutoff &mom){
+            //--- shift of expansion center
+            const PS::F64vec s = mom.pos - this->pos;
+            const PS::F64vec d = mom.dipole;
+            const PS::F64    q = mom.charge;
+            this->dipole  += d + q*s;
+            this->quad.xx += mom.quad.xx + 2.0*d.x*s.x + q*s.x*s.x;
+            this->quad.yy += mom.quad.yy + 2.0*d.y*s.y + q*s.y*s.y;
+            this->quad.zz += mom.quad.zz + 2.0*d.z*s.z + q*s.z*s.z;
+            this->quad.xy += mom.quad.xy + d.x*s.y + s.x*d.y + q*s.x*s.y;
+            this->quad.xz += mom.quad.xz + d.x*s.z + s.x*d.z + q*s.x*s.z;
+            this->quad.yz += mom.quad.yz + d.y*s.z + s.y*d.z + q*s.y*s.z;
+        }
+    };
+
+    /*
+    * @brief super particle for MomentMultipoleCutoff (internal use)
+    * @details "extent" is the half size of the cell from the expansion center (normalized space, for each axis).
+    */
+    class SPJMultipoleCutoff {
+    public:
+        PS::S64    n_ptcl;
+        PS::F64    charge;
+        PS::F64vec pos;
+        PS::F64vec dipole;
+        PS::F64mat quad;
+        PS::F64vec extent;
+
+        template <class Tmom>
+        void copyFromMoment(const Tmom &mom){
+            this->n_ptcl = mom.n_ptcl;
+            this->charge = mom.charge;
+            this->pos    = mom.pos;
+            this->dipole = mom.dipole;
+            this->quad   = mom.quad;
+            this->extent = 0.0;
+            if(mom.n_ptcl > 0){
+                const PS::F64vec d_low  = mom.pos - mom.vertex_in_.low_;
+                const PS::F64vec d_high = mom.vertex_in_.high_ - mom.pos;
+                this->extent = PS::F64vec{ std::max(d_low.x, d_high.x),
+                                           std::max(d_low.y, d_high.y),
+                                           std::max(d_low.z, d_high.z) };
+            }
+        }
+        MomentMultipoleCutoff convertToMoment() const {
+            return MomentMultipoleCutoff(this->n_ptcl, this->charge, this->pos, this->dipole, this->quad, this->extent);
+        }
+        void clear(){
+            this->n_ptcl = 0;
+            this->charge = 0.0;
+            this->pos    = 0.0;
+            this->dipole = 0.0;
+            this->quad   = 0.0;
+            this->extent = 0.0;
+        }
+
+        PS::F64vec getPos()    const { return this->pos;    }
+        PS::F64    getCharge() const { return this->charge; }
+        void setPos(const PS::F64vec &pos_new){ this->pos = pos_new; }
+    };
+
+    namespace _Impl {
+
+        //--- 1st and 2nd derivative of S2_fcut(xi) by xi.
+        inline void S2_fcut_deriv(const PS::F64 xi, PS::F64 &d1, PS::F64 &d2){
+            if (xi <= 1.0) {
+                d1 = -(xi*xi)*(672.0
+                              +(xi*xi)*(-1120.0
+                                       +xi*(420.0
+                                           +xi*(336.0 - 168.0*xi))))/140.0;
+                d2 = -xi*(1344.0
+                         +(xi*xi)*(-4480.0
+                                  +xi*(2100.0
+                                      +xi*(2016.0 - 1176.0*xi))))/140.0;
+            } else if (xi < 2.0) {
+                d1 = -xi*(-448.0
+                         +xi*(2688.0
+                             +xi*(-3360.0
+                                 +xi*(1120.0
+                                     +xi*(420.0
+                                         +xi*(-336.0 + 56.0*xi))))))/140.0;
+                d2 = -(-448.0
+                      +xi*(5376.0
+                          +xi*(-10080.0
+                              +xi*(4480.0
+                                  +xi*(2100.0
+                                      +xi*(-2016.0 + 392.0*xi))))))/140.0;
+            } else {
+                d1 = 0.0;
+                d2 = 0.0;
+            }
+        }
+
+        /*
+        * @brief radial derivatives of the smooth part g(r) = (1 - S2_pcut(2r/rc))/r - 1/R + (r - R)/R^2.
+        * @details grad g = A*r, grad grad g = B*r*r + A*I, grad B = C*r. (r: vector)
+        */
+        inline void smooth_radial_deriv(const PS::F64  r,
+                                        const PS::F64  r_cut_PP_inv,
+                                        const PS::F64  R2_inv,
+                                              PS::F64 &A,
+                                              PS::F64 &B,
+                                              PS::F64 &C){
+            const PS::F64 r_inv  = 1.0/r;
+            const PS::F64 r2_inv = r_inv*r_inv;
+            const PS::F64 coef   = 2.0*r_cut_PP_inv;
+            const PS::F64 xi     = coef*r;
+
+            PS::F64 d1, d2;
+            S2_fcut_deriv(xi, d1, d2);
+            const PS::F64 S    = 1.0 - S2_fcut(xi);
+            const PS::F64 S_r  = -coef*d1;
+            const PS::F64 S_rr = -coef*coef*d2;
+
+            const PS::F64 g1 = -S*r2_inv + R2_inv;
+            const PS::F64 g2 =  2.0*S*r2_inv*r_inv - S_r*r2_inv;
+            const PS::F64 g3 = -6.0*S*r2_inv*r2_inv + 4.0*S_r*r2_inv*r_inv - S_rr*r2_inv;
+
+            A = g1*r_inv;
+            B = (g2 - A)*r2_inv;
+            C = (g3 - B*r)*r2_inv*r_inv - 2.0*B*r2_inv;
+        }
+    }
+
+    /*
+    * @brief smooth part of PM-split coulomb: (1 - S2_pcut(2r/rc))/r, shifted-force at the tree cut off R.
+    * @details the sum with the PP part "S2_pcut(2r/rc)/r" is the shifted-force coulomb with cut off R.
+    *          the value at r = 0 (the particle itself) is the limit of the smooth part with the shift of potential,
+    *          then the self term of PP part, -q_i*(208/70)/rc, is cancelled as same as PM.
+    *          positions of EPJ are given as periodic images by FDPS (in normalized space).
+    *          the virial is accumulated pairwise: 0.5*r_ij*field_ij (multiply the charge of atom i).
+    */
+    struct CalcForceSmoothEP {
+        PS::F64vec box;
+        PS::F64    r_cut_PP_inv;
+        PS::F64    r_cut_tree;
+
+        template <class Tepi, class Tepj>
+        void operator () (const Tepi                 *ep_i,
+                          const PS::S32               n_ep_i,
+                          const Tepj                 *ep_j,
+                          const PS::S32               n_ep_j,
+                                Result_TreeMultipole *result){
+
+            const PS::F64 r2_cut    = this->r_cut_tree*this->r_cut_tree;
+            const PS::F64 R_inv     = 1.0/this->r_cut_tree;
+            const PS::F64 R2_inv    = R_inv*R_inv;
+            const PS::F64 self_coef = (208.0/70.0)*this->r_cut_PP_inv - R_inv;
+
+            for(PS::S32 i=0; i<n_ep_i; ++i){
+                const PS::F64vec pos_i = ep_i[i].getPos();
+
+                PS::F64    pot    = 0.0;
+                PS::F64vec field  = 0.0;
+                PS::F64vec virial = 0.0;
+                for(PS::S32 j=0; j<n_ep_j; ++j){
+                    const PS::F64vec pos_j = ep_j[j].getPos();
+                    const PS::F64vec r_ij  = PS::F64vec{ (pos_i.x - pos_j.x)*this->box.x,
+                                                         (pos_i.y - pos_j.y)*this->box.y,
+                                                         (pos_i.z - pos_j.z)*this->box.z };
+                    const PS::F64    r2    = r_ij*r_ij;
+                    const PS::F64    q_j   = ep_j[j].getCharge();
+
+                    if(r2 == 0.0){
+                        pot += self_coef*q_j;
+                        continue;
+                    }
+                    if(r2 >= r2_cut) continue;
+
+                    const PS::F64 r2_inv = 1.0/r2;
+                    const PS::F64 r_inv  = std::sqrt(r2_inv);
+                    const PS::F64 r      = r2*r_inv;
+                    const PS::F64 xi     = 2.0*r*this->r_cut_PP_inv;
+
+                    const PS::F64vec f_ij = ( q_j*( (1.0 - S2_fcut(xi))*r2_inv - R2_inv )*r_inv )*r_ij;
+
+                    pot    += q_j*( (1.0 - S2_pcut(xi))*r_inv - R_inv + (r - this->r_cut_tree)*R2_inv );
+                    field  += f_ij;
+                    virial += calcVirialEPI(r_ij, f_ij);
+                }
+                result[i].addPot(    pot    );
+                result[i].addField(  field  );
+                result[i].addVirial( virial );
+            }
+        }
+    };
+
+    /*
+    * @brief smooth part from super particles, expanded up to quadrupole around the geometric center.
+    * @details phi   = Q*g - A*(D.r) + 0.5*( B*(r.M.r) + A*tr(M) )
+    *          field = -grad(phi)
+    *          the virial is the expansion of sum_j 0.5*(r - d_j)*field_j in the same order.
+    *          positions of SPJ are given as periodic images by FDPS (in normalized space).
+    *          the cut off is decided by the extent of cell, not by the expansion center:
+    *          the cell is skipped only when it is entirely outside of R.
+    *          the cell straddling R cannot be opened from the kernel (FDPS opens cells by theta only),
+    *          it is expanded with the continuation of g beyond R, (r - R)^2/(r*R^2) <= a^2/R^3 for the cell size a.
+    *          this is the same order as the truncation of quadrupole expansion.
+    */
+    struct CalcForceSmoothSP {
+        PS::F64vec box;
+        PS::F64    r_cut_PP_inv;
+        PS::F64    r_cut_tree;
+
+        template <class Tepi, class Tspj>
+        void operator () (const Tepi                 *ep_i,
+                          const PS::S32               n_ep_i,
+                          const Tspj                 *sp_j,
+                          const PS::S32               n_sp_j,
+                                Result_TreeMultipole *result){
+
+            const PS::F64 R_inv  = 1.0/this->r_cut_tree;
+            const PS::F64 R2_inv = R_inv*R_inv;
+            const PS::F64vec &b  = this->box;
+
+            for(PS::S32 i=0; i<n_ep_i; ++i){
+                const PS::F64vec pos_i = ep_i[i].getPos();
+
+                PS::F64    pot    = 0.0;
+                PS::F64vec field  = 0.0;
+                PS::F64vec virial = 0.0;
+                for(PS::S32 j=0; j<n_sp_j; ++j){
+                    const PS::F64vec pos_j = sp_j[j].getPos();
+                    const PS::F64vec r     = PS::F64vec{ (pos_i.x - pos_j.x)*b.x,
+                                                         (pos_i.y - pos_j.y)*b.y,
+                                                         (pos_i.z - pos_j.z)*b.z };
+                    const PS::F64    r2    = r*r;
+                    if(r2 == 0.0) continue;
+
+                    //--- skip the cell entirely outside of R
+                    const PS::F64vec ext   = PS::F64vec{ sp_j[j].extent.x*b.x,
+                                                         sp_j[j].extent.y*b.y,
+                                                         sp_j[j].extent.z*b.z };
+                    const PS::F64    r_abs = std::sqrt(r2);
+                    const PS::F64    r_out = this->r_cut_tree + std::sqrt(ext*ext);
+                    if(r_abs >= r_out) continue;
+
+                    //--- moments in real space
+                    const PS::F64    Q  = sp_j[j].charge;
+                    const PS::F64vec D  = PS::F64vec{ sp_j[j].dipole.x*b.x,
+                                                      sp_j[j].dipole.y*b.y,
+                                                      sp_j[j].dipole.z*b.z };
+                    const auto&      Mn = sp_j[j].quad;
+                    const PS::F64 Mxx = Mn.xx*b.x*b.x, Myy = Mn.yy*b.y*b.y, Mzz = Mn.zz*b.z*b.z;
+                    const PS::F64 Mxy = Mn.xy*b.x*b.y, Mxz = Mn.xz*b.x*b.z, Myz = Mn.yz*b.y*b.z;
+                    const PS::F64vec Mr = PS::F64vec{ Mxx*r.x + Mxy*r.y + Mxz*r.z,
+                                                      Mxy*r.x + Myy*r.y + Myz*r.z,
+                                                      Mxz*r.x + Myz*r.y + Mzz*r.z };
+                    const PS::F64 trM = Mxx + Myy + Mzz;
+                    const PS::F64 rMr = r*Mr;
+                    const PS::F64 Dr  = D*r;
+
+                    const PS::F64 xi    = 2.0*r_abs*this->r_cut_PP_inv;
+                    const PS::F64 g     = (1.0 - S2_pcut(xi))/r_abs - R_inv + (r_abs - this->r_cut_tree)*R2_inv;
+
+                    PS::F64 A, B, C;
+                    _Impl::smooth_radial_deriv(r_abs, this->r_cut_PP_inv, R2_inv, A, B, C);
+
+                    pot   += Q*g - A*Dr + 0.5*(B*rMr + A*trM);
+                    field -= (Q*A - B*Dr + 0.5*(C*rMr + B*trM))*r - A*D + B*Mr;
+
+                    //--- virial: -0.5*sum_j q_j*F_a(r - d_j), F_a(x) = x_a*x_a*A(|x|)
+                    const PS::F64vec r_sq = PS::F64vec{r.x*r.x, r.y*r.y, r.z*r.z};
+                    const PS::F64vec Mdia = PS::F64vec{Mxx, Myy, Mzz};
+                    const PS::F64vec rMr_a = PS::F64vec{r.x*Mr.x, r.y*Mr.y, r.z*Mr.z};
+                    const PS::F64vec rD_a  = PS::F64vec{r.x*D.x,  r.y*D.y,  r.z*D.z };
+                    virial -= 0.5*( (Q*A - B*Dr + 0.5*(B*trM + C*rMr))*r_sq
+                                   - 2.0*A*rD_a
+                                   + A*Mdia + 2.0*B*rMr_a );
+                }
+                result[i].addPot(    pot    );
+                result[i].addField(  field  );
+                result[i].addVirial( virial );
+            }
+        }
+    };
+
+
+    /*
+    * @brief shifted-force coulomb with large cut off R. the smooth part of PM-split kernel is evaluated by FDPS tree
+    *        (quadrupole moment with cut off search in periodic boundary).
+    * @details the sum with the PP part is 1/r - 1/R + (r - R)/R^2 for r < R, zero for r >= R.
+    *          this is NOT a periodic lattice sum (the periodic images are included only within R),
+    *          so it is not a replacement of PM. the system must be neutral (checked at the first call of setParticleParticleMesh()).
+    *          provide same interface with "FORCE::PM::CalcForceParticleMesh" class.
+    *          the communication is only with the neighbor processes in R (no FFT all-to-all).
+    *          the accuracy is controled by opening angle "theta".
+    */
+    class CalcForceShiftedForceTree {
+    public:
+        //--- data type
+        using EP_type     = EP_TreeMultipole;
+        using Result_type = Result_TreeMultipole;
+
+    private:
+        //--- FDPS object
+        PS::TreeForForce<PS::SEARCH_MODE_LONG_CUTOFF,
+                         Result_type,
+                         EP_type,
+                         EP_type,
+                         MomentMultipoleCutoff,
+                         MomentMultipoleCutoff,
+                         SPJMultipoleCutoff    > tree;
+
+        //--- buffer object
+        PS::ParticleSystem<EP_type> ep_buff;
+        PS::DomainInfo             *dinfo_ptr = nullptr;
+
+        CalcForceSmoothEP func_ep_ep;
+        CalcForceSmoothSP func_ep_sp;
+
+        bool init_flag    = false;
+        bool neutral_flag = false;
+
+    public:
+        CalcForceShiftedForceTree(){
+            this->ep_buff.initialize();
+        }
+        CalcForceShiftedForceTree(const CalcForceShiftedForceTree&) = delete;
+        CalcForceShiftedForceTree& operator = (const CalcForceShiftedForceTree&) = delete;
+        ~CalcForceShiftedForceTree() = default;
+
+        void init(const PS::S64 n_total,
+                  const PS::F32 theta,
+                  const PS::S32 n_leaf_limit,
+                  const PS::S32 n_group_limit){
+            this->tree.initialize(n_total, theta, n_leaf_limit, n_group_limit);
+            this->init_flag = true;
+        }
+
+        /*
+        * @brief set cut off length in normalized space.
+        * @param[in] r_cut_PP   cut off of PP part (scale length of S2 functions).
+        * @param[in] r_cut_tree cut off of shifted-force coulomb. must be longer than r_cut_PP.
+        */
+        void setRcut(const PS::F64 r_cut_PP,
+                     const PS::F64 r_cut_tree){
+            if(r_cut_tree <= r_cut_PP ||
+               r_cut_tree >= 0.5        ){
+                std::ostringstream oss;
+                oss << "cut off for tree coulomb must be in range of (r_cut_PP, 0.5) at normalized space." << "\n"
+                    << "    r_cut_PP = " << r_cut_PP << ", r_cut_tree = " << r_cut_tree << "\n";
+                throw std::length_error(oss.str());
+            }
+            EP_type::setRcut(r_cut_tree);
+            this->func_ep_ep.r_cut_PP_inv = 1.0/Normalize::realCutOff(r_cut_PP);
+            this->func_ep_ep.r_cut_tree   =     Normalize::realCutOff(r_cut_tree);
+            this->func_ep_sp.r_cut_PP_inv = this->func_ep_ep.r_cut_PP_inv;
+            this->func_ep_sp.r_cut_tree   = this->func_ep_ep.r_cut_tree;
+        }
+
+        /*
+        * @brief the domain of MD system is used as it is. (interface for compativility with CalcForceParticleMesh)
+        */
+        template <class Tdinfo>
+        void setDomainInfoParticleMesh(Tdinfo &dinfo){
+            this->dinfo_ptr = &dinfo;
+        }
+
+        template <class Tptcl>
+        void setParticleParticleMesh(PS::ParticleSystem<Tptcl> &psys,
+                                     const bool                 clear_flag = true){
+
+            const PS::S64 n_local = psys.getNumberOfParticleLocal();
+            this->ep_buff.setNumberOfParticleLocal(n_local);
+
+            #ifdef PARTICLE_SIMULATOR_THREAD_PARALLEL
+                #pragma omp parallel for
+            #endif
+            for(PS::S64 i=0; i<n_local; ++i){
+                this->ep_buff[i].copyFromFP(psys[i]);
+            }
+
+            //--- the truncated sum is defined for neutral system only
+            if( !this->neutral_flag ){
+                PS::F64 q_local = 0.0;
+                PS::F64 q_abs   = 0.0;
+                for(PS::S64 i=0; i<n_local; ++i){
+                    q_local += this->ep_buff[i].getCharge();
+                    q_abs   += std::abs(this->ep_buff[i].getCharge());
+                }
+                const PS::F64 q_total = PS::Comm::getSum(q_local);
+                const PS::F64 q_scale = PS::Comm::getSum(q_abs);
+                if( std::abs(q_total) > 1.e-6*std::max(q_scale, 1.0) ){
+                    std::ostringstream oss;
+                    oss << "the system must be neutral in SF_TREE coulomb mode." << "\n"
+                        << "    total charge = " << q_total << "\n";
+                    throw std::invalid_argument(oss.str());
+                }
+                this->neutral_flag = true;
+            }
+        }
+
+        void calcMeshForceOnly(){
+            if( !this->init_flag || this->dinfo_ptr == nullptr ){
+                throw std::logic_error("CalcForceShiftedForceTree is not initialized.");
+            }
+            this->func_ep_ep.box = Normalize::getBoxSize();
+            this->func_ep_sp.box = Normalize::getBoxSize();
+            this->tree.calcForceAll(this->func_ep_ep,
+                                    this->func_ep_sp,
+                                    this->ep_buff,
+                                    *(this->dinfo_ptr),
+                                    true);
+        }
+
+        template <class Tptcl>
+        void writeBackForce(PS::ParticleSystem<Tptcl> &psys){
+            const PS::S64 n_local = psys.getNumberOfParticleLocal();
+
+            #ifdef PARTICLE_SIMULATOR_THREAD_PARALLEL
+                #pragma omp parallel for
+            #endif
+            for(PS::S64 i=0; i<n_local; ++i){
+                const auto& result = this->tree.getForce(i);
+                psys[i].addFieldParticleMesh( result.getField() );
+                psys[i].addPotParticleMesh(   result.getPot()   );
+                psys[i].addVirialLongRange(   result.getVirial() );
+            }
+        }
+    };
+
+    }
+}
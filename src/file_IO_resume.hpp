@@ -82,6 +82,7 @@ namespace FILE_IO {
             oss << this->header_mark << "\n"   // mark for end of header data
                 << "AtomID"   << "\t"
                 << "MolID"    << "\t"
+                << "TmpIndex" << "\t"
                 << "AtomType" << "\t"
                 << "MolType"  << "\t"
                 << "Pos_x"    << "\t"
@@ -282,6 +283,7 @@ namespace FILE_IO {
             oss << std::hexfloat;
             oss << atom.getAtomID()                 << "\t"
                 << atom.getMolID()                  << "\t"
+                << atom.getTemplateIndex()          << "\t"
                 << ENUM::what( atom.getAtomType() ) << "\t"
                 << ENUM::what( atom.getMolType()  ) << "\t"
                 << atom.getPos().x  << "\t"
@@ -310,37 +312,38 @@ namespace FILE_IO {
 
         template <class Tptcl>
         void read_atom(FILE *fp, Tptcl &atom){
-            const size_t field_len = 18;
+            const size_t field_len = 19;
             const auto str_list = TOOL::line_to_str_list(fp, "\t");
             if(str_list.size() < field_len){
                 std::ostringstream oss;
                 oss << "invalid data field." << "\n"
-                    << "  str_list.size() = " << str_list.size() << ", must be >= 15" << "\n";
+                    << "  str_list.size() = " << str_list.size() << ", must be >= " << field_len << "\n";
                 throw std::invalid_argument("invalid data field.");
             }
 
             //--- FP property input
             atom.setAtomID( std::stoi(str_list[0]) );
             atom.setMolID(  std::stoi(str_list[1]) );
-            atom.setAtomType( str_list[2] );
-            atom.setMolType(  str_list[3] );
-            atom.setPos( PS::F32vec{ std::stof(str_list[4]),
-                                     std::stof(str_list[5]),
-                                     std::stof(str_list[6]) } );
-            atom.setMass( std::stof(str_list[7]) );
-            atom.setVel( PS::F32vec{ std::stof(str_list[8]),
-                                     std::stof(str_list[9]),
-                                     std::stof(str_list[10]) } );
+            atom.setTemplateIndex( std::stoi(str_list[2]) );
+            atom.setAtomType( str_list[3] );
+            atom.setMolType(  str_list[4] );
+            atom.setPos( PS::F32vec{ std::stof(str_list[5]),
+                                     std::stof(str_list[6]),
+                                     std::stof(str_list[7]) } );
+            atom.setMass( std::stof(str_list[8]) );
+            atom.setVel( PS::F32vec{ std::stof(str_list[9]),
+                                     std::stof(str_list[10]),
+                                     std::stof(str_list[11]) } );
             atom.clearTrj();
-            atom.addTrj( PS::F32vec{ std::stof(str_list[11]),
-                                     std::stof(str_list[12]),
-                                     std::stof(str_list[13]) } );
-            atom.setCharge( std::stof(str_list[14]) );
-            atom.setVDW_D(  std::stof(str_list[15]) );
-            atom.setVDW_R(  std::stof(str_list[16]) );
+            atom.addTrj( PS::F32vec{ std::stof(str_list[12]),
+                                     std::stof(str_list[13]),
+                                     std::stof(str_list[14]) } );
+            atom.setCharge( std::stof(str_list[15]) );
+            atom.setVDW_D(  std::stof(str_list[16]) );
+            atom.setVDW_R(  std::stof(str_list[17]) );
 
             //--- connection information
-            const PS::S32 n_bond = std::stoi(str_list[17]);
+            const PS::S32 n_bond = std::stoi(str_list[18]);
             if( n_bond          < 0 ||
                 str_list.size() < field_len + static_cast<size_t>(n_bond) ){
                 std::ostringstream oss;
@@ -5,6 +5,8 @@
 
 #include <string>
 #include <sstream>
+#include <vector>
+#include <algorithm>
 #include <unordered_map>
 
 #include <particle_simulator.hpp>
@@ -46,6 +48,41 @@ namespace MODEL {
         }
     };
 
+    //--- explicit LJ parameter for (atom_i, atom_j) pair (override the Lorentz-Berthelot rule)
+    struct CoefVDWPair {
+      public:
+        PS::F32 vdw_d;   // [kcal/mol]
+        PS::F32 vdw_r;   // [angstrom]
+
+        inline std::string to_str(const size_t &shift = 0) const {
+            std::ostringstream oss;
+
+            oss << std::setw(shift + 9) << "vdw_d  : " << std::setw(12) << this->vdw_d << "\n";
+            oss << std::setw(shift + 9) << "vdw_r  : " << std::setw(12) << this->vdw_r << "\n";
+
+            return oss.str();
+        }
+
+        inline void print(const size_t &shift = 0) const {
+            std::cout << this->to_str(shift);
+        }
+    };
+
+    //--- precomputed LJ coefficient for (type_i, type_j) pair
+    //------ V(r) = c12/r^12 - 2*c6/r^6,  c6 = vdw_d*vdw_r^6, c12 = vdw_d*vdw_r^12
+    struct CoefLJ {
+      public:
+        PS::F64 c6;
+        PS::F64 c12;
+    };
+
+    //--- scaling factor of intramolecular mask for each mask level (level 0: no mask)
+    struct CoefMaskScale {
+      public:
+        PS::F64 scale_LJ[MD_DEFS::mask_bits_max_level + 1];
+        PS::F64 scale_coulomb[MD_DEFS::mask_bits_max_level + 1];
+    };
+
     //--- parameter for intramolecular interactions
     struct CoefBond {
       public:
@@ -113,11 +150,40 @@ namespace MODEL {
         }
     };
 
+    //--- solver setting for "constraint" form
+    struct CoefConstraint {
+      public:
+        ConstraintSolver solver      = ConstraintSolver::SHAKE;
+        PS::S32          lincs_order = 4;   // order of matrix expansion
+        PS::S32          lincs_iter  = 1;   // number of correction for rotational lengthening
+
+        inline std::string to_str(const size_t &shift = 0) const {
+            std::ostringstream oss;
+
+            oss << std::setw(shift + 14) << "solver      : " << this->solver      << "\n";
+            oss << std::setw(shift + 14) << "lincs_order : " << this->lincs_order << "\n";
+            oss << std::setw(shift + 14) << "lincs_iter  : " << this->lincs_iter  << "\n";
+
+            return oss.str();
+        }
+
+        inline void print(const size_t &shift = 0) const {
+            std::cout << this->to_str(shift);
+        }
+    };
+
     //--- for residue information
     //------ key = (model_name, atom_name)
     using KeyAtom = std::tuple<MolName,
                                AtomName>;
 
+    //--- for LJ pair parameter
+    //------ key = (model_i, atom_i, model_j, atom_j)
+    using KeyVDWPair = std::tuple<MolName,
+                                  AtomName,
+                                  MolName,
+                                  AtomName>;
+
     //--- for intramolecular parameter
     //------ key = (model_name, i_atom, j_atom)
     using KeyBond = std::tuple<MolName,
@@ -203,6 +269,14 @@ namespace MODEL {
                                 std::string,
                                 hash_tuple::hash_func<KeyAtom>> residue;
 
+            std::unordered_map< KeyAtom,
+                                CoefAtom,
+                                hash_tuple::hash_func<KeyAtom>> atom;
+
+            std::unordered_map< KeyVDWPair,
+                                CoefVDWPair,
+                                hash_tuple::hash_func<KeyVDWPair>> vdw_pair;
+
             std::unordered_map< KeyBond,
                                 CoefBond,
                                 hash_tuple::hash_func<KeyBond>> bond;
@@ -215,29 +289,217 @@ namespace MODEL {
                                 CoefTorsion,
                                 hash_tuple::hash_func<KeyTorsion>> torsion;
 
+            //--- constraint solver for each model (optional, default: SHAKE)
+            std::unordered_map< MolName,
+                                CoefConstraint,
+                                std::hash<MolName> > constraint;
+
+            //--- LJ type index and dense (type_i, type_j) matrix. made by make_vdw_matrix().
+            std::unordered_map< KeyAtom,
+                                PS::S32,
+                                hash_tuple::hash_func<KeyAtom>> vdw_type;
+            std::vector<CoefLJ> vdw_matrix;
+            PS::S32             n_vdw_type = 0;
+
+            //--- dense table of intramolecular mask scaling. index = MolName. made by make_mask_scale().
+            std::vector<CoefMaskScale> mask_scale;
+
+            //--- atom name list of molecular model template (in order of local ID)
+            std::unordered_map< MolName,
+                                std::vector<AtomName>,
+                                std::hash<MolName> > mol_atom;
+
+            //--- flag for 3-site water kernel. index = MolName. made by make_water_kernel_flag().
+            std::vector<bool> water_kernel;
+
             CoefTable(){
                 const PS::F32 factor = 0.7;
                 this->mask_scaling.max_load_factor(factor);
+                this->mol_atom.max_load_factor(factor);
                 this->residue.max_load_factor(factor);
-                this->residue.max_load_factor(factor);
+                this->atom.max_load_factor(factor);
+                this->vdw_pair.max_load_factor(factor);
                 this->bond.max_load_factor(factor);
                 this->angle.max_load_factor(factor);
                 this->torsion.max_load_factor(factor);
+                this->constraint.max_load_factor(factor);
+                this->vdw_type.max_load_factor(factor);
+            }
+
+            /*
+            *  @brief make the LJ type index and the (type_i, type_j) coefficient matrix from "atom" and "vdw_pair".
+            *  @details the type index is assigned in sorted order of KeyAtom (same result in all processes).
+            *           the pair without explicit "vdw_pair" parameter is combined by the Lorentz-Berthelot rule.
+            */
+            void make_vdw_matrix(){
+                std::vector<KeyAtom> key_list;
+                key_list.reserve(this->atom.size());
+                for(const auto& coef : this->atom){
+                    key_list.push_back(coef.first);
+                }
+                std::sort(key_list.begin(), key_list.end());
+
+                const PS::S32 n = key_list.size();
+                this->n_vdw_type = n;
+                this->vdw_type.clear();
+                for(PS::S32 i=0; i<n; ++i){
+                    this->vdw_type[key_list[i]] = i;
+                }
+
+                this->vdw_matrix.resize(n*n);
+                for(PS::S32 i=0; i<n; ++i){
+                    const auto& key_i  = key_list[i];
+                    const auto& coef_i = this->atom.at(key_i);
+                    for(PS::S32 j=0; j<n; ++j){
+                        const auto& key_j  = key_list[j];
+                        const auto& coef_j = this->atom.at(key_j);
+
+                        //--- VDW_D values are pre-affected "sqrt", VDW_R values are pre-affected "0.5*"
+                        PS::F64 vddm = coef_i.vdw_d*coef_j.vdw_d;
+                        PS::F64 vdrm = coef_i.vdw_r + coef_j.vdw_r;
+
+                        //--- explicit pair parameter
+                        auto itr = this->vdw_pair.find( KeyVDWPair{ std::get<0>(key_i), std::get<1>(key_i),
+                                                                    std::get<0>(key_j), std::get<1>(key_j) } );
+                        if(itr == this->vdw_pair.end()){
+                            itr = this->vdw_pair.find( KeyVDWPair{ std::get<0>(key_j), std::get<1>(key_j),
+                                                                   std::get<0>(key_i), std::get<1>(key_i) } );
+                        }
+                        if(itr != this->vdw_pair.end()){
+                            vddm = itr->second.vdw_d;
+                            vdrm = itr->second.vdw_r;
+                        }
+
+                        const PS::F64 vdrm6 = vdrm*vdrm*vdrm*vdrm*vdrm*vdrm;
+                        this->vdw_matrix[i*n + j] = CoefLJ{ vddm*vdrm6,
+                                                            vddm*vdrm6*vdrm6 };
+                    }
+                }
             }
+
+            void make_mask_scale(){
+                this->mask_scale.resize( ENUM::size_MolName() );
+                for(auto& coef : this->mask_scale){
+                    for(PS::S32 k=0; k<=MD_DEFS::mask_bits_max_level; ++k){
+                        coef.scale_LJ[k]      = 1.0;
+                        coef.scale_coulomb[k] = 1.0;
+                    }
+                }
+                for(const auto& mask_param : this->mask_scaling){
+                    auto& coef = this->mask_scale.at( static_cast<size_t>(mask_param.first) );
+                    const PS::S32 n_level = std::min( static_cast<PS::S32>(mask_param.second.size()),
+                                                      MD_DEFS::mask_bits_max_level );
+                    for(PS::S32 k=0; k<n_level; ++k){
+                        coef.scale_LJ[k+1]      = mask_param.second[k].scale_LJ;
+                        coef.scale_coulomb[k+1] = mask_param.second[k].scale_coulomb;
+                    }
+                }
+            }
+
+            /*
+            *  @brief select the molecule type for the 3-site water kernel in FORCE::calcForceShort.
+            *  @details condition: the molecule has 3 atoms, the mask scaling of 1-2 and 1-3 pair is 0.0
+            *           (all intramolecular pairs are excluded), and LJ acts on the 1st atom only (e.g. Ow in SPC/Fw).
+            */
+            void make_water_kernel_flag(){
+                this->water_kernel.assign( ENUM::size_MolName(), false );
+                for(const auto& mol : this->mol_atom){
+                    if(mol.second.size() != 3) continue;
+
+                    const auto itr = this->mask_scaling.find(mol.first);
+                    if(itr == this->mask_scaling.end() || itr->second.size() < 2) continue;
+
+                    bool flag = true;
+                    for(size_t k=0; k<2; ++k){
+                        flag = flag && ( itr->second[k].scale_LJ      == 0.0 &&
+                                         itr->second[k].scale_coulomb == 0.0    );
+                    }
+
+                    //--- LJ coefficient of the 2nd and 3rd atom must be zero for all LJ type
+                    for(size_t s=1; s<3; ++s){
+                        const PS::S32 type_s = this->getVDWType(mol.first, mol.second[s]);
+                        for(PS::S32 t=0; t<this->n_vdw_type; ++t){
+                            const auto& coef = this->getCoefLJ(type_s, t);
+                            flag = flag && (coef.c6 == 0.0 && coef.c12 == 0.0);
+                        }
+                    }
+
+                    this->water_kernel.at( static_cast<size_t>(mol.first) ) = flag;
+                }
+            }
+            inline bool isWaterKernel(const MolName &mol) const {
+                const size_t index = static_cast<size_t>(mol);
+                return (index < this->water_kernel.size()) && this->water_kernel[index];
+            }
+
+            /*
+            *  @brief  get the mask level of the scaling factor in mask.
+            *  @return 0 means the scaling factor is not found in range of [1, MD_DEFS::mask_bits_max_level].
+            */
+            PS::S32 getMaskLevel(const MolName &mol, const MD_DEFS::IntraMask &mask) const {
+                const auto& coef = this->mask_scale.at( static_cast<size_t>(mol) );
+                for(PS::S32 k=1; k<=MD_DEFS::mask_bits_max_level; ++k){
+                    if( coef.scale_LJ[k]      == PS::F64(mask.scale_LJ) &&
+                        coef.scale_coulomb[k] == PS::F64(mask.scale_coulomb) ) return k;
+                }
+                return 0;
+            }
+
+            PS::S32 getVDWType(const MolName &mol, const AtomName &atom_name) const {
+                const auto itr = this->vdw_type.find( KeyAtom{mol, atom_name} );
+                if(itr == this->vdw_type.end()){
+                    std::ostringstream oss;
+                    oss << "the LJ type index of " << ENUM::what( KeyAtom{mol, atom_name} ) << " is not defined." << "\n"
+                        << "    n_vdw_type = " << this->n_vdw_type << "\n";
+                    throw std::out_of_range(oss.str());
+                }
+                return itr->second;
+            }
+
+            inline const CoefLJ& getCoefLJ(const PS::S32 type_i, const PS::S32 type_j) const {
+                return this->vdw_matrix[type_i*this->n_vdw_type + type_j];
+            }
+
+            //--- set LJ type index into local particles.
+            template <class Tpsys>
+            void setVDWType(Tpsys &atom) const {
+                const PS::S64 n_local = atom.getNumberOfParticleLocal();
+                for(PS::S64 i=0; i<n_local; ++i){
+                    atom[i].setVDWType( this->getVDWType(atom[i].getMolType(),
+                                                         atom[i].getAtomType()) );
+                }
+            }
+
             void broadcast(const PS::S32 root = 0){
                 COMM_TOOL::broadcast(this->mask_scaling, root);
                 COMM_TOOL::broadcast(this->residue     , root);
+                COMM_TOOL::broadcast(this->atom        , root);
+                COMM_TOOL::broadcast(this->vdw_pair    , root);
                 COMM_TOOL::broadcast(this->bond        , root);
                 COMM_TOOL::broadcast(this->angle       , root);
                 COMM_TOOL::broadcast(this->torsion     , root);
+                COMM_TOOL::broadcast(this->constraint  , root);
+                COMM_TOOL::broadcast(this->mol_atom    , root);
+
+                this->make_vdw_matrix();
+                this->make_mask_scale();
+                this->make_water_kernel_flag();
             }
             void clear(){
                 this->mask_scaling.clear();
                 this->residue.clear();
-                this->residue.clear();
+                this->atom.clear();
+                this->vdw_pair.clear();
                 this->bond.clear();
                 this->angle.clear();
                 this->torsion.clear();
+                this->constraint.clear();
+                this->vdw_type.clear();
+                this->vdw_matrix.clear();
+                this->n_vdw_type = 0;
+                this->mask_scale.clear();
+                this->mol_atom.clear();
+                this->water_kernel.clear();
             }
         };
     }
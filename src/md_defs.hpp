@@ -8,6 +8,7 @@
 
 #include <vector>
 #include <string>
+#include <stdexcept>
 
 #include <particle_simulator.hpp>
 
@@ -27,6 +28,25 @@ namespace MD_DEFS {
 
     constexpr size_t max_bond = 4;
 
+    //--- lower limit of the range of FORCE::force_table [angstrom]
+    constexpr PS::F64 force_table_r_min = 0.5;
+
+    //--- intramolecular mask encoded into bits (inline evaluation in PP kernel)
+    //------ 2 bits mask level (0: no mask, 1~3) for each relative atom ID in [-16, -1] and [1, 16].
+    //------ the mask out of this range is evaluated in FORCE::calcForceIntraMask().
+    constexpr PS::S64 mask_bits_range     = 16;
+    constexpr PS::S32 mask_bits_max_level = 3;
+
+    //! @brief bit position of the relative atom ID: [-16, -1] -> [0, 15], [1, 16] -> [16, 31] (2 bits/slot).
+    inline PS::S64 mask_bits_slot(const PS::S64 d_id){
+        return d_id + mask_bits_range - (d_id > 0 ? 1 : 0);
+    }
+
+    //--- 3-site water kernel (molecule-pair interaction in PP kernel)
+    //------ upper limit of the distance between the 1st site and other sites [angstrom].
+    //------ the molecule out of this limit (or partially found in EPJ) is evaluated by the generic kernel.
+    constexpr PS::F64 water_site_r_max = 1.5;
+
     using ID_type  = PS::S64;
 
     struct IntraMask{
@@ -95,11 +115,42 @@ namespace MD_DEFS {
     using AngleList   = typename std::vector<AngleSet>;
     using TorsionList = typename std::vector<TorsionSet>;
 
+    //! @brief read only view of the list in packed array (see AtomIntraMask::IntraListTable).
+    template <class T>
+    class ListView {
+    private:
+        const T *ptr_begin = nullptr;
+        const T *ptr_end   = nullptr;
+
+    public:
+        ListView() = default;
+        ListView(const T *ptr_begin, const T *ptr_end){
+            this->ptr_begin = ptr_begin;
+            this->ptr_end   = ptr_end;
+        }
+
+        inline const T* begin() const { return this->ptr_begin; }
+        inline const T* end()   const { return this->ptr_end;   }
+        inline size_t   size()  const { return static_cast<size_t>(this->ptr_end - this->ptr_begin); }
+        inline bool     empty() const { return this->ptr_begin == this->ptr_end; }
+
+        inline const T& operator [] (const size_t i) const { return this->ptr_begin[i]; }
+        const T& at(const size_t i) const {
+            if(i >= this->size()) throw std::out_of_range("MD_DEFS::ListView::at(): index is out of range.");
+            return this->ptr_begin[i];
+        }
+    };
+
+    using MaskView    = ListView<IntraMask>;
+    using AngleView   = ListView<AngleSet>;
+    using TorsionView = ListView<TorsionSet>;
+
 
     //--- mask interface
-    //! @brief search interface for mask list.
+    //! @brief search interface for mask list (MaskList or MaskView).
     //! @return IntraMask.id = -1 means "not found". AtomID must be >= 0.
-    IntraMask find_mask(const MaskList &list, const ID_type id){
+    template <class Tlist>
+    IntraMask find_mask(const Tlist &list, const ID_type id){
         auto itr = std::find_if( list.begin(), list.end(),
                                  [id](const IntraMask &mask){ return mask.getId() == id; } );
         if(itr == list.end()){
@@ -110,7 +161,8 @@ namespace MD_DEFS {
     }
     //! @brief simple search interface for mask list.
     //! @return "true" means the id found in mask list.
-    bool isFind_mask(const MaskList &list, const ID_type id){
+    template <class Tlist>
+    bool isFind_mask(const Tlist &list, const ID_type id){
         auto itr = std::find_if( list.begin(), list.end(),
                                  [id](const IntraMask &mask){ return mask.getId() == id; } );
         if(itr == list.end()){
@@ -29,6 +29,8 @@
 #include "md_setting.hpp"
 //------ calculate interaction
 #include "md_force.hpp"
+//------ constraint for rigid bonds
+#include "atom_constraint.hpp"
 //------ system observer
 #include "observer.hpp"
 //------ external system control
@@ -56,10 +58,6 @@ int main(int argc, char* argv[]){
     }
 
 
-    //--- check for PS::ParticleMesh
-    if(PS::Comm::getNumberOfProc() < 2) throw std::logic_error("MPI proc must be >= 2. (for ParticleMesh extension of FDPS)");
-
-
     //--- make particle system object
     PS::DomainInfo              dinfo;
     PS::ParticleSystem<Atom_FP> atom;
@@ -87,7 +85,8 @@ int main(int argc, char* argv[]){
         for(size_t i=0; i<System::model_list.size(); ++i){
             MODEL::loading_model_parameter(ENUM::what(System::model_list.at(i).first),
                                            System::model_template.at(i),
-                                           MODEL::coef_table                          );
+                                           MODEL::coef_table,
+                                           System::get_HMR_mass()                     );
         }
         //--- display settings
         Unit::print_unit();
@@ -123,12 +122,22 @@ int main(int argc, char* argv[]){
     dinfo.decomposeDomainAll(atom);
 
     atom.adjustPositionIntoRootDomain(dinfo);
-    atom.exchangeParticle(dinfo);
+    ATOM_MOVE::exchangeParticle(atom, dinfo, System::get_mol_exchange());
 
     //--- initialize force culculator
     PS::S64 n_total = atom.getNumberOfParticleGlobal();
     force.init(n_total);
 
+    //--- initialize constraint solver
+    CONSTRAINT::Solver constraint;
+    constraint.init(System::model_list,
+                    System::model_template,
+                    System::get_mol_exchange() );
+    if(PS::Comm::getRank() == 0) std::cout << constraint.str() << std::flush;
+    constraint.update(atom);
+    constraint.project(atom);
+    atom.adjustPositionIntoRootDomain(dinfo);
+
     //--- initialize observer
     Observer::Energy   eng;
     Observer::Property prop;
@@ -160,12 +169,11 @@ int main(int argc, char* argv[]){
         resume_file_mngr.record(atom, System::profile, ext_sys_controller);
 
         //--- get system property
-        eng.getEnergy(atom);
+        eng.getEnergy(atom, constraint.getNumberOfRigidLocal());
         prop.getProperty(eng);
 
         //--- affect external system controller
-        PS::S64 n_rigid = 0;
-        ext_sys_controller.apply(n_rigid,
+        ext_sys_controller.apply(constraint.getNumberOfRigidLocal(),
                                  ext_sys_sequence.getSetting( System::get_istep() ),
                                  System::get_dt(),
                                  atom,
@@ -179,20 +187,60 @@ int main(int argc, char* argv[]){
         eng_ave.record(  System::profile, eng );
         prop_ave.record( System::profile, prop );
 
-        //--- kick
+        //--- r-RESPA: the intermolecular force is kicked with dt, the intramolecular force with dt/n_respa.
+        //------ n_respa = 1 is the normal velocity Verlet integrator.
+        const PS::S32    n_respa    = System::get_n_respa();
+        const PS::F64    dt_inner   = System::get_dt()/static_cast<PS::F64>(n_respa);
+        const RESPA_MODE inner_mode = (n_respa > 1) ? RESPA_MODE::intra : RESPA_MODE::all;
+
+        //--- the constraint virial is accumulated over the step. each correction is weighted by its interval/dt.
+        const PS::F64 w_inner = dt_inner/System::get_dt();
+        constraint.clearVirial(atom);
+
+        //--- the long-range part of coulomb is evaluated every cycle_LR steps, applied as impulse at the both ends of cycle.
+        const bool    LR_enable = (System::get_coulomb_mode() != COULOMB_MODE::DSF);
+        const bool    LR_update = System::isLRUpdate();
+        const PS::F64 dt_LR     = System::get_dt()*static_cast<PS::F64>(System::get_cycle_LR());
+
+        //--- kick (long-range impulse)
+        if(LR_enable && System::isLRCycleBegin()) ext_sys_controller.kick(0.5*dt_LR, atom, RESPA_MODE::long_range);
+
+        //--- kick (outer)
+        if(n_respa > 1) ext_sys_controller.kick(0.5*System::get_dt(), atom, RESPA_MODE::inter);
+
+        //--- inner steps (intramolecular force only)
+        //------ the particles are not exchanged, the intra pair lists are kept.
+        for(PS::S32 i_respa=1; i_respa<n_respa; ++i_respa){
+            ext_sys_controller.kick(0.5*dt_inner, atom, RESPA_MODE::intra);
+
+            constraint.setReference(atom);
+            ATOM_MOVE::drift(dt_inner, atom);
+            constraint.applyPosition(dt_inner, atom, w_inner);
+            atom.adjustPositionIntoRootDomain(dinfo);
+
+            force.update_intra_force(atom, dinfo);
+
+            ext_sys_controller.kick(0.5*dt_inner, atom, RESPA_MODE::intra);
+            constraint.applyVelocity(dt_inner, atom, w_inner);
+        }
+
+        //--- kick (last inner step)
         //ATOM_MOVE::kick(0.5*System::get_dt(), atom);
-        ext_sys_controller.kick(0.5*System::get_dt(), atom);
+        ext_sys_controller.kick(0.5*dt_inner, atom, inner_mode);
 
         //--- drift
-        ATOM_MOVE::drift(System::get_dt(), atom);
+        constraint.setReference(atom);
+        ATOM_MOVE::drift(dt_inner, atom);
         //ext_sys_controller.drift(System::get_dt(), atom);
+        constraint.applyPosition(dt_inner, atom, w_inner);
         atom.adjustPositionIntoRootDomain(dinfo);
 
         #ifdef REUSE_INTERACTION_LIST
             //--- update domain info & exchange particle
             if( System::isDinfoUpdate() ){
                 dinfo.decomposeDomainAll(atom);
-                atom.exchangeParticle(dinfo);
+                ATOM_MOVE::exchangeParticle(atom, dinfo, System::get_mol_exchange());
+                constraint.update(atom);
 
                 /*
                 if(PS::Comm::getRank() == 0){
@@ -205,23 +253,37 @@ int main(int argc, char* argv[]){
                 //--- update intra pair list after psys.echangeParticle()
                 force.update_intra_pair_list(atom, dinfo, MODEL::coef_table.mask_scaling);
 
-                force.update_force(atom, dinfo, PS::MAKE_LIST_FOR_REUSE);
+                force.update_force(atom, dinfo, PS::MAKE_LIST_FOR_REUSE, LR_update);
             } else {
-                force.update_force(atom, dinfo, PS::REUSE_LIST);
+                force.update_force(atom, dinfo, PS::REUSE_LIST, LR_update);
             }
         #else
             //--- update domain info & exchange particle
             dinfo.decomposeDomainAll(atom);  // perform at every step is requred by PS::ParticleMesh
-            atom.exchangeParticle(dinfo);    // perform at every step is requred by PS::ParticleMesh
+            ATOM_MOVE::exchangeParticle(atom, dinfo, System::get_mol_exchange());    // perform at every step is requred by PS::ParticleMesh
+            constraint.update(atom);
 
             //--- calculate intermolecular force in FDPS
             force.update_intra_pair_list(atom, dinfo, MODEL::coef_table.mask_scaling);
-            force.update_force(atom, dinfo, PS::MAKE_LIST);
+            force.update_force(atom, dinfo, PS::MAKE_LIST, LR_update);
         #endif
 
-        //--- kick
+        //--- kick (long-range impulse)
+        if(LR_enable && LR_update){
+            ext_sys_controller.kick(0.5*dt_LR, atom, RESPA_MODE::long_range);
+            if(System::get_cycle_LR() > 1) constraint.applyVelocity(dt_LR, atom, dt_LR/System::get_dt());
+        }
+
+        //--- kick (last inner step)
         //ATOM_MOVE::kick(0.5*System::get_dt(), atom);
-        ext_sys_controller.kick(0.5*System::get_dt(), atom);
+        ext_sys_controller.kick(0.5*dt_inner, atom, inner_mode);
+
+        //--- kick (outer)
+        if(n_respa > 1){
+            constraint.applyVelocity(dt_inner, atom, w_inner);
+            ext_sys_controller.kick(0.5*System::get_dt(), atom, RESPA_MODE::inter);
+        }
+        constraint.applyVelocity(System::get_dt(), atom);
 
         //--- nest step
         System::StepNext();
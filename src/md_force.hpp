@@ -6,15 +6,21 @@
 /**************************************************************************************************/
 #pragma once
 
+#include <memory>
+
 #include <particle_simulator.hpp>
 #include <particle_mesh.hpp>
 #include <molecular_dynamics_ext.hpp>
 
 #include "atom_class.hpp"
 #include "md_coef_table.hpp"
+#include "ff_intra_topology.hpp"
 #include "ff_intra_force.hpp"
 #include "ff_inter_force.hpp"
+#include "ff_inter_tail.hpp"
 #include "ff_pm_wrapper.hpp"
+#include "ff_pm_local.hpp"
+#include "ff_tree_wrapper.hpp"
 #include "md_setting.hpp"
 
 
@@ -27,27 +33,38 @@ private:
     PS::TreeForForceShort<ForceInter<PS::F64>, EP_inter, EP_inter>::Scatter tree_inter;
     PS::TreeForForceShort<ForceIntra<PS::F64>, EP_intra, EP_intra>::Scatter tree_intra;
 
-    //--- ParticleMesh
+    //--- long-range backend. only the backend in use is constructed in init().
+    //------ ParticleMesh
     #ifdef REUSE_INTERACTION_LIST
-        FORCE::PM::CalcForceParticleMesh pm;
+        using PM_type = FORCE::PM::CalcForceParticleMesh;
     #else
-        FORCE::PM::ParticleMesh pm;
+        using PM_type = FORCE::PM::ParticleMesh;
     #endif
+    std::unique_ptr<PM_type> pm;
 
-    //--- intra pair list maker
-    struct GetBond {
-        MD_EXT::basic_connect<MD_DEFS::ID_type,
-                              MD_DEFS::max_bond> operator () (const AtomConnect &atom){
-            return atom.bond;
-        }
-    };
-    IntraPair::IntraMaskMaker<  MD_DEFS::ID_type, GetBond> intra_mask_maker;
-    IntraPair::AngleListMaker<  MD_DEFS::ID_type, GetBond> angle_list_maker;
-    IntraPair::TorsionListMaker<MD_DEFS::ID_type, GetBond> torsion_list_maker;
+    //------ process-local PM for single process execution (PS::ParticleMesh requires MPI proc >= 2)
+    std::unique_ptr<FORCE::PM::LocalParticleMesh> pm_local;
+
+    //------ long-range tree for shifted-force coulomb with large cut off (SF_TREE mode)
+    std::unique_ptr<FORCE::TREE::CalcForceShiftedForceTree> tree_lr;
+
+    //--- intra pair list from molecular model template
+    FORCE::IntraTopology  intra_topology;
+    FORCE::IntraSlotTable intra_slot_table;
+
+    //--- local EPJ for intramolecular force with whole molecule exchange (used instead of tree_intra)
+    FORCE::IntraLocalEpj<EP_intra> intra_local_epj;
 
     //--- result buffer
     std::vector<ForceInter<PS::F64>> inter_force_buff;
 
+    //--- tree_inter holds the ghost snapshot of current step (set in update_inter_force*(), consumed in update_intra_force())
+    //------ not set with PS::REUSE_LIST: the tree is not rebuilt and the ghost positions are stale.
+    bool inter_ghost_ready = false;
+
+    //--- LJ type index in atoms and populations in FORCE::lj_tail are set at first call
+    bool vdw_type_ready = false;
+
 public:
     void init(const PS::S64 &n_total){
         this->tree_inter.initialize(n_total,
@@ -59,18 +76,74 @@ public:
                                     System::profile.n_leaf_limit,
                                     System::profile.n_group_limit);
 
-        FORCE::PM::checkMeshSize(n_total);
+        if(System::get_coulomb_mode() == COULOMB_MODE::PM){
+            FORCE::PM::checkMeshSize(n_total);
+            if(PS::Comm::getNumberOfProc() == 1){
+                this->pm_local.reset(new FORCE::PM::LocalParticleMesh());
+            } else {
+                this->pm.reset(new PM_type());
+            }
+        }
+        if(System::get_coulomb_mode() == COULOMB_MODE::SF_TREE){
+            this->tree_lr.reset(new FORCE::TREE::CalcForceShiftedForceTree());
+            this->tree_lr->init(n_total,
+                                System::get_tree_theta(),
+                                System::profile.n_leaf_limit,
+                                System::profile.n_group_limit);
+        }
+    }
+
+    /**
+    * @brief long-range part of coulomb interaction. PM and tree backend have the same interface.
+    */
+    template <class Tlr, class Tpsys, class Tdinfo>
+    void calc_long_range(Tlr    &lr,
+                         Tpsys  &atom,
+                         Tdinfo &dinfo){
+        lr.setDomainInfoParticleMesh(dinfo);
+        lr.setParticleParticleMesh(atom, true);   // clear previous charge information
+        lr.calcMeshForceOnly();
+        lr.writeBackForce(atom);
     }
 
     /**
     * @brief update cutoff length in normalized space.
     */
     void setRcut(){
-        EP_inter::setR_cut_LJ(      Normalize::normCutOff( System::get_cut_off_LJ() ) );
-        EP_inter::setR_cut_coulomb( Normalize::normCutOff_PM() );
+        const bool DSF = (System::get_coulomb_mode() == COULOMB_MODE::DSF);
+
+        EP_inter::setR_cut_LJ( Normalize::normCutOff( System::get_cut_off_LJ() ) );
+        if(DSF){
+            EP_inter::setR_cut_coulomb( Normalize::normCutOff( System::get_cut_off_coulomb() ) );
+        } else {
+            EP_inter::setR_cut_coulomb( Normalize::normCutOff_PM() );
+        }
 
         EP_intra::setR_cut( Normalize::normCutOff( System::get_cut_off_intra() ) );
 
+        //--- long-range tree (shifted-force at cut_off_coulomb)
+        const bool SF_TREE = (System::get_coulomb_mode() == COULOMB_MODE::SF_TREE);
+        if(SF_TREE && this->tree_lr){
+            this->tree_lr->setRcut( EP_inter::getRcut_coulomb(),
+                                    Normalize::normCutOff( System::get_cut_off_coulomb() ) );
+        }
+        FORCE::coulomb_tree_shift.init( SF_TREE, System::get_cut_off_coulomb() );
+
+        //--- DSF coulomb (disabled in PM mode)
+        Atom_FP::setVirialPairwise(DSF || SF_TREE);
+        FORCE::coulomb_DSF.init( DSF,
+                                 System::get_DSF_alpha(),
+                                 System::get_cut_off_coulomb() );
+
+        //--- tabulated kernel (the PM table is in reduced variable, it is remaked only when rc exceeds the range)
+        if( FORCE::force_table.update( System::get_n_force_table(),
+                                       MD_DEFS::force_table_r_min,
+                                       System::get_cut_off_LJ(),
+                                       Normalize::realCutOff( EP_inter::getRcut_coulomb() ),
+                                       FORCE::coulomb_DSF                                   ) ){
+            if(PS::Comm::getRank() == 0) std::cout << FORCE::force_table.str_error() << std::flush;
+        }
+
         #ifdef REUSE_INTERACTION_LIST
             EP_inter::setR_margin( Normalize::normCutOff( 2.0 ) );
             EP_intra::setR_margin( Normalize::normCutOff( 2.0 ) );
@@ -84,8 +157,16 @@ public:
                 << "    EP_inter::getRcut_LJ() = " << EP_inter::getRcut_LJ() << "\n";
             throw std::length_error(oss.str());
         }
-        if(EP_intra::getRSearch() >= 0.5 ||
-           EP_intra::getRSearch() <= 0.0 ){
+        if(EP_inter::getRcut_coulomb() >= 0.5 ||
+           EP_inter::getRcut_coulomb() <= 0.0 ){
+            std::ostringstream oss;
+            oss << "RSearch for coulomb must be in range of (0.0, 0.5) at normalized space." << "\n"
+                << "    EP_inter::getRcut_coulomb() = " << EP_inter::getRcut_coulomb() << "\n";
+            throw std::length_error(oss.str());
+        }
+        if( !System::get_mol_exchange() &&
+            (EP_intra::getRSearch() >= 0.5 ||
+             EP_intra::getRSearch() <= 0.0 ) ){
             std::ostringstream oss;
             oss << "RSearch for intramolecuar force must be in range of (0.0, 0.5) at normalized space." << "\n"
                 << "    EP_intra::getRSearch() = " << EP_intra::getRSearch() << "\n";
@@ -101,41 +182,84 @@ public:
                                       Tdinfo                    &dinfo,
                                 const Tmask                     &mask_table){
 
-        //--- get neighbor EP_intra information (do not calculate force)
-        this->setRcut();
-        this->tree_intra.calcForceAll( IntraPair::dummy_func{},
-                                       atom,
-                                       dinfo                   );
-
-        const PS::S32 n_local = atom.getNumberOfParticleLocal();
+        //--- set LJ type index (index of MODEL::coef_table.vdw_matrix) and count atoms for each LJ type in LJ tail correction.
+        //------ the LJ type index is carried with the atom in exchange, the populations are conserved.
+        if( !this->vdw_type_ready ){
+            MODEL::coef_table.setVDWType(atom);
+            FORCE::lj_tail.update(atom, System::get_cut_off_LJ(), System::get_LJ_tail());
+            if(PS::Comm::getRank() == 0) std::cout << FORCE::lj_tail.str() << std::flush;
+            this->vdw_type_ready = true;
+        }
 
-        Tptcl::clear_intra_pair_table();
+        //--- make template lists at first call (the topology is fixed for each model)
+        if( !this->intra_topology.isInitialized() ){
+            this->intra_topology.init(System::model_list,
+                                      System::model_template,
+                                      mask_table             );
+        }
 
+        //--- update the packed intra pair lists indexed by local particle index.
+        //------ the lists of atoms staying in this process are reused, the maker is called for arrived atoms only.
+        auto maker = [&](const PS::S32               i,
+                               MD_DEFS::MaskList    &mask_list,
+                               MD_DEFS::AngleList   &angle_list,
+                               MD_DEFS::TorsionList &dihedral_list,
+                               MD_DEFS::TorsionList &improper_list){
+            this->intra_topology.makeList(atom[i], mask_list, angle_list, dihedral_list, improper_list);
+        };
+        Tptcl::update_intra_list_table(atom, maker);
+
+        //--- encode mask list into bits for inline evaluation in PP kernel, set site index for water kernel
+        //------ the staying atoms keep the result in FP.
+        const auto&   made_list = Tptcl::made_intra_list();
+        const PS::S32 n_made    = made_list.size();
         #ifdef PARTICLE_SIMULATOR_THREAD_PARALLEL
-            //--- clear & allocate
-            for(PS::S32 i=0; i<n_local; ++i){
-                atom[i].clear_intra_list();
-            }
+            #pragma omp parallel for
+        #endif
+        for(PS::S32 k=0; k<n_made; ++k){
+            const PS::S32 i = made_list[k];
+            atom[i].makeMaskBits();
+            atom[i].makeWaterSite();
+        }
+    }
+
+    /**
+    * @brief   update long-range part of coulomb interaction on atom (tree in SF_TREE mode, nothing in DSF mode).
+    * @details the result is stored in ForceLongRange of atom, separated from the PP part.
+    *          it can be kept for several steps and applied as impulse (see ATOM_MOVE::kick() with RESPA_MODE::long_range).
+    */
+    template <class Tpsys, class Tdinfo>
+    void update_long_range(Tpsys  &atom,
+                           Tdinfo &dinfo){
+
+        //--- clear long-range part
+        const PS::S64 n_local = atom.getNumberOfParticleLocal();
 
-            //--- search pair
+        #ifdef PARTICLE_SIMULATOR_THREAD_PARALLEL
             #pragma omp parallel for
-            for(PS::S32 i=0; i<n_local; ++i){
-                intra_mask_maker(  atom[i], this->tree_intra, mask_table.at(atom[i].getMolType()),
-                                                              atom[i].mask_list());
-                angle_list_maker(  atom[i], this->tree_intra, atom[i].angle_list());
-                torsion_list_maker(atom[i], this->tree_intra, atom[i].dihedral_list(), atom[i].improper_list());
-            }
-        #else
-            for(PS::S32 i=0; i<n_local; ++i){
-                atom[i].clear_intra_list();
-
-                intra_mask_maker(  atom[i], this->tree_intra, mask_table.at(atom[i].getMolType()),
-                                                              atom[i].mask_list());
-                angle_list_maker(  atom[i], this->tree_intra, atom[i].angle_list());
-                torsion_list_maker(atom[i], this->tree_intra, atom[i].dihedral_list(), atom[i].improper_list());
-            }
         #endif
+        for(PS::S64 i=0; i<n_local; ++i){
+            atom[i].clearForceLongRange();
+        }
+
+        this->setRcut();
 
+        switch (System::get_coulomb_mode()){
+            case COULOMB_MODE::PM:
+                if(this->pm_local){
+                    this->calc_long_range(*(this->pm_local), atom, dinfo);
+                } else {
+                    this->calc_long_range(*(this->pm), atom, dinfo);
+                }
+            break;
+
+            case COULOMB_MODE::SF_TREE:
+                this->calc_long_range(*(this->tree_lr), atom, dinfo);
+            break;
+
+            case COULOMB_MODE::DSF:
+            break;
+        }
     }
 
     /**
@@ -160,16 +284,27 @@ public:
 
         this->setRcut();
 
-        //--- get neighbor EP_intra information (do not calculate force)
-        this->tree_intra.calcForceAll( IntraPair::dummy_func{},
-                                       atom,
-                                       dinfo                   );  // remake list
-        //--- calculate force
-        FORCE::calcForceIntra(this->tree_intra, atom);
+        if( System::get_mol_exchange() ){
+            //--- all atoms of each molecule are in local process (see ATOM_MOVE::exchangeMolecule())
+            this->intra_local_epj.update(atom);
+            FORCE::calcForceIntra(this->intra_topology, this->intra_slot_table, this->intra_local_epj, atom);
+        } else if( this->inter_ghost_ready &&
+                   EP_intra::getRSearch() <= EP_inter::getRSearch() ){
+            //--- the ghost exchange of tree_inter covers the neighbors for intramolecular force
+            FORCE::calcForceIntra(this->intra_topology, this->intra_slot_table, this->tree_inter, atom);
+        } else {
+            //--- get neighbor EP_intra information (do not calculate force)
+            this->tree_intra.calcForceAll( IntraPair::dummy_func{},
+                                           atom,
+                                           dinfo                   );  // remake list
+            //--- calculate force
+            FORCE::calcForceIntra(this->intra_topology, this->intra_slot_table, this->tree_intra, atom);
+        }
+        this->inter_ghost_ready = false;
     }
 
     /**
-    * @brief update intermolecular force on atom (naive version).
+    * @brief update intermolecular force on atom (naive version, PP part only).
     */
     template <class Tpsys, class Tdinfo>
     void update_inter_force_naive(      Tpsys                     &atom,
@@ -188,14 +323,6 @@ public:
 
         this->setRcut();
 
-        //=================
-        // PM part
-        //=================
-        this->pm.setDomainInfoParticleMesh(dinfo);
-        this->pm.setParticleParticleMesh(atom, true);   // clear previous charge information
-        this->pm.calcMeshForceOnly();
-        this->pm.writeBackForce(atom);
-
         //=================
         // PP part
         //=================
@@ -204,6 +331,7 @@ public:
                                       dinfo,
                                       true,
                                       reuse_mode);
+        this->inter_ghost_ready = (reuse_mode != PS::REUSE_LIST);
         for(PS::S64 i=0; i<n_local; ++i){
             const auto& result = tree_inter.getForce(i);
             atom[i].addPotLJ(        result.getPotLJ()        );
@@ -211,11 +339,12 @@ public:
             atom[i].addVirialLJ(     result.getVirialLJ()     );
             atom[i].addPotCoulomb(   result.getPotCoulomb()   );
             atom[i].addFieldCoulomb( result.getFieldCoulomb() );
+            atom[i].addVirialCoulomb(result.getVirialCoulomb());
         }
     }
 
     /**
-    * @brief   update intermolecular force on atom (optimized version).
+    * @brief   update intermolecular force on atom (optimized version, PP part only).
     * @details delayed evaluation for intramolecular mask. if blanch is removed in P-P calculater kernel.
     */
     template <class Tpsys, class Tdinfo>
@@ -251,32 +380,34 @@ public:
         this->setRcut();
 
         //=================
-        // PM part
-        //=================
-        this->pm.setDomainInfoParticleMesh(dinfo);
-        this->pm.setParticleParticleMesh(atom, true);   // clear previous charge information
-        this->pm.calcMeshForceOnly();
-        this->pm.writeBackForce(atom);
-
-        //=================
-        // PP part (without mask)
+        // PP part (with mask encoded in bits)
         //=================
-        this->tree_inter.calcForceAll(FORCE::calcForceShort{},
-                                      atom,
-                                      dinfo,
-                                      true,
-                                      reuse_mode);
+        if( FORCE::force_table.isEnable() ){
+            this->tree_inter.calcForceAll(FORCE::calcForceShort_table{},
+                                          atom,
+                                          dinfo,
+                                          true,
+                                          reuse_mode);
+        } else {
+            this->tree_inter.calcForceAll(FORCE::calcForceShort{},
+                                          atom,
+                                          dinfo,
+                                          true,
+                                          reuse_mode);
+        }
+        this->inter_ghost_ready = (reuse_mode != PS::REUSE_LIST);
         for(PS::S64 i=0; i<n_local; ++i){
             const auto& result = tree_inter.getForce(i);
                   auto& buf    = this->inter_force_buff.at(i);
             buf.addFieldCoulomb( result.getFieldCoulomb() );
             buf.addPotCoulomb(   result.getPotCoulomb()   );
+            buf.addVirialCoulomb(result.getVirialCoulomb());
             buf.addForceLJ(      result.getForceLJ()      );
             buf.addPotLJ(        result.getPotLJ()        );
             buf.addVirialLJ(     result.getVirialLJ()     );
         }
         //=================
-        // PP part (evaluate mask)
+        // PP part (evaluate mask not encoded in bits)
         //=================
         FORCE::calcForceIntraMask(this->tree_inter,
                                   atom,
@@ -292,6 +423,7 @@ public:
             const auto& buf = this->inter_force_buff[i];
             atom[i].addFieldCoulomb( buf.getFieldCoulomb() );
             atom[i].addPotCoulomb(   buf.getPotCoulomb()   );
+            atom[i].addVirialCoulomb(buf.getVirialCoulomb());
             atom[i].addForceLJ(      buf.getForceLJ()      );
             atom[i].addPotLJ(        buf.getPotLJ()        );
             atom[i].addVirialLJ(     buf.getVirialLJ()     );
@@ -300,24 +432,30 @@ public:
 
     /**
     * @brief update force on atom (naive version).
+    * @param[in] long_range if false, the long-range part of coulomb is kept from the previous evaluation.
     */
     template <class Tpsys, class Tdinfo>
     void update_force_naive(      Tpsys                     &atom,
                                   Tdinfo                    &dinfo,
-                            const PS::INTERACTION_LIST_MODE  reuse_mode = PS::MAKE_LIST){
+                            const PS::INTERACTION_LIST_MODE  reuse_mode = PS::MAKE_LIST,
+                            const bool                       long_range = true){
 
+        if(long_range) this->update_long_range(atom, dinfo);
         this->update_inter_force_naive(atom, dinfo, reuse_mode);
         this->update_intra_force(      atom, dinfo);
     }
 
     /**
     * @brief update force on atom (optimized version).
+    * @param[in] long_range if false, the long-range part of coulomb is kept from the previous evaluation.
     */
     template <class Tpsys, class Tdinfo>
     void update_force(      Tpsys                     &atom,
                             Tdinfo                    &dinfo,
-                      const PS::INTERACTION_LIST_MODE  reuse_mode = PS::MAKE_LIST){
+                      const PS::INTERACTION_LIST_MODE  reuse_mode = PS::MAKE_LIST,
+                      const bool                       long_range = true){
 
+        if(long_range) this->update_long_range(atom, dinfo);
         this->update_inter_force(atom, dinfo, reuse_mode);
         this->update_intra_force(atom, dinfo);
     }
@@ -53,7 +53,8 @@ int main(int argc, char *argv[]) {
         for(size_t i=0; i<System::model_list.size(); ++i){
             MODEL::loading_model_parameter(ENUM::what(System::model_list.at(i).first),
                                            System::model_template.at(i),
-                                           MODEL::coef_table                          );
+                                           MODEL::coef_table,
+                                           System::get_HMR_mass()                     );
         }
         System::print_profile();
         System::print_initializer_setting();
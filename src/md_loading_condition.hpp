@@ -8,6 +8,7 @@
 #include <string>
 #include <tuple>
 #include <cassert>
+#include <sstream>
 #include <stdexcept>
 
 #include <particle_simulator.hpp>
@@ -31,6 +32,7 @@ enum class CONDITION_LOAD_MODE : int {
     molecule,
     box,
     ex_radius,
+    mass,
 };
 
 //--- std::string converter for enum
@@ -47,6 +49,7 @@ namespace ENUM {
         {"MOLECULE"        , CONDITION_LOAD_MODE::molecule         },
         {"BOX"             , CONDITION_LOAD_MODE::box              },
         {"EX_RADIUS"       , CONDITION_LOAD_MODE::ex_radius        },
+        {"MASS"            , CONDITION_LOAD_MODE::mass             },
     };
 
     static const std::map<CONDITION_LOAD_MODE, std::string> table_CONDITION_LOAD_MODE_str{
@@ -60,6 +63,7 @@ namespace ENUM {
         {CONDITION_LOAD_MODE::molecule        , "MOLECULE"         },
         {CONDITION_LOAD_MODE::box             , "BOX"              },
         {CONDITION_LOAD_MODE::ex_radius       , "EX_RADIUS"        },
+        {CONDITION_LOAD_MODE::mass            , "MASS"             },
     };
 
     CONDITION_LOAD_MODE which_CONDITION_LOAD_MODE(const std::string &str){
@@ -137,6 +141,10 @@ namespace System {
                     }
                     if( str_list[0] == "i_end") System::profile.nstep_ed = std::stoi(str_list[1]);
                     if( str_list[0] == "dt")    System::profile.dt       = Unit::to_norm_time( std::stof(str_list[1]) );
+                    if( str_list[0] == "n_respa"){
+                        System::profile.n_respa = std::stoi(str_list[1]);
+                        if(System::profile.n_respa <= 0) throw std::invalid_argument("n_respa must be > 0.");
+                    }
                 break;
 
                 case CONDITION_LOAD_MODE::tree:
@@ -147,6 +155,7 @@ namespace System {
                     if( str_list[0] == "theta")         System::profile.theta         = std::stof(str_list[1]);
                     if( str_list[0] == "n_group_limit") System::profile.n_group_limit = std::stoi(str_list[1]);
                     if( str_list[0] == "cycle_dinfo")   System::profile.cycle_dinfo   = std::stoi(str_list[1]);
+                    if( str_list[0] == "mol_exchange")  System::profile.mol_exchange  = std::stoi(str_list[1]);
                 break;
 
                 case CONDITION_LOAD_MODE::cut_off:
@@ -154,6 +163,17 @@ namespace System {
 
                     if( str_list[0] == "LJ")    System::profile.cut_off_LJ    = std::stof(str_list[1]);
                     if( str_list[0] == "intra") System::profile.cut_off_intra = std::stof(str_list[1]);
+                    if( str_list[0] == "table")   System::profile.n_force_table = std::stoi(str_list[1]);
+                    if( str_list[0] == "LJ_tail") System::profile.LJ_tail       = std::stoi(str_list[1]);
+
+                    if( str_list[0] == "coulomb")    System::profile.coulomb_mode    = ENUM::which_COULOMB_MODE(str_list[1]);
+                    if( str_list[0] == "coulomb_rc") System::profile.cut_off_coulomb = std::stof(str_list[1]);
+                    if( str_list[0] == "DSF_alpha")  System::profile.DSF_alpha       = std::stof(str_list[1]);
+                    if( str_list[0] == "tree_theta") System::profile.tree_theta      = std::stof(str_list[1]);
+                    if( str_list[0] == "cycle_LR"){
+                        System::profile.cycle_LR = std::stoi(str_list[1]);
+                        if(System::profile.cycle_LR <= 0) throw std::invalid_argument("cycle_LR must be > 0.");
+                    }
                 break;
 
                 case CONDITION_LOAD_MODE::ext_sys:
@@ -207,6 +227,25 @@ namespace System {
             }
         }
 
+        //--- the long-range impulse is closed at the end of each cycle_LR steps.
+        //------ the run and the resume file must not stop at the middle of the cycle.
+        const auto& prof = System::profile;
+        if(prof.coulomb_mode != COULOMB_MODE::DSF && prof.cycle_LR > 1){
+            std::ostringstream oss;
+            if( (prof.nstep_ed + 1 - prof.nstep_st) % prof.cycle_LR != 0 ){
+                oss << "the number of steps (i_end + 1 - i_start) must be a multiple of cycle_LR." << "\n"
+                    << "   i_start = " << prof.nstep_st << ", i_end = " << prof.nstep_ed
+                    << ", cycle_LR = " << prof.cycle_LR << "\n";
+            }
+            if( prof.resume_interval > 0 && prof.resume_start <= prof.nstep_ed &&
+                (prof.resume_interval % prof.cycle_LR != 0 || prof.nstep_st % prof.cycle_LR != 0) ){
+                oss << "resume_interval and i_start must be multiples of cycle_LR." << "\n"
+                    << "   resume_interval = " << prof.resume_interval << ", i_start = " << prof.nstep_st
+                    << ", cycle_LR = " << prof.cycle_LR << "\n";
+            }
+            if( !oss.str().empty() ) throw std::invalid_argument(oss.str());
+        }
+
         //--- initialize ext_sys controller
         controller.init(n_chain,
                         n_rep,
@@ -264,6 +303,15 @@ namespace System {
                     System::profile.try_limit = std::stoi(str_list[1]);
                 break;
 
+                case CONDITION_LOAD_MODE::mass:
+                    if( str_list.size() < 2) continue;
+
+                    if( str_list[0] == "HMR_mass"){
+                        System::profile.HMR_mass = std::stod(str_list[1]);
+                        if(System::profile.HMR_mass < 0.0) throw std::invalid_argument("HMR_mass must be >= 0.0.");
+                    }
+                break;
+
                 default:
                     std::cerr << "  file: " << file_name << std::endl;
                     throw std::invalid_argument("undefined loading mode: " + ENUM::what(mode));
@@ -29,6 +29,13 @@ namespace MODEL {
 
         static const std::string scaling_LJ_tag      = "scaling_LJ";
         static const std::string scaling_coulomb_tag = "scaling_coulomb";
+
+        static const std::string constraint_solver_tag = "solver";
+        static const std::string lincs_order_tag       = "lincs_order";
+        static const std::string lincs_iter_tag        = "lincs_iter";
+
+        //--- upper limit of hydrogen mass in the original model for HMR [g/mol]. (H, D, and T)
+        static const PS::F64 HMR_hydrogen_limit = 3.5;
     }
 }
 
@@ -41,6 +48,8 @@ enum class MOL2_LOAD_MODE : int {
     torsion,
     SUBSTRUCTURE,
     scaling,
+    vdw_pair,
+    constraint,
 };
 
 //--- std::string converter for enum
@@ -53,7 +62,9 @@ namespace ENUM {
         {"ANGLE"       , MOL2_LOAD_MODE::angle       },
         {"TORSION"     , MOL2_LOAD_MODE::torsion     },
         {"SUBSTRUCTURE", MOL2_LOAD_MODE::SUBSTRUCTURE},
-        {"SCALING"     , MOL2_LOAD_MODE::scaling  },
+        {"SCALING"     , MOL2_LOAD_MODE::scaling     },
+        {"VDW_PAIR"    , MOL2_LOAD_MODE::vdw_pair    },
+        {"CONSTRAINT"  , MOL2_LOAD_MODE::constraint  },
     };
 
     static const std::map<MOL2_LOAD_MODE, std::string> table_MOL2_LOAD_MODE_str{
@@ -64,6 +75,8 @@ namespace ENUM {
         {MOL2_LOAD_MODE::torsion     , "TORSION"     },
         {MOL2_LOAD_MODE::SUBSTRUCTURE, "SUBSTRUCTURE"},
         {MOL2_LOAD_MODE::scaling     , "SCALING"     },
+        {MOL2_LOAD_MODE::vdw_pair    , "VDW_PAIR"    },
+        {MOL2_LOAD_MODE::constraint  , "CONSTRAINT"  },
     };
 
     MOL2_LOAD_MODE which_MOL2_LOAD_MODE(const std::string &str){
@@ -115,6 +128,7 @@ namespace MODEL {
         Atom_FP atom_tmp;
         atom_tmp.setAtomID(std::stoi(str_list[0])-1);
         atom_tmp.setMolID(-1);   // this is parameter table. not real atom.
+        atom_tmp.setTemplateIndex(std::stoi(str_list[0])-1);
         atom_tmp.setAtomType(str_list[1]);
         atom_tmp.setMolType(model_name);
         atom_tmp.setPos( PS::F64vec{std::stod(str_list[2]),
@@ -279,6 +293,34 @@ namespace MODEL {
         residue_table[key_atom] = str_list[1];
     }
 
+    template<class Ttable_vdw_pair>
+    void loading_param_vdw_pair(const std::string              &model_name,
+                                const std::vector<std::string> &str_list,
+                                      Ttable_vdw_pair          &vdw_pair_table){
+        MODEL::CoefVDWPair coef_pair;
+        MODEL::KeyVDWPair  key_pair;
+
+        //--- check format: 5 parameters. (atom_i, model_j, atom_j, vdw_d, vdw_r)
+        if( str_list.size() < 5 ) return;
+
+        coef_pair.vdw_d = std::stod(str_list[3]);
+        coef_pair.vdw_r = std::stod(str_list[4]);
+        if(coef_pair.vdw_d < 0.0 || coef_pair.vdw_r <= 0.0){
+            throw std::invalid_argument("vdw_d must be >= 0.0 and vdw_r must be > 0.0 in VDW_PAIR.");
+        }
+
+        key_pair = std::make_tuple( ENUM::which_MolName(model_name),
+                                    ENUM::which_AtomName(str_list[0]),
+                                    ENUM::which_MolName(str_list[1]),
+                                    ENUM::which_AtomName(str_list[2]) );
+
+        //--- check duplication
+        if( vdw_pair_table.find(key_pair) != vdw_pair_table.cend() ){
+            std::cerr << "WARNING: 'coef_vdw_pair' of " << ENUM::what(key_pair) << " is overloaded." << std::endl;
+        }
+        vdw_pair_table[key_pair] = coef_pair;
+    }
+
     template<class Ttable_bond>
     void loading_param_bond(const std::string              &model_name,
                             const std::vector<std::string> &str_list,
@@ -311,6 +353,10 @@ namespace MODEL {
             coef_bond.r0   = std::stod(str_list[3]);
             coef_bond.k    = std::stod(str_list[4]);
             coef_bond.a    = std::stod(str_list[5]);
+        } else if(func_form == IntraFuncForm::constraint){
+            if( str_list.size() < 4) throw std::invalid_argument("invalid format for constraint bond.");
+            coef_bond.form = func_form;
+            coef_bond.r0   = std::stod(str_list[3]);
         } else {
             throw std::invalid_argument("undefined form of bond potential.");
         }
@@ -355,6 +401,11 @@ namespace MODEL {
             coef_angle.form   = ENUM::which_IntraFuncForm(str_list[3]);
             coef_angle.theta0 = std::stod(str_list[4])*Unit::pi/180.0;                           // [degree] -> [rad]
             coef_angle.k      = std::stod(str_list[5])/std::pow(std::sin(coef_angle.theta0),2);  // make [kcal/mol rad^2]/sin(theta0)^2
+        } else if(func_form == IntraFuncForm::constraint){
+            if( str_list.size() < 5 ) throw std::invalid_argument("invalid format for angle constraint.");
+
+            coef_angle.form   = func_form;
+            coef_angle.theta0 = std::stod(str_list[4])*Unit::pi/180.0;                           // [degree] -> [rad]
         } else {
             throw std::invalid_argument("undefined form of angle potential.");
         }
@@ -482,17 +533,44 @@ namespace MODEL {
         }
     }
 
-    template<class Ttable_atom, class Ttable_res,
+    template <class Ttable_constraint>
+    void loading_param_constraint(const std::string              &model_name,
+                                  const std::vector<std::string> &str_list,
+                                        Ttable_constraint        &constraint_table){
+
+        //--- check format: total 2 parameters in line.
+        if(str_list.size() < 2) return;
+
+        auto &coef_constraint = constraint_table[ ENUM::which_MolName(model_name) ];
+
+        if(       str_list[0] == DEFS::constraint_solver_tag){
+            coef_constraint.solver = ENUM::which_ConstraintSolver(str_list[1]);
+        } else if(str_list[0] == DEFS::lincs_order_tag){
+            if( !STR_TOOL::isInteger(str_list[1]) ) throw std::invalid_argument("lincs_order must be integer.");
+            coef_constraint.lincs_order = std::stoi(str_list[1]);
+            if(coef_constraint.lincs_order < 1) throw std::invalid_argument("lincs_order must be >= 1.");
+        } else if(str_list[0] == DEFS::lincs_iter_tag){
+            if( !STR_TOOL::isInteger(str_list[1]) ) throw std::invalid_argument("lincs_iter must be integer.");
+            coef_constraint.lincs_iter = std::stoi(str_list[1]);
+            if(coef_constraint.lincs_iter < 0) throw std::invalid_argument("lincs_iter must be >= 0.");
+        } else {
+            throw std::invalid_argument("undefined setting in CONSTRAINT: " + str_list[0]);
+        }
+    }
+
+    template<class Ttable_atom, class Ttable_vdw_pair, class Ttable_res,
              class Ttable_bond, class Ttable_angle, class Ttable_torsion,
-             class Ttable_scaling>
-    void loading_param_file(const std::string    &model_name,
-                            const std::string    &file_name,
-                                  Ttable_atom    &atom_table,
-                                  Ttable_res     &residue_table,
-                                  Ttable_bond    &bond_table,
-                                  Ttable_angle   &angle_table,
-                                  Ttable_torsion &torsion_table,
-                                  Ttable_scaling &scaling_table ){
+             class Ttable_scaling, class Ttable_constraint>
+    void loading_param_file(const std::string       &model_name,
+                            const std::string       &file_name,
+                                  Ttable_atom       &atom_table,
+                                  Ttable_vdw_pair   &vdw_pair_table,
+                                  Ttable_res        &residue_table,
+                                  Ttable_bond       &bond_table,
+                                  Ttable_angle      &angle_table,
+                                  Ttable_torsion    &torsion_table,
+                                  Ttable_scaling    &scaling_table,
+                                  Ttable_constraint &constraint_table ){
 
         std::ifstream file_para{file_name};
         if(file_para.fail()) throw std::ios_base::failure("file: " + file_name + ".para was not found.");
@@ -533,6 +611,10 @@ namespace MODEL {
                         loading_param_atom(model_name, str_list, atom_table, residue_table);
                     break;
 
+                    case MOL2_LOAD_MODE::vdw_pair:
+                        loading_param_vdw_pair(model_name, str_list, vdw_pair_table);
+                    break;
+
                     case MOL2_LOAD_MODE::bond:
                         loading_param_bond(model_name, str_list, bond_table);
                     break;
@@ -549,6 +631,10 @@ namespace MODEL {
                         loading_param_scaling(model_name, str_list, scaling_table);
                     break;
 
+                    case MOL2_LOAD_MODE::constraint:
+                        loading_param_constraint(model_name, str_list, constraint_table);
+                    break;
+
                     default:
                         throw std::invalid_argument("undefined loading mode.");
                 }
@@ -565,20 +651,76 @@ namespace MODEL {
         }
     }
 
+    /**
+    * @brief   hydrogen mass repartitioning (HMR).
+    * @details the mass of each hydrogen is increased up to HMR_mass, the same amount is subtracted from the bonded heavy atom.
+    *          the total mass of the molecule is conserved.
+    *          the hydrogen is detected by the original mass (< DEFS::HMR_hydrogen_limit).
+    * @param[in] HMR_mass target mass of hydrogen [g/mol]. HMR is not applied for HMR_mass <= 0.
+    */
+    template <class Tptcl>
+    void repartition_hydrogen_mass(const std::string        &model_name,
+                                         std::vector<Tptcl> &atom_list,
+                                   const PS::F64             HMR_mass){
+
+        if(HMR_mass <= 0.0) return;
+
+        const PS::F64 m_H_target = 1.e-3*HMR_mass/Unit::mass_C;
+        const PS::F64 m_H_limit  = 1.e-3*DEFS::HMR_hydrogen_limit/Unit::mass_C;
+
+        std::vector<bool> is_hydrogen;
+        is_hydrogen.reserve(atom_list.size());
+        for(const auto& atom : atom_list){
+            is_hydrogen.push_back( atom.getMass() < m_H_limit );
+        }
+
+        for(size_t i=0; i<atom_list.size(); ++i){
+            if( !is_hydrogen[i] ) continue;
+
+            //--- the heavy atom bonded to the hydrogen (skip H2 or isolated hydrogen)
+            PS::S64 j_heavy = -1;
+            for(const auto j : atom_list[i].bond){
+                if( !is_hydrogen.at(j) ){
+                    j_heavy = j;
+                    break;
+                }
+            }
+            if(j_heavy < 0) continue;
+
+            const PS::F64 dm = m_H_target - atom_list[i].getMass();
+            if(dm <= 0.0) continue;
+
+            atom_list[i      ].setMass( m_H_target );
+            atom_list[j_heavy].setMass( atom_list[j_heavy].getMass() - dm );
+        }
+
+        //--- the heavy atom must be heavier than hydrogen after repartitioning
+        for(size_t i=0; i<atom_list.size(); ++i){
+            if( is_hydrogen[i] ) continue;
+            if( atom_list[i].getMass() <= m_H_target ){
+                std::ostringstream oss;
+                oss << "HMR_mass is too large for the model: " << model_name << "\n"
+                    << "   HMR_mass = " << HMR_mass << " [g/mol]"
+                    << ", mass of " << ENUM::what(atom_list[i].getAtomType())
+                    << " (local ID = " << i << ") becomes " << 1.e3*atom_list[i].getMass()*Unit::mass_C << " [g/mol]" << "\n";
+                throw std::invalid_argument(oss.str());
+            }
+        }
+    }
+
+    /**
+    * @param[in] HMR_mass target mass of hydrogen [g/mol] for hydrogen mass repartitioning. 0: not applied.
+    */
     template<class Tptcl, class TCoefTable>
     void loading_model_parameter(const std::string        &model_name,
                                        std::vector<Tptcl> &atom_list,
-                                       TCoefTable         &coef_table){
+                                       TCoefTable         &coef_table,
+                                 const PS::F64             HMR_mass = 0.0){
 
         std::string file_name;
 
-        //--- temporary table for intermolecular parameter
-        std::unordered_map< KeyAtom,
-                            CoefAtom,
-                            hash_tuple::hash_func<KeyAtom>> atom_table;
-
-        //--- setting the load factor of std::unordered_map
-        atom_table.max_load_factor(0.7);
+        //--- table for intermolecular parameter
+        auto& atom_table = coef_table.atom;
 
         //--- loading ****.mol2 file
         if(model_name.find_first_of("/") != std::string::npos){
@@ -596,6 +738,13 @@ namespace MODEL {
             throw;
         }
 
+        //--- atom name list of the model (in order of local ID)
+        auto& mol_atom = coef_table.mol_atom[ ENUM::which_MolName(model_name) ];
+        mol_atom.clear();
+        for(const auto& atom : atom_list){
+            mol_atom.push_back( atom.getAtomType() );
+        }
+
         //--- loading ****.param file
         if(model_name.find_first_of("/") != std::string::npos){
             file_name = model_name + DEFS::ext_param_file;
@@ -606,11 +755,13 @@ namespace MODEL {
             loading_param_file(model_name,
                                file_name,
                                atom_table,
+                               coef_table.vdw_pair,
                                coef_table.residue,
                                coef_table.bond,
                                coef_table.angle,
                                coef_table.torsion,
-                               coef_table.mask_scaling);
+                               coef_table.mask_scaling,
+                               coef_table.constraint);
         }
         catch(...){
             std::cerr << "ERROR at loading file: " << file_name << std::endl;
@@ -672,6 +823,9 @@ namespace MODEL {
             }
             throw std::invalid_argument(oss.str());
         }
+
+        //--- hydrogen mass repartitioning (the model template has the repartitioned mass)
+        repartition_hydrogen_mass(model_name, atom_list, HMR_mass);
     }
 
 
@@ -7,6 +7,8 @@
 #include <sstream>
 #include <iomanip>
 #include <vector>
+#include <string>
+#include <map>
 #include <cassert>
 #include <stdexcept>
 
@@ -17,6 +19,53 @@
 #include "md_coef_table.hpp"
 
 
+//--- evaluation mode of coulomb interaction
+enum class COULOMB_MODE : int {
+    PM,     // PM-split (ParticleMesh + short-range part in PP kernel)
+    DSF,    // damped shifted force (PP kernel only, ParticleMesh is not used)
+    SF_TREE,   // shifted-force coulomb with large cut off, the smooth part is evaluated by FDPS long-range tree (no lattice sum)
+};
+
+namespace ENUM {
+
+    static const std::map<COULOMB_MODE, std::string> table_COULOMB_MODE_str{
+        {COULOMB_MODE::PM     , "PM"     },
+        {COULOMB_MODE::DSF    , "DSF"    },
+        {COULOMB_MODE::SF_TREE, "SF_TREE"},
+    };
+
+    static const std::map<std::string, COULOMB_MODE> table_str_COULOMB_MODE{
+        {"PM"     , COULOMB_MODE::PM     },
+        {"DSF"    , COULOMB_MODE::DSF    },
+        {"SF_TREE", COULOMB_MODE::SF_TREE},
+    };
+
+    std::string what(const COULOMB_MODE &e){
+        if(table_COULOMB_MODE_str.find(e) != table_COULOMB_MODE_str.end()){
+            return table_COULOMB_MODE_str.at(e);
+        } else {
+            using type_base = typename std::underlying_type<COULOMB_MODE>::type;
+            std::cerr << "  COULOMB_MODE: input = " << static_cast<type_base>(e) << std::endl;
+            throw std::out_of_range("undefined enum value in COULOMB_MODE.");
+        }
+    }
+
+    COULOMB_MODE which_COULOMB_MODE(const std::string &str){
+        if(table_str_COULOMB_MODE.find(str) != table_str_COULOMB_MODE.end()){
+            return table_str_COULOMB_MODE.at(str);
+        } else {
+            std::cerr << "  COULOMB_MODE: input = " << str << std::endl;
+            throw std::out_of_range("undefined enum value in COULOMB_MODE.");
+        }
+    }
+}
+
+inline std::ostream& operator << (std::ostream& s, const COULOMB_MODE &e){
+    s << ENUM::what(e);
+    return s;
+}
+
+
 namespace System {
 
     //--- setting data class: DO NOT contain pointer or container.
@@ -31,6 +80,7 @@ namespace System {
         PS::S64 nstep_st = -1;
         PS::S64 nstep_ed = -1;
         PS::F64 dt       = 0.0;
+        PS::S32 n_respa  = 1;    // number of inner steps for intramolecular force in r-RESPA (1: velocity Verlet)
 
         //--- for Tree
         PS::F32 coef_ema      = -1.0;
@@ -38,15 +88,32 @@ namespace System {
         PS::S32 n_leaf_limit  = -1;
         PS::S32 n_group_limit = -1;
         PS::S32 cycle_dinfo   = -1;
+        PS::S32 mol_exchange  = 0;    // 0: exchange each atom, 1: exchange whole molecule by its center of mass
 
         //--- for cut_off radius
         PS::F32 cut_off_LJ    = -1.0;
         PS::F32 cut_off_intra = -1.0;
 
+        //--- for tabulated short-range kernel (0: analytic kernel)
+        PS::S32 n_force_table = 0;
+
+        //--- for LJ long-range correction (0: off, 1: energy & pressure)
+        PS::S32 LJ_tail = 0;
+
+        //--- for coulomb interaction (cut_off_coulomb: DSF and SF_TREE mode, DSF_alpha: DSF mode, tree_theta: SF_TREE mode)
+        COULOMB_MODE coulomb_mode    = COULOMB_MODE::PM;
+        PS::F32      cut_off_coulomb = -1.0;
+        PS::F32      DSF_alpha       = 0.2;
+        PS::F32      tree_theta      = 0.5;
+        PS::S32      cycle_LR        = 1;      // interval steps of long-range part (PM and SF_TREE mode)
+
         //--- for installing molecule at initialize
         PS::F32 ex_radius = -1.0;
         PS::S32 try_limit = -1;
 
+        //--- for hydrogen mass repartitioning at model loading [g/mol] (0: off)
+        PS::F64 HMR_mass = 0.0;
+
         //--- for recording data
         PS::S64 pos_interval    = std::numeric_limits<PS::S64>::max();
         PS::S64 pos_start       = std::numeric_limits<PS::S64>::max();
@@ -64,6 +131,10 @@ namespace System {
 
         PS::S64 get_istep() const { return this->istep; }
         PS::F64 get_dt()    const { return this->dt;    }
+        PS::S32 get_n_respa() const {
+            assert(this->n_respa > 0);
+            return this->n_respa;
+        }
 
         //--- simulation time
         PS::F64 get_time_raw()                const { return this->time; }
@@ -81,14 +152,28 @@ namespace System {
 
         void    clear_trj_time() { this->time_trj = 0.0; }
 
+        //--- particle exchange
+        bool get_mol_exchange() const { return (this->mol_exchange != 0); }
+
         //--- cut off
         PS::F64 get_cut_off_intra() const { return this->cut_off_intra; }
         PS::F64 get_cut_off_LJ()    const { return this->cut_off_LJ;    }
+        PS::S32 get_n_force_table() const { return this->n_force_table; }
+        bool    get_LJ_tail()       const { return (this->LJ_tail != 0); }
+
+        COULOMB_MODE get_coulomb_mode()    const { return this->coulomb_mode;    }
+        PS::F64      get_cut_off_coulomb() const { return this->cut_off_coulomb; }
+        PS::F64      get_DSF_alpha()       const { return this->DSF_alpha;       }
+        PS::F64      get_tree_theta()      const { return this->tree_theta;      }
+        PS::S32      get_cycle_LR()        const { return this->cycle_LR;        }
 
         //--- for initializer
         PS::F64 get_ex_radius() const { return this->ex_radius;     }
         PS::F64 get_try_limit() const { return this->try_limit;     }
 
+        //--- for model loading
+        PS::F64 get_HMR_mass() const { return this->HMR_mass; }
+
         //--- for record
         PS::S64 get_eng_start()  const { return this->eng_start;  }
         PS::S64 get_prop_start() const { return this->prop_start; }
@@ -118,6 +203,16 @@ namespace System {
             assert(this->cycle_dinfo > 0);
             return ( ((this->istep - this->nstep_st) % this->cycle_dinfo) == 0 );
         }
+        //------ the long-range force is applied as impulse at the beginning of cycle,
+        //------ and it is re-evaluated at the end of the last step in cycle.
+        bool is_LR_cycle_begin() const {
+            assert(this->cycle_LR > 0);
+            return ( ((this->istep - this->nstep_st) % this->cycle_LR) == 0 );
+        }
+        bool is_LR_update() const {
+            assert(this->cycle_LR > 0);
+            return ( ((this->istep + 1 - this->nstep_st) % this->cycle_LR) == 0 );
+        }
         bool is_loop_continue() const {
             assert(this->istep    >= 0);
             assert(this->nstep_ed >= 0);
@@ -165,18 +260,33 @@ namespace System {
     void StepNext(){ profile.step_next(); }
 
     bool isDinfoUpdate() { return profile.is_dinfo_update();  }
+    bool isLRCycleBegin(){ return profile.is_LR_cycle_begin(); }
+    bool isLRUpdate()    { return profile.is_LR_update();      }
     bool isLoopContinue(){ return profile.is_loop_continue(); }
 
     PS::S64 get_istep(){ return profile.get_istep(); }
     PS::F64 get_dt()   { return profile.get_dt();    }
+    PS::S32 get_n_respa(){ return profile.get_n_respa(); }
     PS::F64 get_time() { return profile.get_time();  }
 
+    bool    get_mol_exchange()  { return profile.get_mol_exchange();  }
+
     PS::F64 get_cut_off_intra() { return profile.get_cut_off_intra(); }
     PS::F64 get_cut_off_LJ()    { return profile.get_cut_off_LJ();    }
+    PS::S32 get_n_force_table() { return profile.get_n_force_table(); }
+    bool    get_LJ_tail()       { return profile.get_LJ_tail();       }
+
+    COULOMB_MODE get_coulomb_mode()    { return profile.get_coulomb_mode();    }
+    PS::F64      get_cut_off_coulomb() { return profile.get_cut_off_coulomb(); }
+    PS::F64      get_DSF_alpha()       { return profile.get_DSF_alpha();       }
+    PS::F64      get_tree_theta()      { return profile.get_tree_theta();      }
+    PS::S32      get_cycle_LR()        { return profile.get_cycle_LR();        }
 
     PS::F64 get_ex_radius()    { return profile.get_ex_radius();     }
     PS::S64 get_try_limit()    { return profile.get_try_limit();     }
 
+    PS::F64 get_HMR_mass()     { return profile.get_HMR_mass();      }
+
     PS::S64 get_eng_start()    { return profile.get_eng_start();     }
     PS::S64 get_prop_start()   { return profile.get_prop_start();    }
 
@@ -204,6 +314,7 @@ namespace System {
         oss << "\n";
         oss << "    dt       = " << std::setw(15) << profile.get_dt()    << " (normalized)" << "\n";
         oss << "             = " << std::setw(15) << Unit::to_real_time( profile.get_dt() ) << " [fs]\n";
+        oss << "    n_respa  = " << std::setw(15) << profile.n_respa     << " (inner steps for intramolecular force)\n";
         oss << "\n";
 
         oss << "  FDPS Tree setting:\n";
@@ -212,12 +323,32 @@ namespace System {
         oss << "    theta         = "<< std::setw(9) << profile.theta         << "\n";
         oss << "    n_group_limit = "<< std::setw(9) << profile.n_group_limit << "\n";
         oss << "    cycle_dinfo   = "<< std::setw(9) << profile.cycle_dinfo   << "\n";
+        oss << "    mol_exchange  = "<< std::setw(9) << profile.mol_exchange  << " (0: each atom, 1: whole molecule)\n";
         oss << "\n";
 
         oss << "  Cut_off setting:\n";
         oss << "    cut_off_intra   = " << std::setw(9) << std::setprecision(7) << profile.get_cut_off_intra() << " [angstrom]\n";
         oss << "    cut_off_LJ      = " << std::setw(9) << std::setprecision(7) << profile.get_cut_off_LJ()    << " [angstrom]\n";
-        oss << "    cut_off_coulomb = " << std::setw(9) << std::setprecision(7) << Normalize::normCutOff_PM()  << " (normalized) fixed value.\n";
+        oss << "    coulomb         = " << std::setw(9) << profile.get_coulomb_mode() << "\n";
+        if(profile.get_coulomb_mode() == COULOMB_MODE::DSF){
+            oss << "    cut_off_coulomb = " << std::setw(9) << std::setprecision(7) << profile.get_cut_off_coulomb() << " [angstrom]\n";
+            oss << "    DSF_alpha       = " << std::setw(9) << std::setprecision(7) << profile.get_DSF_alpha()       << " [/angstrom]\n";
+        } else if(profile.get_coulomb_mode() == COULOMB_MODE::SF_TREE){
+            oss << "    cut_off_PP      = " << std::setw(9) << std::setprecision(7) << Normalize::normCutOff_PM()      << " (normalized) fixed value.\n";
+            oss << "    cut_off_coulomb = " << std::setw(9) << std::setprecision(7) << profile.get_cut_off_coulomb() << " [angstrom] (shifted-force, no lattice sum)\n";
+            oss << "    tree_theta      = " << std::setw(9) << std::setprecision(7) << profile.get_tree_theta()      << "\n";
+        } else {
+            oss << "    cut_off_coulomb = " << std::setw(9) << std::setprecision(7) << Normalize::normCutOff_PM()  << " (normalized) fixed value.\n";
+        }
+        if(profile.get_coulomb_mode() != COULOMB_MODE::DSF){
+            oss << "    cycle_LR        = " << std::setw(9) << profile.get_cycle_LR() << " steps (interval of long-range part)\n";
+        }
+        oss << "    force_table     = " << std::setw(9) << profile.get_n_force_table() << " segments per octave of r^2 (0: analytic kernel)\n";
+        oss << "    LJ_tail         = " << std::setw(9) << profile.LJ_tail                << " (0: off, 1: energy & pressure)\n";
+        oss << "\n";
+
+        oss << "  Hydrogen mass repartitioning:\n";
+        oss << "    HMR_mass        = " << std::setw(9) << std::setprecision(7) << profile.get_HMR_mass() << " [g/mol] (0: off)\n";
         oss << "\n";
 
         oss << "loaded models:\n";
@@ -15,6 +15,7 @@
 #include <molecular_dynamics_ext.hpp>
 
 #include "unit.hpp"
+#include "ff_inter_tail.hpp"
 
 namespace Observer {
 
@@ -29,14 +30,17 @@ namespace Observer {
         PS::F64 torsion;
 
         PS::F64 vdw;
+        PS::F64 vdw_tail;   // LJ long-range correction
         PS::F64 coulomb;
 
         PS::F64    kin;
         PS::F64    ext_sys;
         PS::F64vec virial;
+        PS::F64    virial_tail;   // LJ long-range correction (isotropic, sum of x, y, z)
 
         PS::F64 density;
         PS::F64 n_atom;    // buffer for property calculation
+        PS::F64 n_rigid;   // number of constraints (removed degree of freedom)
 
         //--- manipulator
         void clear(){
@@ -44,15 +48,18 @@ namespace Observer {
             this->angle   = 0.0;
             this->torsion = 0.0;
 
-            this->vdw     = 0.0;
-            this->coulomb = 0.0;
+            this->vdw      = 0.0;
+            this->vdw_tail = 0.0;
+            this->coulomb  = 0.0;
 
-            this->kin     = 0.0;
-            this->ext_sys = 0.0;
-            this->virial  = 0.0;
+            this->kin         = 0.0;
+            this->ext_sys     = 0.0;
+            this->virial      = 0.0;
+            this->virial_tail = 0.0;
 
             this->density = 0.0;
             this->n_atom  = 0.0;
+            this->n_rigid = 0.0;
         }
 
     private:
@@ -61,15 +68,18 @@ namespace Observer {
             this->angle   += sign*rv.angle;
             this->torsion += sign*rv.torsion;
 
-            this->vdw     += sign*rv.vdw;
-            this->coulomb += sign*rv.coulomb;
+            this->vdw      += sign*rv.vdw;
+            this->vdw_tail += sign*rv.vdw_tail;
+            this->coulomb  += sign*rv.coulomb;
 
-            this->kin     += sign*rv.kin;
-            this->ext_sys += sign*rv.ext_sys;
-            this->virial  += sign*rv.virial;
+            this->kin         += sign*rv.kin;
+            this->ext_sys     += sign*rv.ext_sys;
+            this->virial      += sign*rv.virial;
+            this->virial_tail += sign*rv.virial_tail;
 
             this->density += sign*rv.density;
             this->n_atom  += sign*rv.n_atom;
+            this->n_rigid += sign*rv.n_rigid;
         }
         void _assign(const Energy &rv){
             this->clear();
@@ -107,8 +117,16 @@ namespace Observer {
 
         PS::F64 inter() const {
             return   this->vdw
+                   + this->vdw_tail
                    + this->coulomb;
         }
+        //--- trace of virial tensor including LJ long-range correction
+        PS::F64 virial_trace() const {
+            return   this->virial.x
+                   + this->virial.y
+                   + this->virial.z
+                   + this->virial_tail;
+        }
         PS::F64 intra() const {
             return   this->bond
                    + this->angle
@@ -126,7 +144,8 @@ namespace Observer {
 
         //--- sampling from PS::ParticleSystem<FP>
         template <class Tpsys>
-        void getEnergy(const Tpsys &psys){
+        void getEnergy(const Tpsys   &psys,
+                       const PS::S64  n_rigid_local = 0){
             Energy  buf;
                     buf.clear();
             PS::S64 n_local  = psys.getNumberOfParticleLocal();
@@ -137,7 +156,8 @@ namespace Observer {
                 buf.torsion += psys[i].getPotTorsion();
 
                 buf.vdw     += psys[i].getPotLJ();
-                buf.coulomb += psys[i].getPotCoulomb()*psys[i].getCharge();
+                buf.coulomb += ( psys[i].getPotCoulomb()
+                               + psys[i].getPotLongRange() )*psys[i].getCharge();
 
                 PS::F64vec v  = psys[i].getVel();
                 buf.kin      += 0.5*psys[i].getMass()*(v*v);
@@ -149,7 +169,8 @@ namespace Observer {
                 buf.density += psys[i].getMass();   // total mass
             //    buf.n_atom   = 0;
             }
-            buf.n_atom = PS::F64(n_local);
+            buf.n_atom  = PS::F64(n_local);
+            buf.n_rigid = PS::F64(n_rigid_local);
 
             //--- sumation
             buf.bond    = PS::Comm::getSum(buf.bond);
@@ -162,9 +183,14 @@ namespace Observer {
             buf.virial  = PS::Comm::getSum(buf.virial);
             buf.density = PS::Comm::getSum(buf.density);
             buf.n_atom  = PS::Comm::getSum(buf.n_atom);
+            buf.n_rigid = PS::Comm::getSum(buf.n_rigid);
 
             buf.ext_sys = this->ext_sys;
 
+            //--- LJ long-range correction (the value for whole system)
+            buf.vdw_tail    = FORCE::lj_tail.getEnergy();
+            buf.virial_tail = FORCE::lj_tail.getVirial();
+
             buf.density = buf.density*Normalize::getVolInv();   // mass -> density
             *this = buf;
         }
@@ -182,6 +208,7 @@ namespace Observer {
             oss << std::left << std::setw(word_length) << "  angle";
             oss << std::left << std::setw(word_length) << "  torsion";
             oss << std::left << std::setw(word_length) << "  vdw";
+            oss << std::left << std::setw(word_length) << "  vdw_tail";
             oss << std::left << std::setw(word_length) << "  coulomb";
             oss << std::left << std::setw(word_length) << "  virial_x";
             oss << std::left << std::setw(word_length) << "  virial_y";
@@ -210,6 +237,7 @@ namespace Observer {
             oss << std::setw(word_length) << std::setprecision(8) << n_atom_inv*this->angle;
             oss << std::setw(word_length) << std::setprecision(8) << n_atom_inv*this->torsion;
             oss << std::setw(word_length) << std::setprecision(8) << n_atom_inv*this->vdw;
+            oss << std::setw(word_length) << std::setprecision(8) << n_atom_inv*this->vdw_tail;
             oss << std::setw(word_length) << std::setprecision(8) << n_atom_inv*this->coulomb;
             oss << std::setw(word_length) << std::setprecision(8) << n_atom_inv*this->virial.x;
             oss << std::setw(word_length) << std::setprecision(8) << n_atom_inv*this->virial.y;
@@ -314,16 +342,14 @@ namespace Observer {
         template <class Teng>
         void getProperty(const Teng &eng){
             //--- temperature [K]
-            this->temperature = eng.kinetic()*(2.0/(3.0*eng.n_atom - 1.0))*Unit::norm_temp;
+            this->temperature = eng.kinetic()*(2.0/(3.0*eng.n_atom - eng.n_rigid - 1.0))*Unit::norm_temp;
 
             //--- density [g/cm^3] = 10^-3 [kg/m^3]
             this->density     = eng.density*Unit::norm_dens*1.e-3;
 
             //--- pressure [Pa]
             this->press_temperature = Normalize::getVolInv()*Unit::norm_press*eng.kinetic()*(2.0/3.0);
-            this->press_virial      = Normalize::getVolInv()*Unit::norm_press*(  eng.virial.x
-                                                                               + eng.virial.y
-                                                                               + eng.virial.z)/3.0;
+            this->press_virial      = Normalize::getVolInv()*Unit::norm_press*eng.virial_trace()/3.0;   // with LJ tail correction
 
             this->pressure = this->press_temperature
                            + this->press_virial;
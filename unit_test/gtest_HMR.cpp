@@ -0,0 +1,112 @@
+//=======================================================================================
+//  This is unit test of hydrogen mass repartitioning (HMR).
+//     module location: ./src/md_loading_model.hpp
+//=======================================================================================
+
+#include <cmath>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <particle_simulator.hpp>
+#include <molecular_dynamics_ext.hpp>
+
+#include "md_loading_model.hpp"
+
+
+namespace TEST_DEFS {
+    const PS::F64 m_C = 12.011;   // [g/mol]
+    const PS::F64 m_H =  1.008;
+
+    const PS::F64 eps = 1.e-12;
+}
+
+//--- atom in model template
+class HMR_atom {
+public:
+    PS::F64              mass;
+    AtomName             atom_type;
+    std::vector<PS::S32> bond;
+
+    PS::F64  getMass()     const { return this->mass;      }
+    AtomName getAtomType() const { return this->atom_type; }
+    void     setMass(const PS::F64 m){ this->mass = m; }
+};
+
+//--- [g/mol] -> normalized mass
+PS::F64 norm_mass(const PS::F64 m){ return 1.e-3*m/Unit::mass_C; }
+
+HMR_atom make_atom(const PS::F64 m, const AtomName type, const std::vector<PS::S32> &bond){
+    HMR_atom atom;
+    atom.mass      = norm_mass(m);
+    atom.atom_type = type;
+    atom.bond      = bond;
+    return atom;
+}
+
+PS::F64 total_mass(const std::vector<HMR_atom> &atom_list){
+    PS::F64 m = 0.0;
+    for(const auto& atom : atom_list) m += atom.getMass();
+    return m;
+}
+
+//--- ethane: C(0)-C(1), H(2,3,4) on C(0), H(5,6,7) on C(1)
+std::vector<HMR_atom> make_ethane(){
+    std::vector<HMR_atom> atom_list;
+    atom_list.push_back( make_atom(TEST_DEFS::m_C, AtomName::CT, {1, 2, 3, 4}) );
+    atom_list.push_back( make_atom(TEST_DEFS::m_C, AtomName::CT, {0, 5, 6, 7}) );
+    for(PS::S32 i=0; i<3; ++i) atom_list.push_back( make_atom(TEST_DEFS::m_H, AtomName::HC, {0}) );
+    for(PS::S32 i=0; i<3; ++i) atom_list.push_back( make_atom(TEST_DEFS::m_H, AtomName::HC, {1}) );
+    return atom_list;
+}
+
+
+//--- unit test definition, CANNOT use "_" in test/test_case name.
+TEST(HMR, massConservation){
+    const PS::F64 HMR_mass = 3.024;
+
+    auto atom_list = make_ethane();
+    const PS::F64 m_total = total_mass(atom_list);
+    MODEL::repartition_hydrogen_mass("ethane", atom_list, HMR_mass);
+
+    EXPECT_NEAR(total_mass(atom_list), m_total, TEST_DEFS::eps*m_total);
+    for(size_t i=2; i<atom_list.size(); ++i){
+        EXPECT_NEAR(atom_list[i].getMass(), norm_mass(HMR_mass), TEST_DEFS::eps) << " i= " << i;
+    }
+    const PS::F64 m_C_HMR = norm_mass(TEST_DEFS::m_C - 3.0*(HMR_mass - TEST_DEFS::m_H));
+    EXPECT_NEAR(atom_list[0].getMass(), m_C_HMR, TEST_DEFS::eps);
+    EXPECT_NEAR(atom_list[1].getMass(), m_C_HMR, TEST_DEFS::eps);
+}
+
+TEST(HMR, disabled){
+    auto atom_list = make_ethane();
+    const auto atom_ref = atom_list;
+    MODEL::repartition_hydrogen_mass("ethane", atom_list, 0.0);
+
+    for(size_t i=0; i<atom_list.size(); ++i){
+        EXPECT_EQ(atom_list[i].getMass(), atom_ref[i].getMass()) << " i= " << i;
+    }
+}
+
+TEST(HMR, heavyAtomFloor){
+    //--- methane: 12.011 - 4*(4.0 - 1.008) < 4.0
+    std::vector<HMR_atom> atom_list;
+    atom_list.push_back( make_atom(TEST_DEFS::m_C, AtomName::CT, {1, 2, 3, 4}) );
+    for(PS::S32 i=0; i<4; ++i) atom_list.push_back( make_atom(TEST_DEFS::m_H, AtomName::HC, {0}) );
+
+    EXPECT_THROW(MODEL::repartition_hydrogen_mass("methane", atom_list, 4.0), std::invalid_argument);
+}
+
+TEST(HMR, skipHydrogenPair){
+    //--- H2 has no heavy atom. the mass is not changed.
+    std::vector<HMR_atom> atom_list;
+    atom_list.push_back( make_atom(TEST_DEFS::m_H, AtomName::HC, {1}) );
+    atom_list.push_back( make_atom(TEST_DEFS::m_H, AtomName::HC, {0}) );
+
+    MODEL::repartition_hydrogen_mass("hydrogen", atom_list, 3.024);
+    EXPECT_EQ(atom_list[0].getMass(), norm_mass(TEST_DEFS::m_H));
+    EXPECT_EQ(atom_list[1].getMass(), norm_mass(TEST_DEFS::m_H));
+}
+
+
+#include "gtest_main.hpp"
@@ -0,0 +1,554 @@
+//=======================================================================================
+//  This is unit test of constraint solver (SETTLE, SHAKE/RATTLE, LINCS, rigid body).
+//     module location: ./src/atom_constraint.hpp
+//=======================================================================================
+
+#undef NDEBUG
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <particle_simulator.hpp>
+#include <molecular_dynamics_ext.hpp>
+
+#include "unit.hpp"
+#include "atom_constraint.hpp"
+
+
+namespace TEST_DEFS {
+    //--- SPC/E geometry
+    const PS::F64 m_O   = 15.9994;
+    const PS::F64 m_H   = 1.008;
+    const PS::F64 d_OH  = 1.0;
+    const PS::F64 theta = 109.47*Unit::pi/180.0;
+
+    const PS::S32 n_sample = 1000;
+    const PS::F64 disp     = 0.02;    // random displacement [angstrom]
+    const PS::F64 eps      = 1.e-9;
+
+    const PS::F64 eps_pressure = 1.e-3;   // integration error of time averaged pressure (relative)
+}
+
+class ConstraintWater :
+    public ::testing::Test {
+    protected:
+        std::vector<CONSTRAINT::Pair> pair;
+        CONSTRAINT::SettleParam       param;
+        PS::F64                       m_inv[3];
+        PS::F64vec                    x_ref[3];
+
+        virtual void SetUp(){
+            const PS::F64 d2_HH = 2.0*TEST_DEFS::d_OH*TEST_DEFS::d_OH*(1.0 - std::cos(TEST_DEFS::theta));
+            pair.clear();
+            pair.push_back( CONSTRAINT::Pair{0, 1, TEST_DEFS::d_OH*TEST_DEFS::d_OH} );
+            pair.push_back( CONSTRAINT::Pair{0, 2, TEST_DEFS::d_OH*TEST_DEFS::d_OH} );
+            pair.push_back( CONSTRAINT::Pair{1, 2, d2_HH} );
+
+            const PS::F64 h = std::sqrt(TEST_DEFS::d_OH*TEST_DEFS::d_OH - 0.25*d2_HH);
+            param.i_O  = 0;
+            param.i_H1 = 1;
+            param.i_H2 = 2;
+            param.wh   = TEST_DEFS::m_H/(TEST_DEFS::m_O + 2.0*TEST_DEFS::m_H);
+            param.rc   = 0.5*std::sqrt(d2_HH);
+            param.ra   = 2.0*TEST_DEFS::m_H*h/(TEST_DEFS::m_O + 2.0*TEST_DEFS::m_H);
+            param.rb   = h - param.ra;
+
+            m_inv[0] = 1.0/TEST_DEFS::m_O;
+            m_inv[1] = 1.0/TEST_DEFS::m_H;
+            m_inv[2] = 1.0/TEST_DEFS::m_H;
+
+            x_ref[0] = PS::F64vec{0.0, 0.0, 0.0};
+            x_ref[1] = PS::F64vec{TEST_DEFS::d_OH, 0.0, 0.0};
+            x_ref[2] = PS::F64vec{TEST_DEFS::d_OH*std::cos(TEST_DEFS::theta),
+                                  TEST_DEFS::d_OH*std::sin(TEST_DEFS::theta), 0.0};
+        }
+};
+
+//--- unit test definition, CANNOT use "_" in test/test_case name.
+TEST_F(ConstraintWater, position){
+    std::mt19937 mt(19937);
+    std::normal_distribution<PS::F64> dist(0.0, TEST_DEFS::disp);
+
+    for(PS::S32 i_sample=0; i_sample<TEST_DEFS::n_sample; ++i_sample){
+        PS::F64vec x_settle[3], x_shake[3];
+        for(PS::S32 k=0; k<3; ++k){
+            x_settle[k] = x_ref[k] + PS::F64vec{dist(mt), dist(mt), dist(mt)};
+            x_shake[k]  = x_settle[k];
+        }
+        const PS::F64vec com_0 = x_settle[0]*TEST_DEFS::m_O + (x_settle[1] + x_settle[2])*TEST_DEFS::m_H;
+
+        ASSERT_TRUE( CONSTRAINT::_Impl::settlePosition(param, x_ref, x_settle) );
+        ASSERT_GE( CONSTRAINT::_Impl::shakePosition(pair, m_inv, x_ref, x_shake, 1.e-12, 1000), 0 );
+
+        for(const auto& c : pair){
+            const PS::F64vec r = x_settle[c.i] - x_settle[c.j];
+            EXPECT_NEAR(r*r, c.d2, TEST_DEFS::eps);
+        }
+        for(PS::S32 k=0; k<3; ++k){
+            const PS::F64vec diff = x_settle[k] - x_shake[k];
+            EXPECT_NEAR(std::sqrt(diff*diff), 0.0, TEST_DEFS::eps) << " atom = " << k;
+        }
+
+        //--- constraint force is internal: the center of mass is kept.
+        const PS::F64vec com_1 = x_settle[0]*TEST_DEFS::m_O + (x_settle[1] + x_settle[2])*TEST_DEFS::m_H;
+        const PS::F64vec d_com = com_1 - com_0;
+        EXPECT_NEAR(std::sqrt(d_com*d_com), 0.0, TEST_DEFS::eps);
+    }
+}
+
+TEST_F(ConstraintWater, velocity){
+    std::mt19937 mt(19937);
+    std::normal_distribution<PS::F64> dist(0.0, 1.0);
+
+    for(PS::S32 i_sample=0; i_sample<TEST_DEFS::n_sample; ++i_sample){
+        PS::F64vec v_settle[3], v_rattle[3];
+        for(PS::S32 k=0; k<3; ++k){
+            v_settle[k] = PS::F64vec{dist(mt), dist(mt), dist(mt)};
+            v_rattle[k] = v_settle[k];
+        }
+
+        ASSERT_TRUE( CONSTRAINT::_Impl::settleVelocity(pair, m_inv, x_ref, v_settle) );
+        ASSERT_GE( CONSTRAINT::_Impl::rattleVelocity(pair, m_inv, x_ref, v_rattle, 1.e-12, 10000), 0 );
+
+        for(const auto& c : pair){
+            const PS::F64vec r = x_ref[c.i] - x_ref[c.j];
+            EXPECT_NEAR(r*(v_settle[c.i] - v_settle[c.j]), 0.0, TEST_DEFS::eps);
+        }
+        for(PS::S32 k=0; k<3; ++k){
+            const PS::F64vec diff = v_settle[k] - v_rattle[k];
+            EXPECT_NEAR(std::sqrt(diff*diff), 0.0, 1.e-6) << " atom = " << k;
+        }
+    }
+}
+
+//--- X-H bonds of CH3-OH like structure: C-H x3, O-H (coupled at C).
+class ConstraintLINCS :
+    public ::testing::Test {
+    protected:
+        CONSTRAINT::ModelConstraint mc;
+        PS::F64                     m_inv[6];
+        PS::F64vec                  x_ref[6];
+
+        virtual void SetUp(){
+            x_ref[0] = PS::F64vec{ 0.0 ,  0.0 ,  0.0 };    // C
+            x_ref[1] = PS::F64vec{ 1.09,  0.0 ,  0.0 };    // H
+            x_ref[2] = PS::F64vec{-0.36,  1.03,  0.0 };    // H
+            x_ref[3] = PS::F64vec{-0.36, -0.51,  0.89};    // H
+            x_ref[4] = PS::F64vec{-0.48, -0.68, -1.19};    // O
+            x_ref[5] = PS::F64vec{-1.44, -0.6 , -1.2 };    // H
+
+            m_inv[0] = 1.0/12.011;
+            m_inv[1] = 1.0/1.008;
+            m_inv[2] = 1.0/1.008;
+            m_inv[3] = 1.0/1.008;
+            m_inv[4] = 1.0/15.999;
+            m_inv[5] = 1.0/1.008;
+
+            mc.n_atom = 6;
+            mc.pair.clear();
+            mc.pair.push_back( CONSTRAINT::Pair{0, 1, 0.0} );
+            mc.pair.push_back( CONSTRAINT::Pair{0, 2, 0.0} );
+            mc.pair.push_back( CONSTRAINT::Pair{0, 3, 0.0} );
+            mc.pair.push_back( CONSTRAINT::Pair{4, 5, 0.0} );
+            for(auto& c : mc.pair){
+                const PS::F64vec r = x_ref[c.i] - x_ref[c.j];
+                c.d2 = r*r;
+            }
+
+            //--- pairs sharing the atom C
+            mc.couple_offset = { 0, 2, 4, 6, 6 };
+            mc.couple.clear();
+            mc.couple.push_back( CONSTRAINT::LincsCouple{1, 0, 1.0} );
+            mc.couple.push_back( CONSTRAINT::LincsCouple{2, 0, 1.0} );
+            mc.couple.push_back( CONSTRAINT::LincsCouple{0, 0, 1.0} );
+            mc.couple.push_back( CONSTRAINT::LincsCouple{2, 0, 1.0} );
+            mc.couple.push_back( CONSTRAINT::LincsCouple{0, 0, 1.0} );
+            mc.couple.push_back( CONSTRAINT::LincsCouple{1, 0, 1.0} );
+
+            mc.coef.solver      = ConstraintSolver::LINCS;
+            mc.coef.lincs_order = 8;
+            mc.coef.lincs_iter  = 4;
+        }
+};
+
+TEST_F(ConstraintLINCS, position){
+    std::mt19937 mt(19937);
+    std::normal_distribution<PS::F64> dist(0.0, TEST_DEFS::disp);
+    CONSTRAINT::_Impl::LincsBuff buff;
+
+    for(PS::S32 i_sample=0; i_sample<TEST_DEFS::n_sample; ++i_sample){
+        PS::F64vec x_lincs[6], x_shake[6];
+        for(PS::S32 k=0; k<6; ++k){
+            x_lincs[k] = x_ref[k] + PS::F64vec{dist(mt), dist(mt), dist(mt)};
+            x_shake[k] = x_lincs[k];
+        }
+
+        ASSERT_TRUE( CONSTRAINT::_Impl::lincsPosition(mc, m_inv, x_ref, x_lincs, buff) );
+        ASSERT_GE( CONSTRAINT::_Impl::shakePosition(mc.pair, m_inv, x_ref, x_shake, 1.e-12, 1000), 0 );
+
+        for(const auto& c : mc.pair){
+            const PS::F64vec r = x_lincs[c.i] - x_lincs[c.j];
+            EXPECT_NEAR(r*r, c.d2, TEST_DEFS::eps);
+        }
+        for(PS::S32 k=0; k<6; ++k){
+            const PS::F64vec diff = x_lincs[k] - x_shake[k];
+            EXPECT_NEAR(std::sqrt(diff*diff), 0.0, TEST_DEFS::eps) << " atom = " << k;
+        }
+    }
+}
+
+TEST_F(ConstraintLINCS, velocity){
+    std::mt19937 mt(19937);
+    std::normal_distribution<PS::F64> dist(0.0, 1.0);
+    CONSTRAINT::_Impl::LincsBuff buff;
+
+    for(PS::S32 i_sample=0; i_sample<TEST_DEFS::n_sample; ++i_sample){
+        PS::F64vec v[6];
+        for(PS::S32 k=0; k<6; ++k){
+            v[k] = PS::F64vec{dist(mt), dist(mt), dist(mt)};
+        }
+
+        ASSERT_TRUE( CONSTRAINT::_Impl::lincsVelocity(mc, m_inv, x_ref, v, buff) );
+
+        for(const auto& c : mc.pair){
+            const PS::F64vec r = x_ref[c.i] - x_ref[c.j];
+            EXPECT_NEAR(r*(v[c.i] - v[c.j]), 0.0, TEST_DEFS::eps);
+        }
+    }
+}
+
+TEST_F(ConstraintWater, rigidBody){
+    CONSTRAINT::RigidParam rp;
+    ASSERT_TRUE( CONSTRAINT::_Impl::rigidMakeParam( std::vector<PS::F64vec>{x_ref[0], x_ref[1], x_ref[2]},
+                                                    std::vector<PS::F64>{TEST_DEFS::m_O, TEST_DEFS::m_H, TEST_DEFS::m_H},
+                                                    rp ) );
+    const PS::F64 mass[3] = {TEST_DEFS::m_O, TEST_DEFS::m_H, TEST_DEFS::m_H};
+
+    auto calc_state = [&](const PS::F64vec *x, const PS::F64vec *v, PS::F64vec &P, PS::F64vec &L, PS::F64 &eng){
+        PS::F64vec com = 0.0;
+        for(PS::S32 k=0; k<3; ++k) com += mass[k]*x[k];
+        com = com*(1.0/rp.mass);
+        P   = 0.0;
+        L   = 0.0;
+        eng = 0.0;
+        for(PS::S32 k=0; k<3; ++k){
+            P   += mass[k]*v[k];
+            L   += mass[k]*((x[k] - com) ^ v[k]);
+            eng += 0.5*mass[k]*(v[k]*v[k]);
+        }
+    };
+
+    //--- projection to the rigid body motion
+    PS::F64vec x[3] = { x_ref[0], x_ref[1], x_ref[2] };
+    PS::F64vec v[3] = { PS::F64vec{0.1, 0.2, -0.3}, PS::F64vec{1.0, 2.0, 3.0}, PS::F64vec{-2.0, 0.5, 1.0} };
+    CONSTRAINT::_Impl::rigidPosition(rp, m_inv, x_ref, 0.0, x, v);
+    for(const auto& c : pair){
+        const PS::F64vec r = x[c.i] - x[c.j];
+        EXPECT_NEAR(r*r, c.d2, TEST_DEFS::eps);
+        EXPECT_NEAR(r*(v[c.i] - v[c.j]), 0.0, TEST_DEFS::eps);
+    }
+
+    //--- free rotation: the momentum, angular momentum, and energy are conserved.
+    PS::F64vec P_0, L_0;
+    PS::F64    eng_0;
+    calc_state(x, v, P_0, L_0, eng_0);
+
+    const PS::F64 dt = 0.01;
+    for(PS::S32 i_step=0; i_step<1000; ++i_step){
+        PS::F64vec x_prev[3];
+        for(PS::S32 k=0; k<3; ++k){
+            x_prev[k] = x[k];
+            x[k]     += v[k]*dt;
+        }
+        CONSTRAINT::_Impl::rigidPosition(rp, m_inv, x_prev, dt, x, v);
+    }
+    PS::F64vec P_1, L_1;
+    PS::F64    eng_1;
+    calc_state(x, v, P_1, L_1, eng_1);
+    EXPECT_NEAR(std::sqrt((P_1 - P_0)*(P_1 - P_0)), 0.0, TEST_DEFS::eps);
+    EXPECT_NEAR(std::sqrt((L_1 - L_0)*(L_1 - L_0)), 0.0, TEST_DEFS::eps);
+    EXPECT_NEAR(eng_1/eng_0, 1.0, 1.e-5);
+    for(const auto& c : pair){
+        const PS::F64vec r = x[c.i] - x[c.j];
+        EXPECT_NEAR(r*r, c.d2, TEST_DEFS::eps);
+    }
+
+    //--- kick: same to the total force and torque
+    const PS::F64vec f[3] = { PS::F64vec{1.0, -2.0, 0.5}, PS::F64vec{3.0, 1.0, -1.0}, PS::F64vec{-0.5, 2.0, 2.0} };
+    PS::F64vec com = 0.0;
+    for(PS::S32 k=0; k<3; ++k) com += mass[k]*x[k];
+    com = com*(1.0/rp.mass);
+    PS::F64vec f_total = 0.0, torque = 0.0;
+    for(PS::S32 k=0; k<3; ++k){
+        f_total += f[k];
+        torque  += (x[k] - com) ^ f[k];
+        v[k]    += f[k]*(dt*m_inv[k]);
+    }
+    CONSTRAINT::_Impl::rigidVelocity(rp, m_inv, x, v);
+
+    PS::F64vec P_2, L_2;
+    PS::F64    eng_2;
+    calc_state(x, v, P_2, L_2, eng_2);
+    const PS::F64vec dP = P_2 - (P_1 + f_total*dt);
+    const PS::F64vec dL = L_2 - (L_1 + torque*dt);
+    EXPECT_NEAR(std::sqrt(dP*dP), 0.0, TEST_DEFS::eps);
+    EXPECT_NEAR(std::sqrt(dL*dL), 0.0, TEST_DEFS::eps);
+}
+
+//--- small box of SPC/E water integrated by the sequence of md_fdps.cpp (r-RESPA and long-range impulse).
+//------ the pressure must not depend on n_respa and cycle_LR.
+class ConstraintAtom {
+public:
+    PS::F64vec       pos, vel;
+    PS::F64vec       force_inter, force_LR;
+    PS::F64vec       virial_constraint;
+    PS::F64          mass;
+    MolName          mol_type;
+    AtomName         atom_type;
+    MD_DEFS::ID_type mol_id, atom_id;
+    std::vector<PS::S32> bond;
+
+    PS::F64vec       getPos()      const { return this->pos;       }
+    PS::F64vec       getVel()      const { return this->vel;       }
+    PS::F64          getMass()     const { return this->mass;      }
+    MolName          getMolType()  const { return this->mol_type;  }
+    AtomName         getAtomType() const { return this->atom_type; }
+    MD_DEFS::ID_type getMolID()    const { return this->mol_id;    }
+    MD_DEFS::ID_type getAtomID()   const { return this->atom_id;   }
+
+    void setPos(const PS::F64vec &pos_new){ this->pos = pos_new; }
+    void setVel(const PS::F64vec &vel_new){ this->vel = vel_new; }
+    void addTrj(const PS::F64vec&){}
+
+    void       clearVirialConstraint(){ this->virial_constraint = 0.0; }
+    void       addVirialConstraint(const PS::F64vec &v){ this->virial_constraint += v; }
+    PS::F64vec getVirialConstraint() const { return this->virial_constraint; }
+};
+
+//--- local particles in single process (the interface of PS::ParticleSystem used by CONSTRAINT::Solver)
+class ConstraintSystem :
+    public std::vector<ConstraintAtom> {
+    public:
+        PS::S64 getNumberOfParticleLocal() const { return this->size(); }
+};
+
+class ConstraintPressure :
+    public ::testing::Test {
+    protected:
+        ConstraintSystem                         atom;
+        CONSTRAINT::Solver                       solver;
+        std::vector<ConstraintAtom>              atom_init;
+        std::vector<std::vector<ConstraintAtom>> model_template;
+
+        const PS::F64    box      = 7.2;
+        const PS::S32    n_side   = 2;
+        const PS::F64    dt       = 0.5;
+        const PS::S32    n_step   = 400;
+        const PS::F64    r_cut    = 3.5;
+        const PS::F64    eps_O    = 0.02;    // site amplitude of the short-range (inter) force
+        const PS::F64    eps_H    = 0.01;
+        const PS::F64    eps_LR   = 0.005;   // amplitude of the slow (long_range) force
+        const PS::F64    v_scale  = 0.01;
+
+        //--- smooth site-site potential: U = eps_i*eps_j*(1 - r^2/r_cut^2)^3
+        PS::F64 calcForce(const bool long_range){
+            const PS::S64 n     = this->atom.getNumberOfParticleLocal();
+                  PS::F64 w_sum = 0.0;
+            for(PS::S64 i=0; i<n; ++i){
+                if(long_range){
+                    this->atom[i].force_LR = 0.0;
+                } else {
+                    this->atom[i].force_inter = 0.0;
+                }
+            }
+            for(PS::S64 i=0; i<n; ++i){
+                for(PS::S64 j=i+1; j<n; ++j){
+                    if(this->atom[i].mol_id == this->atom[j].mol_id) continue;
+                    const PS::F64vec r_ij = Normalize::realPos( Normalize::relativePosAdjustNorm(this->atom[i].pos - this->atom[j].pos) );
+                    const PS::F64    r2   = r_ij*r_ij;
+                    if(r2 >= this->r_cut*this->r_cut) continue;
+
+                    PS::F64 eps = this->eps_LR;
+                    if( !long_range ){
+                        eps = ( (this->atom[i].atom_type == AtomName::Ow) ? this->eps_O : this->eps_H )
+                             *( (this->atom[j].atom_type == AtomName::Ow) ? this->eps_O : this->eps_H );
+                    }
+                    const PS::F64    s    = 1.0 - r2/(this->r_cut*this->r_cut);
+                    const PS::F64vec f_ij = r_ij*(6.0*eps*s*s/(this->r_cut*this->r_cut));
+                    if(long_range){
+                        this->atom[i].force_LR += f_ij;
+                        this->atom[j].force_LR -= f_ij;
+                    } else {
+                        this->atom[i].force_inter += f_ij;
+                        this->atom[j].force_inter -= f_ij;
+                    }
+                    w_sum += r_ij*f_ij;
+                }
+            }
+            return w_sum;
+        }
+
+        void kick(const PS::F64 dt_kick, const bool long_range){
+            for(PS::S64 i=0; i<this->atom.getNumberOfParticleLocal(); ++i){
+                auto& a = this->atom[i];
+                a.vel += ( long_range ? a.force_LR : a.force_inter )*(dt_kick/a.mass);
+            }
+        }
+
+        void drift(const PS::F64 dt_drift){
+            for(PS::S64 i=0; i<this->atom.getNumberOfParticleLocal(); ++i){
+                auto& a = this->atom[i];
+                PS::F64vec pos_new = a.pos + Normalize::normPos(a.vel*dt_drift);
+                pos_new.x -= std::floor(pos_new.x);
+                pos_new.y -= std::floor(pos_new.y);
+                pos_new.z -= std::floor(pos_new.z);
+                a.pos = pos_new;
+            }
+        }
+
+        virtual void SetUp(){
+            Normalize::setBoxSize( PS::F64vec{this->box, this->box, this->box} );
+
+            const MolName  mol = MolName::AA_wat_SPC_E;
+            const AtomName O   = AtomName::Ow;
+            const AtomName H   = AtomName::Hw;
+            MODEL::coef_table.bond[ std::make_tuple(mol, O, H) ] = MODEL::CoefBond{IntraFuncForm::constraint, 1.0, 0.0, 0.0};
+            MODEL::coef_table.bond[ std::make_tuple(mol, H, O) ] = MODEL::CoefBond{IntraFuncForm::constraint, 1.0, 0.0, 0.0};
+            MODEL::coef_table.angle[ std::make_tuple(mol, H, O, H) ] = MODEL::CoefAngle{IntraFuncForm::constraint,
+                                                                                          static_cast<PS::F32>(TEST_DEFS::theta), 0.0};
+            MODEL::coef_table.constraint[mol] = MODEL::CoefConstraint{};
+
+            //--- template
+            const PS::F64vec x_mol[3] = { PS::F64vec{0.0, 0.0, 0.0},
+                                          PS::F64vec{TEST_DEFS::d_OH, 0.0, 0.0},
+                                          PS::F64vec{TEST_DEFS::d_OH*std::cos(TEST_DEFS::theta),
+                                                     TEST_DEFS::d_OH*std::sin(TEST_DEFS::theta), 0.0} };
+            std::vector<ConstraintAtom> tmp(3);
+            for(PS::S32 k=0; k<3; ++k){
+                tmp[k].pos       = x_mol[k];
+                tmp[k].mass      = (k == 0) ? TEST_DEFS::m_O : TEST_DEFS::m_H;
+                tmp[k].mol_type  = mol;
+                tmp[k].atom_type = (k == 0) ? O : H;
+                tmp[k].mol_id    = 0;
+                tmp[k].atom_id   = k;
+            }
+            tmp[0].bond = {1, 2};
+            tmp[1].bond = {0};
+            tmp[2].bond = {0};
+            this->model_template = { tmp };
+
+            //--- molecules on lattice with random orientation and velocity
+            std::mt19937 mt(19937);
+            std::uniform_real_distribution<PS::F64> dist_angle(0.0, 2.0*Unit::pi);
+            std::normal_distribution<PS::F64>       dist_vel(0.0, this->v_scale);
+            this->atom_init.clear();
+            PS::S64 i_mol = 0;
+            for(PS::S32 ix=0; ix<this->n_side; ++ix){
+                for(PS::S32 iy=0; iy<this->n_side; ++iy){
+                    for(PS::S32 iz=0; iz<this->n_side; ++iz){
+                        const PS::F64vec pos_O = PS::F64vec{ix + 0.25, iy + 0.25, iz + 0.25}*(1.0/this->n_side);
+                        const PS::F64    a = dist_angle(mt);
+                        const PS::F64    b = dist_angle(mt);
+                        for(PS::S32 k=0; k<3; ++k){
+                            ConstraintAtom atom_tmp = tmp[k];
+                            const PS::F64vec x_rot_z{ x_mol[k].x*std::cos(a) - x_mol[k].y*std::sin(a),
+                                                      x_mol[k].x*std::sin(a) + x_mol[k].y*std::cos(a),
+                                                      x_mol[k].z };
+                            const PS::F64vec x_rot_x{ x_rot_z.x,
+                                                      x_rot_z.y*std::cos(b) - x_rot_z.z*std::sin(b),
+                                                      x_rot_z.y*std::sin(b) + x_rot_z.z*std::cos(b) };
+                            atom_tmp.pos    = pos_O + Normalize::normPos(x_rot_x);
+                            atom_tmp.vel    = PS::F64vec{dist_vel(mt), dist_vel(mt), dist_vel(mt)}*std::sqrt(TEST_DEFS::m_O/atom_tmp.mass);
+                            atom_tmp.mol_id = i_mol;
+                            atom_tmp.virial_constraint = 0.0;
+                            this->atom_init.push_back(atom_tmp);
+                        }
+                        ++i_mol;
+                    }
+                }
+            }
+        }
+
+        //--- time average of pressure (in virial unit) by the step sequence of md_fdps.cpp
+        PS::F64 calcPressure(const PS::S32 n_respa, const PS::S32 cycle_LR){
+            this->atom.assign(this->atom_init.begin(), this->atom_init.end());
+            this->solver.init(std::vector<std::pair<MolName, PS::S64>>{ std::make_pair(MolName::AA_wat_SPC_E, PS::S64(this->n_side*this->n_side*this->n_side)) },
+                              this->model_template, true);
+            this->solver.update(this->atom);
+            this->solver.project(this->atom);
+
+            const PS::F64 dt_inner = this->dt/static_cast<PS::F64>(n_respa);
+            const PS::F64 dt_LR    = this->dt*static_cast<PS::F64>(cycle_LR);
+            const PS::F64 w_inner  = dt_inner/this->dt;
+
+            PS::F64 w_inter = this->calcForce(false);
+            PS::F64 w_LR    = this->calcForce(true);
+            PS::F64 p_sum   = 0.0;
+            for(PS::S32 i_step=0; i_step<this->n_step; ++i_step){
+                this->solver.clearVirial(this->atom);
+
+                if(i_step%cycle_LR == 0) this->kick(0.5*dt_LR, true);
+                this->kick(0.5*this->dt, false);
+
+                //--- SPC/E has no intramolecular force
+                for(PS::S32 i_respa=1; i_respa<n_respa; ++i_respa){
+                    this->solver.setReference(this->atom);
+                    this->drift(dt_inner);
+                    this->solver.applyPosition(dt_inner, this->atom, w_inner);
+                    this->solver.applyVelocity(dt_inner, this->atom, w_inner);
+                }
+                this->solver.setReference(this->atom);
+                this->drift(dt_inner);
+                this->solver.applyPosition(dt_inner, this->atom, w_inner);
+
+                w_inter = this->calcForce(false);
+                if((i_step + 1)%cycle_LR == 0){
+                    w_LR = this->calcForce(true);
+                    this->kick(0.5*dt_LR, true);
+                    if(cycle_LR > 1) this->solver.applyVelocity(dt_LR, this->atom, dt_LR/this->dt);
+                }
+
+                if(n_respa > 1) this->solver.applyVelocity(dt_inner, this->atom, w_inner);
+                this->kick(0.5*this->dt, false);
+                this->solver.applyVelocity(this->dt, this->atom);
+
+                //--- P*3V = 2K + W
+                PS::F64 p_step = w_inter + w_LR;
+                for(PS::S64 i=0; i<this->atom.getNumberOfParticleLocal(); ++i){
+                    const auto& a = this->atom[i];
+                    const PS::F64vec v_c = a.getVirialConstraint();
+                    p_step += a.mass*(a.vel*a.vel) + v_c.x + v_c.y + v_c.z;
+                }
+                p_sum += p_step;
+            }
+            return p_sum/static_cast<PS::F64>(this->n_step);
+        }
+};
+
+TEST_F(ConstraintPressure, respaAndLongRangeCycle){
+    const PS::F64 p_ref = this->calcPressure(1, 1);
+    ASSERT_GT(std::abs(p_ref), 0.0);
+
+    const std::vector<std::pair<PS::S32, PS::S32>> setting_list = { {2, 1}, {4, 1}, {1, 2}, {1, 4}, {2, 2} };
+    for(const auto& setting : setting_list){
+        const PS::F64 p = this->calcPressure(setting.first, setting.second);
+        EXPECT_NEAR(p, p_ref, TEST_DEFS::eps_pressure*std::abs(p_ref)) << " n_respa = " << setting.first << ", cycle_LR = " << setting.second;
+    }
+}
+
+TEST_F(ConstraintPressure, massMismatch){
+    //--- the resume file written with other HMR_mass has different mass from the template.
+    this->atom.assign(this->atom_init.begin(), this->atom_init.end());
+    this->solver.init(std::vector<std::pair<MolName, PS::S64>>{ std::make_pair(MolName::AA_wat_SPC_E, PS::S64(this->n_side*this->n_side*this->n_side)) },
+                      this->model_template, true);
+    EXPECT_NO_THROW(this->solver.update(this->atom));
+
+    this->atom[1].mass = 3.0*TEST_DEFS::m_H;
+    EXPECT_THROW(this->solver.update(this->atom), std::invalid_argument);
+}
+
+
+#include "gtest_main.hpp"
@@ -337,6 +337,7 @@ TEST(TestFileIO, resume){
     for(size_t i=0; i<v_atom.size(); ++i){
         EXPECT_EQ(v_atom_file[i].getAtomID()  , v_atom[i].getAtomID()  );
         EXPECT_EQ(v_atom_file[i].getMolID()   , v_atom[i].getMolID()   );
+        EXPECT_EQ(v_atom_file[i].getTemplateIndex(), v_atom[i].getTemplateIndex());
         EXPECT_EQ(v_atom_file[i].getAtomType(), v_atom[i].getAtomType());
         EXPECT_EQ(v_atom_file[i].getMolType() , v_atom[i].getMolType() );
         EXPECT_TRUE( float_complete_eq(v_atom_file[i].getPos().x , v_atom[i].getPos().x  ) ) << " i = " << i;
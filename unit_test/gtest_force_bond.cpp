@@ -188,7 +188,7 @@ TEST_F(TestForceBond, harmonic){
         atom.setNumberOfParticleLocal(TEST_DEFS::n_atom);
         for(PS::S32 i=0; i<TEST_DEFS::n_atom; ++i){
             atom[i].setAtomID(i);
-            atom[i].setMolID(i);
+            atom[i].setMolID(0);
             atom[i].setMolType( MolName::AA_wat_SPC_Fw );
             atom[i].setCharge( 0.0 );
             atom[i].setVDW_R( 3.0 );
@@ -227,7 +227,7 @@ TEST_F(TestForceBond, anharmonic){
         atom.setNumberOfParticleLocal(TEST_DEFS::n_atom);
         for(PS::S32 i=0; i<TEST_DEFS::n_atom; ++i){
             atom[i].setAtomID(i);
-            atom[i].setMolID(i);
+            atom[i].setMolID(0);
             atom[i].setMolType( MolName::AA_wat_aSPC_Fw );
             atom[i].setCharge( 0.0 );
             atom[i].setVDW_R( 3.0 );
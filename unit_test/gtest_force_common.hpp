@@ -31,6 +31,37 @@ void test_init(const PS::S64 n_step){
                                        40.0 } );
 }
 
+//--- register VDW parameters of test atoms into MODEL::coef_table (source of the LJ type index)
+template <class Tpsys>
+void test_set_coef_atom(const Tpsys &atom){
+    for(PS::S64 i=0; i<atom.getNumberOfParticleLocal(); ++i){
+        MODEL::coef_table.atom[ std::make_tuple(atom[i].getMolType(),
+                                                atom[i].getAtomType()) ] = MODEL::CoefAtom{ atom[i].getMass(),
+                                                                                            atom[i].getCharge(),
+                                                                                            atom[i].getVDW_D(),
+                                                                                            atom[i].getVDW_R() };
+    }
+}
+
+//--- register test atoms as one molecule of System::model_template (source of the intramolecular lists)
+//------ the test atoms must have the same MolType and AtomID in [0, n_atom). the template index is set as AtomID.
+template <class Tpsys>
+void test_set_model_template(Tpsys &atom){
+    System::model_list.clear();
+    System::model_template.clear();
+    if(atom.getNumberOfParticleLocal() == 0) return;
+
+    const MolName mol_type = atom[0].getMolType();
+    System::model_list.push_back( std::make_pair(mol_type, PS::S64(1)) );
+    System::model_template.resize(1);
+    for(PS::S64 i=0; i<atom.getNumberOfParticleLocal(); ++i){
+        assert(atom[i].getMolType() == mol_type);
+        assert(atom[i].getAtomID()  == i);
+        atom[i].setTemplateIndex(i);
+        System::model_template[0].push_back(atom[i]);
+    }
+}
+
 template <class Tptcl, class Tdinfo, class Tforce,
           class Tdata>
 void execute_force_calc(Tptcl              &atom,
@@ -40,6 +71,8 @@ void execute_force_calc(Tptcl              &atom,
                         std::vector<Tdata> &force_ref ){
 
     //--- sync settings
+    test_set_coef_atom(atom);
+    test_set_model_template(atom);
     System::broadcast_profile(0);
     MODEL::coef_table.broadcast(0);
     System::InitDinfo(dinfo);
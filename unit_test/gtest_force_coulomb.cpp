@@ -148,8 +148,8 @@ void test_record(const Tptcl   &atom,
 
     logger.push_back( ForceData{ count,
                                  Normalize::realPos( buf.getPos() - PS::F32vec{0.5, 0.5, 0.5} ),
-                                 buf.getCharge()*buf.getPotCoulomb(),
-                                 buf.getCharge()*buf.getFieldCoulomb() } );
+                                 buf.getCharge()*(buf.getPotCoulomb()   + buf.getPotLongRange()),
+                                 buf.getCharge()*(buf.getFieldCoulomb() + buf.getFieldLongRange()) } );
 }
 
 
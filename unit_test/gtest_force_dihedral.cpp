@@ -198,7 +198,7 @@ TEST_F(TestForceDihedral, harmonic){
         atom.setNumberOfParticleLocal(TEST_DEFS::n_atom);
         for(PS::S32 i=0; i<TEST_DEFS::n_atom; ++i){
             atom[i].setAtomID(i);
-            atom[i].setMolID(i);
+            atom[i].setMolID(0);
             atom[i].setAtomType( AtomName::CT );
             atom[i].setMolType(  MolName::AA_propan_1_ol );
             atom[i].setCharge( 0.0 );
@@ -257,7 +257,7 @@ TEST_F(TestForceDihedral, OPLS3){
         atom.setNumberOfParticleLocal(TEST_DEFS::n_atom);
         for(PS::S32 i=0; i<TEST_DEFS::n_atom; ++i){
             atom[i].setAtomID(i);
-            atom[i].setMolID(i);
+            atom[i].setMolID(0);
             atom[i].setAtomType( AtomName::CT );
             atom[i].setMolType(  MolName::AA_propan_1_ol );
             atom[i].setCharge( 0.0 );
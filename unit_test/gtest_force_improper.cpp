@@ -199,7 +199,7 @@ TEST_F(TestForceImproper, harmonic){
         atom.setNumberOfParticleLocal(TEST_DEFS::n_atom);
         for(PS::S32 i=0; i<TEST_DEFS::n_atom; ++i){
             atom[i].setAtomID(i);
-            atom[i].setMolID(i);
+            atom[i].setMolID(0);
             atom[i].setAtomType( AtomName::CT );
             atom[i].setMolType(  MolName::AA_C6H5_CH3 );
             atom[i].setCharge( 0.0 );
@@ -261,7 +261,7 @@ TEST_F(TestForceImproper, OPLS3){
         atom.setNumberOfParticleLocal(TEST_DEFS::n_atom);
         for(PS::S32 i=0; i<TEST_DEFS::n_atom; ++i){
             atom[i].setAtomID(i);
-            atom[i].setMolID(i);
+            atom[i].setMolID(0);
             atom[i].setAtomType( AtomName::CT );
             atom[i].setMolType(  MolName::AA_C6H5_CH3 );
             atom[i].setCharge( 0.0 );
@@ -182,8 +182,8 @@ void test_record(const Tptcl              &atom,
                                 Normalize::realPos( buf.getPos() - PS::F32vec{0.5, 0.5, 0.5}),
                                 buf.getPotLJ(),
                                 buf.getForceLJ(),
-                                buf.getCharge()*buf.getPotCoulomb(),
-                                buf.getCharge()*buf.getFieldCoulomb()} );
+                                buf.getCharge()*(buf.getPotCoulomb()   + buf.getPotLongRange()),
+                                buf.getCharge()*(buf.getFieldCoulomb() + buf.getFieldLongRange())} );
 }
 
 template <class Tptcl, class Tdinfo, class Tforce,
@@ -195,6 +195,8 @@ void execute_force_calc_naive(Tptcl              &atom,
                               std::vector<Tdata> &force_ref ){
 
     //--- sync settings
+    test_set_coef_atom(atom);
+    test_set_model_template(atom);
     System::broadcast_profile(0);
     MODEL::coef_table.broadcast(0);
     System::InitDinfo(dinfo);
@@ -246,7 +248,7 @@ void setup_test_data(Tdinfo &dinfo,
         atom.setNumberOfParticleLocal(n_atom);
         for(PS::S32 i=0; i<n_atom; ++i){
             atom[i].setAtomID(i);
-            atom[i].setMolID(i);
+            atom[i].setMolID(0);
             atom[i].setAtomType( AtomName::Ow );
             atom[i].setMolType( MolName::AA_wat_SPC_Fw );
             atom[i].setCharge( -1.0*Unit::coef_coulomb );
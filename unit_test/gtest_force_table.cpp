@@ -0,0 +1,137 @@
+//=======================================================================================
+//  This is unit test of FORCE::ForceTable.
+//     module location: ./src/ff_inter_force_table.hpp
+//=======================================================================================
+
+#undef NDEBUG
+
+#include <cmath>
+#include <random>
+
+#include <gtest/gtest.h>
+
+#include <particle_simulator.hpp>
+#include <molecular_dynamics_ext.hpp>
+
+#include "ff_inter_force_table.hpp"
+
+
+namespace TEST_DEFS {
+    const PS::S32 n_div         = 8;
+    const PS::F64 r_min         = 0.5;
+    const PS::F64 r_cut_LJ      = 12.0;
+    const PS::F64 r_cut_coulomb = 7.5;
+
+    const PS::S32 n_sample = 100000;
+
+    const PS::F64 eps_LJ      = 1.e-8;
+    const PS::F64 eps_coulomb = 1.e-8;
+
+    const size_t size_limit = 64*1024;   // [byte], resident in L2 cache
+}
+
+//--- unit test definition, CANNOT use "_" in test/test_case name.
+TEST(ForceTable, init){
+    FORCE::ForceTable table;
+
+    EXPECT_FALSE(table.isEnable());
+    EXPECT_FALSE(table.update(0, TEST_DEFS::r_min, TEST_DEFS::r_cut_LJ, TEST_DEFS::r_cut_coulomb)) << "0: analytic kernel";
+    EXPECT_FALSE(table.isEnable());
+
+    EXPECT_THROW(table.update(16, TEST_DEFS::r_cut_LJ, 1.0, 1.0), std::invalid_argument) << "no range";
+    EXPECT_THROW(table.update(12, TEST_DEFS::r_min, TEST_DEFS::r_cut_LJ, TEST_DEFS::r_cut_coulomb), std::invalid_argument) << "not power of 2";
+
+    EXPECT_TRUE( table.update(TEST_DEFS::n_div, TEST_DEFS::r_min, TEST_DEFS::r_cut_LJ, TEST_DEFS::r_cut_coulomb));
+    EXPECT_TRUE( table.isEnable());
+    EXPECT_LT(   table.getMemorySize(), TEST_DEFS::size_limit);
+    EXPECT_FALSE(table.update(TEST_DEFS::n_div, TEST_DEFS::r_min, TEST_DEFS::r_cut_LJ, TEST_DEFS::r_cut_coulomb)) << "same setting";
+
+    //--- PM part is tabulated in xi = 2r/rc: the change of rc (box size in NPT) does not remake the table
+    EXPECT_FALSE(table.update(TEST_DEFS::n_div, TEST_DEFS::r_min, TEST_DEFS::r_cut_LJ, 0.8*TEST_DEFS::r_cut_coulomb)) << "box was shrunk";
+    EXPECT_FALSE(table.update(TEST_DEFS::n_div, TEST_DEFS::r_min, TEST_DEFS::r_cut_LJ, 1.1*TEST_DEFS::r_cut_coulomb)) << "box was expanded";
+    EXPECT_TRUE( table.update(TEST_DEFS::n_div, TEST_DEFS::r_min, TEST_DEFS::r_cut_LJ, 2.0*TEST_DEFS::r_cut_coulomb)) << "xi^2 range was exceeded";
+}
+
+TEST(ForceTable, accuracy){
+    FORCE::ForceTable table;
+    table.update(TEST_DEFS::n_div, TEST_DEFS::r_min, TEST_DEFS::r_cut_LJ, TEST_DEFS::r_cut_coulomb);
+
+    std::mt19937 mt;
+
+    //--- PM cut off length is changed without remaking table. r < r_min is evaluated by analytic function.
+    for(const PS::F64 r_cut_coulomb : {TEST_DEFS::r_cut_coulomb, 0.8*TEST_DEFS::r_cut_coulomb, 1.1*TEST_DEFS::r_cut_coulomb}){
+        EXPECT_FALSE(table.update(TEST_DEFS::n_div, TEST_DEFS::r_min, TEST_DEFS::r_cut_LJ, r_cut_coulomb));
+
+        std::uniform_real_distribution<> dist_r(0.5*TEST_DEFS::r_min, TEST_DEFS::r_cut_LJ);
+        for(PS::S32 i=0; i<TEST_DEFS::n_sample; ++i){
+            const PS::F64 r  = dist_r(mt);
+            const PS::F64 r2 = r*r;
+            const PS::F64 xi = 2.0*r/r_cut_coulomb;
+
+            PS::F64 tbl[4];
+            table.eval(r2, tbl);
+
+            EXPECT_NEAR(tbl[0]*std::pow(r, 12), 1.0, TEST_DEFS::eps_LJ) << " r= " << r;
+            EXPECT_NEAR(tbl[1]*std::pow(r,  6), 1.0, TEST_DEFS::eps_LJ) << " r= " << r;
+            EXPECT_NEAR(tbl[2]*r , FORCE::S2_pcut(xi), TEST_DEFS::eps_coulomb) << " r= " << r;
+            EXPECT_NEAR(tbl[3]*r2, FORCE::S2_fcut(xi), TEST_DEFS::eps_coulomb) << " r= " << r;
+        }
+    }
+}
+
+TEST(ForceTable, coulombDSF){
+    const PS::F64 alpha = 0.2;
+
+    FORCE::CoulombDSF dsf;
+    EXPECT_THROW(dsf.init(true, alpha, 0.0), std::invalid_argument) << "no cut off";
+    dsf.init(true, alpha, TEST_DEFS::r_cut_coulomb);
+
+    //--- potential and force are continuous to zero at cut off
+    const PS::F64 r_c = TEST_DEFS::r_cut_coulomb*(1.0 - 1.e-9);
+    PS::F64 f_c[2];
+    dsf.eval(r_c*r_c, 1.0/r_c, f_c);
+    EXPECT_NEAR(f_c[0], 0.0, 1.e-10);
+    EXPECT_NEAR(f_c[1], 0.0, 1.e-10);
+
+    //--- F(r) = -dV/dr
+    for(const PS::F64 r : {1.0, 2.5, 5.0, 7.0}){
+        const PS::F64 dr = 1.e-5;
+        PS::F64 f[2], f_p[2], f_m[2];
+        dsf.eval( r*r,           1.0/r,        f  );
+        dsf.eval((r+dr)*(r+dr),  1.0/(r+dr),   f_p);
+        dsf.eval((r-dr)*(r-dr),  1.0/(r-dr),   f_m);
+        EXPECT_NEAR(f[1]*r, -(f_p[0] - f_m[0])/(2.0*dr), 1.e-8) << " r= " << r;
+    }
+
+    //--- table
+    FORCE::ForceTable table;
+    table.update(TEST_DEFS::n_div, TEST_DEFS::r_min, TEST_DEFS::r_cut_LJ, TEST_DEFS::r_cut_coulomb);
+    EXPECT_TRUE( table.update(TEST_DEFS::n_div, TEST_DEFS::r_min, TEST_DEFS::r_cut_LJ, TEST_DEFS::r_cut_coulomb, dsf)) << "coulomb mode was changed";
+    EXPECT_FALSE(table.update(TEST_DEFS::n_div, TEST_DEFS::r_min, TEST_DEFS::r_cut_LJ, TEST_DEFS::r_cut_coulomb, dsf)) << "same setting";
+
+    std::mt19937 mt;
+    std::uniform_real_distribution<> dist_r(0.5*TEST_DEFS::r_min, TEST_DEFS::r_cut_LJ);
+
+    for(PS::S32 i=0; i<TEST_DEFS::n_sample; ++i){
+        const PS::F64 r  = dist_r(mt);
+        const PS::F64 r2 = r*r;
+
+        PS::F64 tbl[4], ref[2];
+        table.eval(r2, tbl);
+        dsf.eval(r2, 1.0/r, ref);
+
+        EXPECT_NEAR(tbl[2]*r , ref[0]*r , TEST_DEFS::eps_coulomb) << " r= " << r;
+        EXPECT_NEAR(tbl[3]*r2, ref[1]*r2, TEST_DEFS::eps_coulomb) << " r= " << r;
+    }
+}
+
+TEST(ForceTable, branchFreeCutoff){
+    for(PS::S32 i=0; i<=300; ++i){
+        const PS::F64 xi = 0.01*PS::F64(i);
+        EXPECT_DOUBLE_EQ(FORCE::S2_pcut_bf(xi), FORCE::S2_pcut(xi)) << " xi= " << xi;
+        EXPECT_DOUBLE_EQ(FORCE::S2_fcut_bf(xi), FORCE::S2_fcut(xi)) << " xi= " << xi;
+    }
+}
+
+
+#include "gtest_main.hpp"
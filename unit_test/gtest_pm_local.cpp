@@ -0,0 +1,202 @@
+//=======================================================================================
+//  This is unit test of FORCE::PM::LocalParticleMesh.
+//     module location: ./src/ff_pm_local.hpp
+//     reference: direct Ewald-like sum in k space of the same long-range kernel.
+//=======================================================================================
+
+#undef NDEBUG
+
+#include <cmath>
+#include <random>
+#include <vector>
+#include <complex>
+#include <algorithm>
+
+#include <gtest/gtest.h>
+
+#include <particle_simulator.hpp>
+#include <particle_mesh.hpp>
+#include <molecular_dynamics_ext.hpp>
+
+#include "unit.hpp"
+#include "ff_pm_local.hpp"
+
+
+namespace TEST_DEFS {
+    const PS::F64vec box{40.0, 40.0, 40.0};
+
+    const PS::S32 n_pair = 8;     // number of +/- charge pairs (neutral system)
+    const PS::S32 n_k    = 32;    // range of wave number for reference: [-n_k, n_k]
+
+    //--- discretization error of TSC mesh with r_cut = 3 mesh (relative to max value)
+    const PS::F64 eps_pot   = 5.e-2;
+    const PS::F64 eps_field = 1.e-2;
+    const PS::F64 eps_shift = 5.e-2;
+}
+
+//--- minimum particle class for PM interface
+class PM_Particle {
+public:
+    PS::F64vec pos;
+    PS::F64    charge;
+    PS::F64vec field;
+    PS::F64    pot;
+
+    PS::F64vec getPos() const { return this->pos; }
+    void       setPos(const PS::F64vec &pos_new){ this->pos = pos_new; }
+
+    PS::F64 getChargeParticleMesh() const { return this->charge; }
+    void    addFieldParticleMesh(const PS::F64vec &f){ this->field += f; }
+    void    addPotParticleMesh(  const PS::F64     p){ this->pot   += p; }
+};
+
+//--- Fourier transform of S2 shape (diameter a). same definition with LocalParticleMesh.
+PS::F64 S2_shape_k_ref(const PS::F64 k, const PS::F64 a){
+    const PS::F64 x = 0.5*k*a;
+    if(x < 1.e-3) return 1.0 - x*x/15.0;
+    return 12.0/(x*x*x*x)*(2.0 - 2.0*std::cos(x) - x*std::sin(x));
+}
+
+//--- phi_i = 4*pi/V * sum_k U(k)^2/k^2 * Re[ exp(ik*x_i) * S(k) ],  S(k) = sum_j q_j exp(-ik*x_j)
+void calc_pm_reference(const std::vector<PM_Particle> &ptcl,
+                             std::vector<PS::F64>     &pot_ref,
+                             std::vector<PS::F64vec>  &field_ref){
+
+    const PS::F64vec box     = Normalize::getBoxSize();
+    const PS::F64    vol_inv = 1.0/(box.x*box.y*box.z);
+    const PS::F64    r_cut   = Normalize::realCutOff( Normalize::normCutOff_PM() );
+
+    const size_t n = ptcl.size();
+    pot_ref.assign(n, 0.0);
+    field_ref.assign(n, PS::F64vec{0.0, 0.0, 0.0});
+
+    std::vector<PS::F64vec> pos_real(n);
+    for(size_t i=0; i<n; ++i){
+        pos_real[i] = Normalize::realPos( ptcl[i].getPos() );
+    }
+
+    for(PS::S32 nx=-TEST_DEFS::n_k; nx<=TEST_DEFS::n_k; ++nx){
+        for(PS::S32 ny=-TEST_DEFS::n_k; ny<=TEST_DEFS::n_k; ++ny){
+            for(PS::S32 nz=-TEST_DEFS::n_k; nz<=TEST_DEFS::n_k; ++nz){
+                if(nx == 0 && ny == 0 && nz == 0) continue;
+
+                const PS::F64vec k_vec{ 2.0*Unit::pi*nx/box.x,
+                                        2.0*Unit::pi*ny/box.y,
+                                        2.0*Unit::pi*nz/box.z };
+                const PS::F64 k2 = k_vec*k_vec;
+                const PS::F64 u  = S2_shape_k_ref(std::sqrt(k2), r_cut);
+                const PS::F64 g  = 4.0*Unit::pi*vol_inv*u*u/k2;
+
+                std::complex<PS::F64> s_k{0.0, 0.0};
+                for(size_t j=0; j<n; ++j){
+                    s_k += ptcl[j].charge*std::polar(1.0, -(k_vec*pos_real[j]));
+                }
+                for(size_t i=0; i<n; ++i){
+                    const std::complex<PS::F64> f = std::polar(1.0, k_vec*pos_real[i])*s_k;
+                    pot_ref[i]   += g*f.real();
+                    field_ref[i] += k_vec*(g*f.imag());   // E = -grad(phi)
+                }
+            }
+        }
+    }
+}
+
+//--- unit test definition, CANNOT use "_" in test/test_case name.
+TEST(LocalParticleMesh, ewaldReference){
+    Normalize::setBoxSize(TEST_DEFS::box);
+
+    PS::ParticleSystem<PM_Particle> atom;
+    atom.initialize();
+    atom.setNumberOfParticleLocal(2*TEST_DEFS::n_pair);
+
+    std::mt19937 mt;
+    std::uniform_real_distribution<> dist_pos(0.0, 1.0);
+    std::uniform_real_distribution<> dist_q(0.2, 1.0);
+    for(PS::S32 i=0; i<2*TEST_DEFS::n_pair; ++i){
+        if(i%2 == 0){
+            atom[i].charge = dist_q(mt);
+        } else {
+            atom[i].charge = -atom[i-1].charge;
+        }
+        atom[i].pos   = PS::F64vec{dist_pos(mt), dist_pos(mt), dist_pos(mt)};
+        atom[i].field = 0.0;
+        atom[i].pot   = 0.0;
+    }
+
+    FORCE::PM::LocalParticleMesh pm;
+    pm.setParticleParticleMesh(atom, true);
+    pm.calcMeshForceOnly();
+    pm.writeBackForce(atom);
+
+    std::vector<PM_Particle> ptcl;
+    for(PS::S32 i=0; i<atom.getNumberOfParticleLocal(); ++i){
+        ptcl.push_back(atom[i]);
+    }
+    std::vector<PS::F64>    pot_ref;
+    std::vector<PS::F64vec> field_ref;
+    calc_pm_reference(ptcl, pot_ref, field_ref);
+
+    PS::F64 pot_max   = 0.0;
+    PS::F64 field_max = 0.0;
+    for(size_t i=0; i<ptcl.size(); ++i){
+        pot_max   = std::max(pot_max,   std::abs(pot_ref[i]));
+        field_max = std::max(field_max, std::sqrt(field_ref[i]*field_ref[i]));
+    }
+    ASSERT_GT(pot_max,   0.0);
+    ASSERT_GT(field_max, 0.0);
+
+    for(size_t i=0; i<ptcl.size(); ++i){
+        const PS::F64vec diff = ptcl[i].field - field_ref[i];
+        EXPECT_NEAR(ptcl[i].pot, pot_ref[i], TEST_DEFS::eps_pot*pot_max) << " i= " << i;
+        EXPECT_NEAR(std::sqrt(diff*diff), 0.0, TEST_DEFS::eps_field*field_max) << " i= " << i
+                    << "\n   field = " << ptcl[i].field
+                    << "\n   ref   = " << field_ref[i];
+    }
+}
+
+TEST(LocalParticleMesh, translationInvariance){
+    Normalize::setBoxSize(TEST_DEFS::box);
+
+    PS::ParticleSystem<PM_Particle> atom;
+    atom.initialize();
+    atom.setNumberOfParticleLocal(2);
+
+    const PS::F64vec shift_list[3] = { PS::F64vec{0.0,   0.0,   0.0  },
+                                       PS::F64vec{0.013, 0.271, 0.402},
+                                       PS::F64vec{0.5,   0.117, 0.733} };
+    PS::F64vec field_0 = 0.0;
+
+    for(PS::S32 i_shift=0; i_shift<3; ++i_shift){
+        const PS::F64vec shift = shift_list[i_shift];
+        atom[0].pos = PS::F64vec{0.40, 0.50, 0.50} + shift;
+        atom[1].pos = PS::F64vec{0.55, 0.50, 0.50} + shift;
+        atom[0].charge =  1.0;
+        atom[1].charge = -1.0;
+        for(PS::S32 i=0; i<2; ++i){
+            atom[i].pos.x -= std::floor(atom[i].pos.x);   // into [0, 1)
+            atom[i].pos.y -= std::floor(atom[i].pos.y);
+            atom[i].pos.z -= std::floor(atom[i].pos.z);
+            atom[i].field = 0.0;
+            atom[i].pot   = 0.0;
+        }
+
+        FORCE::PM::LocalParticleMesh pm;
+        pm.setParticleParticleMesh(atom, true);
+        pm.calcMeshForceOnly();
+        pm.writeBackForce(atom);
+
+        //--- action-reaction
+        const PS::F64vec f_sum = atom[0].field*atom[0].charge + atom[1].field*atom[1].charge;
+        EXPECT_NEAR(std::sqrt(f_sum*f_sum), 0.0, TEST_DEFS::eps_shift*std::sqrt(atom[0].field*atom[0].field));
+
+        if(i_shift == 0){
+            field_0 = atom[0].field;
+        } else {
+            const PS::F64vec diff = atom[0].field - field_0;
+            EXPECT_NEAR(std::sqrt(diff*diff), 0.0, TEST_DEFS::eps_shift*std::sqrt(field_0*field_0)) << " shift= " << shift;
+        }
+    }
+}
+
+
+#include "gtest_main_mpi.hpp"
@@ -0,0 +1,146 @@
+//=======================================================================================
+//  This is unit test of the cell expansion in SF_TREE coulomb mode.
+//     module location: ./src/ff_tree_wrapper.hpp
+//=======================================================================================
+
+#undef NDEBUG
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <particle_simulator.hpp>
+#include <molecular_dynamics_ext.hpp>
+
+#include "ff_tree_wrapper.hpp"
+
+
+namespace TEST_DEFS {
+    const PS::F64 r_cut_PP   =  4.0;
+    const PS::F64 r_cut_tree = 12.0;
+
+    const PS::F64 cell_size = 1.0;    // half size of the cell
+    const PS::S32 n_ptcl    = 32;
+
+    const PS::F64vec box = PS::F64vec{1.0, 1.0, 1.0};
+}
+
+//--- EPI and EPJ for direct sum
+class EP_test {
+public:
+    PS::F64vec pos;
+    PS::F64    charge;
+
+    PS::F64vec getPos()     const { return this->pos;    }
+    PS::F64    getCharge()  const { return this->charge; }
+    PS::F64    getRSearch() const { return TEST_DEFS::r_cut_tree; }
+};
+
+class TreeCell :
+    public ::testing::Test {
+protected:
+    std::vector<EP_test>             epj;
+    FORCE::TREE::SPJMultipoleCutoff spj;
+    PS::F64                          q_abs;
+
+    FORCE::TREE::CalcForceSmoothEP func_ep;
+    FORCE::TREE::CalcForceSmoothSP func_sp;
+
+    virtual void SetUp(){
+        std::mt19937 mt;
+        std::uniform_real_distribution<PS::F64> dist_pos(-TEST_DEFS::cell_size, TEST_DEFS::cell_size);
+        std::uniform_real_distribution<PS::F64> dist_q(-1.0, 1.0);
+
+        this->epj.resize(TEST_DEFS::n_ptcl);
+        this->q_abs = 0.0;
+        for(auto& ep : this->epj){
+            ep.pos    = PS::F64vec{ dist_pos(mt), dist_pos(mt), dist_pos(mt) };
+            ep.charge = dist_q(mt);
+            this->q_abs += std::abs(ep.charge);
+        }
+
+        FORCE::TREE::MomentMultipoleCutoff mom;
+        for(const auto& ep : this->epj){
+            mom.accumulateAtLeaf(ep);
+        }
+        mom.set();
+        for(const auto& ep : this->epj){
+            mom.accumulateAtLeaf2(ep);
+        }
+        this->spj.copyFromMoment(mom);
+
+        this->func_ep.box          = TEST_DEFS::box;
+        this->func_ep.r_cut_PP_inv = 1.0/TEST_DEFS::r_cut_PP;
+        this->func_ep.r_cut_tree   = TEST_DEFS::r_cut_tree;
+        this->func_sp.box          = TEST_DEFS::box;
+        this->func_sp.r_cut_PP_inv = 1.0/TEST_DEFS::r_cut_PP;
+        this->func_sp.r_cut_tree   = TEST_DEFS::r_cut_tree;
+    }
+
+    //--- target on x axis at distance "d" from the expansion center
+    void calc(const PS::F64                            d,
+                    FORCE::TREE::Result_TreeMultipole &ref,
+                    FORCE::TREE::Result_TreeMultipole &tree){
+        EP_test epi;
+        epi.pos    = this->spj.pos + PS::F64vec{d, 0.0, 0.0};
+        epi.charge = 1.0;
+
+        ref.clear();
+        tree.clear();
+        this->func_ep(&epi, 1, this->epj.data(), static_cast<PS::S32>(this->epj.size()), &ref);
+        this->func_sp(&epi, 1, &(this->spj), 1, &tree);
+    }
+};
+
+//--- unit test definition, CANNOT use "_" in test/test_case name.
+TEST_F(TreeCell, inside){
+    //--- truncation of quadrupole expansion: O((a/d)^3)
+    const PS::F64 a = std::sqrt(3.0)*TEST_DEFS::cell_size;
+    for(const PS::F64 d : {6.0, 8.0, 10.0}){
+        FORCE::TREE::Result_TreeMultipole ref, tree;
+        this->calc(d, ref, tree);
+
+        const PS::F64 eps         = (a/d)*(a/d)*(a/d);
+        const PS::F64 scale_pot   = this->q_abs/d;
+        const PS::F64 scale_field = this->q_abs/(d*d);
+        EXPECT_NEAR(tree.getPot(),       ref.getPot(),       eps*scale_pot  ) << " d= " << d;
+        EXPECT_NEAR(tree.getField().x,   ref.getField().x,   eps*scale_field) << " d= " << d;
+        EXPECT_NEAR(tree.getField().y,   ref.getField().y,   eps*scale_field) << " d= " << d;
+        EXPECT_NEAR(tree.getField().z,   ref.getField().z,   eps*scale_field) << " d= " << d;
+        EXPECT_NEAR(tree.getVirial().x,  ref.getVirial().x,  eps*scale_pot  ) << " d= " << d;
+        EXPECT_NEAR(tree.getVirial().y,  ref.getVirial().y,  eps*scale_pot  ) << " d= " << d;
+        EXPECT_NEAR(tree.getVirial().z,  ref.getVirial().z,  eps*scale_pot  ) << " d= " << d;
+    }
+}
+
+TEST_F(TreeCell, outside){
+    //--- the cell is entirely outside of R
+    const PS::F64 d = TEST_DEFS::r_cut_tree + 2.0*TEST_DEFS::cell_size;
+
+    FORCE::TREE::Result_TreeMultipole ref, tree;
+    this->calc(d, ref, tree);
+
+    EXPECT_EQ(ref.getPot(),  0.0);
+    EXPECT_EQ(tree.getPot(), 0.0);
+    EXPECT_EQ(tree.getField().x, 0.0);
+}
+
+TEST_F(TreeCell, straddle){
+    //--- the expansion center is outside of R, but a part of the cell is inside.
+    //    the error is bounded by the continuation of g beyond R: sum(|q|)*a^2/R^3.
+    const PS::F64 R = TEST_DEFS::r_cut_tree;
+    const PS::F64 a = std::sqrt(3.0)*TEST_DEFS::cell_size;
+    for(const PS::F64 d : {R - 0.5*TEST_DEFS::cell_size, R + 0.5*TEST_DEFS::cell_size}){
+        FORCE::TREE::Result_TreeMultipole ref, tree;
+        this->calc(d, ref, tree);
+
+        ASSERT_NE(ref.getPot(), 0.0) << " d= " << d;
+        EXPECT_NEAR(tree.getPot(),     ref.getPot(),     this->q_abs*a*a/(R*R*R)) << " d= " << d;
+        EXPECT_NEAR(tree.getField().x, ref.getField().x, this->q_abs*a/(R*R*R)  ) << " d= " << d;
+    }
+}
+
+
+#include "gtest_main.hpp"
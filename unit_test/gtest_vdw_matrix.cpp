@@ -0,0 +1,119 @@
+//=======================================================================================
+//  This is unit test of LJ type index & coefficient matrix in MODEL::coef_table.
+//    (and the flag for 3-site water kernel)
+//     module location: ./src/md_coef_table.hpp
+//=======================================================================================
+
+#undef NDEBUG
+
+#include <cmath>
+
+#include <gtest/gtest.h>
+
+#include <particle_simulator.hpp>
+#include <molecular_dynamics_ext.hpp>
+
+#include "md_coef_table.hpp"
+
+
+namespace TEST_DEFS {
+    const MODEL::KeyAtom key_Ar{MolName::AA_Ar        , AtomName::Ar};
+    const MODEL::KeyAtom key_Ow{MolName::AA_wat_SPC_Fw, AtomName::Ow};
+
+    //--- real values
+    const PS::F64 d_Ar = 0.24;
+    const PS::F64 r_Ar = 3.81637;
+    const PS::F64 d_Ow = 0.1554253;
+    const PS::F64 r_Ow = 3.165492;
+
+    const PS::F64 eps = 1.e-6;
+}
+
+void test_coef_setting(){
+    MODEL::coef_table.clear();
+    MODEL::coef_table.atom[TEST_DEFS::key_Ar] = MODEL::CoefAtom{ 1.0, 0.0, PS::F32(std::sqrt(TEST_DEFS::d_Ar)), PS::F32(0.5*TEST_DEFS::r_Ar) };
+    MODEL::coef_table.atom[TEST_DEFS::key_Ow] = MODEL::CoefAtom{ 1.0, 0.0, PS::F32(std::sqrt(TEST_DEFS::d_Ow)), PS::F32(0.5*TEST_DEFS::r_Ow) };
+}
+
+void check_coef(const MODEL::CoefLJ &coef, const PS::F64 d, const PS::F64 r){
+    const PS::F64 r6 = std::pow(r, 6);
+    EXPECT_NEAR(coef.c6 /(d*r6)   , 1.0, TEST_DEFS::eps);
+    EXPECT_NEAR(coef.c12/(d*r6*r6), 1.0, TEST_DEFS::eps);
+}
+
+//--- unit test definition, CANNOT use "_" in test/test_case name.
+TEST(VDWMatrix, typeIndex){
+    test_coef_setting();
+    MODEL::coef_table.make_vdw_matrix();
+
+    EXPECT_EQ(MODEL::coef_table.n_vdw_type, 2);
+    EXPECT_EQ(MODEL::coef_table.vdw_matrix.size(), 4);
+
+    const PS::S32 type_Ar = MODEL::coef_table.getVDWType(MolName::AA_Ar        , AtomName::Ar);
+    const PS::S32 type_Ow = MODEL::coef_table.getVDWType(MolName::AA_wat_SPC_Fw, AtomName::Ow);
+    EXPECT_NE(type_Ar, type_Ow);
+    EXPECT_THROW(MODEL::coef_table.getVDWType(MolName::AA_wat_SPC_Fw, AtomName::Hw), std::out_of_range);
+}
+
+TEST(VDWMatrix, LorentzBerthelot){
+    test_coef_setting();
+    MODEL::coef_table.make_vdw_matrix();
+
+    const PS::S32 type_Ar = MODEL::coef_table.getVDWType(MolName::AA_Ar        , AtomName::Ar);
+    const PS::S32 type_Ow = MODEL::coef_table.getVDWType(MolName::AA_wat_SPC_Fw, AtomName::Ow);
+
+    check_coef(MODEL::coef_table.getCoefLJ(type_Ar, type_Ar), TEST_DEFS::d_Ar, TEST_DEFS::r_Ar);
+    check_coef(MODEL::coef_table.getCoefLJ(type_Ow, type_Ow), TEST_DEFS::d_Ow, TEST_DEFS::r_Ow);
+
+    const PS::F64 d_mix = std::sqrt(TEST_DEFS::d_Ar*TEST_DEFS::d_Ow);
+    const PS::F64 r_mix = 0.5*(TEST_DEFS::r_Ar + TEST_DEFS::r_Ow);
+    check_coef(MODEL::coef_table.getCoefLJ(type_Ar, type_Ow), d_mix, r_mix);
+    check_coef(MODEL::coef_table.getCoefLJ(type_Ow, type_Ar), d_mix, r_mix);
+}
+
+TEST(VDWMatrix, pairOverride){
+    test_coef_setting();
+
+    const PS::F64 d_pair = 0.19;
+    const PS::F64 r_pair = 3.5;
+    MODEL::coef_table.vdw_pair[ MODEL::KeyVDWPair{MolName::AA_wat_SPC_Fw, AtomName::Ow,
+                                                  MolName::AA_Ar        , AtomName::Ar} ] = MODEL::CoefVDWPair{ PS::F32(d_pair), PS::F32(r_pair) };
+    MODEL::coef_table.make_vdw_matrix();
+
+    const PS::S32 type_Ar = MODEL::coef_table.getVDWType(MolName::AA_Ar        , AtomName::Ar);
+    const PS::S32 type_Ow = MODEL::coef_table.getVDWType(MolName::AA_wat_SPC_Fw, AtomName::Ow);
+
+    check_coef(MODEL::coef_table.getCoefLJ(type_Ar, type_Ow), d_pair, r_pair);
+    check_coef(MODEL::coef_table.getCoefLJ(type_Ow, type_Ar), d_pair, r_pair);
+    check_coef(MODEL::coef_table.getCoefLJ(type_Ar, type_Ar), TEST_DEFS::d_Ar, TEST_DEFS::r_Ar);
+}
+
+TEST(VDWMatrix, waterKernelFlag){
+    const MolName wat = MolName::AA_wat_SPC_Fw;
+
+    auto set_water = [&](const PS::F64 d_Hw, const PS::F32 scale_13){
+        test_coef_setting();
+        MODEL::coef_table.atom[ MODEL::KeyAtom{wat, AtomName::Hw} ] = MODEL::CoefAtom{ 1.0, 0.0, PS::F32(d_Hw), 0.5 };
+        MODEL::coef_table.mol_atom[wat]     = { AtomName::Ow, AtomName::Hw, AtomName::Hw };
+        MODEL::coef_table.mask_scaling[wat] = { MD_DEFS::IntraMask{-1, 0.0     , 0.0     },
+                                                MD_DEFS::IntraMask{-1, scale_13, scale_13},
+                                                MD_DEFS::IntraMask{-1, 0.5     , 0.5     } };
+        MODEL::coef_table.make_vdw_matrix();
+        MODEL::coef_table.make_water_kernel_flag();
+    };
+
+    set_water(0.0, 0.0);
+    EXPECT_TRUE(  MODEL::coef_table.isWaterKernel(wat)           );
+    EXPECT_FALSE( MODEL::coef_table.isWaterKernel(MolName::AA_Ar) );
+
+    //--- 1-3 pair is not excluded
+    set_water(0.0, 0.5);
+    EXPECT_FALSE( MODEL::coef_table.isWaterKernel(wat) );
+
+    //--- LJ on the 2nd site
+    set_water(0.1, 0.0);
+    EXPECT_FALSE( MODEL::coef_table.isWaterKernel(wat) );
+}
+
+
+#include "gtest_main.hpp"
@@ -346,12 +346,16 @@ int main(int argc, char *argv[]) {
             IntraPair::IntraMaskMaker<  MD_DEFS::ID_type, GetBond> intra_mask_maker;
             IntraPair::AngleListMaker<  MD_DEFS::ID_type, GetBond> angle_list_maker;
             IntraPair::TorsionListMaker<MD_DEFS::ID_type, GetBond> torsion_list_maker;
-            for(PS::S64 i=0; i<test_atom.getNumberOfParticleLocal(); ++i){
-                test_atom[i].clear_intra_list();
-                intra_mask_maker(  test_atom[i], test_tree, MODEL::coef_table.mask_scaling.at(model), test_atom[i].mask_list());
-                angle_list_maker(  test_atom[i], test_tree, test_atom[i].angle_list());
-                torsion_list_maker(test_atom[i], test_tree, test_atom[i].dihedral_list(), test_atom[i].improper_list());
-            }
+            auto maker = [&](const PS::S32               i,
+                                   MD_DEFS::MaskList    &mask_list,
+                                   MD_DEFS::AngleList   &angle_list,
+                                   MD_DEFS::TorsionList &dihedral_list,
+                                   MD_DEFS::TorsionList &improper_list){
+                intra_mask_maker(  test_atom[i], test_tree, MODEL::coef_table.mask_scaling.at(model), mask_list);
+                angle_list_maker(  test_atom[i], test_tree, angle_list);
+                torsion_list_maker(test_atom[i], test_tree, dihedral_list, improper_list);
+            };
+            Atom_FP::rebuild_intra_list_table(test_atom, maker);
 
             //--- check intraforce coef table.
             checkIntraForceParam(test_atom, test_tree);